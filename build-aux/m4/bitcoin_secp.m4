@@ -14,6 +14,56 @@ AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
 AC_MSG_RESULT([$has_64bit_asm])
 ])
 
+dnl Checks whether the assembler accepts the BMI2/ADX instructions and the CPU
+dnl can be queried for them at runtime.
+AC_DEFUN([SECP_ADX_ASM_CHECK],[
+AC_MSG_CHECKING(for x86_64 BMI2/ADX assembly availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <stdint.h>]],[[
+  uint64_t a = 11, lo, hi;
+  if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx")) {
+    __asm__ __volatile__("mulxq %%rsi,%0,%1; adcxq %0,%1; adoxq %0,%1" : "=&r"(lo), "=&r"(hi) : "d"(a), "S"(a) : "cc");
+  }
+  ]])],[has_adx_asm=yes],[has_adx_asm=no])
+AC_MSG_RESULT([$has_adx_asm])
+])
+
+dnl Checks whether functions can be compiled for AVX2 with a target attribute
+dnl and the CPU can be queried for it at runtime.
+AC_DEFUN([SECP_AVX2_CHECK],[
+AC_MSG_CHECKING(for AVX2 target attribute availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <immintrin.h>
+  __attribute__((target("avx2"))) static void add4(long long *r, const long long *a) {
+    _mm256_storeu_si256((__m256i *)r, _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)r), _mm256_loadu_si256((const __m256i *)a)));
+  }]],[[
+  long long r[4] = {0}, a[4] = {0};
+  if (__builtin_cpu_supports("avx2")) {
+    add4(r, a);
+  }
+  ]])],[has_avx2=yes],[has_avx2=no])
+AC_MSG_RESULT([$has_avx2])
+])
+
+dnl Checks whether functions can be compiled for the SHA extensions with a target
+dnl attribute and the CPU can be queried for them at runtime.
+AC_DEFUN([SECP_SHANI_CHECK],[
+AC_MSG_CHECKING(for SHA extensions target attribute availability)
+AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+  #include <immintrin.h>
+  __attribute__((target("sha,sse4.1"))) static void rnds2(unsigned int *s) {
+    __m128i a = _mm_loadu_si128((const __m128i *)s);
+    a = _mm_sha256rnds2_epu32(a, _mm_sha256msg2_epu32(a, _mm_sha256msg1_epu32(a, a)), a);
+    _mm_storeu_si128((__m128i *)s, _mm_blend_epi16(_mm_shuffle_epi8(a, a), a, 0xF0));
+  }]],[[
+  unsigned int s[4] = {0};
+  if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+    rnds2(s);
+  }
+  ]])],[has_shani=yes],[has_shani=no])
+AC_MSG_RESULT([$has_shani])
+])
+
 dnl
 AC_DEFUN([SECP_OPENSSL_CHECK],[
   has_libcrypto=no
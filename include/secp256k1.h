@@ -46,15 +46,38 @@ typedef struct secp256k1_context_struct secp256k1_context;
  *
  *  The purpose of this structure is to replace dynamic memory allocations,
  *  because we target architectures where this may not be available. It is
- *  essentially a resizable (within specified parameters) block of bytes,
- *  which is initially created either by memory allocation or TODO as a pointer
- *  into some fixed rewritable space.
+ *  an arena that grows in chunks, up to the budget it was created with, as
+ *  functions using it need more memory. The chunks are kept until the scratch
+ *  space is destroyed, so a scratch space that is reused for operations of
+ *  the same size only allocates memory the first time.
  *
  *  Unlike the context object, this cannot safely be shared between threads
- *  without additional synchronization logic.
+ *  without additional synchronization logic. Threads verifying in parallel
+ *  should each use their own scratch space. Tasks run by a context's task
+ *  runner never access the scratch space themselves, so a single one suffices
+ *  for a call that splits its work over several tasks.
  */
 typedef struct secp256k1_scratch_space_struct secp256k1_scratch_space;
 
+/** Opaque data structure that accumulates a multi-multiplication
+ *
+ *  It collects (scalar, point) pairs that are added to it in chunks, which
+ *  may come from a stream or from disk, and computes the sum of their
+ *  products. Its memory use is bounded by the scratch space it was created
+ *  with, so the number of pairs is not.
+ */
+typedef struct secp256k1_multiexp_struct secp256k1_multiexp;
+
+/** Opaque data structure that holds a secret key prepared for signing many
+ *  messages.
+ *
+ *  It caches the parsed secret key, its public key and the part of the
+ *  RFC6979 nonce derivation that only depends on the secret key. It contains
+ *  secret data and must be destroyed with secp256k1_signing_key_destroy,
+ *  which clears it.
+ */
+typedef struct secp256k1_signing_key_struct secp256k1_signing_key;
+
 /** Opaque data structure that holds a parsed and valid public key.
  *
  *  The exact representation of data inside is implementation defined and not
@@ -198,6 +221,12 @@ SECP256K1_API secp256k1_context* secp256k1_context_create(
 ) SECP256K1_WARN_UNUSED_RESULT;
 
 /** Copies a secp256k1 context object.
+ *
+ *  The precomputed tables are shared with the original context rather than
+ *  copied where the platform supports it, so cloning is cheap and a clone per
+ *  thread costs little memory.
+ *  The clone has its own randomization state (see secp256k1_context_randomize),
+ *  and either context may be destroyed first.
  *
  *  Returns: a newly created context object.
  *  Args:    ctx: an existing context to copy (cannot be NULL)
@@ -278,11 +307,129 @@ SECP256K1_API void secp256k1_context_set_error_callback(
     const void* data
 ) SECP256K1_ARG_NONNULL(1);
 
+/** A pointer to a function that runs independent tasks on behalf of the library.
+ *
+ *  It must call task(task_data[i]) exactly once for every 0 <= i < n_tasks,
+ *  in any order and on any threads, and may only return after all of these
+ *  calls have finished. The tasks do not call back into the library's API and
+ *  do not share mutable state, so they need no synchronization.
+ *
+ *  Returns: 1 if the tasks were run, 0 if they were not (in which case the
+ *           library runs them itself on the calling thread).
+ *  In:      task:      the function to call for every task.
+ *           task_data: array of n_tasks opaque pointers, one per task.
+ *           n_tasks:   the number of tasks.
+ *           data:      the opaque pointer given to secp256k1_context_set_task_runner.
+ */
+typedef int (*secp256k1_task_runner_function)(
+    void (*task)(void *task_data),
+    void * const *task_data,
+    size_t n_tasks,
+    void *data
+);
+
+/** Set a task runner that is used to split large multi-multiplications (such
+ *  as batch verification of bulletproofs, Schnorr and aggsig signatures) over
+ *  several threads. The library never creates threads by itself.
+ *
+ *  The points of every batch are split into at most max_tasks ranges whose
+ *  partial sums are computed by separate tasks and added up afterwards. Small
+ *  batches are not split. Splitting requires additional scratch space for
+ *  every task, so the scratch space passed to the verification functions
+ *  should be somewhat larger than for single-threaded use; batches are made
+ *  smaller if necessary.
+ *
+ *  The task runner is copied by secp256k1_context_clone.
+ *
+ *  Args: ctx:       an existing context object (cannot be NULL)
+ *  In:   fun:       a pointer to a function that runs tasks, or NULL to run
+ *                   everything on the calling thread.
+ *        max_tasks: the maximum number of tasks a computation is split into,
+ *                   typically the number of available threads.
+ *        data:      the opaque pointer to pass to fun above.
+ */
+SECP256K1_API void secp256k1_context_set_task_runner(
+    secp256k1_context* ctx,
+    secp256k1_task_runner_function fun,
+    size_t max_tasks,
+    void* data
+) SECP256K1_ARG_NONNULL(1);
+
+/** Size of the serialized tuning parameters of a context, in bytes */
+#define SECP256K1_CONTEXT_TUNING_SIZE 128
+
+/** Measure which multi-multiplication algorithm and parameters are fastest on
+ *  this machine for a given number of points, and use the result in all later
+ *  multi-multiplications with this context (such as batch verification of
+ *  bulletproofs, Schnorr and aggsig signatures). Without calibration built-in
+ *  defaults are used, which were measured on a single machine.
+ *
+ *  Calibration runs on the calling thread and takes about a second, plus the
+ *  time of a few dozen multi-multiplications of max_points points. Only
+ *  numbers of points up to max_points are measured; the defaults are kept
+ *  for larger ones. The result is copied by secp256k1_context_clone, and can
+ *  be stored with secp256k1_context_serialize_tuning so that it does not
+ *  have to be measured again on every start.
+ *
+ *  Returns: 1 on success, 0 if no clock is available or the scratch space is
+ *           too small for a single point, in which case the context is
+ *           unchanged.
+ *  Args: ctx:        an existing context object, initialized for verification
+ *                    (cannot be NULL)
+ *        scratch:    scratch space used for the measurements. max_points is
+ *                    reduced if it is too small (cannot be NULL)
+ *  In:   max_points: the largest number of points to measure, e.g. the largest
+ *                    batch that is verified at once, or about 100000 to cover
+ *                    all parameters.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_context_calibrate(
+    secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    size_t max_points
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Serialize the tuning parameters of a context, as set by
+ *  secp256k1_context_calibrate.
+ *
+ *  Returns: 1 on success, 0 if the output buffer was too small
+ *  Args:    ctx:       an existing context object (cannot be NULL)
+ *  Out:     output:    pointer to a buffer of SECP256K1_CONTEXT_TUNING_SIZE bytes
+ *                      (cannot be NULL)
+ *  In/Out:  outputlen: pointer to the length of the output buffer, which is
+ *                      overwritten with the number of bytes written (cannot be NULL)
+ */
+SECP256K1_API int secp256k1_context_serialize_tuning(
+    const secp256k1_context* ctx,
+    unsigned char *output,
+    size_t *outputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Load tuning parameters written by secp256k1_context_serialize_tuning into
+ *  a context.
+ *
+ *  Returns: 1 on success, 0 if the input is malformed or was written by a
+ *           build of the library with different parameters, in which case
+ *           the context is unchanged.
+ *  Args:    ctx:      an existing context object (cannot be NULL)
+ *  In:      input:    the serialized tuning parameters (cannot be NULL)
+ *           inputlen: the length of input in bytes
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_context_parse_tuning(
+    secp256k1_context* ctx,
+    const unsigned char *input,
+    size_t inputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
 /** Create a secp256k1 scratch space object.
+ *
+ *  No memory other than the object itself is allocated until it is used. The
+ *  functions that take a scratch space have companions returning the budget
+ *  they need, e.g. secp256k1_schnorrsig_verify_batch_scratch_size.
  *
  *  Returns: a newly created scratch space.
  *  Args: ctx:  an existing context object (cannot be NULL)
- *  In:   max_size: maximum amount of memory to allocate
+ *  In:   max_size: maximum amount of memory in use by the scratch space at any
+ *                  time, not counting a small bookkeeping overhead
  */
 SECP256K1_API SECP256K1_WARN_UNUSED_RESULT secp256k1_scratch_space* secp256k1_scratch_space_create(
     const secp256k1_context* ctx,
@@ -298,6 +445,19 @@ SECP256K1_API void secp256k1_scratch_space_destroy(
     secp256k1_scratch_space* scratch
 );
 
+/** Get the largest amount of memory a scratch space has had in use so far.
+ *
+ *  This is measured in the same units as the max_size passed to
+ *  secp256k1_scratch_space_create, so a scratch space created with the
+ *  returned value as its budget is large enough for the operations done so far.
+ *
+ *  Returns: the high-water mark in bytes.
+ *  Args:   scratch: an existing scratch space (cannot be NULL)
+ */
+SECP256K1_API size_t secp256k1_scratch_space_high_water_mark(
+    const secp256k1_scratch_space* scratch
+) SECP256K1_ARG_NONNULL(1);
+
 /** Parse a variable-length public key into the pubkey object.
  *
  *  Returns: 1 if the public key was fully valid.
@@ -523,6 +683,51 @@ SECP256K1_API int secp256k1_ecdsa_sign(
     const void *ndata
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Prepare a secret key for signing many messages.
+ *
+ *  Returns: a newly created signing key, or NULL if the secret key was invalid
+ *           or memory could not be allocated.
+ *  Args:    ctx:    pointer to a context object, initialized for signing (cannot be NULL)
+ *  In:      seckey: pointer to a 32-byte secret key (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT secp256k1_signing_key* secp256k1_signing_key_create(
+    const secp256k1_context* ctx,
+    const unsigned char *seckey
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Clear and destroy a signing key.
+ *
+ *  Does nothing if key is NULL.
+ *  Args:    key: the signing key, which may not be used afterwards
+ */
+SECP256K1_API void secp256k1_signing_key_destroy(
+    secp256k1_signing_key* key
+);
+
+/** Create an ECDSA signature with a prepared secret key.
+ *
+ *  Produces the same signature as secp256k1_ecdsa_sign with the key's secret
+ *  key. With the default nonce function, the nonce derivation skips the part
+ *  that was precomputed for the key.
+ *
+ *  Returns: 1: signature created
+ *           0: the nonce generation function failed.
+ *  Args:    ctx:    pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:     sig:    pointer to an array where the signature will be placed (cannot be NULL)
+ *  In:      msg32:  the 32-byte message hash being signed (cannot be NULL)
+ *           key:    the signing key (cannot be NULL)
+ *           noncefp:pointer to a nonce generation function. If NULL, secp256k1_nonce_function_default is used
+ *           ndata:  pointer to arbitrary data used by the nonce generation function (can be NULL)
+ */
+SECP256K1_API int secp256k1_ecdsa_sign_with_key(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature *sig,
+    const unsigned char *msg32,
+    const secp256k1_signing_key *key,
+    secp256k1_nonce_function noncefp,
+    const void *ndata
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
 /** Verify an ECDSA secret key.
  *
  *  Returns: 1: secret key is valid
@@ -689,6 +894,105 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ec_privkey_tweak_neg(
     unsigned char *seckey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
 
+/** Create a multi-multiplication accumulator.
+ *
+ *  The pairs added to it are buffered in the scratch space and reduced to a
+ *  partial sum, in a single multi-multiplication, whenever the buffer is full.
+ *  The buffer takes as much of the scratch space as leaves room for that, so
+ *  larger scratch spaces give fewer and more efficient reductions. The scratch
+ *  space cannot be used for anything else until the accumulator is finalized
+ *  or destroyed.
+ *
+ *  Returns: a newly created accumulator, or NULL if the scratch space is too
+ *           small or memory could not be allocated.
+ *  Args:    ctx:     pointer to a context object initialized for verification
+ *                    (cannot be NULL)
+ *           scratch: scratch space to use (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT secp256k1_multiexp* secp256k1_multiexp_create(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Add a chunk of (scalar, point) pairs to a multi-multiplication.
+ *
+ *  Returns: 1 if the pairs were added, 0 if a scalar was out of range or the
+ *           accumulator has failed before. Once this returns 0, finalizing
+ *           the accumulator fails too.
+ *  Args:    ctx:      pointer to the context object the accumulator was
+ *                     created with (cannot be NULL)
+ *  In/Out:  multiexp: the accumulator (cannot be NULL)
+ *  In:      scalars:  n 32-byte big-endian scalars, one after the other
+ *                     (cannot be NULL unless n is 0)
+ *           points:   array of n points (cannot be NULL unless n is 0)
+ *           n:        number of pairs
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_multiexp_add(
+    const secp256k1_context* ctx,
+    secp256k1_multiexp* multiexp,
+    const unsigned char *scalars,
+    const secp256k1_pubkey *points,
+    size_t n
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Add a multiple of the generator to a multi-multiplication.
+ *
+ *  This is cheaper than adding the generator as a point. The scalars given to
+ *  all calls are summed up and multiplied by the generator once.
+ *
+ *  Returns: 1 if the scalar was added, 0 if it was out of range, in which case
+ *           the accumulator fails as for secp256k1_multiexp_add.
+ *  Args:    ctx:      pointer to the context object the accumulator was
+ *                     created with (cannot be NULL)
+ *  In/Out:  multiexp: the accumulator (cannot be NULL)
+ *  In:      scalar32: 32-byte big-endian scalar (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_multiexp_add_generator(
+    const secp256k1_context* ctx,
+    secp256k1_multiexp* multiexp,
+    const unsigned char *scalar32
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Compute the sum accumulated by a multi-multiplication and destroy it.
+ *
+ *  Returns: 1 if the sum is a valid point, 0 if it is the point at infinity
+ *           or the accumulator has failed.
+ *  Args:    ctx:      pointer to the context object the accumulator was
+ *                     created with (cannot be NULL)
+ *           multiexp: the accumulator, which may not be used afterwards
+ *                     (cannot be NULL)
+ *  Out:     result:   the sum if 1 is returned (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_multiexp_finalize(
+    const secp256k1_context* ctx,
+    secp256k1_multiexp* multiexp,
+    secp256k1_pubkey *result
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Check whether the sum accumulated by a multi-multiplication is the point
+ *  at infinity, as batch verification equations require, and destroy it.
+ *
+ *  Returns: 1 if the sum is the point at infinity, 0 if it is not or the
+ *           accumulator has failed.
+ *  Args:    ctx:      pointer to the context object the accumulator was
+ *                     created with (cannot be NULL)
+ *           multiexp: the accumulator, which may not be used afterwards
+ *                     (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_multiexp_finalize_is_infinity(
+    const secp256k1_context* ctx,
+    secp256k1_multiexp* multiexp
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Destroy a multi-multiplication accumulator without computing its sum.
+ *
+ *  Does nothing if multiexp is NULL.
+ *  Args:    multiexp: the accumulator, which may not be used afterwards
+ */
+SECP256K1_API void secp256k1_multiexp_destroy(
+    secp256k1_multiexp* multiexp
+);
+
 #ifdef __cplusplus
 }
 #endif
@@ -124,6 +124,32 @@ SECP256K1_API int secp256k1_aggsig_sign_single(
     const unsigned char* seed)
 SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(10) SECP256K1_WARN_UNUSED_RESULT;
 
+/** Generate a single-signer signature (or partial sig) with a prepared secret key
+ *
+ *  Produces the same signature as secp256k1_aggsig_sign_single with the key's
+ *  secret key.
+ *
+ *  Returns: 1 on success, 0 on failure
+ *  Args:    ctx: an existing context object, initialized for signing (cannot be NULL)
+ *  Out:     sig64: the completed signature (cannot be NULL)
+ *  In:      msg32: the message to sign (cannot be NULL)
+ *           key: the signing key (cannot be NULL)
+ *           secnonce32, extra32, pubnonce_for_e, pubnonce_total, pubkey_for_e, seed:
+ *               as for secp256k1_aggsig_sign_single
+ */
+SECP256K1_API int secp256k1_aggsig_sign_single_with_key(
+    const secp256k1_context* ctx,
+    unsigned char *sig64,
+    const unsigned char *msg32,
+    const secp256k1_signing_key *key,
+    const unsigned char* secnonce32,
+    const unsigned char* extra32,
+    const secp256k1_pubkey *pubnonce_for_e,
+    const secp256k1_pubkey* pubnonce_total,
+    const secp256k1_pubkey* pubkey_for_e,
+    const unsigned char* seed)
+SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(10) SECP256K1_WARN_UNUSED_RESULT;
+
 /** Generate a single signature part in an aggregated signature
  *
  *  Returns: 1 on success, 0 on failure
@@ -204,11 +230,43 @@ SECP256K1_API int secp256k1_aggsig_verify_single(
     const int is_partial)
 SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(5) SECP256K1_WARN_UNUSED_RESULT;
 
+/** Verify a set of single-signer signatures at once
+ *
+ *  Equivalent to calling secp256k1_aggsig_verify_single with is_partial set to 0 on every
+ *  signature in the set, but much faster for large sets. Partial signatures, whose public
+ *  nonce may have had its jacobi symbol flipped, cannot be batch verified.
+ *
+ *  Returns: 1 if all signatures are valid (in particular if n_sigs is 0), 0 otherwise
+ *  Args:    ctx: an existing context object, initialized for verification (cannot be NULL)
+ *       scratch: scratch space used for the multiexponentiation (cannot be NULL)
+ *  In:    sig64: array of signatures, or NULL if there are no signatures
+ *         msg32: array of messages, or NULL if there are no signatures
+ *      pubnonce: if non-NULL, array of public nonces to encode in e. NULL entries, or
+ *                a NULL array, use the nonce in the signature as in verify_single
+ *        pubkey: array of public keys, or NULL if there are no signatures
+ *  pubkey_total: if non-NULL, array of public keys to encode in e (entries may be NULL)
+ *  extra_pubkey: if non-NULL, array of public keys to subtract from sG (entries may be NULL)
+ *        n_sigs: number of signatures in above arrays. Must be smaller than 2^31 and
+ *                smaller than a third of the maximum size_t value
+ */
+SECP256K1_API int secp256k1_aggsig_verify_single_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubnonce,
+    const secp256k1_pubkey *const *pubkey,
+    const secp256k1_pubkey *const *pubkey_total,
+    const secp256k1_pubkey *const *extra_pubkey,
+    size_t n_sigs
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_WARN_UNUSED_RESULT;
+
 /** Verify an aggregate signature
  *
  *  Returns: 1 if the signature is valid, 0 if not
  *  Args:    ctx: an existing context object (cannot be NULL)
- *       scratch: a scratch space (cannot be NULL)
+ *       scratch: a scratch space, which may be reused across calls without further
+ *                allocation (may be NULL only if n_keys is 1)
  *  In:    sig64: the signature to verify (cannot be NULL)
  *         msg32: the message that should be signed (cannot be NULL)
  *       pubkeys: array of public keys (cannot be NULL)
@@ -221,7 +279,21 @@ SECP256K1_API int secp256k1_aggsig_verify(
     const unsigned char *msg32,
     const secp256k1_pubkey *pubkeys,
     size_t n_pubkeys
-) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5) SECP256K1_WARN_UNUSED_RESULT;
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5) SECP256K1_WARN_UNUSED_RESULT;
+
+/** Get the scratch space needed to verify an aggregate signature
+ *
+ *  Returns: the smallest max_size of a scratch space with which secp256k1_aggsig_verify
+ *           verifies a signature over n_pubkeys keys in a single multiexponentiation. This
+ *           is 0 for a single key, which needs no scratch space. Depends on the tuning
+ *           parameters and task runner of the context.
+ *  Args:    ctx: an existing context object, initialized for verification (cannot be NULL)
+ *  In:   n_pubkeys: the number of public keys
+ */
+SECP256K1_API size_t secp256k1_aggsig_verify_scratch_size(
+    const secp256k1_context* ctx,
+    size_t n_pubkeys
+) SECP256K1_ARG_NONNULL(1);
 
 /** Verify an aggregate signature, building scratch space interally beforehand
  *
@@ -39,6 +39,41 @@ SECP256K1_API void secp256k1_bulletproof_generators_destroy(
     secp256k1_bulletproof_generators *gen
 ) SECP256K1_ARG_NONNULL(1);
 
+/* Size of a serialized generator set with `n` NUMS generators, in bytes: a 16-byte header
+ * (magic, version and `n`), `n + 1` affine points of 64 bytes each and a 32-byte SHA256 checksum */
+#define SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(n) (16 + 64 * ((size_t)(n) + 1) + 32)
+
+/** Serializes a list of NUMS generators into a flat, versioned and checksummed blob which
+ *  can be stored, e.g. in a file which is memory-mapped by every process that needs it.
+ *  Returns: 1 on success, 0 if the output buffer was too small
+ *  Args:          ctx: pointer to a context object (cannot be NULL)
+ *  Out:        output: pointer to a buffer of SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(n)
+ *                      bytes, where n is the number of generators in gens (cannot be NULL)
+ *  In/Out:  outputlen: pointer to the length of the output buffer, which is overwritten with
+ *                      the number of bytes written (cannot be NULL)
+ *  In:           gens: the generator set to serialize (cannot be NULL)
+ */
+SECP256K1_API int secp256k1_bulletproof_generators_serialize(
+    const secp256k1_context* ctx,
+    unsigned char *output,
+    size_t *outputlen,
+    const secp256k1_bulletproof_generators *gens
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
+
+/** Allocates a list of NUMS generators and loads it from a serialized blob, without
+ *  regenerating any of the points. The input is only read, so it may be a read-only mapping
+ *  shared between processes.
+ *  Returns a list of generators, or NULL if the blob was malformed or allocation failed.
+ *  Args:          ctx: pointer to a context object (cannot be NULL)
+ *  In:          input: a blob produced by secp256k1_bulletproof_generators_serialize (cannot be NULL)
+ *            inputlen: the length of the blob in bytes
+ */
+SECP256K1_API secp256k1_bulletproof_generators *secp256k1_bulletproof_generators_parse(
+    const secp256k1_context* ctx,
+    const unsigned char *input,
+    size_t inputlen
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
 /** Verifies a single bulletproof (aggregate) rangeproof
  *  Returns: 1: rangeproof was valid
  *           0: rangeproof was invalid, or out of memory
@@ -103,6 +138,96 @@ SECP256K1_WARN_UNUSED_RESULT SECP256K1_API int secp256k1_bulletproof_rangeproof_
     size_t *extra_commit_len
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(8);
 
+/** Returns the scratch space budget needed to verify rangeproofs of a given shape
+ *  Returns: the smallest max_size of a scratch space with which secp256k1_bulletproof_rangeproof_verify_multi
+ *           verifies n_proofs rangeproofs in a single multiexponentiation, whatever their value
+ *           generators, or 0 if the arguments are invalid. For n_proofs = 1 this also covers
+ *           secp256k1_bulletproof_rangeproof_verify.
+ *  Args:       ctx: pointer to a context object initialized for verification (cannot be NULL)
+ *  In:    n_proofs: number of proofs verified at once (cannot be 0)
+ *            nbits: number of bits in each proof (cannot be 0, at most 64)
+ *        n_commits: number of commitments in each proof (cannot be 0)
+ *
+ *  The result depends on the tuning parameters and task runner of the context, so it should be
+ *  computed after they are set.
+ */
+SECP256K1_API size_t secp256k1_bulletproof_rangeproof_verify_scratch_size(
+    const secp256k1_context* ctx,
+    size_t n_proofs,
+    size_t nbits,
+    size_t n_commits
+) SECP256K1_ARG_NONNULL(1);
+
+/** Batch-verifies multiple bulletproof (aggregate) rangeproofs which may differ in size and generator
+ *  Returns: 1: all rangeproofs were valid
+ *           0: some rangeproof was invalid, or out of memory
+ *  Args:       ctx: pointer to a context object initialized for verification (cannot be NULL)
+ *          scratch: scratch space with enough memory for verification (cannot be NULL)
+ *             gens: generator set with at least 2*nbits[i]*n_commits[i] many generators for every i (cannot be NULL)
+ *  In:       proof: array of byte-serialized rangeproofs (cannot be NULL)
+ *         n_proofs: number of proofs in the above array, and of entries in each of the following arrays
+ *             plen: array of lengths of the individual proofs (cannot be NULL)
+ *        min_value: array of arrays of minimum values to prove ranges above, or NULL for all-zeroes
+ *           commit: array of arrays of pedersen commitment that the rangeproofs is over (cannot be NULL)
+ *        n_commits: array of number of commitments in each element of the above array (cannot be NULL, no entry may be 0)
+ *            nbits: array of number of bits in each proof (cannot be NULL)
+ *        value_gen: array of generators multiplied by value in pedersen commitments, one per proof (cannot be NULL)
+ *     extra_commit: additonal data committed to by the rangeproof (may be NULL if `extra_commit_len` is 0)
+ *     extra_commit_len: array of lengths of additional data
+ *
+ *  All proofs are checked in a single multiexponentiation, sharing the G_i and H_i generators
+ *  as far as the proofs overlap and sharing one point for every distinct value generator.
+ */
+SECP256K1_WARN_UNUSED_RESULT SECP256K1_API int secp256k1_bulletproof_rangeproof_verify_multi_mixed(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    const secp256k1_bulletproof_generators *gens,
+    const unsigned char* const* proof,
+    size_t n_proofs,
+    const size_t* plen,
+    const uint64_t* const* min_value,
+    const secp256k1_pedersen_commitment* const* commit,
+    const size_t* n_commits,
+    const size_t* nbits,
+    const secp256k1_generator* value_gen,
+    const unsigned char* const* extra_commit,
+    size_t *extra_commit_len
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(8);
+
+/** Batch-verifies like secp256k1_bulletproof_rangeproof_verify_multi_mixed, and reports which proofs were valid
+ *  Returns: 1: all rangeproofs were valid
+ *           0: some rangeproof was invalid
+ *          -1: the scratch space was too small to check every rangeproof
+ *  Args:       ctx: pointer to a context object initialized for verification (cannot be NULL)
+ *          scratch: scratch space with enough memory for verification (cannot be NULL)
+ *             gens: generator set with at least 2*nbits[i]*n_commits[i] many generators for every i (cannot be NULL)
+ *  Out:      valid: bitmap of (n_proofs + 7) / 8 bytes; bit (i % 8) of byte (i / 8) is set iff proof i
+ *                   was valid (cannot be NULL)
+ *  In:              all further arguments are as for secp256k1_bulletproof_rangeproof_verify_multi_mixed
+ *
+ *  If the batch does not verify, the bad proofs are located by recursive bisection over the already
+ *  computed batch, so finding k bad proofs out of n costs O(k log n) smaller multiexponentiations
+ *  rather than n separate verifications. If -1 is returned, the bits of the proofs that could not be
+ *  checked are clear although they may be valid, so a clear bit does not mean that a proof is invalid.
+ *  Set bits are always accurate.
+ */
+SECP256K1_WARN_UNUSED_RESULT SECP256K1_API int secp256k1_bulletproof_rangeproof_verify_multi_bitmap(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    const secp256k1_bulletproof_generators *gens,
+    unsigned char* valid,
+    const unsigned char* const* proof,
+    size_t n_proofs,
+    const size_t* plen,
+    const uint64_t* const* min_value,
+    const secp256k1_pedersen_commitment* const* commit,
+    const size_t* n_commits,
+    const size_t* nbits,
+    const secp256k1_generator* value_gen,
+    const unsigned char* const* extra_commit,
+    size_t *extra_commit_len
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5) SECP256K1_ARG_NONNULL(9);
+
 /** Extracts the value and blinding factor from a single-commit rangeproof given a secret nonce
  *  Returns: 1: value and blinding factor were extracted and matched the input commit
  *           0: one of the above was not true, extraction failed
@@ -103,6 +103,79 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_recover(
     const unsigned char *msg32
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Recover the ECDSA public keys of many signatures.
+ *
+ *  Gives the same results as calling secp256k1_ecdsa_recover for every
+ *  signature, but shares the modular inversions between signatures, which
+ *  makes it faster for large numbers of signatures.
+ *
+ *  Returns: 1: all public keys were successfully recovered.
+ *           0: otherwise.
+ *  Args:    ctx:     pointer to a context object, initialized for verification (cannot be NULL)
+ *  Out:     pubkeys: array of n recovered public keys. Keys that could not be recovered
+ *                    are cleared, as by secp256k1_ecdsa_recover (cannot be NULL unless n is 0)
+ *           valid:   if non-NULL, bitmap of (n + 7) / 8 bytes; bit (i % 8) of byte (i / 8) is
+ *                    set iff public key i was recovered
+ *  In:      sigs:    array of n signatures that support pubkey recovery (cannot be NULL
+ *                    unless n is 0)
+ *           msgs32:  n 32-byte message hashes assumed to be signed, one after the other
+ *                    (cannot be NULL unless n is 0)
+ *           n:       number of signatures
+ */
+SECP256K1_API int secp256k1_ecdsa_recover_batch(
+    const secp256k1_context* ctx,
+    secp256k1_pubkey *pubkeys,
+    unsigned char *valid,
+    const secp256k1_ecdsa_recoverable_signature *sigs,
+    const unsigned char *msgs32,
+    size_t n
+) SECP256K1_ARG_NONNULL(1);
+
+/** Verify many recoverable ECDSA signatures at once.
+ *
+ *  Signature i is valid if secp256k1_ecdsa_recover recovers pk[i] from it and
+ *  msg32[i], and if it is in lower-S form as secp256k1_ecdsa_verify requires.
+ *  As the recovery id determines the point R, all signatures are checked with
+ *  a single randomized multi-multiplication. If that fails, the signatures are
+ *  checked one by one.
+ *
+ *  Returns: 1: all signatures are valid (in particular if n_sigs is 0).
+ *           0: otherwise.
+ *  Args:    ctx:     pointer to a context object, initialized for verification (cannot be NULL)
+ *           scratch: scratch space used for the multi-multiplication (cannot be NULL)
+ *  Out:     valid:   if non-NULL, bitmap of (n_sigs + 7) / 8 bytes; bit (i % 8) of byte
+ *                    (i / 8) is set iff signature i is valid
+ *  In:      sig:     array of signatures, or NULL if there are no signatures
+ *           msg32:   array of 32-byte message hashes, or NULL if there are no signatures
+ *           pk:      array of public keys, or NULL if there are no signatures
+ *           n_sigs:  number of signatures in above arrays. Must be smaller than 2^31
+ *                    and smaller than half the maximum size_t value.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_recoverable_verify_batch(
+    const secp256k1_context* ctx,
+    secp256k1_scratch_space* scratch,
+    unsigned char *valid,
+    const secp256k1_ecdsa_recoverable_signature *const *sig,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pk,
+    size_t n_sigs
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
+
+/** Returns the scratch space needed to verify a batch of recoverable signatures.
+ *
+ *  Returns the smallest max_size of a scratch space with which
+ *  secp256k1_ecdsa_recoverable_verify_batch verifies n_sigs signatures in a
+ *  single multi-multiplication, or 0 if n_sigs is 0 or too large.
+ *
+ *  Args:    ctx:    pointer to a context object, initialized for verification (cannot be NULL)
+ *  In:      n_sigs: number of signatures, subject to the same limits as for
+ *                   secp256k1_ecdsa_recoverable_verify_batch
+ */
+SECP256K1_API size_t secp256k1_ecdsa_recoverable_verify_batch_scratch_size(
+    const secp256k1_context* ctx,
+    size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 #ifdef __cplusplus
 }
 #endif
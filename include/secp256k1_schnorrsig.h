@@ -84,6 +84,31 @@ SECP256K1_API int secp256k1_schnorrsig_sign(
 	void* ndata
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
 
+/** Create a Schnorr signature with a prepared secret key.
+ *
+ * Produces the same signature as secp256k1_schnorrsig_sign with the key's
+ * secret key, without recomputing its public key.
+ *
+ * Returns 1 on success, 0 on failure.
+ *  Args:    ctx: pointer to a context object, initialized for signing (cannot be NULL)
+ *  Out:     sig: pointer to the returned signature (cannot be NULL)
+ *       nonce_is_negated: a pointer to an integer indicates if signing algorithm negated the
+ *                nonce (can be NULL)
+ *  In:    msg32: the 32-byte message hash being signed (cannot be NULL)
+ *           key: the signing key (cannot be NULL)
+ *       noncefp: pointer to a nonce generation function. If NULL, secp256k1_nonce_function_bipschnorr is used
+ *         ndata: pointer to arbitrary data used by the nonce generation function (can be NULL)
+ */
+SECP256K1_API int secp256k1_schnorrsig_sign_with_key(
+	const secp256k1_context* ctx,
+	secp256k1_schnorrsig* sig,
+	int* nonce_is_negated,
+	const unsigned char* msg32,
+	const secp256k1_signing_key* key,
+	secp256k1_nonce_function noncefp,
+	void* ndata
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
 /** Verify a Schnorr signature.
  *
  *  Returns: 1: correct signature
@@ -105,7 +130,8 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify(
  * Returns 1 if all succeeded, 0 otherwise. In particular, returns 1 if n_sigs is 0.
  *
  *  Args:    ctx: a secp256k1 context object, initialized for verification.
- *       scratch: scratch space used for the multiexponentiation
+ *       scratch: scratch space used to buffer the points and scalars of the
+ *                multiexponentiation, and for the multiexponentiation itself
  *  In:      sig: array of signatures, or NULL if there are no signatures
  *         msg32: array of messages, or NULL if there are no signatures
  *            pk: array of public keys, or NULL if there are no signatures
@@ -122,6 +148,100 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_verify_batch
 	size_t n_sigs
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2);
 
+/** Returns the scratch space needed to verify a batch of Schnorr signatures.
+ *
+ * Returns the smallest max_size of a scratch space with which
+ * secp256k1_schnorrsig_verify_batch verifies n_sigs signatures in a single
+ * multiexponentiation, or 0 if n_sigs is 0 or too large. The result depends
+ * on the tuning parameters and task runner of the context.
+ *
+ *  Args:    ctx: a secp256k1 context object, initialized for verification.
+ *  In:   n_sigs: number of signatures, subject to the same limits as for
+ *                secp256k1_schnorrsig_verify_batch.
+ */
+SECP256K1_API size_t secp256k1_schnorrsig_verify_batch_scratch_size(
+	const secp256k1_context* ctx,
+	size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
+/** Opaque data structure that collects Schnorr signatures for batch verification.
+ *
+ *  Signatures are parsed, and their challenges computed, as they are added, so
+ *  that this work can overlap with receiving them. Verifying the collected
+ *  signatures then takes a single multiexponentiation, plus a few more to
+ *  locate any invalid signatures.
+ */
+typedef struct secp256k1_schnorrsig_batch_struct secp256k1_schnorrsig_batch;
+
+/** Create a Schnorr batch verifier.
+ *
+ *  Returns: a newly created verifier, or NULL if memory could not be allocated
+ *  Args:    ctx: a secp256k1 context object, initialized for verification.
+ *  In: capacity: the number of signatures it can hold. Must be smaller than
+ *                2^31 and smaller than half the maximum size_t value.
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT secp256k1_schnorrsig_batch* secp256k1_schnorrsig_batch_create(
+	const secp256k1_context* ctx,
+	size_t capacity
+) SECP256K1_ARG_NONNULL(1);
+
+/** Add a signature to a batch verifier.
+ *
+ *  The signature gets the next index, counting from 0 since the verifier was
+ *  created or last finalized. A signature that cannot be parsed is added too
+ *  and reported as invalid when the batch is finalized.
+ *
+ *  Returns: 1 if the signature was added, 0 if the verifier is full or the
+ *           public key is invalid (in which case nothing is added)
+ *  Args:    ctx: a secp256k1 context object
+ *  In/Out: batch: the batch verifier (cannot be NULL)
+ *  In:       sig: the signature (cannot be NULL)
+ *          msg32: the 32-byte message that was signed (cannot be NULL)
+ *             pk: the public key of the signer (cannot be NULL)
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_batch_add(
+	const secp256k1_context* ctx,
+	secp256k1_schnorrsig_batch* batch,
+	const secp256k1_schnorrsig* sig,
+	const unsigned char* msg32,
+	const secp256k1_pubkey* pk
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
+/** Verify the signatures in a batch verifier and empty it.
+ *
+ *  If the batch does not verify, the invalid signatures are located by
+ *  recursive bisection, so finding k invalid signatures out of n costs
+ *  O(k log n) smaller multiexponentiations rather than n separate
+ *  verifications.
+ *
+ *  Returns 1 if all signatures are valid (in particular if there are none), 0
+ *  otherwise. If the scratch space is too small for even a single signature,
+ *  the signatures are verified one at a time instead.
+ *  Args:    ctx: a secp256k1 context object, initialized for verification.
+ *       scratch: scratch space used for the multiexponentiations. With
+ *                secp256k1_schnorrsig_verify_batch_scratch_size(ctx, n) bytes,
+ *                n signatures are verified in a single batch (cannot be NULL)
+ *  In/Out: batch: the batch verifier, which is empty afterwards (cannot be NULL)
+ *  Out:    valid: if non-NULL, bitmap of (n + 7) / 8 bytes for the n signatures
+ *                 that were added; bit (i % 8) of byte (i / 8) is set iff
+ *                 signature i is valid
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorrsig_batch_finalize(
+	const secp256k1_context* ctx,
+	secp256k1_scratch_space* scratch,
+	secp256k1_schnorrsig_batch* batch,
+	unsigned char* valid
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3);
+
+/** Destroy a Schnorr batch verifier.
+ *
+ *  Does nothing if batch is NULL.
+ *  Args:  batch: the batch verifier, which may not be used afterwards
+ */
+SECP256K1_API void secp256k1_schnorrsig_batch_destroy(
+	secp256k1_schnorrsig_batch* batch
+);
+
 # ifdef __cplusplus
 }
 # endif
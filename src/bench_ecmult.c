@@ -70,6 +70,25 @@ static void bench_ecmult(void* arg) {
     }
 }
 
+/* Feeds the points one by one through an accumulator */
+static int bench_ecmult_accumulate(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n) {
+    secp256k1_ecmult_multi_accumulator acc;
+    size_t i;
+    if (!secp256k1_ecmult_multi_accumulator_init(&acc, ctx, scratch, SIZE_MAX)) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar sc;
+        secp256k1_ge pt;
+        cb(&sc, &pt, i, cbdata);
+        secp256k1_ecmult_multi_accumulator_add(&acc, &sc, &pt);
+    }
+    if (inp_g_sc != NULL) {
+        secp256k1_ecmult_multi_accumulator_add_g(&acc, inp_g_sc);
+    }
+    return secp256k1_ecmult_multi_accumulator_finalize(&acc, r);
+}
+
 static void bench_ecmult_setup(void* arg) {
     bench_data* data = (bench_data*)arg;
     data->offset1 = (data->count * 0x537b7f6f + 0x8f66a481) % POINTS;
@@ -146,6 +165,9 @@ int main(int argc, char **argv) {
         } else if(have_flag(argc, argv, "strauss_wnaf")) {
             printf("Using strauss_wnaf:\n");
             data.ecmult_multi = secp256k1_ecmult_strauss_batch_single;
+        } else if(have_flag(argc, argv, "accumulator")) {
+            printf("Using an accumulator with a 1 MiB scratch space:\n");
+            data.ecmult_multi = bench_ecmult_accumulate;
         }
     } else {
         data.ecmult_multi = secp256k1_ecmult_multi_var;
@@ -154,6 +176,9 @@ int main(int argc, char **argv) {
     /* Allocate stuff */
     data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY);
     scratch_size = secp256k1_strauss_scratch_size(POINTS) + STRAUSS_SCRATCH_OBJECTS*16;
+    if (data.ecmult_multi == bench_ecmult_accumulate) {
+        scratch_size = 1 << 20;
+    }
     data.scratch = secp256k1_scratch_space_create(data.ctx, scratch_size);
     data.scalars = malloc(sizeof(secp256k1_scalar) * POINTS);
     data.seckeys = malloc(sizeof(secp256k1_scalar) * POINTS);
@@ -191,6 +191,15 @@ void bench_field_sqrt(void* arg) {
     }
 }
 
+void bench_field_is_quad_var(void* arg) {
+    int i;
+    bench_inv *data = (bench_inv*)arg;
+
+    for (i = 0; i < 20000; i++) {
+        data->fe_x.n[0] += 1 + secp256k1_fe_is_quad_var(&data->fe_x);
+    }
+}
+
 void bench_group_double_var(void* arg) {
     int i;
     bench_inv *data = (bench_inv*)arg;
@@ -269,6 +278,24 @@ void bench_sha256(void* arg) {
     }
 }
 
+void bench_sha256_multi(void* arg) {
+    int i, j;
+    bench_inv *data = (bench_inv*)arg;
+    unsigned char out[8 * 32];
+    const unsigned char *msgs[8];
+    size_t lens[8];
+
+    for (j = 0; j < 8; j++) {
+        msgs[j] = &out[32 * j];
+        lens[j] = 32;
+        memcpy(&out[32 * j], data->data, 32);
+    }
+    for (i = 0; i < 20000 / 8; i++) {
+        secp256k1_sha256_multi(out, msgs, lens, 8);
+    }
+    memcpy(data->data, out, 32);
+}
+
 void bench_hmac_sha256(void* arg) {
     int i;
     bench_inv *data = (bench_inv*)arg;
@@ -343,6 +370,7 @@ int main(int argc, char **argv) {
     if (have_flag(argc, argv, "field") || have_flag(argc, argv, "inverse")) run_benchmark("field_inverse", bench_field_inverse, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "field") || have_flag(argc, argv, "inverse")) run_benchmark("field_inverse_var", bench_field_inverse_var, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "field") || have_flag(argc, argv, "sqrt")) run_benchmark("field_sqrt", bench_field_sqrt, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "field") || have_flag(argc, argv, "quad")) run_benchmark("field_is_quad_var", bench_field_is_quad_var, bench_setup, NULL, &data, 10, 20000);
 
     if (have_flag(argc, argv, "group") || have_flag(argc, argv, "double")) run_benchmark("group_double_var", bench_group_double_var, bench_setup, NULL, &data, 10, 200000);
     if (have_flag(argc, argv, "group") || have_flag(argc, argv, "add")) run_benchmark("group_add_var", bench_group_add_var, bench_setup, NULL, &data, 10, 200000);
@@ -354,6 +382,7 @@ int main(int argc, char **argv) {
     if (have_flag(argc, argv, "ecmult") || have_flag(argc, argv, "wnaf")) run_benchmark("ecmult_wnaf", bench_ecmult_wnaf, bench_setup, NULL, &data, 10, 20000);
 
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256", bench_sha256, bench_setup, NULL, &data, 10, 20000);
+    if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "sha256")) run_benchmark("hash_sha256_multi", bench_sha256_multi, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "hmac")) run_benchmark("hash_hmac_sha256", bench_hmac_sha256, bench_setup, NULL, &data, 10, 20000);
     if (have_flag(argc, argv, "hash") || have_flag(argc, argv, "rng6979")) run_benchmark("hash_rfc6979_hmac_sha256", bench_rfc6979_hmac_sha256, bench_setup, NULL, &data, 10, 20000);
 
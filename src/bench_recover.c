@@ -9,10 +9,16 @@
 #include "util.h"
 #include "bench.h"
 
+#define BATCH_SIZE 100
+
 typedef struct {
     secp256k1_context *ctx;
     unsigned char msg[32];
     unsigned char sig[64];
+    secp256k1_ecdsa_recoverable_signature sigs[BATCH_SIZE];
+    unsigned char msgs[BATCH_SIZE][32];
+    secp256k1_pubkey pks[BATCH_SIZE];
+    secp256k1_scratch_space *scratch;
 } bench_recover_data;
 
 void bench_recover(void* arg) {
@@ -36,6 +42,16 @@ void bench_recover(void* arg) {
     }
 }
 
+void bench_recover_batch(void* arg) {
+    int i;
+    bench_recover_data *data = (bench_recover_data*)arg;
+    secp256k1_pubkey pubkeys[BATCH_SIZE];
+
+    for (i = 0; i < 20000 / BATCH_SIZE; i++) {
+        CHECK(secp256k1_ecdsa_recover_batch(data->ctx, pubkeys, NULL, data->sigs, &data->msgs[0][0], BATCH_SIZE));
+    }
+}
+
 void bench_recover_setup(void* arg) {
     int i;
     bench_recover_data *data = (bench_recover_data*)arg;
@@ -48,12 +64,78 @@ void bench_recover_setup(void* arg) {
     }
 }
 
+void bench_recover_batch_setup(void* arg) {
+    int i;
+    bench_recover_data *data = (bench_recover_data*)arg;
+    secp256k1_pubkey pubkey;
+
+    /* Collect signatures along the chain bench_recover follows, which are all recoverable. */
+    bench_recover_setup(arg);
+    for (i = 0; i < BATCH_SIZE; i++) {
+        int j;
+        size_t pubkeylen = 33;
+        unsigned char pubkeyc[33];
+        CHECK(secp256k1_ecdsa_recoverable_signature_parse_compact(data->ctx, &data->sigs[i], data->sig, i % 2));
+        memcpy(data->msgs[i], data->msg, 32);
+        CHECK(secp256k1_ecdsa_recover(data->ctx, &pubkey, &data->sigs[i], data->msg));
+        CHECK(secp256k1_ec_pubkey_serialize(data->ctx, pubkeyc, &pubkeylen, &pubkey, SECP256K1_EC_COMPRESSED));
+        for (j = 0; j < 32; j++) {
+            data->sig[j + 32] = data->msg[j];
+            data->msg[j] = data->sig[j];
+            data->sig[j] = pubkeyc[j + 1];
+        }
+    }
+}
+
+void bench_verify_batch(void* arg) {
+    int i;
+    bench_recover_data *data = (bench_recover_data*)arg;
+    const secp256k1_ecdsa_recoverable_signature *sig_ptr[BATCH_SIZE];
+    const unsigned char *msg_ptr[BATCH_SIZE];
+    const secp256k1_pubkey *pk_ptr[BATCH_SIZE];
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        sig_ptr[i] = &data->sigs[i];
+        msg_ptr[i] = data->msgs[i];
+        pk_ptr[i] = &data->pks[i];
+    }
+    for (i = 0; i < 20000 / BATCH_SIZE; i++) {
+        CHECK(secp256k1_ecdsa_recoverable_verify_batch(data->ctx, data->scratch, NULL, sig_ptr, msg_ptr, pk_ptr, BATCH_SIZE));
+    }
+}
+
+void bench_verify_batch_setup(void* arg) {
+    int i;
+    bench_recover_data *data = (bench_recover_data*)arg;
+    secp256k1_context *sign_ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        unsigned char key[32];
+        int j;
+        for (j = 0; j < 32; j++) {
+            key[j] = i + j + 1;
+            data->msgs[i][j] = i * j + 65;
+        }
+        CHECK(secp256k1_ec_pubkey_create(sign_ctx, &data->pks[i], key));
+        CHECK(secp256k1_ecdsa_sign_recoverable(sign_ctx, &data->sigs[i], data->msgs[i], key, NULL, NULL));
+    }
+    secp256k1_context_destroy(sign_ctx);
+    data->scratch = secp256k1_scratch_space_create(data->ctx, secp256k1_ecdsa_recoverable_verify_batch_scratch_size(data->ctx, BATCH_SIZE));
+}
+
+void bench_verify_batch_teardown(void* arg) {
+    bench_recover_data *data = (bench_recover_data*)arg;
+    secp256k1_scratch_space_destroy(data->scratch);
+}
+
 int main(void) {
     bench_recover_data data;
 
     data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
 
     run_benchmark("ecdsa_recover", bench_recover, bench_recover_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_recover_batch", bench_recover_batch, bench_recover_batch_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_recoverable_verify_batch", bench_verify_batch, bench_verify_batch_setup, bench_verify_batch_teardown, &data, 10, 20000);
 
     secp256k1_context_destroy(data.ctx);
     return 0;
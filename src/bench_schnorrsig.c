@@ -39,6 +39,23 @@ void bench_schnorrsig_sign(void* arg) {
     }
 }
 
+void bench_schnorrsig_sign_with_key(void* arg) {
+    bench_schnorrsig_data *data = (bench_schnorrsig_data *)arg;
+    size_t i;
+    const unsigned char sk[32] = "benchmarkexample secrettemplate";
+    unsigned char msg[32] = "benchmarkexamplemessagetemplate";
+    secp256k1_schnorrsig sig;
+    secp256k1_signing_key *key = secp256k1_signing_key_create(data->ctx, sk);
+
+    CHECK(key != NULL);
+    for (i = 0; i < 1000; i++) {
+        msg[0] = i;
+        msg[1] = i >> 8;
+        CHECK(secp256k1_schnorrsig_sign_with_key(data->ctx, &sig, NULL, msg, key, NULL, NULL));
+    }
+    secp256k1_signing_key_destroy(key);
+}
+
 void bench_schnorrsig_verify(void* arg) {
     bench_schnorrsig_data *data = (bench_schnorrsig_data *)arg;
     size_t i;
@@ -70,6 +87,23 @@ void bench_schnorrsig_verify_n(void* arg) {
     free(pk);
 }
 
+void bench_schnorrsig_batch_object_n(void* arg) {
+    bench_schnorrsig_data *data = (bench_schnorrsig_data *)arg;
+    size_t i, j;
+    secp256k1_schnorrsig_batch *batch = secp256k1_schnorrsig_batch_create(data->ctx, data->n);
+
+    CHECK(batch != NULL);
+    for (j = 0; j < MAX_SIGS/data->n; j++) {
+        for (i = 0; i < data->n; i++) {
+            secp256k1_pubkey pk;
+            CHECK(secp256k1_ec_pubkey_parse(data->ctx, &pk, data->pk[i], 33) == 1);
+            CHECK(secp256k1_schnorrsig_batch_add(data->ctx, batch, data->sigs[i], data->msgs[i], &pk));
+        }
+        CHECK(secp256k1_schnorrsig_batch_finalize(data->ctx, data->scratch, batch, NULL));
+    }
+    secp256k1_schnorrsig_batch_destroy(batch);
+}
+
 int main(void) {
     size_t i;
     bench_schnorrsig_data data;
@@ -104,6 +138,7 @@ int main(void) {
     }
 
     run_benchmark("schnorrsig_sign", bench_schnorrsig_sign, NULL, NULL, (void *) &data, 10, 1000);
+    run_benchmark("schnorrsig_sign_with_key", bench_schnorrsig_sign_with_key, NULL, NULL, (void *) &data, 10, 1000);
     run_benchmark("schnorrsig_verify", bench_schnorrsig_verify, NULL, NULL, (void *) &data, 10, 1000);
     for (i = 1; i <= MAX_SIGS; i *= 2) {
         char name[64];
@@ -112,6 +147,13 @@ int main(void) {
         data.n = i;
         run_benchmark(name, bench_schnorrsig_verify_n, NULL, NULL, (void *) &data, 3, MAX_SIGS);
     }
+    for (i = 1; i <= MAX_SIGS; i *= 8) {
+        char name[64];
+        sprintf(name, "schnorrsig_batch_object_%d", (int) i);
+
+        data.n = i;
+        run_benchmark(name, bench_schnorrsig_batch_object_n, NULL, NULL, (void *) &data, 3, MAX_SIGS);
+    }
 
     for (i = 0; i < MAX_SIGS; i++) {
         free((void *)data.pk[i]);
@@ -12,6 +12,7 @@ typedef struct {
     secp256k1_context* ctx;
     unsigned char msg[32];
     unsigned char key[32];
+    secp256k1_signing_key* signing_key;
 } bench_sign;
 
 static void bench_sign_setup(void* arg) {
@@ -44,12 +45,44 @@ static void bench_sign_run(void* arg) {
     }
 }
 
+static void bench_sign_with_key_setup(void* arg) {
+    bench_sign *data = (bench_sign*)arg;
+
+    bench_sign_setup(arg);
+    data->signing_key = secp256k1_signing_key_create(data->ctx, data->key);
+    CHECK(data->signing_key != NULL);
+}
+
+static void bench_sign_with_key_teardown(void* arg) {
+    bench_sign *data = (bench_sign*)arg;
+
+    secp256k1_signing_key_destroy(data->signing_key);
+}
+
+static void bench_sign_with_key_run(void* arg) {
+    int i;
+    bench_sign *data = (bench_sign*)arg;
+
+    unsigned char sig[74];
+    for (i = 0; i < 20000; i++) {
+        size_t siglen = 74;
+        int j;
+        secp256k1_ecdsa_signature signature;
+        CHECK(secp256k1_ecdsa_sign_with_key(data->ctx, &signature, data->msg, data->signing_key, NULL, NULL));
+        CHECK(secp256k1_ecdsa_signature_serialize_der(data->ctx, sig, &siglen, &signature));
+        for (j = 0; j < 32; j++) {
+            data->msg[j] = sig[j];
+        }
+    }
+}
+
 int main(void) {
     bench_sign data;
 
     data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
 
     run_benchmark("ecdsa_sign", bench_sign_run, bench_sign_setup, NULL, &data, 10, 20000);
+    run_benchmark("ecdsa_sign_with_key", bench_sign_with_key_run, bench_sign_with_key_setup, bench_sign_with_key_teardown, &data, 10, 20000);
 
     secp256k1_context_destroy(data.ctx);
     return 0;
@@ -0,0 +1,55 @@
+/**********************************************************************
+ * Copyright (c) 2019 The libsecp256k1 developers                     *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_CPU_H
+#define SECP256K1_CPU_H
+
+#if defined HAVE_CONFIG_H
+#include "libsecp256k1-config.h"
+#endif
+
+#include "util.h"
+
+/* Code using instruction set extensions beyond the baseline of the build is
+ * compiled for them with a target attribute (or written in assembly), and must
+ * only be called after checking at runtime that the CPU supports them. */
+
+#ifdef USE_AVX2
+# define SECP256K1_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef USE_SHANI
+# define SECP256K1_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#endif
+
+/** Returns whether the CPU supports AVX2 and AVX2 code was compiled in. */
+static SECP256K1_INLINE int secp256k1_cpu_has_avx2(void) {
+#ifdef USE_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return 0;
+#endif
+}
+
+/** Returns whether the CPU supports BMI2 and ADX and assembly using them was compiled in. */
+static SECP256K1_INLINE int secp256k1_cpu_has_adx(void) {
+#ifdef USE_ASM_X86_64_ADX
+    return __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx");
+#else
+    return 0;
+#endif
+}
+
+/** Returns whether the CPU supports the SHA extensions and SSE4.1 and code using them was compiled in. */
+static SECP256K1_INLINE int secp256k1_cpu_has_sha(void) {
+#ifdef USE_SHANI
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+#else
+    return 0;
+#endif
+}
+
+#endif /* SECP256K1_CPU_H */
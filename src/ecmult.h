@@ -12,14 +12,48 @@
 #include "scalar.h"
 #include "scratch.h"
 
+/** A task runner executes task(task_data[i]) for every i < n_tasks, possibly
+ *  concurrently, and returns only after all of them have finished. It returns
+ *  0 if it did not run the tasks, in which case they are run sequentially. */
+typedef struct {
+    int (*fn)(void (*task)(void *task_data), void * const *task_data, size_t n_tasks, void *data);
+    void *data;
+    size_t n_tasks;
+} secp256k1_ecmult_task_runner;
+
+#define PIPPENGER_MAX_BUCKET_WINDOW 12
+
+/** Parameters that select the multi-multiplication algorithm and its bucket
+ *  window for a given number of points. */
+typedef struct {
+    /* Minimum number of points for which pippenger is used instead of strauss */
+    size_t pippenger_threshold;
+    /* Minimum number of points for which the batch-affine pippenger variant is used */
+    size_t pippenger_affine_threshold;
+    /* bucket_window_max_points[w-1] is the largest number of points for which
+     * a bucket window of at most w is used. Non-decreasing, and SIZE_MAX for
+     * PIPPENGER_MAX_BUCKET_WINDOW. */
+    size_t bucket_window_max_points[PIPPENGER_MAX_BUCKET_WINDOW];
+} secp256k1_ecmult_tuning;
+
+/** Size of a serialized secp256k1_ecmult_tuning */
+#define SECP256K1_ECMULT_TUNING_SERIALIZED_SIZE (16 + 8 * (2 + PIPPENGER_MAX_BUCKET_WINDOW))
+
 typedef struct {
     /* For accelerating the computation of a*P + b*G: */
     secp256k1_ge_storage (*pre_g)[];    /* odd multiples of the generator */
 #ifdef USE_ENDOMORPHISM
     secp256k1_ge_storage (*pre_g_128)[]; /* odd multiples of 2^128*generator */
 #endif
+    /* For splitting large multi-multiplications over several threads: */
+    secp256k1_ecmult_task_runner task_runner;
+    /* For choosing between the multi-multiplication algorithms: */
+    secp256k1_ecmult_tuning tuning;
 } secp256k1_ecmult_context;
 
+/** Set the tuning parameters to the built-in defaults. */
+static void secp256k1_ecmult_tuning_set_default(secp256k1_ecmult_tuning *tuning);
+
 static void secp256k1_ecmult_context_init(secp256k1_ecmult_context *ctx);
 static void secp256k1_ecmult_context_build(secp256k1_ecmult_context *ctx, const secp256k1_callback *cb);
 static void secp256k1_ecmult_context_clone(secp256k1_ecmult_context *dst,
@@ -39,10 +73,101 @@ typedef int (secp256k1_ecmult_multi_callback)(secp256k1_scalar *sc, secp256k1_ge
  * fit in the scratch space the algorithm is repeatedly run with batches of
  * points. If no scratch space is given then a simple algorithm is used that
  * simply multiplies the points with the corresponding scalars and adds them up.
+ * If the context has a task runner and the batches are large enough, the
+ * points of each batch are split into ranges whose partial sums are computed
+ * by separate tasks. The callback itself is always called from the calling
+ * thread.
  * Returns: 1 on success (including when inp_g_sc is NULL and n is 0)
  *          0 if there is not enough scratch space for a single point or
  *          callback returns 0
  */
 static int secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n);
 
+/**
+ * Multi-multiply: R = inp_g_sc * G + sum_i scalars[i] * points[i], for i < n.
+ * Behaves like secp256k1_ecmult_multi_var, but reads the inputs from arrays
+ * instead of calling a callback for every point, so callers can compute
+ * them in a separate pass beforehand.
+ */
+static int secp256k1_ecmult_multi_var_array(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, const secp256k1_scalar *scalars, const secp256k1_ge *points, size_t n);
+
+/**
+ * Returns the smallest amount of unused scratch space budget with which
+ * secp256k1_ecmult_multi_var handles n points in as few batches as possible,
+ * which is a single batch unless n exceeds ECMULT_MAX_POINTS_PER_BATCH.
+ * Depends on the tuning parameters and task runner of ctx.
+ */
+static size_t secp256k1_ecmult_multi_scratch_size(const secp256k1_ecmult_context *ctx, size_t n);
+
+/** Collects (scalar, point) pairs for a multi-multiplication that is too large
+ *  to be reachable through a single callback or to fit a single scratch space.
+ *  The pairs are buffered in the scratch space and the buffer is reduced to a
+ *  partial sum with secp256k1_ecmult_multi_var whenever it is full. */
+typedef struct {
+    const secp256k1_ecmult_context *ctx;
+    secp256k1_scratch *scratch;
+    secp256k1_scalar *scalars;
+    secp256k1_ge *points;
+    size_t n;
+    size_t capacity;
+    /* Scalar for G, which is added once at the end */
+    secp256k1_scalar g_sc;
+    /* Sum of the pairs flushed so far */
+    secp256k1_gej r;
+    int failed;
+} secp256k1_ecmult_multi_accumulator;
+
+/**
+ * Initializes an accumulator which buffers as many pairs as fit the scratch
+ * space together with what secp256k1_ecmult_multi_var needs to flush them in a
+ * single batch, but no more than max_n (or one, if max_n is 0). The buffer is
+ * a frame of the scratch space, which must not be used otherwise until
+ * secp256k1_ecmult_multi_accumulator_finalize or _clear.
+ * Returns 0 if the scratch space is too small.
+ */
+static int secp256k1_ecmult_multi_accumulator_init(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, size_t max_n);
+
+/**
+ * Returns the smallest amount of unused scratch space budget with which an
+ * accumulator initialized with max_n = n buffers all n pairs, or as many as
+ * secp256k1_ecmult_multi_var handles in a single batch.
+ */
+static size_t secp256k1_ecmult_multi_accumulator_scratch_size(const secp256k1_ecmult_context *ctx, size_t n);
+
+/** Adds sc*pt to the accumulated sum. Returns 0 if a flush failed, after
+ *  which the accumulator only fails. */
+static int secp256k1_ecmult_multi_accumulator_add(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_scalar *sc, const secp256k1_ge *pt);
+
+/** Adds sc*G to the accumulated sum. */
+static void secp256k1_ecmult_multi_accumulator_add_g(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_scalar *sc);
+
+/** Computes the accumulated sum into r and releases the scratch frame.
+ *  Returns 0 if a flush failed. */
+static int secp256k1_ecmult_multi_accumulator_finalize(secp256k1_ecmult_multi_accumulator *acc, secp256k1_gej *r);
+
+/** Releases the scratch frame of an accumulator without computing its sum. */
+static void secp256k1_ecmult_multi_accumulator_clear(secp256k1_ecmult_multi_accumulator *acc);
+
+/**
+ * Measures on this machine for which numbers of points pippenger beats strauss
+ * and the batch-affine pippenger variant beats the Jacobian one, and which
+ * bucket window is fastest, and stores the result in ctx->tuning. Only
+ * multi-multiplications of up to max_points points are timed; the parameters
+ * for larger ones keep their previous values. The scratch space must be large
+ * enough for a few copies of max_points points, otherwise max_points is
+ * reduced.
+ * Returns: 1 on success
+ *          0 if the scratch space is too small or no clock is available, in
+ *          which case ctx->tuning is unchanged
+ */
+static int secp256k1_ecmult_calibrate(secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, size_t max_points);
+
+/** Serialize tuning parameters into SECP256K1_ECMULT_TUNING_SERIALIZED_SIZE bytes. */
+static void secp256k1_ecmult_tuning_serialize(unsigned char *output, const secp256k1_ecmult_tuning *tuning);
+
+/** Parse tuning parameters written by secp256k1_ecmult_tuning_serialize.
+ *  Returns 0 if the input is malformed or was created for a build with
+ *  different ecmult parameters. */
+static int secp256k1_ecmult_tuning_parse(secp256k1_ecmult_tuning *tuning, const unsigned char *input);
+
 #endif /* SECP256K1_ECMULT_H */
@@ -9,7 +9,9 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
+#include "cpu.h"
 #include "group.h"
 #include "scalar.h"
 #include "ecmult.h"
@@ -53,11 +55,28 @@
 /** The number of entries a table with precomputed multiples needs to have. */
 #define ECMULT_TABLE_SIZE(w) (1 << ((w)-2))
 
+#ifdef USE_ECMULT_STATIC_PRECOMPUTATION
+#include "ecmult_static_pre_g.h"
+#if ECMULT_STATIC_WINDOW_G != WINDOW_G
+#error "ecmult_static_pre_g.h was generated for a different WINDOW_G"
+#endif
+#endif
+
 /* The number of objects allocated on the scratch space for ecmult_multi algorithms */
 #define PIPPENGER_SCRATCH_OBJECTS 6
 #define STRAUSS_SCRATCH_OBJECTS 6
 
-#define PIPPENGER_MAX_BUCKET_WINDOW 12
+#define PIPPENGER_PARALLEL_SCRATCH_OBJECTS 8
+#define PIPPENGER_AFFINE_SCRATCH_OBJECTS 14
+
+/* Number of pending bucket additions to look ahead when prefetching buckets in
+ * pippenger_affine_wnaf. */
+#define PIPPENGER_AFFINE_PREFETCH_DISTANCE 8
+
+/* Minimum number of points (including endomorphism splits) handed to a single
+ * task when a multi-multiplication is split over several tasks. Below this the
+ * per-task doublings and bucket accumulation dominate. */
+#define ECMULT_PARALLEL_MIN_POINTS_PER_TASK 256
 
 /* Minimum number of points for which pippenger_wnaf is faster than strauss wnaf */
 #ifdef USE_ENDOMORPHISM
@@ -66,6 +85,10 @@
     #define ECMULT_PIPPENGER_THRESHOLD 160
 #endif
 
+/* Minimum number of points for which pippenger_affine_wnaf is faster than
+ * pippenger_wnaf */
+#define ECMULT_PIPPENGER_AFFINE_THRESHOLD 2048
+
 #ifdef USE_ENDOMORPHISM
     #define ECMULT_MAX_POINTS_PER_BATCH 5000000
 #else
@@ -187,19 +210,26 @@ static void secp256k1_ecmult_context_init(secp256k1_ecmult_context *ctx) {
 #ifdef USE_ENDOMORPHISM
     ctx->pre_g_128 = NULL;
 #endif
+    ctx->task_runner.fn = NULL;
+    ctx->task_runner.data = NULL;
+    ctx->task_runner.n_tasks = 1;
+    secp256k1_ecmult_tuning_set_default(&ctx->tuning);
 }
 
 static void secp256k1_ecmult_context_build(secp256k1_ecmult_context *ctx, const secp256k1_callback *cb) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
     secp256k1_gej gj;
+#endif
 
     if (ctx->pre_g != NULL) {
         return;
     }
 
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
     /* get the generator */
     secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
 
-    ctx->pre_g = (secp256k1_ge_storage (*)[])checked_malloc(cb, sizeof((*ctx->pre_g)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
+    ctx->pre_g = (secp256k1_ge_storage (*)[])secp256k1_shared_malloc(cb, sizeof((*ctx->pre_g)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
 
     /* precompute the tables with odd multiples */
     secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(WINDOW_G), *ctx->pre_g, &gj, cb);
@@ -209,7 +239,7 @@ static void secp256k1_ecmult_context_build(secp256k1_ecmult_context *ctx, const
         secp256k1_gej g_128j;
         int i;
 
-        ctx->pre_g_128 = (secp256k1_ge_storage (*)[])checked_malloc(cb, sizeof((*ctx->pre_g_128)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
+        ctx->pre_g_128 = (secp256k1_ge_storage (*)[])secp256k1_shared_malloc(cb, sizeof((*ctx->pre_g_128)[0]) * ECMULT_TABLE_SIZE(WINDOW_G));
 
         /* calculate 2^128*generator */
         g_128j = gj;
@@ -219,26 +249,41 @@ static void secp256k1_ecmult_context_build(secp256k1_ecmult_context *ctx, const
         secp256k1_ecmult_odd_multiples_table_storage_var(ECMULT_TABLE_SIZE(WINDOW_G), *ctx->pre_g_128, &g_128j, cb);
     }
 #endif
+#else
+    (void)cb;
+    ctx->pre_g = (secp256k1_ge_storage (*)[])secp256k1_ecmult_static_pre_g;
+#ifdef USE_ENDOMORPHISM
+    ctx->pre_g_128 = (secp256k1_ge_storage (*)[])secp256k1_ecmult_static_pre_g_128;
+#endif
+#endif
 }
 
 static void secp256k1_ecmult_context_clone(secp256k1_ecmult_context *dst,
                                            const secp256k1_ecmult_context *src, const secp256k1_callback *cb) {
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
     if (src->pre_g == NULL) {
         dst->pre_g = NULL;
     } else {
         size_t size = sizeof((*dst->pre_g)[0]) * ECMULT_TABLE_SIZE(WINDOW_G);
-        dst->pre_g = (secp256k1_ge_storage (*)[])checked_malloc(cb, size);
-        memcpy(dst->pre_g, src->pre_g, size);
+        dst->pre_g = (secp256k1_ge_storage (*)[])secp256k1_shared_clone(cb, src->pre_g, size);
     }
 #ifdef USE_ENDOMORPHISM
     if (src->pre_g_128 == NULL) {
         dst->pre_g_128 = NULL;
     } else {
         size_t size = sizeof((*dst->pre_g_128)[0]) * ECMULT_TABLE_SIZE(WINDOW_G);
-        dst->pre_g_128 = (secp256k1_ge_storage (*)[])checked_malloc(cb, size);
-        memcpy(dst->pre_g_128, src->pre_g_128, size);
+        dst->pre_g_128 = (secp256k1_ge_storage (*)[])secp256k1_shared_clone(cb, src->pre_g_128, size);
     }
 #endif
+#else
+    (void)cb;
+    dst->pre_g = src->pre_g;
+#ifdef USE_ENDOMORPHISM
+    dst->pre_g_128 = src->pre_g_128;
+#endif
+#endif
+    dst->task_runner = src->task_runner;
+    dst->tuning = src->tuning;
 }
 
 static int secp256k1_ecmult_context_is_built(const secp256k1_ecmult_context *ctx) {
@@ -246,9 +291,11 @@ static int secp256k1_ecmult_context_is_built(const secp256k1_ecmult_context *ctx
 }
 
 static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context *ctx) {
-    free(ctx->pre_g);
+#ifndef USE_ECMULT_STATIC_PRECOMPUTATION
+    secp256k1_shared_free(ctx->pre_g);
 #ifdef USE_ENDOMORPHISM
-    free(ctx->pre_g_128);
+    secp256k1_shared_free(ctx->pre_g_128);
+#endif
 #endif
     secp256k1_ecmult_context_init(ctx);
 }
@@ -505,6 +552,25 @@ static void secp256k1_ecmult(const secp256k1_ecmult_context *ctx, secp256k1_gej
     secp256k1_ecmult_strauss_wnaf(ctx, &state, r, 1, a, na, ng);
 }
 
+/* Inputs of secp256k1_ecmult_multi_var_array. The batch functions below are
+ * given a NULL callback and a pointer to this struct as callback data in that
+ * case, and then read the arrays directly instead of making an indirect call
+ * for every point. */
+typedef struct {
+    const secp256k1_scalar *scalars;
+    const secp256k1_ge *points;
+} secp256k1_ecmult_multi_arrays;
+
+static SECP256K1_INLINE int secp256k1_ecmult_multi_load(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, secp256k1_ecmult_multi_callback cb, void *cbdata) {
+    if (cb == NULL) {
+        const secp256k1_ecmult_multi_arrays *arrays = (const secp256k1_ecmult_multi_arrays *) cbdata;
+        *sc = arrays->scalars[idx];
+        *pt = arrays->points[idx];
+        return 1;
+    }
+    return cb(sc, pt, idx, cbdata);
+}
+
 static size_t secp256k1_strauss_scratch_size(size_t n_points) {
 #ifdef USE_ENDOMORPHISM
     static const size_t point_size = (2 * sizeof(secp256k1_ge) + sizeof(secp256k1_gej) + sizeof(secp256k1_fe)) * ECMULT_TABLE_SIZE(WINDOW_A) + sizeof(struct secp256k1_strauss_point_state) + sizeof(secp256k1_gej) + sizeof(secp256k1_scalar);
@@ -542,7 +608,7 @@ static int secp256k1_ecmult_strauss_batch(const secp256k1_ecmult_context *ctx, s
 
     for (i = 0; i < n_points; i++) {
         secp256k1_ge point;
-        if (!cb(&scalars[i], &point, i+cb_offset, cbdata)) {
+        if (!secp256k1_ecmult_multi_load(&scalars[i], &point, i+cb_offset, cb, cbdata)) {
             secp256k1_scratch_deallocate_frame(scratch);
             return 0;
         }
@@ -558,8 +624,12 @@ static int secp256k1_ecmult_strauss_batch_single(const secp256k1_ecmult_context
     return secp256k1_ecmult_strauss_batch(actx, scratch, r, inp_g_sc, cb, cbdata, n, 0);
 }
 
-static size_t secp256k1_strauss_max_points(secp256k1_scratch *scratch) {
-    return secp256k1_scratch_max_allocation(scratch, STRAUSS_SCRATCH_OBJECTS) / secp256k1_strauss_scratch_size(1);
+/**
+ * Returns the maximum number of points that can be used with strauss when
+ * `available` bytes of the scratch space budget are left.
+ */
+static size_t secp256k1_strauss_max_points(size_t available) {
+    return secp256k1_scratch_max_allocation_within(available, STRAUSS_SCRATCH_OBJECTS) / secp256k1_strauss_scratch_size(1);
 }
 
 /** Convert a number to WNAF notation.
@@ -641,6 +711,56 @@ struct secp256k1_pippenger_state {
     struct secp256k1_pippenger_point_state* ps;
 };
 
+/* Additions of points to buckets, collected so that four of them to distinct
+ * buckets can be performed at once by secp256k1_gej_add_ge_var_4x. Without
+ * AVX2 every addition is performed immediately. */
+struct secp256k1_pippenger_pending {
+    secp256k1_gej *bucket[4];
+    secp256k1_ge pt[4];
+    int n;
+    int use_4x;
+};
+
+static void secp256k1_pippenger_pending_init(struct secp256k1_pippenger_pending *pending) {
+    pending->n = 0;
+    pending->use_4x = secp256k1_cpu_has_avx2();
+}
+
+static void secp256k1_pippenger_pending_add(struct secp256k1_pippenger_pending *pending, secp256k1_gej *bucket, const secp256k1_ge *pt) {
+#ifdef USE_AVX2
+    if (pending->use_4x) {
+        int k;
+        for (k = 0; k < pending->n; k++) {
+            if (pending->bucket[k] == bucket) {
+                /* Perform the earlier addition to this bucket now and let
+                 * this one take its place */
+                secp256k1_gej_add_ge_var(bucket, bucket, &pending->pt[k], NULL);
+                pending->pt[k] = *pt;
+                return;
+            }
+        }
+        pending->bucket[pending->n] = bucket;
+        pending->pt[pending->n] = *pt;
+        if (++pending->n == 4) {
+            secp256k1_gej_add_ge_var_4x(pending->bucket, pending->pt);
+            pending->n = 0;
+        }
+        return;
+    }
+#else
+    (void)pending;
+#endif
+    secp256k1_gej_add_ge_var(bucket, bucket, pt, NULL);
+}
+
+static void secp256k1_pippenger_pending_flush(struct secp256k1_pippenger_pending *pending) {
+    int k;
+    for (k = 0; k < pending->n; k++) {
+        secp256k1_gej_add_ge_var(pending->bucket[k], pending->bucket[k], &pending->pt[k], NULL);
+    }
+    pending->n = 0;
+}
+
 /*
  * pippenger_wnaf computes the result of a multi-point multiplication as
  * follows: The scalars are brought into wnaf with n_wnaf elements each. Then
@@ -654,6 +774,7 @@ static int secp256k1_ecmult_pippenger_wnaf(secp256k1_gej *buckets, int bucket_wi
     size_t no = 0;
     int i;
     int j;
+    struct secp256k1_pippenger_pending pending;
 
     for (np = 0; np < num; ++np) {
         if (secp256k1_scalar_is_zero(&sc[np]) || secp256k1_ge_is_infinity(&pt[np])) {
@@ -669,6 +790,7 @@ static int secp256k1_ecmult_pippenger_wnaf(secp256k1_gej *buckets, int bucket_wi
         return 1;
     }
 
+    secp256k1_pippenger_pending_init(&pending);
     for (i = n_wnaf - 1; i >= 0; i--) {
         secp256k1_gej running_sum;
 
@@ -687,18 +809,19 @@ static int secp256k1_ecmult_pippenger_wnaf(secp256k1_gej *buckets, int bucket_wi
                 int skew = point_state.skew_na;
                 if (skew) {
                     secp256k1_ge_neg(&tmp, &pt[point_state.input_pos]);
-                    secp256k1_gej_add_ge_var(&buckets[0], &buckets[0], &tmp, NULL);
+                    secp256k1_pippenger_pending_add(&pending, &buckets[0], &tmp);
                 }
             }
             if (n > 0) {
                 idx = (n - 1)/2;
-                secp256k1_gej_add_ge_var(&buckets[idx], &buckets[idx], &pt[point_state.input_pos], NULL);
+                secp256k1_pippenger_pending_add(&pending, &buckets[idx], &pt[point_state.input_pos]);
             } else if (n < 0) {
                 idx = -(n + 1)/2;
                 secp256k1_ge_neg(&tmp, &pt[point_state.input_pos]);
-                secp256k1_gej_add_ge_var(&buckets[idx], &buckets[idx], &tmp, NULL);
+                secp256k1_pippenger_pending_add(&pending, &buckets[idx], &tmp);
             }
         }
+        secp256k1_pippenger_pending_flush(&pending);
 
         for(j = 0; j < bucket_window; j++) {
             secp256k1_gej_double_var(r, r, NULL);
@@ -819,6 +942,29 @@ static size_t secp256k1_pippenger_bucket_window_inv(int bucket_window) {
     return 0;
 }
 
+static void secp256k1_ecmult_tuning_set_default(secp256k1_ecmult_tuning *tuning) {
+    int i;
+    tuning->pippenger_threshold = ECMULT_PIPPENGER_THRESHOLD;
+    tuning->pippenger_affine_threshold = ECMULT_PIPPENGER_AFFINE_THRESHOLD;
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW; i++) {
+        tuning->bucket_window_max_points[i] = secp256k1_pippenger_bucket_window_inv(i + 1);
+    }
+}
+
+/**
+ * Like secp256k1_pippenger_bucket_window, but according to the given tuning
+ * parameters.
+ */
+static int secp256k1_pippenger_tuned_bucket_window(const secp256k1_ecmult_tuning *tuning, size_t n) {
+    int i;
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW - 1; i++) {
+        if (n <= tuning->bucket_window_max_points[i]) {
+            break;
+        }
+    }
+    return i + 1;
+}
+
 
 #ifdef USE_ENDOMORPHISM
 SECP256K1_INLINE static void secp256k1_ecmult_endo_split(secp256k1_scalar *s1, secp256k1_scalar *s2, secp256k1_ge *p1, secp256k1_ge *p2) {
@@ -869,13 +1015,12 @@ static int secp256k1_ecmult_pippenger_batch(const secp256k1_ecmult_context *ctx,
     int i, j;
     int bucket_window;
 
-    (void)ctx;
     secp256k1_gej_set_infinity(r);
     if (inp_g_sc == NULL && n_points == 0) {
         return 1;
     }
 
-    bucket_window = secp256k1_pippenger_bucket_window(n_points);
+    bucket_window = secp256k1_pippenger_tuned_bucket_window(&ctx->tuning, n_points);
     if (!secp256k1_scratch_allocate_frame(scratch, secp256k1_pippenger_scratch_size(n_points, bucket_window), PIPPENGER_SCRATCH_OBJECTS)) {
         return 0;
     }
@@ -897,7 +1042,7 @@ static int secp256k1_ecmult_pippenger_batch(const secp256k1_ecmult_context *ctx,
     }
 
     while (point_idx < n_points) {
-        if (!cb(&scalars[idx], &points[idx], point_idx + cb_offset, cbdata)) {
+        if (!secp256k1_ecmult_multi_load(&scalars[idx], &points[idx], point_idx + cb_offset, cb, cbdata)) {
             secp256k1_scratch_deallocate_frame(scratch);
             return 0;
         }
@@ -931,19 +1076,580 @@ static int secp256k1_ecmult_pippenger_batch_single(const secp256k1_ecmult_contex
     return secp256k1_ecmult_pippenger_batch(actx, scratch, r, inp_g_sc, cb, cbdata, n, 0);
 }
 
+#define PIPPENGER_AFFINE_NEG 1
+#define PIPPENGER_AFFINE_DOUBLE 2
+
+/* A pending addition of the (possibly negated) point at input_pos to a bucket */
+struct secp256k1_pippenger_affine_entry {
+    size_t input_pos;
+    int bucket;
+    int flags;
+};
+
+/* Buckets in affine coordinates, stored as separate arrays of x and y
+ * coordinates, together with the space needed to schedule the additions. */
+struct secp256k1_pippenger_affine_state {
+    secp256k1_fe *x;
+    secp256k1_fe *y;
+    unsigned char *used;
+    /* mark[j] is the number of the last round that touched bucket j */
+    size_t *mark;
+    size_t round;
+    /* Additions of the current round and their denominators */
+    struct secp256k1_pippenger_affine_entry *batch;
+    secp256k1_fe *den;
+    secp256k1_fe *inv;
+    size_t n_batch;
+    /* Additions to buckets that are already touched by the current round */
+    struct secp256k1_pippenger_affine_entry *queue;
+    size_t n_queue;
+    size_t batch_size;
+};
+
 /**
- * Returns the maximum number of points in addition to G that can be used with
- * a given scratch space. The function ensures that fewer points may also be
- * used.
+ * Returns the maximum number of additions that are batched into a single
+ * inversion for a given bucket_window. Larger batches amortize the inversion
+ * better but are more likely to hit a bucket twice.
+ */
+static size_t secp256k1_pippenger_affine_batch_size(int bucket_window) {
+    return ((size_t)1 << bucket_window) / 4 + 1;
+}
+
+SECP256K1_INLINE static void secp256k1_pippenger_affine_load(secp256k1_fe *x, secp256k1_fe *y, const secp256k1_ge *pt, int flags) {
+    *x = pt->x;
+    *y = pt->y;
+    secp256k1_fe_normalize_weak(x);
+    secp256k1_fe_normalize_weak(y);
+    if (flags & PIPPENGER_AFFINE_NEG) {
+        secp256k1_fe_negate(y, y, 1);
+        secp256k1_fe_normalize_weak(y);
+    }
+}
+
+/* Adds the point of e to its bucket if the bucket is empty or the point
+ * cancels it, and otherwise schedules the addition in the current round.
+ * Returns 0 if the bucket is already touched by the current round. */
+static int secp256k1_pippenger_affine_schedule(struct secp256k1_pippenger_affine_state *buckets, const secp256k1_ge *pt, const struct secp256k1_pippenger_affine_entry *e) {
+    struct secp256k1_pippenger_affine_entry *be;
+    secp256k1_fe *den;
+    secp256k1_fe px, py;
+    int b = e->bucket;
+
+    if (buckets->mark[b] == buckets->round) {
+        return 0;
+    }
+    buckets->mark[b] = buckets->round;
+    secp256k1_pippenger_affine_load(&px, &py, &pt[e->input_pos], e->flags);
+    if (!buckets->used[b]) {
+        buckets->x[b] = px;
+        buckets->y[b] = py;
+        buckets->used[b] = 1;
+        return 1;
+    }
+    be = &buckets->batch[buckets->n_batch];
+    den = &buckets->den[buckets->n_batch];
+    *be = *e;
+    /* lambda = (py - y) / (px - x) */
+    secp256k1_fe_negate(den, &buckets->x[b], 1);
+    secp256k1_fe_add(den, &px);
+    if (secp256k1_fe_normalizes_to_zero_var(den)) {
+        if (!secp256k1_fe_equal_var(&buckets->y[b], &py)) {
+            /* The point cancels the bucket */
+            buckets->used[b] = 0;
+            return 1;
+        }
+        /* lambda = 3*x^2 / 2*y */
+        *den = buckets->y[b];
+        secp256k1_fe_mul_int(den, 2);
+        be->flags |= PIPPENGER_AFFINE_DOUBLE;
+    }
+    buckets->n_batch++;
+    return 1;
+}
+
+/* Performs the additions scheduled in the current round using a single
+ * inversion, then starts a new round with the queued additions. Repeats
+ * until neither the batch nor the queue is full. */
+static void secp256k1_pippenger_affine_flush(struct secp256k1_pippenger_affine_state *buckets, const secp256k1_ge *pt) {
+    do {
+        size_t n_queue = buckets->n_queue;
+        size_t k;
+
+        secp256k1_fe_inv_all_var(buckets->inv, buckets->den, buckets->n_batch);
+        for (k = 0; k < buckets->n_batch; k++) {
+            const struct secp256k1_pippenger_affine_entry *e = &buckets->batch[k];
+            secp256k1_fe *x = &buckets->x[e->bucket];
+            secp256k1_fe *y = &buckets->y[e->bucket];
+            secp256k1_fe px, py, lambda, t, x3, y3;
+
+            secp256k1_pippenger_affine_load(&px, &py, &pt[e->input_pos], e->flags);
+            if (e->flags & PIPPENGER_AFFINE_DOUBLE) {
+                secp256k1_fe_sqr(&t, x);
+                secp256k1_fe_mul_int(&t, 3);
+            } else {
+                secp256k1_fe_negate(&t, y, 1);
+                secp256k1_fe_add(&t, &py);
+            }
+            secp256k1_fe_mul(&lambda, &t, &buckets->inv[k]);
+            /* x3 = lambda^2 - x - px */
+            secp256k1_fe_sqr(&x3, &lambda);
+            secp256k1_fe_negate(&t, x, 1);
+            secp256k1_fe_add(&x3, &t);
+            secp256k1_fe_negate(&t, &px, 1);
+            secp256k1_fe_add(&x3, &t);
+            secp256k1_fe_normalize_weak(&x3);
+            /* y3 = lambda*(x - x3) - y */
+            secp256k1_fe_negate(&t, &x3, 1);
+            secp256k1_fe_add(&t, x);
+            secp256k1_fe_mul(&y3, &lambda, &t);
+            secp256k1_fe_negate(&t, y, 1);
+            secp256k1_fe_add(&y3, &t);
+            secp256k1_fe_normalize_weak(&y3);
+            *x = x3;
+            *y = y3;
+        }
+        buckets->n_batch = 0;
+        buckets->round++;
+
+        /* The queue is never larger than a batch, so this can't overflow it */
+        buckets->n_queue = 0;
+        for (k = 0; k < n_queue; k++) {
+            if (!secp256k1_pippenger_affine_schedule(buckets, pt, &buckets->queue[k])) {
+                buckets->queue[buckets->n_queue++] = buckets->queue[k];
+            }
+        }
+    } while (buckets->n_batch == buckets->batch_size || buckets->n_queue == buckets->batch_size);
+}
+
+/*
+ * pippenger_affine_wnaf computes the same result as pippenger_wnaf, but keeps
+ * the buckets in affine coordinates. Adding two affine points only requires a
+ * single field inversion, which is shared between many additions using
+ * Montgomery's trick: additions are collected in rounds in which every bucket
+ * is touched at most once, all denominators of a round are inverted at once
+ * with secp256k1_fe_inv_all_var, and additions to a bucket that was already
+ * touched are queued for the next round. The wnaf skew corrections all go to
+ * bucket 0 and are accumulated separately in Jacobian coordinates.
  */
-static size_t secp256k1_pippenger_max_points(secp256k1_scratch *scratch) {
-    size_t max_alloc = secp256k1_scratch_max_allocation(scratch, PIPPENGER_SCRATCH_OBJECTS);
+static int secp256k1_ecmult_pippenger_affine_wnaf(struct secp256k1_pippenger_affine_state *buckets, int bucket_window, struct secp256k1_pippenger_state *state, secp256k1_gej *r, const secp256k1_scalar *sc, const secp256k1_ge *pt, size_t num) {
+    size_t n_wnaf = WNAF_SIZE(bucket_window+1);
+    size_t np;
+    size_t no = 0;
+    int i;
+    int j;
+
+    for (np = 0; np < num; ++np) {
+        if (secp256k1_scalar_is_zero(&sc[np]) || secp256k1_ge_is_infinity(&pt[np])) {
+            continue;
+        }
+        state->ps[no].input_pos = np;
+        state->ps[no].skew_na = secp256k1_wnaf_fixed(&state->wnaf_na[no*n_wnaf], &sc[np], bucket_window+1);
+        no++;
+    }
+    secp256k1_gej_set_infinity(r);
+
+    if (no == 0) {
+        return 1;
+    }
+
+    for(j = 0; j < ECMULT_TABLE_SIZE(bucket_window+2); j++) {
+        buckets->mark[j] = 0;
+    }
+    buckets->round = 1;
+    buckets->n_batch = 0;
+    buckets->n_queue = 0;
+    buckets->batch_size = secp256k1_pippenger_affine_batch_size(bucket_window);
+
+    for (i = n_wnaf - 1; i >= 0; i--) {
+        secp256k1_gej running_sum;
+        secp256k1_gej skew_sum;
+
+        for(j = 0; j < ECMULT_TABLE_SIZE(bucket_window+2); j++) {
+            buckets->used[j] = 0;
+        }
+        secp256k1_gej_set_infinity(&skew_sum);
+
+        for (np = 0; np < no; ++np) {
+            int n = state->wnaf_na[np*n_wnaf + i];
+            struct secp256k1_pippenger_point_state point_state = state->ps[np];
+            struct secp256k1_pippenger_affine_entry e;
+
+            if (np + PIPPENGER_AFFINE_PREFETCH_DISTANCE < no) {
+                int pn = state->wnaf_na[(np + PIPPENGER_AFFINE_PREFETCH_DISTANCE)*n_wnaf + i];
+                int pidx = pn > 0 ? (pn - 1)/2 : -(pn + 1)/2;
+                PREFETCH(&buckets->x[pidx]);
+                PREFETCH(&buckets->y[pidx]);
+            }
+            if (i == 0 && point_state.skew_na) {
+                /* correct for wnaf skew */
+                secp256k1_ge tmp;
+                secp256k1_ge_neg(&tmp, &pt[point_state.input_pos]);
+                secp256k1_gej_add_ge_var(&skew_sum, &skew_sum, &tmp, NULL);
+            }
+            if (n == 0) {
+                continue;
+            }
+            e.input_pos = point_state.input_pos;
+            if (n > 0) {
+                e.bucket = (n - 1)/2;
+                e.flags = 0;
+            } else {
+                e.bucket = -(n + 1)/2;
+                e.flags = PIPPENGER_AFFINE_NEG;
+            }
+            if (!secp256k1_pippenger_affine_schedule(buckets, pt, &e)) {
+                buckets->queue[buckets->n_queue++] = e;
+            }
+            if (buckets->n_batch == buckets->batch_size || buckets->n_queue == buckets->batch_size) {
+                secp256k1_pippenger_affine_flush(buckets, pt);
+            }
+        }
+        while (buckets->n_batch > 0 || buckets->n_queue > 0) {
+            secp256k1_pippenger_affine_flush(buckets, pt);
+        }
+
+        for(j = 0; j < bucket_window; j++) {
+            secp256k1_gej_double_var(r, r, NULL);
+        }
+
+        /* See pippenger_wnaf */
+        secp256k1_gej_set_infinity(&running_sum);
+        for(j = ECMULT_TABLE_SIZE(bucket_window+2) - 1; j > 0; j--) {
+            if (buckets->used[j]) {
+                secp256k1_ge tmp;
+                secp256k1_ge_set_xy(&tmp, &buckets->x[j], &buckets->y[j]);
+                secp256k1_gej_add_ge_var(&running_sum, &running_sum, &tmp, NULL);
+            }
+            secp256k1_gej_add_var(r, r, &running_sum, NULL);
+        }
+
+        if (buckets->used[0]) {
+            secp256k1_ge tmp;
+            secp256k1_ge_set_xy(&tmp, &buckets->x[0], &buckets->y[0]);
+            secp256k1_gej_add_ge_var(&running_sum, &running_sum, &tmp, NULL);
+        }
+        secp256k1_gej_add_var(&running_sum, &running_sum, &skew_sum, NULL);
+        secp256k1_gej_double_var(r, r, NULL);
+        secp256k1_gej_add_var(r, r, &running_sum, NULL);
+    }
+    return 1;
+}
+
+/**
+ * Returns the scratch size required by secp256k1_ecmult_pippenger_affine_batch
+ * for a given number of points (excluding base point G) without considering
+ * alignment.
+ */
+static size_t secp256k1_pippenger_affine_scratch_size(size_t n_points, int bucket_window) {
+#ifdef USE_ENDOMORPHISM
+    size_t entries = 2*n_points + 2;
+#else
+    size_t entries = n_points + 1;
+#endif
+    size_t entry_size = sizeof(secp256k1_ge) + sizeof(secp256k1_scalar) + sizeof(struct secp256k1_pippenger_point_state) + (WNAF_SIZE(bucket_window+1)+1)*sizeof(int);
+    size_t bucket_size = 2*sizeof(secp256k1_fe) + sizeof(unsigned char) + sizeof(size_t);
+    size_t batch_entry_size = 2*sizeof(secp256k1_fe) + 2*sizeof(struct secp256k1_pippenger_affine_entry);
+    return ((1<<bucket_window) * bucket_size + secp256k1_pippenger_affine_batch_size(bucket_window) * batch_entry_size + sizeof(struct secp256k1_pippenger_state) + sizeof(struct secp256k1_pippenger_affine_state) + entries * entry_size);
+}
+
+/**
+ * Like secp256k1_ecmult_pippenger_batch, but uses pippenger_affine_wnaf.
+ */
+static int secp256k1_ecmult_pippenger_affine_batch(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n_points, size_t cb_offset) {
+#ifdef USE_ENDOMORPHISM
+    size_t entries = 2*n_points + 2;
+#else
+    size_t entries = n_points + 1;
+#endif
+    secp256k1_ge *points;
+    secp256k1_scalar *scalars;
+    struct secp256k1_pippenger_affine_state *buckets;
+    struct secp256k1_pippenger_state *state_space;
+    size_t n_buckets;
+    size_t batch_size;
+    size_t idx = 0;
+    size_t point_idx = 0;
+    size_t i;
+    int j;
+    int bucket_window;
+
+    secp256k1_gej_set_infinity(r);
+    if (inp_g_sc == NULL && n_points == 0) {
+        return 1;
+    }
+
+    bucket_window = secp256k1_pippenger_tuned_bucket_window(&ctx->tuning, n_points);
+    n_buckets = (size_t)1 << bucket_window;
+    batch_size = secp256k1_pippenger_affine_batch_size(bucket_window);
+    if (!secp256k1_scratch_allocate_frame(scratch, secp256k1_pippenger_affine_scratch_size(n_points, bucket_window), PIPPENGER_AFFINE_SCRATCH_OBJECTS)) {
+        return 0;
+    }
+    points = (secp256k1_ge *) secp256k1_scratch_alloc(scratch, entries * sizeof(*points));
+    scalars = (secp256k1_scalar *) secp256k1_scratch_alloc(scratch, entries * sizeof(*scalars));
+    state_space = (struct secp256k1_pippenger_state *) secp256k1_scratch_alloc(scratch, sizeof(*state_space));
+    state_space->ps = (struct secp256k1_pippenger_point_state *) secp256k1_scratch_alloc(scratch, entries * sizeof(*state_space->ps));
+    state_space->wnaf_na = (int *) secp256k1_scratch_alloc(scratch, entries*(WNAF_SIZE(bucket_window+1)) * sizeof(int));
+    buckets = (struct secp256k1_pippenger_affine_state *) secp256k1_scratch_alloc(scratch, sizeof(*buckets));
+    buckets->x = (secp256k1_fe *) secp256k1_scratch_alloc(scratch, n_buckets * sizeof(*buckets->x));
+    buckets->y = (secp256k1_fe *) secp256k1_scratch_alloc(scratch, n_buckets * sizeof(*buckets->y));
+    buckets->used = (unsigned char *) secp256k1_scratch_alloc(scratch, n_buckets * sizeof(*buckets->used));
+    buckets->mark = (size_t *) secp256k1_scratch_alloc(scratch, n_buckets * sizeof(*buckets->mark));
+    buckets->batch = (struct secp256k1_pippenger_affine_entry *) secp256k1_scratch_alloc(scratch, batch_size * sizeof(*buckets->batch));
+    buckets->den = (secp256k1_fe *) secp256k1_scratch_alloc(scratch, batch_size * sizeof(*buckets->den));
+    buckets->inv = (secp256k1_fe *) secp256k1_scratch_alloc(scratch, batch_size * sizeof(*buckets->inv));
+    buckets->queue = (struct secp256k1_pippenger_affine_entry *) secp256k1_scratch_alloc(scratch, batch_size * sizeof(*buckets->queue));
+
+    if (inp_g_sc != NULL) {
+        scalars[0] = *inp_g_sc;
+        points[0] = secp256k1_ge_const_g;
+        idx++;
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_endo_split(&scalars[0], &scalars[1], &points[0], &points[1]);
+        idx++;
+#endif
+    }
+
+    while (point_idx < n_points) {
+        if (!secp256k1_ecmult_multi_load(&scalars[idx], &points[idx], point_idx + cb_offset, cb, cbdata)) {
+            secp256k1_scratch_deallocate_frame(scratch);
+            return 0;
+        }
+        idx++;
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_endo_split(&scalars[idx - 1], &scalars[idx], &points[idx - 1], &points[idx]);
+        idx++;
+#endif
+        point_idx++;
+    }
+
+    secp256k1_ecmult_pippenger_affine_wnaf(buckets, bucket_window, state_space, r, scalars, points, idx);
+
+    /* Clear data */
+    for(i = 0; i < idx; i++) {
+        secp256k1_scalar_clear(&scalars[i]);
+        state_space->ps[i].skew_na = 0;
+        for(j = 0; j < WNAF_SIZE(bucket_window+1); j++) {
+            state_space->wnaf_na[i * WNAF_SIZE(bucket_window+1) + j] = 0;
+        }
+    }
+    for(i = 0; i < n_buckets; i++) {
+        secp256k1_fe_clear(&buckets->x[i]);
+        secp256k1_fe_clear(&buckets->y[i]);
+    }
+    secp256k1_scratch_deallocate_frame(scratch);
+    return 1;
+}
+
+/* Wrapper for secp256k1_ecmult_multi_func interface */
+static int secp256k1_ecmult_pippenger_affine_batch_single(const secp256k1_ecmult_context *actx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n) {
+    return secp256k1_ecmult_pippenger_affine_batch(actx, scratch, r, inp_g_sc, cb, cbdata, n, 0);
+}
+
+struct secp256k1_pippenger_task {
+    secp256k1_gej *buckets;
+    int bucket_window;
+    struct secp256k1_pippenger_state state;
+    const secp256k1_scalar *sc;
+    const secp256k1_ge *pt;
+    size_t num;
+    secp256k1_gej r;
+};
+
+static void secp256k1_ecmult_pippenger_task(void *task_data) {
+    struct secp256k1_pippenger_task *task = (struct secp256k1_pippenger_task *) task_data;
+    secp256k1_ecmult_pippenger_wnaf(task->buckets, task->bucket_window, &task->state, &task->r, task->sc, task->pt, task->num);
+}
+
+/**
+ * Returns the scratch size required to compute a multi-multiplication of
+ * n_points (excluding base point G) split over n_tasks tasks, without
+ * considering alignment.
+ */
+static size_t secp256k1_pippenger_parallel_scratch_size(const secp256k1_ecmult_context *ctx, size_t n_points, size_t n_tasks) {
+#ifdef USE_ENDOMORPHISM
+    size_t entries = 2*n_points + 2;
+#else
+    size_t entries = n_points + 1;
+#endif
+    int bucket_window = secp256k1_pippenger_tuned_bucket_window(&ctx->tuning, (entries + n_tasks - 1) / n_tasks);
+    return secp256k1_pippenger_scratch_size(n_points, bucket_window)
+        + (n_tasks - 1) * (1<<bucket_window) * sizeof(secp256k1_gej)
+        + n_tasks * (sizeof(struct secp256k1_pippenger_task) + sizeof(void *));
+}
+
+/**
+ * Returns the number of tasks a batch of n_points (excluding base point G) is
+ * split into, such that every task gets at least
+ * ECMULT_PARALLEL_MIN_POINTS_PER_TASK points.
+ */
+static size_t secp256k1_pippenger_parallel_n_tasks(const secp256k1_ecmult_context *ctx, size_t n_points) {
+#ifdef USE_ENDOMORPHISM
+    size_t entries = 2*n_points + 2;
+#else
+    size_t entries = n_points + 1;
+#endif
+    size_t n_tasks = ctx->task_runner.n_tasks;
+    if (n_tasks > entries / ECMULT_PARALLEL_MIN_POINTS_PER_TASK) {
+        n_tasks = entries / ECMULT_PARALLEL_MIN_POINTS_PER_TASK;
+    }
+    return n_tasks;
+}
+
+/**
+ * Returns the largest number of points not exceeding max_points for which a
+ * batch can be split over all of the tasks it is entitled to when `available`
+ * bytes of the scratch space budget are left, or max_points if no such number
+ * exists.
+ */
+static size_t secp256k1_pippenger_parallel_max_points(const secp256k1_ecmult_context *ctx, size_t available, size_t max_points) {
+    size_t max_alloc = secp256k1_scratch_max_allocation_within(available, PIPPENGER_PARALLEL_SCRATCH_OBJECTS);
+    size_t n_points = max_points;
+
+    while (n_points > 0) {
+        size_t n_tasks = secp256k1_pippenger_parallel_n_tasks(ctx, n_points);
+        if (n_tasks < 2) {
+            break;
+        }
+        if (secp256k1_pippenger_parallel_scratch_size(ctx, n_points, n_tasks) <= max_alloc) {
+            return n_points;
+        }
+        n_points -= n_points / 16 + 1;
+    }
+    return max_points;
+}
+
+/**
+ * Like secp256k1_ecmult_pippenger_batch, but the points are split into
+ * consecutive ranges whose partial sums are computed by separate tasks of the
+ * context's task runner and added up at the end. Each task has its own set of
+ * buckets and a bucket window chosen for the size of its range. If the
+ * scratch space does not fit the additional buckets for at least two tasks,
+ * this falls back to secp256k1_ecmult_pippenger_batch.
+ */
+static int secp256k1_ecmult_pippenger_batch_parallel(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n_points, size_t cb_offset) {
+#ifdef USE_ENDOMORPHISM
+    size_t entries = 2*n_points + 2;
+#else
+    size_t entries = n_points + 1;
+#endif
+    size_t max_alloc = secp256k1_scratch_max_allocation(scratch, PIPPENGER_PARALLEL_SCRATCH_OBJECTS);
+    size_t n_tasks = secp256k1_pippenger_parallel_n_tasks(ctx, n_points);
+    secp256k1_ge *points;
+    secp256k1_scalar *scalars;
+    secp256k1_gej *buckets;
+    struct secp256k1_pippenger_state *state_space;
+    struct secp256k1_pippenger_task *tasks;
+    void **task_data;
+    size_t idx = 0;
+    size_t point_idx = 0;
+    size_t n_wnaf;
+    size_t i, j;
+    int bucket_window;
+
+    while (n_tasks > 1 && secp256k1_pippenger_parallel_scratch_size(ctx, n_points, n_tasks) > max_alloc) {
+        n_tasks--;
+    }
+    if (ctx->task_runner.fn == NULL || n_tasks < 2) {
+        return secp256k1_ecmult_pippenger_batch(ctx, scratch, r, inp_g_sc, cb, cbdata, n_points, cb_offset);
+    }
+
+    secp256k1_gej_set_infinity(r);
+    bucket_window = secp256k1_pippenger_tuned_bucket_window(&ctx->tuning, (entries + n_tasks - 1) / n_tasks);
+    n_wnaf = WNAF_SIZE(bucket_window+1);
+    if (!secp256k1_scratch_allocate_frame(scratch, secp256k1_pippenger_parallel_scratch_size(ctx, n_points, n_tasks), PIPPENGER_PARALLEL_SCRATCH_OBJECTS)) {
+        return 0;
+    }
+    points = (secp256k1_ge *) secp256k1_scratch_alloc(scratch, entries * sizeof(*points));
+    scalars = (secp256k1_scalar *) secp256k1_scratch_alloc(scratch, entries * sizeof(*scalars));
+    state_space = (struct secp256k1_pippenger_state *) secp256k1_scratch_alloc(scratch, sizeof(*state_space));
+    state_space->ps = (struct secp256k1_pippenger_point_state *) secp256k1_scratch_alloc(scratch, entries * sizeof(*state_space->ps));
+    state_space->wnaf_na = (int *) secp256k1_scratch_alloc(scratch, entries * n_wnaf * sizeof(int));
+    buckets = (secp256k1_gej *) secp256k1_scratch_alloc(scratch, n_tasks * (1<<bucket_window) * sizeof(*buckets));
+    tasks = (struct secp256k1_pippenger_task *) secp256k1_scratch_alloc(scratch, n_tasks * sizeof(*tasks));
+    task_data = (void **) secp256k1_scratch_alloc(scratch, n_tasks * sizeof(*task_data));
+
+    if (inp_g_sc != NULL) {
+        scalars[0] = *inp_g_sc;
+        points[0] = secp256k1_ge_const_g;
+        idx++;
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_endo_split(&scalars[0], &scalars[1], &points[0], &points[1]);
+        idx++;
+#endif
+    }
+
+    while (point_idx < n_points) {
+        if (!secp256k1_ecmult_multi_load(&scalars[idx], &points[idx], point_idx + cb_offset, cb, cbdata)) {
+            secp256k1_scratch_deallocate_frame(scratch);
+            return 0;
+        }
+        idx++;
+#ifdef USE_ENDOMORPHISM
+        secp256k1_ecmult_endo_split(&scalars[idx - 1], &scalars[idx], &points[idx - 1], &points[idx]);
+        idx++;
+#endif
+        point_idx++;
+    }
+
+    /* Every task works on a disjoint range of the points and of the per-point
+     * state, so they can run concurrently without synchronization. */
+    for (i = 0; i < n_tasks; i++) {
+        size_t begin = idx * i / n_tasks;
+        size_t end = idx * (i + 1) / n_tasks;
+        tasks[i].buckets = &buckets[i * (1<<bucket_window)];
+        tasks[i].bucket_window = bucket_window;
+        tasks[i].state.ps = &state_space->ps[begin];
+        tasks[i].state.wnaf_na = &state_space->wnaf_na[begin * n_wnaf];
+        tasks[i].sc = &scalars[begin];
+        tasks[i].pt = &points[begin];
+        tasks[i].num = end - begin;
+        task_data[i] = &tasks[i];
+    }
+    if (!ctx->task_runner.fn(secp256k1_ecmult_pippenger_task, task_data, n_tasks, ctx->task_runner.data)) {
+        for (i = 0; i < n_tasks; i++) {
+            secp256k1_ecmult_pippenger_task(task_data[i]);
+        }
+    }
+    for (i = 0; i < n_tasks; i++) {
+        secp256k1_gej_add_var(r, r, &tasks[i].r, NULL);
+    }
+
+    /* Clear data */
+    for(i = 0; i < idx; i++) {
+        secp256k1_scalar_clear(&scalars[i]);
+        state_space->ps[i].skew_na = 0;
+        for(j = 0; j < n_wnaf; j++) {
+            state_space->wnaf_na[i * n_wnaf + j] = 0;
+        }
+    }
+    for(i = 0; i < n_tasks * (1<<bucket_window); i++) {
+        secp256k1_gej_clear(&buckets[i]);
+    }
+    for(i = 0; i < n_tasks; i++) {
+        secp256k1_gej_clear(&tasks[i].r);
+    }
+    secp256k1_scratch_deallocate_frame(scratch);
+    return 1;
+}
+
+/* Wrapper for secp256k1_ecmult_multi_func interface */
+static int secp256k1_ecmult_pippenger_batch_parallel_single(const secp256k1_ecmult_context *actx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n) {
+    return secp256k1_ecmult_pippenger_batch_parallel(actx, scratch, r, inp_g_sc, cb, cbdata, n, 0);
+}
+
+/**
+ * Returns the maximum number of points in addition to G that can be used when
+ * `available` bytes of the scratch space budget are left. The function
+ * ensures that fewer points may also be used.
+ */
+static size_t secp256k1_pippenger_max_points(const secp256k1_ecmult_context *ctx, size_t available) {
+    size_t max_alloc = secp256k1_scratch_max_allocation_within(available, PIPPENGER_SCRATCH_OBJECTS);
     int bucket_window;
     size_t res = 0;
 
     for (bucket_window = 1; bucket_window <= PIPPENGER_MAX_BUCKET_WINDOW; bucket_window++) {
         size_t n_points;
-        size_t max_points = secp256k1_pippenger_bucket_window_inv(bucket_window);
+        size_t max_points = ctx->tuning.bucket_window_max_points[bucket_window - 1];
         size_t space_for_points;
         size_t space_overhead;
         size_t entry_size = sizeof(secp256k1_ge) + sizeof(secp256k1_scalar) + sizeof(struct secp256k1_pippenger_point_state) + (WNAF_SIZE(bucket_window+1)+1)*sizeof(int);
@@ -987,7 +1693,7 @@ static int secp256k1_ecmult_multi_var_simple(const secp256k1_ecmult_context *ctx
         secp256k1_ge point;
         secp256k1_gej pointj;
         secp256k1_scalar scalar;
-        if (!cb(&scalar, &point, point_idx, cbdata)) {
+        if (!secp256k1_ecmult_multi_load(&scalar, &point, point_idx, cb, cbdata)) {
             return 0;
         }
         /* r += scalar*point */
@@ -999,11 +1705,66 @@ static int secp256k1_ecmult_multi_var_simple(const secp256k1_ecmult_context *ctx
 }
 
 typedef int (*secp256k1_ecmult_multi_func)(const secp256k1_ecmult_context*, secp256k1_scratch*, secp256k1_gej*, const secp256k1_scalar*, secp256k1_ecmult_multi_callback cb, void*, size_t);
+typedef int (*secp256k1_ecmult_multi_batch_func)(const secp256k1_ecmult_context*, secp256k1_scratch*, secp256k1_gej*, const secp256k1_scalar*, secp256k1_ecmult_multi_callback cb, void*, size_t, size_t);
+
+/**
+ * Chooses the algorithm and batch size secp256k1_ecmult_multi_var uses for n
+ * points (n > 0) when `available` bytes of the scratch space budget are left.
+ * Returns 0 if there is not enough space for a single point.
+ */
+static int secp256k1_ecmult_multi_plan(const secp256k1_ecmult_context *ctx, size_t available, size_t n, secp256k1_ecmult_multi_batch_func *f, size_t *n_batches, size_t *n_batch_points) {
+    size_t max_points = secp256k1_pippenger_max_points(ctx, available);
+    if (max_points == 0) {
+        return 0;
+    } else if (max_points > ECMULT_MAX_POINTS_PER_BATCH) {
+        max_points = ECMULT_MAX_POINTS_PER_BATCH;
+    }
+    if (ctx->task_runner.fn != NULL && ctx->task_runner.n_tasks > 1) {
+        /* Leave room for the buckets of every task */
+        max_points = secp256k1_pippenger_parallel_max_points(ctx, available, max_points);
+    }
+    *n_batches = (n+max_points-1)/max_points;
+    *n_batch_points = (n+*n_batches-1)/ *n_batches;
+
+    if (*n_batch_points >= ctx->tuning.pippenger_threshold) {
+        if (ctx->task_runner.fn != NULL && ctx->task_runner.n_tasks > 1) {
+            *f = secp256k1_ecmult_pippenger_batch_parallel;
+        } else {
+            *f = secp256k1_ecmult_pippenger_batch;
+            if (*n_batch_points >= ctx->tuning.pippenger_affine_threshold) {
+                /* The affine variant uses more scratch objects, so the
+                 * batches may have to be made smaller for it to fit. */
+                size_t max_alloc = secp256k1_scratch_max_allocation_within(available, PIPPENGER_AFFINE_SCRATCH_OBJECTS);
+                size_t n_affine_batches = *n_batches;
+                size_t n_affine_batch_points = *n_batch_points;
+                while (n_affine_batch_points >= ctx->tuning.pippenger_affine_threshold
+                       && secp256k1_pippenger_affine_scratch_size(n_affine_batch_points, secp256k1_pippenger_tuned_bucket_window(&ctx->tuning, n_affine_batch_points)) > max_alloc) {
+                    n_affine_batches++;
+                    n_affine_batch_points = (n+n_affine_batches-1)/n_affine_batches;
+                }
+                if (n_affine_batch_points >= ctx->tuning.pippenger_affine_threshold) {
+                    *n_batches = n_affine_batches;
+                    *n_batch_points = n_affine_batch_points;
+                    *f = secp256k1_ecmult_pippenger_affine_batch;
+                }
+            }
+        }
+    } else {
+        max_points = secp256k1_strauss_max_points(available);
+        if (max_points == 0) {
+            return 0;
+        }
+        *n_batches = (n+max_points-1)/max_points;
+        *n_batch_points = (n+*n_batches-1)/ *n_batches;
+        *f = secp256k1_ecmult_strauss_batch;
+    }
+    return 1;
+}
+
 static int secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, secp256k1_ecmult_multi_callback cb, void *cbdata, size_t n) {
     size_t i;
 
-    int (*f)(const secp256k1_ecmult_context*, secp256k1_scratch*, secp256k1_gej*, const secp256k1_scalar*, secp256k1_ecmult_multi_callback cb, void*, size_t, size_t);
-    size_t max_points;
+    secp256k1_ecmult_multi_batch_func f;
     size_t n_batches;
     size_t n_batch_points;
 
@@ -1020,25 +1781,8 @@ static int secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, secp2
         return secp256k1_ecmult_multi_var_simple(ctx, r, inp_g_sc, cb, cbdata, n);
     }
 
-    max_points = secp256k1_pippenger_max_points(scratch);
-    if (max_points == 0) {
+    if (!secp256k1_ecmult_multi_plan(ctx, secp256k1_scratch_max_allocation(scratch, 0), n, &f, &n_batches, &n_batch_points)) {
         return 0;
-    } else if (max_points > ECMULT_MAX_POINTS_PER_BATCH) {
-        max_points = ECMULT_MAX_POINTS_PER_BATCH;
-    }
-    n_batches = (n+max_points-1)/max_points;
-    n_batch_points = (n+n_batches-1)/n_batches;
-
-    if (n_batch_points >= ECMULT_PIPPENGER_THRESHOLD) {
-        f = secp256k1_ecmult_pippenger_batch;
-    } else {
-        max_points = secp256k1_strauss_max_points(scratch);
-        if (max_points == 0) {
-            return 0;
-        }
-        n_batches = (n+max_points-1)/max_points;
-        n_batch_points = (n+n_batches-1)/n_batches;
-        f = secp256k1_ecmult_strauss_batch;
     }
     for(i = 0; i < n_batches; i++) {
         size_t nbp = n < n_batch_points ? n : n_batch_points;
@@ -1053,4 +1797,354 @@ static int secp256k1_ecmult_multi_var(const secp256k1_ecmult_context *ctx, secp2
     return 1;
 }
 
+static int secp256k1_ecmult_multi_var_array(const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_gej *r, const secp256k1_scalar *inp_g_sc, const secp256k1_scalar *scalars, const secp256k1_ge *points, size_t n) {
+    secp256k1_ecmult_multi_arrays arrays;
+    arrays.scalars = scalars;
+    arrays.points = points;
+    return secp256k1_ecmult_multi_var(ctx, scratch, r, inp_g_sc, NULL, &arrays, n);
+}
+
+static size_t secp256k1_ecmult_multi_scratch_size(const secp256k1_ecmult_context *ctx, size_t n) {
+    secp256k1_ecmult_multi_batch_func f;
+    size_t n_batches, min_batches;
+    size_t n_batch_points;
+    size_t lo = 0;
+    size_t hi = SIZE_MAX / 2;
+
+    if (n == 0) {
+        return 0;
+    }
+    /* With an unbounded budget the batches are only limited by
+     * ECMULT_MAX_POINTS_PER_BATCH. Search for the smallest budget that
+     * gets by with as few of them; the plan only depends on the budget
+     * through the space left, and gets no worse as that grows. */
+    secp256k1_ecmult_multi_plan(ctx, hi, n, &f, &min_batches, &n_batch_points);
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (secp256k1_ecmult_multi_plan(ctx, mid, n, &f, &n_batches, &n_batch_points) && n_batches <= min_batches) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+static int secp256k1_ecmult_multi_accumulator_fits(const secp256k1_ecmult_context *ctx, size_t available, size_t n) {
+    const size_t entry_size = sizeof(secp256k1_scalar) + sizeof(secp256k1_ge);
+    return n <= available / entry_size && secp256k1_ecmult_multi_scratch_size(ctx, n) <= available - n * entry_size;
+}
+
+static int secp256k1_ecmult_multi_accumulator_init(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, size_t max_n) {
+    const size_t entry_size = sizeof(secp256k1_scalar) + sizeof(secp256k1_ge);
+    size_t available = secp256k1_scratch_max_allocation(scratch, 2);
+    size_t lo = 0;
+    size_t hi = available / entry_size + 1;
+
+    if (max_n == 0) {
+        max_n = 1;
+    } else if (max_n > ECMULT_MAX_POINTS_PER_BATCH) {
+        max_n = ECMULT_MAX_POINTS_PER_BATCH;
+    }
+    if (secp256k1_ecmult_multi_accumulator_fits(ctx, available, max_n)) {
+        lo = max_n;
+    } else {
+        if (hi > max_n) {
+            hi = max_n;
+        }
+        /* Find the largest buffer that leaves enough room to flush it in one
+         * batch. The space needed for a batch is not quite monotonic where
+         * strauss gives way to pippenger, but lo always fits. */
+        while (hi - lo > 1) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (secp256k1_ecmult_multi_accumulator_fits(ctx, available, mid)) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+    if (lo == 0 || !secp256k1_scratch_allocate_frame(scratch, lo * entry_size, 2)) {
+        return 0;
+    }
+    acc->ctx = ctx;
+    acc->scratch = scratch;
+    acc->scalars = (secp256k1_scalar *)secp256k1_scratch_alloc(scratch, lo * sizeof(secp256k1_scalar));
+    acc->points = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, lo * sizeof(secp256k1_ge));
+    acc->n = 0;
+    acc->capacity = lo;
+    secp256k1_scalar_clear(&acc->g_sc);
+    secp256k1_gej_set_infinity(&acc->r);
+    acc->failed = 0;
+    return 1;
+}
+
+static size_t secp256k1_ecmult_multi_accumulator_scratch_size(const secp256k1_ecmult_context *ctx, size_t n) {
+    const size_t entry_size = sizeof(secp256k1_scalar) + sizeof(secp256k1_ge);
+    if (n == 0) {
+        n = 1;
+    } else if (n > ECMULT_MAX_POINTS_PER_BATCH) {
+        n = ECMULT_MAX_POINTS_PER_BATCH;
+    }
+    return secp256k1_scratch_frame_budget(n * entry_size, 2) + secp256k1_ecmult_multi_scratch_size(ctx, n);
+}
+
+static int secp256k1_ecmult_multi_accumulator_flush(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_scalar *inp_g_sc) {
+    secp256k1_gej tmp;
+    if (!acc->failed && secp256k1_ecmult_multi_var_array(acc->ctx, acc->scratch, &tmp, inp_g_sc, acc->scalars, acc->points, acc->n)) {
+        secp256k1_gej_add_var(&acc->r, &acc->r, &tmp, NULL);
+    } else {
+        acc->failed = 1;
+    }
+    acc->n = 0;
+    return !acc->failed;
+}
+
+static int secp256k1_ecmult_multi_accumulator_add(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_scalar *sc, const secp256k1_ge *pt) {
+    acc->scalars[acc->n] = *sc;
+    acc->points[acc->n] = *pt;
+    acc->n++;
+    if (acc->n == acc->capacity) {
+        return secp256k1_ecmult_multi_accumulator_flush(acc, NULL);
+    }
+    return !acc->failed;
+}
+
+static void secp256k1_ecmult_multi_accumulator_add_g(secp256k1_ecmult_multi_accumulator *acc, const secp256k1_scalar *sc) {
+    secp256k1_scalar_add(&acc->g_sc, &acc->g_sc, sc);
+}
+
+static int secp256k1_ecmult_multi_accumulator_finalize(secp256k1_ecmult_multi_accumulator *acc, secp256k1_gej *r) {
+    int ret = secp256k1_ecmult_multi_accumulator_flush(acc, &acc->g_sc);
+    *r = acc->r;
+    secp256k1_ecmult_multi_accumulator_clear(acc);
+    return ret;
+}
+
+static void secp256k1_ecmult_multi_accumulator_clear(secp256k1_ecmult_multi_accumulator *acc) {
+    secp256k1_scratch_deallocate_frame(acc->scratch);
+    secp256k1_scalar_clear(&acc->g_sc);
+    acc->scalars = NULL;
+    acc->points = NULL;
+    acc->n = 0;
+    acc->capacity = 0;
+}
+
+/* Minimum time a single measurement of secp256k1_ecmult_calibrate runs for */
+#define ECMULT_CALIBRATE_TICKS (CLOCKS_PER_SEC / 100)
+
+/* Sets *t to the time a call of f takes for n points, in 1/65536 clock ticks.
+ * Returns 0 if there is no clock or f fails. */
+static int secp256k1_ecmult_calibrate_time(uint64_t *t, const secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, secp256k1_ecmult_multi_func f, secp256k1_ecmult_multi_arrays *data, size_t n) {
+    clock_t start = clock();
+    clock_t now;
+    uint64_t runs = 0;
+    secp256k1_gej r;
+
+    if (start == (clock_t)-1) {
+        return 0;
+    }
+    do {
+        if (!f(ctx, scratch, &r, NULL, NULL, data, n)) {
+            return 0;
+        }
+        runs++;
+        now = clock();
+    } while (now - start < ECMULT_CALIBRATE_TICKS);
+    *t = ((uint64_t)(now - start) << 16) / runs;
+    return 1;
+}
+
+/* Compares f_a and f_b on a geometric sequence of numbers of points from
+ * about *threshold/2 to 2 * *threshold, up to max_points, and sets *threshold
+ * to the smallest of them from which on f_b is faster. If f_b is not faster
+ * for the largest one, *threshold is set to a number above it. Leaves
+ * *threshold unchanged if nothing could be measured. */
+static void secp256k1_ecmult_calibrate_crossover(size_t *threshold, const secp256k1_ecmult_context *ctx_a, secp256k1_ecmult_multi_func f_a, const secp256k1_ecmult_context *ctx_b, secp256k1_ecmult_multi_func f_b, secp256k1_scratch *scratch, secp256k1_ecmult_multi_arrays *data, size_t max_points) {
+    size_t n = *threshold / 2 + 1;
+    size_t end = *threshold > max_points / 2 ? max_points : 2 * *threshold;
+    size_t last = 0;
+    size_t result = 0;
+
+    for (; n <= end; n += n / 2 + 1) {
+        uint64_t t_a, t_b;
+        if (!secp256k1_ecmult_calibrate_time(&t_a, ctx_a, scratch, f_a, data, n)
+            || !secp256k1_ecmult_calibrate_time(&t_b, ctx_b, scratch, f_b, data, n)) {
+            break;
+        }
+        if (t_b < t_a) {
+            if (result == 0) {
+                result = n;
+            }
+        } else {
+            result = 0;
+        }
+        last = n;
+    }
+    if (last == 0) {
+        return;
+    }
+    *threshold = result != 0 ? result : last + 1;
+}
+
+/* Makes ctx use bucket window w for any number of points */
+static void secp256k1_ecmult_calibrate_force_window(secp256k1_ecmult_context *ctx, int w) {
+    int i;
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW; i++) {
+        ctx->tuning.bucket_window_max_points[i] = i < w - 1 ? 0 : SIZE_MAX;
+    }
+}
+
+static int secp256k1_ecmult_calibrate(secp256k1_ecmult_context *ctx, secp256k1_scratch *scratch, size_t max_points) {
+    static const unsigned char seed[32] = { 0 };
+    secp256k1_ecmult_context ctx_a = *ctx;
+    secp256k1_ecmult_context ctx_b = *ctx;
+    secp256k1_ecmult_tuning tuning = ctx->tuning;
+    secp256k1_ecmult_multi_arrays data;
+    secp256k1_scalar *scalars;
+    secp256k1_ge *points;
+    secp256k1_gej pj;
+    size_t max_alloc = secp256k1_scratch_max_allocation(scratch, 2);
+    size_t i;
+    int w;
+
+    /* Leave at least half of the scratch space to the algorithms */
+    if (max_points > max_alloc / 2 / (sizeof(*scalars) + sizeof(*points))) {
+        max_points = max_alloc / 2 / (sizeof(*scalars) + sizeof(*points));
+    }
+    max_points &= ~(size_t)1;
+    if (max_points == 0 || clock() == (clock_t)-1) {
+        return 0;
+    }
+    if (!secp256k1_scratch_allocate_frame(scratch, max_points * (sizeof(*scalars) + sizeof(*points)), 2)) {
+        return 0;
+    }
+    scalars = (secp256k1_scalar *) secp256k1_scratch_alloc(scratch, max_points * sizeof(*scalars));
+    points = (secp256k1_ge *) secp256k1_scratch_alloc(scratch, max_points * sizeof(*points));
+    secp256k1_gej_set_ge(&pj, &secp256k1_ge_const_g);
+    for (i = 0; i < max_points; i += 2) {
+        secp256k1_scalar_chacha20(&scalars[i], &scalars[i + 1], seed, i);
+        secp256k1_ge_set_gej_var(&points[i], &pj);
+        secp256k1_gej_add_ge_var(&pj, &pj, &secp256k1_ge_const_g, NULL);
+        secp256k1_ge_set_gej_var(&points[i + 1], &pj);
+        secp256k1_gej_add_ge_var(&pj, &pj, &secp256k1_ge_const_g, NULL);
+    }
+    data.scalars = scalars;
+    data.points = points;
+    ctx_a.task_runner.fn = NULL;
+    ctx_b.task_runner.fn = NULL;
+
+    /* For every window find the number of points from which on the next
+     * larger one is faster, with the variant of pippenger that would be used
+     * for that many points. */
+    for (w = 1; w < PIPPENGER_MAX_BUCKET_WINDOW; w++) {
+        size_t threshold = tuning.bucket_window_max_points[w - 1];
+        secp256k1_ecmult_multi_func f;
+        if (threshold != SIZE_MAX) {
+            threshold++;
+            f = threshold >= tuning.pippenger_affine_threshold ? secp256k1_ecmult_pippenger_affine_batch_single : secp256k1_ecmult_pippenger_batch_single;
+            secp256k1_ecmult_calibrate_force_window(&ctx_a, w);
+            secp256k1_ecmult_calibrate_force_window(&ctx_b, w + 1);
+            secp256k1_ecmult_calibrate_crossover(&threshold, &ctx_a, f, &ctx_b, f, scratch, &data, max_points);
+            threshold--;
+        }
+        if (w > 1 && threshold < tuning.bucket_window_max_points[w - 2]) {
+            threshold = tuning.bucket_window_max_points[w - 2];
+        }
+        tuning.bucket_window_max_points[w - 1] = threshold;
+    }
+
+    ctx_a.tuning = tuning;
+    secp256k1_ecmult_calibrate_crossover(&tuning.pippenger_threshold,
+        &ctx_a, secp256k1_ecmult_strauss_batch_single,
+        &ctx_a, secp256k1_ecmult_pippenger_batch_single,
+        scratch, &data, max_points);
+    secp256k1_ecmult_calibrate_crossover(&tuning.pippenger_affine_threshold,
+        &ctx_a, secp256k1_ecmult_pippenger_batch_single,
+        &ctx_a, secp256k1_ecmult_pippenger_affine_batch_single,
+        scratch, &data, max_points);
+
+    secp256k1_scratch_deallocate_frame(scratch);
+    ctx->tuning = tuning;
+    return 1;
+}
+
+static void secp256k1_ecmult_tuning_write64(unsigned char *output, size_t value) {
+    uint64_t v = value == SIZE_MAX ? UINT64_MAX : (uint64_t)value;
+    int i;
+    for (i = 0; i < 8; i++) {
+        output[i] = v >> (56 - 8*i);
+    }
+}
+
+static int secp256k1_ecmult_tuning_read64(size_t *value, const unsigned char *input) {
+    uint64_t v = 0;
+    int i;
+    for (i = 0; i < 8; i++) {
+        v = (v << 8) | input[i];
+    }
+    if (v == UINT64_MAX) {
+        *value = SIZE_MAX;
+        return 1;
+    }
+    if (v >= SIZE_MAX) {
+        return 0;
+    }
+    *value = v;
+    return 1;
+}
+
+/* The serialization starts with the magic "ECMT", a version number and the
+ * build parameters the tuning depends on, followed by the parameters as 8-byte
+ * big-endian numbers. */
+static void secp256k1_ecmult_tuning_serialize(unsigned char *output, const secp256k1_ecmult_tuning *tuning) {
+    int i;
+    memcpy(output, "ECMT", 4);
+    memset(&output[4], 0, 12);
+    output[7] = 1;
+#ifdef USE_ENDOMORPHISM
+    output[11] = 1;
+#endif
+    output[15] = PIPPENGER_MAX_BUCKET_WINDOW;
+    secp256k1_ecmult_tuning_write64(&output[16], tuning->pippenger_threshold);
+    secp256k1_ecmult_tuning_write64(&output[24], tuning->pippenger_affine_threshold);
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW; i++) {
+        secp256k1_ecmult_tuning_write64(&output[32 + 8*i], tuning->bucket_window_max_points[i]);
+    }
+}
+
+static int secp256k1_ecmult_tuning_parse(secp256k1_ecmult_tuning *tuning, const unsigned char *input) {
+    unsigned char header[16];
+    secp256k1_ecmult_tuning ret;
+    int i;
+
+    memcpy(header, "ECMT", 4);
+    memset(&header[4], 0, 12);
+    header[7] = 1;
+#ifdef USE_ENDOMORPHISM
+    header[11] = 1;
+#endif
+    header[15] = PIPPENGER_MAX_BUCKET_WINDOW;
+    if (memcmp(input, header, sizeof(header)) != 0) {
+        return 0;
+    }
+    if (!secp256k1_ecmult_tuning_read64(&ret.pippenger_threshold, &input[16])
+        || !secp256k1_ecmult_tuning_read64(&ret.pippenger_affine_threshold, &input[24])) {
+        return 0;
+    }
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW; i++) {
+        if (!secp256k1_ecmult_tuning_read64(&ret.bucket_window_max_points[i], &input[32 + 8*i])) {
+            return 0;
+        }
+        if (i > 0 && ret.bucket_window_max_points[i] < ret.bucket_window_max_points[i - 1]) {
+            return 0;
+        }
+    }
+    if (ret.bucket_window_max_points[PIPPENGER_MAX_BUCKET_WINDOW - 1] != SIZE_MAX) {
+        return 0;
+    }
+    *tuning = ret;
+    return 1;
+}
+
 #endif /* SECP256K1_ECMULT_IMPL_H */
@@ -0,0 +1,64 @@
+/**********************************************************************
+ * Copyright (c) 2019 The libsecp256k1 developers                     *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_FIELD_4X_H
+#define SECP256K1_FIELD_4X_H
+
+/** Parallel field arithmetic.
+ *
+ *  A secp256k1_fe_4x holds four independent field elements, on which every
+ *  operation is performed at once. The elements are kept in the 10x26
+ *  representation with limb i of all four of them in one 256-bit vector, so
+ *  each limb product of a multiplication is a single AVX2 instruction
+ *  regardless of the field implementation the rest of the library uses.
+ *  Magnitudes have the same meaning as for secp256k1_fe and apply to all four
+ *  elements.
+ *
+ *  All functions require AVX2, so they may only be called if
+ *  secp256k1_cpu_has_avx2() returns 1.
+ */
+
+#include "field.h"
+#include "cpu.h"
+
+#ifdef USE_AVX2
+
+#include <immintrin.h>
+
+typedef struct {
+    __m256i n[10];
+#ifdef VERIFY
+    int magnitude;
+#endif
+} secp256k1_fe_4x;
+
+/** Load four field elements of magnitude at most 7. The result has a
+ *  magnitude one larger than the largest of theirs. */
+static void secp256k1_fe_4x_load(secp256k1_fe_4x *r, const secp256k1_fe *a0, const secp256k1_fe *a1, const secp256k1_fe *a2, const secp256k1_fe *a3);
+
+/** Store the four field elements of a. They keep the magnitude of a. */
+static void secp256k1_fe_4x_store(secp256k1_fe *r0, secp256k1_fe *r1, secp256k1_fe *r2, secp256k1_fe *r3, const secp256k1_fe_4x *a);
+
+/** Set r to -a; a must have magnitude at most m. The result has magnitude m+1. */
+static void secp256k1_fe_4x_negate(secp256k1_fe_4x *r, const secp256k1_fe_4x *a, int m);
+
+/** Multiply r by a small integer. The magnitude is multiplied by a. */
+static void secp256k1_fe_4x_mul_int(secp256k1_fe_4x *r, int a);
+
+/** Add a to r. The magnitudes are added. */
+static void secp256k1_fe_4x_add(secp256k1_fe_4x *r, const secp256k1_fe_4x *a);
+
+/** Set r to a*b. The inputs must have magnitude at most 8, the output has
+ *  magnitude 1. r may alias a, but not b. */
+static void secp256k1_fe_4x_mul(secp256k1_fe_4x *r, const secp256k1_fe_4x *a, const secp256k1_fe_4x * SECP256K1_RESTRICT b);
+
+/** Set r to a^2. The input must have magnitude at most 8, the output has
+ *  magnitude 1. */
+static void secp256k1_fe_4x_sqr(secp256k1_fe_4x *r, const secp256k1_fe_4x *a);
+
+#endif /* USE_AVX2 */
+
+#endif /* SECP256K1_FIELD_4X_H */
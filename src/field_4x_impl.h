@@ -0,0 +1,415 @@
+/**********************************************************************
+ * Copyright (c) 2019 The libsecp256k1 developers                     *
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+#ifndef SECP256K1_FIELD_4X_IMPL_H
+#define SECP256K1_FIELD_4X_IMPL_H
+
+#include "util.h"
+#include "field_4x.h"
+
+#ifdef USE_AVX2
+
+#ifdef VERIFY
+SECP256K1_TARGET_AVX2 static void secp256k1_fe_4x_verify(const secp256k1_fe_4x *a) {
+    uint64_t t[4];
+    int i, j;
+    VERIFY_CHECK(a->magnitude >= 0 && a->magnitude <= 32);
+    for (i = 0; i < 10; i++) {
+        _mm256_storeu_si256((__m256i *)t, a->n[i]);
+        for (j = 0; j < 4; j++) {
+            VERIFY_CHECK(t[j] <= 2 * (uint64_t)a->magnitude * (i < 9 ? 0x3FFFFFFULL : 0x03FFFFFULL));
+        }
+    }
+}
+#endif
+
+SECP256K1_TARGET_AVX2 static void secp256k1_fe_4x_load(secp256k1_fe_4x *r, const secp256k1_fe *a0, const secp256k1_fe *a1, const secp256k1_fe *a2, const secp256k1_fe *a3) {
+    int i;
+#if defined(USE_FIELD_5X52)
+    const __m256i m = _mm256_set1_epi64x(0x3FFFFFF);
+    for (i = 0; i < 5; i++) {
+        __m256i v = _mm256_set_epi64x(a3->n[i], a2->n[i], a1->n[i], a0->n[i]);
+        r->n[2 * i] = _mm256_and_si256(v, m);
+        r->n[2 * i + 1] = _mm256_srli_epi64(v, 26);
+    }
+#else
+    for (i = 0; i < 10; i++) {
+        r->n[i] = _mm256_set_epi64x(a3->n[i], a2->n[i], a1->n[i], a0->n[i]);
+    }
+#endif
+#ifdef VERIFY
+    secp256k1_fe_verify(a0);
+    secp256k1_fe_verify(a1);
+    secp256k1_fe_verify(a2);
+    secp256k1_fe_verify(a3);
+    VERIFY_CHECK(a0->magnitude <= 7 && a1->magnitude <= 7 && a2->magnitude <= 7 && a3->magnitude <= 7);
+    /* Splitting a 52-bit limb leaves the lower half normalized and the upper
+     * half within the same bound as the whole limb, scaled down. */
+    r->magnitude = a0->magnitude;
+    if (a1->magnitude > r->magnitude) {
+        r->magnitude = a1->magnitude;
+    }
+    if (a2->magnitude > r->magnitude) {
+        r->magnitude = a2->magnitude;
+    }
+    if (a3->magnitude > r->magnitude) {
+        r->magnitude = a3->magnitude;
+    }
+    r->magnitude++;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+SECP256K1_TARGET_AVX2 static void secp256k1_fe_4x_store(secp256k1_fe *r0, secp256k1_fe *r1, secp256k1_fe *r2, secp256k1_fe *r3, const secp256k1_fe_4x *a) {
+    uint64_t t[4];
+    int i;
+#ifdef VERIFY
+    secp256k1_fe_4x_verify(a);
+#endif
+#if defined(USE_FIELD_5X52)
+    /* Joining two limbs without propagating carries keeps every 52-bit limb
+     * within the bound of the magnitude. */
+    for (i = 0; i < 5; i++) {
+        _mm256_storeu_si256((__m256i *)t, _mm256_add_epi64(a->n[2 * i], _mm256_slli_epi64(a->n[2 * i + 1], 26)));
+        r0->n[i] = t[0];
+        r1->n[i] = t[1];
+        r2->n[i] = t[2];
+        r3->n[i] = t[3];
+    }
+#else
+    for (i = 0; i < 10; i++) {
+        _mm256_storeu_si256((__m256i *)t, a->n[i]);
+        r0->n[i] = t[0];
+        r1->n[i] = t[1];
+        r2->n[i] = t[2];
+        r3->n[i] = t[3];
+    }
+#endif
+#ifdef VERIFY
+    r0->magnitude = r1->magnitude = r2->magnitude = r3->magnitude = a->magnitude;
+    r0->normalized = r1->normalized = r2->normalized = r3->normalized = 0;
+    secp256k1_fe_verify(r0);
+    secp256k1_fe_verify(r1);
+    secp256k1_fe_verify(r2);
+    secp256k1_fe_verify(r3);
+#endif
+}
+
+SECP256K1_TARGET_AVX2 static SECP256K1_INLINE void secp256k1_fe_4x_negate(secp256k1_fe_4x *r, const secp256k1_fe_4x *a, int m) {
+    const __m256i k = _mm256_set1_epi64x(2 * (m + 1));
+    const __m256i p0 = _mm256_mul_epu32(_mm256_set1_epi64x(0x3FFFC2F), k);
+    const __m256i p1 = _mm256_mul_epu32(_mm256_set1_epi64x(0x3FFFFBF), k);
+    const __m256i p2 = _mm256_mul_epu32(_mm256_set1_epi64x(0x3FFFFFF), k);
+    const __m256i p9 = _mm256_mul_epu32(_mm256_set1_epi64x(0x03FFFFF), k);
+    int i;
+#ifdef VERIFY
+    VERIFY_CHECK(a->magnitude <= m);
+    secp256k1_fe_4x_verify(a);
+#endif
+    r->n[0] = _mm256_sub_epi64(p0, a->n[0]);
+    r->n[1] = _mm256_sub_epi64(p1, a->n[1]);
+    for (i = 2; i < 9; i++) {
+        r->n[i] = _mm256_sub_epi64(p2, a->n[i]);
+    }
+    r->n[9] = _mm256_sub_epi64(p9, a->n[9]);
+#ifdef VERIFY
+    r->magnitude = m + 1;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+SECP256K1_TARGET_AVX2 static SECP256K1_INLINE void secp256k1_fe_4x_mul_int(secp256k1_fe_4x *r, int a) {
+    const __m256i k = _mm256_set1_epi64x(a);
+    int i;
+    for (i = 0; i < 10; i++) {
+        r->n[i] = _mm256_mul_epu32(r->n[i], k);
+    }
+#ifdef VERIFY
+    r->magnitude *= a;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+SECP256K1_TARGET_AVX2 static SECP256K1_INLINE void secp256k1_fe_4x_add(secp256k1_fe_4x *r, const secp256k1_fe_4x *a) {
+    int i;
+#ifdef VERIFY
+    secp256k1_fe_4x_verify(a);
+#endif
+    for (i = 0; i < 10; i++) {
+        r->n[i] = _mm256_add_epi64(r->n[i], a->n[i]);
+    }
+#ifdef VERIFY
+    r->magnitude += a->magnitude;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+/* The multiplication and squaring below follow secp256k1_fe_mul_inner and
+ * secp256k1_fe_sqr_inner of the 10x26 field, with every 32x32->64 bit product
+ * computed for all four lanes at once. _mm256_mul_epu32 only uses the low 32
+ * bits of its operands, so the few products with a wider operand are formed
+ * from two of them (or a shift, for powers of two). */
+#define vmul(x, y) _mm256_mul_epu32((x), (y))
+#define vmul64(x, k) _mm256_add_epi64(_mm256_mul_epu32((x), (k)), _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64((x), 32), (k)), 32))
+#define vmuladd(acc, x, y) ((acc) = _mm256_add_epi64((acc), _mm256_mul_epu32((x), (y))))
+#define vadd(x, y) _mm256_add_epi64((x), (y))
+#define vand(x, y) _mm256_and_si256((x), (y))
+#define vsrl(x, n) _mm256_srli_epi64((x), (n))
+#define vsll(x, n) _mm256_slli_epi64((x), (n))
+
+SECP256K1_TARGET_AVX2 static void secp256k1_fe_4x_mul(secp256k1_fe_4x *r, const secp256k1_fe_4x *x, const secp256k1_fe_4x * SECP256K1_RESTRICT y) {
+    const __m256i M26 = _mm256_set1_epi64x(0x3FFFFFF), M22 = _mm256_set1_epi64x(0x3FFFFF);
+    const __m256i K3D10 = _mm256_set1_epi64x(0x3D10), K400 = _mm256_set1_epi64x(0x400), K3D1 = _mm256_set1_epi64x(0x3D1);
+    const __m256i *a = x->n, *b = y->n;
+    __m256i c, d, u0, u1, u2, u3, u4, u5, u6, u7, u8, t0, t1, t2, t3, t4, t5, t6, t7, t9;
+#ifdef VERIFY
+    VERIFY_CHECK(x->magnitude <= 8);
+    VERIFY_CHECK(y->magnitude <= 8);
+    secp256k1_fe_4x_verify(x);
+    secp256k1_fe_4x_verify(y);
+    VERIFY_CHECK(r != y);
+#endif
+
+    d = vmul(a[0], b[9]); vmuladd(d, a[1], b[8]); vmuladd(d, a[2], b[7]); vmuladd(d, a[3], b[6]);
+    vmuladd(d, a[4], b[5]); vmuladd(d, a[5], b[4]); vmuladd(d, a[6], b[3]); vmuladd(d, a[7], b[2]);
+    vmuladd(d, a[8], b[1]); vmuladd(d, a[9], b[0]);
+    t9 = vand(d, M26);
+    d = vsrl(d, 26);
+    c = vmul(a[0], b[0]);
+    vmuladd(d, a[1], b[9]); vmuladd(d, a[2], b[8]); vmuladd(d, a[3], b[7]); vmuladd(d, a[4], b[6]);
+    vmuladd(d, a[5], b[5]); vmuladd(d, a[6], b[4]); vmuladd(d, a[7], b[3]); vmuladd(d, a[8], b[2]);
+    vmuladd(d, a[9], b[1]);
+    u0 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u0, K3D10);
+    t0 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u0, K400);
+    vmuladd(c, a[0], b[1]); vmuladd(c, a[1], b[0]);
+    vmuladd(d, a[2], b[9]); vmuladd(d, a[3], b[8]); vmuladd(d, a[4], b[7]); vmuladd(d, a[5], b[6]);
+    vmuladd(d, a[6], b[5]); vmuladd(d, a[7], b[4]); vmuladd(d, a[8], b[3]); vmuladd(d, a[9], b[2]);
+    u1 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u1, K3D10);
+    t1 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u1, K400);
+    vmuladd(c, a[0], b[2]); vmuladd(c, a[1], b[1]); vmuladd(c, a[2], b[0]);
+    vmuladd(d, a[3], b[9]); vmuladd(d, a[4], b[8]); vmuladd(d, a[5], b[7]); vmuladd(d, a[6], b[6]);
+    vmuladd(d, a[7], b[5]); vmuladd(d, a[8], b[4]); vmuladd(d, a[9], b[3]);
+    u2 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u2, K3D10);
+    t2 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u2, K400);
+    vmuladd(c, a[0], b[3]); vmuladd(c, a[1], b[2]); vmuladd(c, a[2], b[1]); vmuladd(c, a[3], b[0]);
+    vmuladd(d, a[4], b[9]); vmuladd(d, a[5], b[8]); vmuladd(d, a[6], b[7]); vmuladd(d, a[7], b[6]);
+    vmuladd(d, a[8], b[5]); vmuladd(d, a[9], b[4]);
+    u3 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u3, K3D10);
+    t3 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u3, K400);
+    vmuladd(c, a[0], b[4]); vmuladd(c, a[1], b[3]); vmuladd(c, a[2], b[2]); vmuladd(c, a[3], b[1]);
+    vmuladd(c, a[4], b[0]);
+    vmuladd(d, a[5], b[9]); vmuladd(d, a[6], b[8]); vmuladd(d, a[7], b[7]); vmuladd(d, a[8], b[6]);
+    vmuladd(d, a[9], b[5]);
+    u4 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u4, K3D10);
+    t4 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u4, K400);
+    vmuladd(c, a[0], b[5]); vmuladd(c, a[1], b[4]); vmuladd(c, a[2], b[3]); vmuladd(c, a[3], b[2]);
+    vmuladd(c, a[4], b[1]); vmuladd(c, a[5], b[0]);
+    vmuladd(d, a[6], b[9]); vmuladd(d, a[7], b[8]); vmuladd(d, a[8], b[7]); vmuladd(d, a[9], b[6]);
+    u5 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u5, K3D10);
+    t5 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u5, K400);
+    vmuladd(c, a[0], b[6]); vmuladd(c, a[1], b[5]); vmuladd(c, a[2], b[4]); vmuladd(c, a[3], b[3]);
+    vmuladd(c, a[4], b[2]); vmuladd(c, a[5], b[1]); vmuladd(c, a[6], b[0]);
+    vmuladd(d, a[7], b[9]); vmuladd(d, a[8], b[8]); vmuladd(d, a[9], b[7]);
+    u6 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u6, K3D10);
+    t6 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u6, K400);
+    vmuladd(c, a[0], b[7]); vmuladd(c, a[1], b[6]); vmuladd(c, a[2], b[5]); vmuladd(c, a[3], b[4]);
+    vmuladd(c, a[4], b[3]); vmuladd(c, a[5], b[2]); vmuladd(c, a[6], b[1]); vmuladd(c, a[7], b[0]);
+    vmuladd(d, a[8], b[9]); vmuladd(d, a[9], b[8]);
+    u7 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u7, K3D10);
+    t7 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u7, K400);
+    vmuladd(c, a[0], b[8]); vmuladd(c, a[1], b[7]); vmuladd(c, a[2], b[6]); vmuladd(c, a[3], b[5]);
+    vmuladd(c, a[4], b[4]); vmuladd(c, a[5], b[3]); vmuladd(c, a[6], b[2]); vmuladd(c, a[7], b[1]);
+    vmuladd(c, a[8], b[0]);
+    vmuladd(d, a[9], b[9]);
+    u8 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u8, K3D10);
+    r->n[3] = t3;
+    r->n[4] = t4;
+    r->n[5] = t5;
+    r->n[6] = t6;
+    r->n[7] = t7;
+    r->n[8] = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u8, K400);
+    c = vadd(c, vmul(d, K3D10)); c = vadd(c, t9);
+    r->n[9] = vand(c, M22);
+    c = vsrl(c, 22);
+    c = vadd(c, vsll(d, 14));
+    d = vmul64(c, K3D1); d = vadd(d, t0);
+    r->n[0] = vand(d, M26);
+    d = vsrl(d, 26);
+    d = vadd(d, vsll(c, 6)); d = vadd(d, t1);
+    r->n[1] = vand(d, M26);
+    d = vsrl(d, 26);
+    d = vadd(d, t2);
+    r->n[2] = d;
+#ifdef VERIFY
+    r->magnitude = 1;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+SECP256K1_TARGET_AVX2 static void secp256k1_fe_4x_sqr(secp256k1_fe_4x *r, const secp256k1_fe_4x *x) {
+    const __m256i M26 = _mm256_set1_epi64x(0x3FFFFFF), M22 = _mm256_set1_epi64x(0x3FFFFF);
+    const __m256i K3D10 = _mm256_set1_epi64x(0x3D10), K400 = _mm256_set1_epi64x(0x400), K3D1 = _mm256_set1_epi64x(0x3D1);
+    const __m256i *a = x->n;
+    __m256i a2[10];
+    __m256i c, d, u0, u1, u2, u3, u4, u5, u6, u7, u8, t0, t1, t2, t3, t4, t5, t6, t7, t9;
+    int i;
+#ifdef VERIFY
+    VERIFY_CHECK(x->magnitude <= 8);
+    secp256k1_fe_4x_verify(x);
+#endif
+
+    for (i = 0; i < 10; i++) {
+        a2[i] = vadd(a[i], a[i]);
+    }
+
+    d = vmul(a2[0], a[9]); vmuladd(d, a2[1], a[8]); vmuladd(d, a2[2], a[7]); vmuladd(d, a2[3], a[6]);
+    vmuladd(d, a2[4], a[5]);
+    t9 = vand(d, M26);
+    d = vsrl(d, 26);
+    c = vmul(a[0], a[0]);
+    vmuladd(d, a2[1], a[9]); vmuladd(d, a2[2], a[8]); vmuladd(d, a2[3], a[7]); vmuladd(d, a2[4], a[6]);
+    vmuladd(d, a[5], a[5]);
+    u0 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u0, K3D10);
+    t0 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u0, K400);
+    vmuladd(c, a2[0], a[1]);
+    vmuladd(d, a2[2], a[9]); vmuladd(d, a2[3], a[8]); vmuladd(d, a2[4], a[7]); vmuladd(d, a2[5], a[6]);
+    u1 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u1, K3D10);
+    t1 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u1, K400);
+    vmuladd(c, a2[0], a[2]); vmuladd(c, a[1], a[1]);
+    vmuladd(d, a2[3], a[9]); vmuladd(d, a2[4], a[8]); vmuladd(d, a2[5], a[7]); vmuladd(d, a[6], a[6]);
+    u2 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u2, K3D10);
+    t2 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u2, K400);
+    vmuladd(c, a2[0], a[3]); vmuladd(c, a2[1], a[2]);
+    vmuladd(d, a2[4], a[9]); vmuladd(d, a2[5], a[8]); vmuladd(d, a2[6], a[7]);
+    u3 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u3, K3D10);
+    t3 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u3, K400);
+    vmuladd(c, a2[0], a[4]); vmuladd(c, a2[1], a[3]); vmuladd(c, a[2], a[2]);
+    vmuladd(d, a2[5], a[9]); vmuladd(d, a2[6], a[8]); vmuladd(d, a[7], a[7]);
+    u4 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u4, K3D10);
+    t4 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u4, K400);
+    vmuladd(c, a2[0], a[5]); vmuladd(c, a2[1], a[4]); vmuladd(c, a2[2], a[3]);
+    vmuladd(d, a2[6], a[9]); vmuladd(d, a2[7], a[8]);
+    u5 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u5, K3D10);
+    t5 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u5, K400);
+    vmuladd(c, a2[0], a[6]); vmuladd(c, a2[1], a[5]); vmuladd(c, a2[2], a[4]); vmuladd(c, a[3], a[3]);
+    vmuladd(d, a2[7], a[9]); vmuladd(d, a[8], a[8]);
+    u6 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u6, K3D10);
+    t6 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u6, K400);
+    vmuladd(c, a2[0], a[7]); vmuladd(c, a2[1], a[6]); vmuladd(c, a2[2], a[5]); vmuladd(c, a2[3], a[4]);
+    vmuladd(d, a2[8], a[9]);
+    u7 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u7, K3D10);
+    t7 = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u7, K400);
+    vmuladd(c, a2[0], a[8]); vmuladd(c, a2[1], a[7]); vmuladd(c, a2[2], a[6]); vmuladd(c, a2[3], a[5]);
+    vmuladd(c, a[4], a[4]);
+    vmuladd(d, a[9], a[9]);
+    u8 = vand(d, M26);
+    d = vsrl(d, 26);
+    vmuladd(c, u8, K3D10);
+    r->n[3] = t3;
+    r->n[4] = t4;
+    r->n[5] = t5;
+    r->n[6] = t6;
+    r->n[7] = t7;
+    r->n[8] = vand(c, M26);
+    c = vsrl(c, 26);
+    vmuladd(c, u8, K400);
+    c = vadd(c, vmul(d, K3D10)); c = vadd(c, t9);
+    r->n[9] = vand(c, M22);
+    c = vsrl(c, 22);
+    c = vadd(c, vsll(d, 14));
+    d = vmul64(c, K3D1); d = vadd(d, t0);
+    r->n[0] = vand(d, M26);
+    d = vsrl(d, 26);
+    d = vadd(d, vsll(c, 6)); d = vadd(d, t1);
+    r->n[1] = vand(d, M26);
+    d = vsrl(d, 26);
+    d = vadd(d, t2);
+    r->n[2] = d;
+#ifdef VERIFY
+    r->magnitude = 1;
+    secp256k1_fe_4x_verify(r);
+#endif
+}
+
+#undef vmul
+#undef vmul64
+#undef vmuladd
+#undef vadd
+#undef vand
+#undef vsrl
+#undef vsll
+
+#endif /* USE_AVX2 */
+
+#endif /* SECP256K1_FIELD_4X_IMPL_H */
@@ -24,6 +24,79 @@ static const secp256k1_callback default_error_callback = {
     NULL
 };
 
+/* Window sizes used by ecmult_impl.h for the odd multiples of G, with and without the
+ * endomorphism. The table for the smaller window is a prefix of the one for the larger. */
+#define ECMULT_STATIC_WINDOW_G_ENDO 15
+#define ECMULT_STATIC_WINDOW_G 16
+#define ECMULT_STATIC_TABLE_SIZE(w) (1 << ((w)-2))
+
+/* Writes the odd multiples 1*P, 3*P, ..., (2*n-1)*P as an array named `name`. Entries from
+ * `endo_n` onwards are only needed without the endomorphism and are guarded accordingly. */
+static void print_odd_multiples(FILE *fp, const char *name, const secp256k1_gej *p, int n, int endo_n) {
+    secp256k1_gej pj = *p;
+    secp256k1_gej p2j;
+    secp256k1_ge p2;
+    int i;
+
+    secp256k1_gej_double_var(&p2j, p, NULL);
+    secp256k1_ge_set_gej_var(&p2, &p2j);
+
+    fprintf(fp, "static const secp256k1_ge_storage %s[] = {\n", name);
+    for (i = 0; i < n; i++) {
+        secp256k1_ge ge;
+        secp256k1_ge_storage ges;
+        if (i == endo_n) {
+            fprintf(fp, "#ifndef USE_ENDOMORPHISM\n");
+        }
+        secp256k1_ge_set_gej_var(&ge, &pj);
+        secp256k1_ge_to_storage(&ges, &ge);
+        fprintf(fp,"    SC(%uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu, %uu)%s\n", SECP256K1_GE_STORAGE_CONST_GET(ges), i != n - 1 ? "," : "");
+        secp256k1_gej_add_ge_var(&pj, &pj, &p2, NULL);
+    }
+    if (endo_n < n) {
+        fprintf(fp, "#endif\n");
+    }
+    fprintf(fp,"};\n");
+}
+
+static int gen_ecmult_static_pre_g(void) {
+    secp256k1_gej gj;
+    FILE* fp;
+    int i;
+
+    fp = fopen("src/ecmult_static_pre_g.h","w");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open src/ecmult_static_pre_g.h for writing!\n");
+        return -1;
+    }
+
+    fprintf(fp, "#ifndef _SECP256K1_ECMULT_STATIC_PRE_G_\n");
+    fprintf(fp, "#define _SECP256K1_ECMULT_STATIC_PRE_G_\n");
+    fprintf(fp, "#include \"src/group.h\"\n");
+    fprintf(fp, "#define SC SECP256K1_GE_STORAGE_CONST\n");
+    fprintf(fp, "#ifdef USE_ENDOMORPHISM\n");
+    fprintf(fp, "#define ECMULT_STATIC_WINDOW_G %d\n", ECMULT_STATIC_WINDOW_G_ENDO);
+    fprintf(fp, "#else\n");
+    fprintf(fp, "#define ECMULT_STATIC_WINDOW_G %d\n", ECMULT_STATIC_WINDOW_G);
+    fprintf(fp, "#endif\n");
+
+    secp256k1_gej_set_ge(&gj, &secp256k1_ge_const_g);
+    print_odd_multiples(fp, "secp256k1_ecmult_static_pre_g", &gj, ECMULT_STATIC_TABLE_SIZE(ECMULT_STATIC_WINDOW_G), ECMULT_STATIC_TABLE_SIZE(ECMULT_STATIC_WINDOW_G_ENDO));
+
+    fprintf(fp, "#ifdef USE_ENDOMORPHISM\n");
+    for (i = 0; i < 128; i++) {
+        secp256k1_gej_double_var(&gj, &gj, NULL);
+    }
+    print_odd_multiples(fp, "secp256k1_ecmult_static_pre_g_128", &gj, ECMULT_STATIC_TABLE_SIZE(ECMULT_STATIC_WINDOW_G_ENDO), ECMULT_STATIC_TABLE_SIZE(ECMULT_STATIC_WINDOW_G_ENDO));
+    fprintf(fp, "#endif\n");
+
+    fprintf(fp, "#undef SC\n");
+    fprintf(fp, "#endif\n");
+    fclose(fp);
+
+    return 0;
+}
+
 int main(int argc, char **argv) {
     secp256k1_ecmult_gen_context ctx;
     int inner;
@@ -70,5 +143,5 @@ int main(int argc, char **argv) {
     fprintf(fp, "#endif\n");
     fclose(fp);
     
-    return 0;
+    return gen_ecmult_static_pre_g();
 }
@@ -118,6 +118,13 @@ static void secp256k1_gej_add_ge(secp256k1_gej *r, const secp256k1_gej *a, const
     guarantee, and b is allowed to be infinity. If rzr is non-NULL, r->z = a->z * *rzr (a cannot be infinity in that case). */
 static void secp256k1_gej_add_ge_var(secp256k1_gej *r, const secp256k1_gej *a, const secp256k1_ge *b, secp256k1_fe *rzr);
 
+#ifdef USE_AVX2
+/** Set *r[k] equal to *r[k] + b[k] for k < 4, like secp256k1_gej_add_ge_var without rzr. The
+    four additions share their field operations, so this may only be called if
+    secp256k1_cpu_has_avx2() returns 1. The r[k] must be distinct. */
+static void secp256k1_gej_add_ge_var_4x(secp256k1_gej * const *r, const secp256k1_ge *b);
+#endif
+
 /** Set r equal to the sum of a and b (with the inverse of b's Z coordinate passed as bzinv). */
 static void secp256k1_gej_add_zinv_var(secp256k1_gej *r, const secp256k1_gej *a, const secp256k1_ge *b, const secp256k1_fe *bzinv);
 
@@ -9,6 +9,7 @@
 
 #include "num.h"
 #include "field.h"
+#include "field_4x.h"
 #include "group.h"
 
 /* These points can be generated in sage as follows:
@@ -466,6 +467,69 @@ static void secp256k1_gej_add_ge_var(secp256k1_gej *r, const secp256k1_gej *a, c
     secp256k1_fe_add(&r->y, &h3);
 }
 
+#ifdef USE_AVX2
+SECP256K1_TARGET_AVX2 static void secp256k1_gej_add_ge_var_4x(secp256k1_gej * const *r, const secp256k1_ge *b) {
+    /* The formulas of secp256k1_gej_add_ge_var, evaluated for all four lanes. Lanes with an
+     * infinity input compute on the generator instead, and those as well as lanes where h
+     * turns out to be zero (doubling or cancellation) are redone with the scalar code. */
+    secp256k1_fe u1[4], s1[4], rx[4], ry[4], rz[4], hs[4];
+    const secp256k1_fe *az[4], *bx[4], *by[4];
+    secp256k1_fe_4x z, z12, u, s, u2, s2, h, i, i2, h2, h3, t, x, y;
+    int special[4];
+    int k;
+    for (k = 0; k < 4; k++) {
+        special[k] = r[k]->infinity || b[k].infinity;
+        if (special[k]) {
+            u1[k] = secp256k1_ge_const_g.x;
+            s1[k] = secp256k1_ge_const_g.y;
+            az[k] = &secp256k1_ge_const_g.x;
+            bx[k] = &secp256k1_ge_const_g.x;
+            by[k] = &secp256k1_ge_const_g.y;
+        } else {
+            u1[k] = r[k]->x; secp256k1_fe_normalize_weak(&u1[k]);
+            s1[k] = r[k]->y; secp256k1_fe_normalize_weak(&s1[k]);
+            az[k] = &r[k]->z;
+            bx[k] = &b[k].x;
+            by[k] = &b[k].y;
+        }
+    }
+    secp256k1_fe_4x_load(&z, az[0], az[1], az[2], az[3]);
+    secp256k1_fe_4x_load(&u, &u1[0], &u1[1], &u1[2], &u1[3]);
+    secp256k1_fe_4x_load(&s, &s1[0], &s1[1], &s1[2], &s1[3]);
+    secp256k1_fe_4x_load(&u2, bx[0], bx[1], bx[2], bx[3]);
+    secp256k1_fe_4x_load(&s2, by[0], by[1], by[2], by[3]);
+
+    secp256k1_fe_4x_sqr(&z12, &z);
+    secp256k1_fe_4x_mul(&u2, &u2, &z12);
+    secp256k1_fe_4x_mul(&s2, &s2, &z12); secp256k1_fe_4x_mul(&s2, &s2, &z);
+    secp256k1_fe_4x_negate(&h, &u, 2); secp256k1_fe_4x_add(&h, &u2);
+    secp256k1_fe_4x_negate(&i, &s, 2); secp256k1_fe_4x_add(&i, &s2);
+    secp256k1_fe_4x_sqr(&i2, &i);
+    secp256k1_fe_4x_sqr(&h2, &h);
+    secp256k1_fe_4x_mul(&h3, &h, &h2);
+    secp256k1_fe_4x_mul(&z, &z, &h);
+    secp256k1_fe_4x_mul(&t, &u, &h2);
+    x = t; secp256k1_fe_4x_mul_int(&x, 2); secp256k1_fe_4x_add(&x, &h3); secp256k1_fe_4x_negate(&x, &x, 3); secp256k1_fe_4x_add(&x, &i2);
+    secp256k1_fe_4x_negate(&y, &x, 5); secp256k1_fe_4x_add(&y, &t); secp256k1_fe_4x_mul(&y, &y, &i);
+    secp256k1_fe_4x_mul(&h3, &h3, &s); secp256k1_fe_4x_negate(&h3, &h3, 1);
+    secp256k1_fe_4x_add(&y, &h3);
+
+    secp256k1_fe_4x_store(&hs[0], &hs[1], &hs[2], &hs[3], &h);
+    secp256k1_fe_4x_store(&rx[0], &rx[1], &rx[2], &rx[3], &x);
+    secp256k1_fe_4x_store(&ry[0], &ry[1], &ry[2], &ry[3], &y);
+    secp256k1_fe_4x_store(&rz[0], &rz[1], &rz[2], &rz[3], &z);
+    for (k = 0; k < 4; k++) {
+        if (special[k] || secp256k1_fe_normalizes_to_zero_var(&hs[k])) {
+            secp256k1_gej_add_ge_var(r[k], r[k], &b[k], NULL);
+        } else {
+            r[k]->x = rx[k];
+            r[k]->y = ry[k];
+            r[k]->z = rz[k];
+        }
+    }
+}
+#endif
+
 static void secp256k1_gej_add_zinv_var(secp256k1_gej *r, const secp256k1_gej *a, const secp256k1_ge *b, const secp256k1_fe *bzinv) {
     /* 9 mul, 3 sqr, 4 normalize, 12 mul_int/add/negate */
     secp256k1_fe az, z12, u1, u2, s1, s2, h, i, i2, h2, h3, t;
@@ -20,6 +20,17 @@ static void secp256k1_sha256_initialize(secp256k1_sha256 *hash);
 static void secp256k1_sha256_write(secp256k1_sha256 *hash, const unsigned char *data, size_t size);
 static void secp256k1_sha256_finalize(secp256k1_sha256 *hash, unsigned char *out32);
 
+/* Number of 64-byte blocks in a padded message of len bytes. */
+#define SECP256K1_SHA256_BLOCKS(len) (((len) + 8) / 64 + 1)
+
+/* Minimum number of messages worth hashing in parallel rather than one after another. */
+#define SECP256K1_SHA256_MULTI_MIN_LANES 2
+
+/** Computes the SHA-256 hashes of n independent messages, message i being the lens[i] bytes at
+ *  msgs[i], and writes hash i to out32 + 32*i. Up to 8 messages are hashed in parallel if the
+ *  CPU supports it. */
+static void secp256k1_sha256_multi(unsigned char *out32, const unsigned char * const *msgs, const size_t *lens, size_t n);
+
 typedef struct {
     secp256k1_sha256 inner, outer;
 } secp256k1_hmac_sha256;
@@ -35,6 +46,20 @@ typedef struct {
 } secp256k1_rfc6979_hmac_sha256;
 
 static void secp256k1_rfc6979_hmac_sha256_initialize(secp256k1_rfc6979_hmac_sha256 *rng, const unsigned char *key, size_t keylen);
+
+/** The HMAC state of RFC6979 3.2.d after absorbing a fixed prefix of at most 32 bytes of the
+ *  key (usually the secret key). This is the only part of the derivation that does not depend
+ *  on the rest of the key, as every later step is keyed with its output. */
+typedef struct {
+    secp256k1_hmac_sha256 hmac;
+    unsigned char key[32];
+    size_t keylen;
+} secp256k1_rfc6979_hmac_sha256_prefix;
+
+static void secp256k1_rfc6979_hmac_sha256_prefix_initialize(secp256k1_rfc6979_hmac_sha256_prefix *prefix, const unsigned char *key, size_t keylen);
+/** Equivalent to secp256k1_rfc6979_hmac_sha256_initialize with the prefix's key followed by key. */
+static void secp256k1_rfc6979_hmac_sha256_initialize_prefixed(secp256k1_rfc6979_hmac_sha256 *rng, const secp256k1_rfc6979_hmac_sha256_prefix *prefix, const unsigned char *key, size_t keylen);
+static void secp256k1_rfc6979_hmac_sha256_prefix_clear(secp256k1_rfc6979_hmac_sha256_prefix *prefix);
 static void secp256k1_rfc6979_hmac_sha256_generate(secp256k1_rfc6979_hmac_sha256 *rng, unsigned char *out, size_t outlen);
 static void secp256k1_rfc6979_hmac_sha256_finalize(secp256k1_rfc6979_hmac_sha256 *rng);
 
@@ -7,12 +7,17 @@
 #ifndef SECP256K1_HASH_IMPL_H
 #define SECP256K1_HASH_IMPL_H
 
+#include "cpu.h"
 #include "hash.h"
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 
+#if defined(USE_SHANI) || defined(USE_AVX2)
+#include <immintrin.h>
+#endif
+
 #define Ch(x,y,z) ((z) ^ ((x) & ((y) ^ (z))))
 #define Maj(x,y,z) (((x) & (y)) | ((z) & ((x) | (y))))
 #define Sigma0(x) (((x) >> 2 | (x) << 30) ^ ((x) >> 13 | (x) << 19) ^ ((x) >> 22 | (x) << 10))
@@ -46,7 +51,7 @@ static void secp256k1_sha256_initialize(secp256k1_sha256 *hash) {
 }
 
 /** Perform one SHA-256 transformation, processing 16 big endian 32-bit words. */
-static void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
+static void secp256k1_sha256_transform_generic(uint32_t* s, const uint32_t* chunk) {
     uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
     uint32_t w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
 
@@ -128,6 +133,117 @@ static void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
     s[7] += h;
 }
 
+#if defined(USE_SHANI) || defined(USE_AVX2)
+static const uint32_t secp256k1_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+#endif
+
+#ifdef USE_SHANI
+/* Four rounds, with message words m and round constants secp256k1_sha256_k[i..i+3]. Each
+ * SHA256RNDS2 performs two rounds on the state split into (A,B,E,F) and (C,D,G,H) halves, and
+ * swaps the roles of the halves. */
+#define SHANI_QUADROUND(s0, s1, m, i) do { \
+    __m128i msg_ = _mm_add_epi32((m), _mm_loadu_si128((const __m128i*)&secp256k1_sha256_k[i])); \
+    (s1) = _mm_sha256rnds2_epu32((s1), (s0), msg_); \
+    (s0) = _mm_sha256rnds2_epu32((s0), (s1), _mm_shuffle_epi32(msg_, 0x0e)); \
+} while(0)
+
+/* Message schedule, with words in groups of four. SHANI_MSG1 starts computing the group four
+ * positions after m0 from m0 and the group following it (m1). SHANI_MSG2 finishes the group in m2
+ * from the two groups m0 and m1 that precede it. */
+#define SHANI_MSG1(m0, m1) ((m0) = _mm_sha256msg1_epu32((m0), (m1)))
+#define SHANI_MSG2(m0, m1, m2) ((m2) = _mm_sha256msg2_epu32(_mm_add_epi32((m2), _mm_alignr_epi8((m1), (m0), 4)), (m1)))
+
+/** Perform one SHA-256 transformation using the x86 SHA extensions. May only be called if
+ *  secp256k1_cpu_has_sha() returns 1. */
+SECP256K1_TARGET_SHANI static void secp256k1_sha256_transform_shani(uint32_t* s, const uint32_t* chunk) {
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    __m128i s0, s1, so0, so1, t0, t1, m0, m1, m2, m3;
+
+    /* Rearrange (a,b,c,d) (e,f,g,h) into (f,e,b,a) (h,g,d,c), as used by SHA256RNDS2. */
+    t0 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s), 0xB1);
+    t1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(s + 4)), 0x1B);
+    s0 = _mm_alignr_epi8(t0, t1, 8);
+    s1 = _mm_blend_epi16(t1, t0, 0xF0);
+    so0 = s0;
+    so1 = s1;
+
+    m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)chunk), bswap);
+    SHANI_QUADROUND(s0, s1, m0, 0);
+    m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 4)), bswap);
+    SHANI_QUADROUND(s0, s1, m1, 4);
+    SHANI_MSG1(m0, m1);
+    m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 8)), bswap);
+    SHANI_QUADROUND(s0, s1, m2, 8);
+    SHANI_MSG1(m1, m2);
+    m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(chunk + 12)), bswap);
+    SHANI_QUADROUND(s0, s1, m3, 12);
+    SHANI_MSG2(m2, m3, m0); SHANI_MSG1(m2, m3);
+    SHANI_QUADROUND(s0, s1, m0, 16);
+    SHANI_MSG2(m3, m0, m1); SHANI_MSG1(m3, m0);
+    SHANI_QUADROUND(s0, s1, m1, 20);
+    SHANI_MSG2(m0, m1, m2); SHANI_MSG1(m0, m1);
+    SHANI_QUADROUND(s0, s1, m2, 24);
+    SHANI_MSG2(m1, m2, m3); SHANI_MSG1(m1, m2);
+    SHANI_QUADROUND(s0, s1, m3, 28);
+    SHANI_MSG2(m2, m3, m0); SHANI_MSG1(m2, m3);
+    SHANI_QUADROUND(s0, s1, m0, 32);
+    SHANI_MSG2(m3, m0, m1); SHANI_MSG1(m3, m0);
+    SHANI_QUADROUND(s0, s1, m1, 36);
+    SHANI_MSG2(m0, m1, m2); SHANI_MSG1(m0, m1);
+    SHANI_QUADROUND(s0, s1, m2, 40);
+    SHANI_MSG2(m1, m2, m3); SHANI_MSG1(m1, m2);
+    SHANI_QUADROUND(s0, s1, m3, 44);
+    SHANI_MSG2(m2, m3, m0); SHANI_MSG1(m2, m3);
+    SHANI_QUADROUND(s0, s1, m0, 48);
+    SHANI_MSG2(m3, m0, m1); SHANI_MSG1(m3, m0);
+    SHANI_QUADROUND(s0, s1, m1, 52);
+    SHANI_MSG2(m0, m1, m2);
+    SHANI_QUADROUND(s0, s1, m2, 56);
+    SHANI_MSG2(m1, m2, m3);
+    SHANI_QUADROUND(s0, s1, m3, 60);
+
+    s0 = _mm_add_epi32(s0, so0);
+    s1 = _mm_add_epi32(s1, so1);
+
+    /* Undo the rearrangement. */
+    t0 = _mm_shuffle_epi32(s0, 0x1B);
+    t1 = _mm_shuffle_epi32(s1, 0xB1);
+    _mm_storeu_si128((__m128i*)s, _mm_blend_epi16(t0, t1, 0xF0));
+    _mm_storeu_si128((__m128i*)(s + 4), _mm_alignr_epi8(t1, t0, 8));
+}
+
+#undef SHANI_QUADROUND
+#undef SHANI_MSG1
+#undef SHANI_MSG2
+#endif
+
+static void secp256k1_sha256_transform(uint32_t* s, const uint32_t* chunk) {
+#ifdef USE_SHANI
+    if (secp256k1_cpu_has_sha()) {
+        secp256k1_sha256_transform_shani(s, chunk);
+        return;
+    }
+#endif
+    secp256k1_sha256_transform_generic(s, chunk);
+}
+
 static void secp256k1_sha256_write(secp256k1_sha256 *hash, const unsigned char *data, size_t len) {
     size_t bufsize = hash->bytes & 0x3F;
     hash->bytes += len;
@@ -162,6 +278,166 @@ static void secp256k1_sha256_finalize(secp256k1_sha256 *hash, unsigned char *out
     memcpy(out32, (const unsigned char*)out, 32);
 }
 
+/* Writes block b of the padded message msg of len bytes to block. */
+static void secp256k1_sha256_padded_block(unsigned char *block, const unsigned char *msg, size_t len, size_t b) {
+    size_t off = 64 * b;
+    memset(block, 0, 64);
+    if (off < len) {
+        memcpy(block, msg + off, len - off < 64 ? len - off : 64);
+    }
+    if (off <= len && len - off < 64) {
+        block[len - off] = 0x80;
+    }
+    if (b == SECP256K1_SHA256_BLOCKS(len) - 1) {
+        uint64_t bits = (uint64_t)len << 3;
+        int i;
+        for (i = 0; i < 8; i++) {
+            block[63 - i] = bits >> (8 * i);
+        }
+    }
+}
+
+#ifdef USE_AVX2
+#define ROTR8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define XOR3_8(x, y, z) _mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+#define ADD3_8(x, y, z) _mm256_add_epi32(_mm256_add_epi32((x), (y)), (z))
+
+#define Round8(a,b,c,d,e,f,g,h,k,w) do { \
+    __m256i t1_ = ADD3_8((h), XOR3_8(ROTR8((e), 6), ROTR8((e), 11), ROTR8((e), 25)), _mm256_xor_si256((g), _mm256_and_si256((e), _mm256_xor_si256((f), (g))))); \
+    __m256i t2_ = _mm256_add_epi32(XOR3_8(ROTR8((a), 2), ROTR8((a), 13), ROTR8((a), 22)), _mm256_or_si256(_mm256_and_si256((a), (b)), _mm256_and_si256((c), _mm256_or_si256((a), (b))))); \
+    t1_ = ADD3_8(t1_, _mm256_set1_epi32(k), (w)); \
+    (d) = _mm256_add_epi32((d), t1_); \
+    (h) = _mm256_add_epi32(t1_, t2_); \
+} while(0)
+
+/* w[i] += sigma1(w[i-2]) + w[i-7] + sigma0(w[i-15]), with indices mod 16 */
+#define Expand8(w, i) ((w)[(i) & 15] = ADD3_8((w)[(i) & 15], \
+    XOR3_8(ROTR8((w)[((i) - 2) & 15], 17), ROTR8((w)[((i) - 2) & 15], 19), _mm256_srli_epi32((w)[((i) - 2) & 15], 10)), \
+    _mm256_add_epi32((w)[((i) - 7) & 15], XOR3_8(ROTR8((w)[((i) - 15) & 15], 7), ROTR8((w)[((i) - 15) & 15], 18), _mm256_srli_epi32((w)[((i) - 15) & 15], 3)))))
+
+/** Perform one SHA-256 transformation on each of 8 independent states, with lane l of s[0..7]
+ *  and chunk[0..15] holding the state and message words of the l-th computation. */
+SECP256K1_TARGET_AVX2 static void secp256k1_sha256_transform_8way(__m256i *s, const __m256i *chunk) {
+    __m256i a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+    __m256i w[16];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        w[i] = chunk[i];
+    }
+    for (i = 0; i < 64; i += 8) {
+        if (i >= 16) {
+            Expand8(w, i); Expand8(w, i + 1); Expand8(w, i + 2); Expand8(w, i + 3);
+            Expand8(w, i + 4); Expand8(w, i + 5); Expand8(w, i + 6); Expand8(w, i + 7);
+        }
+        Round8(a, b, c, d, e, f, g, h, secp256k1_sha256_k[i], w[i & 15]);
+        Round8(h, a, b, c, d, e, f, g, secp256k1_sha256_k[i + 1], w[(i + 1) & 15]);
+        Round8(g, h, a, b, c, d, e, f, secp256k1_sha256_k[i + 2], w[(i + 2) & 15]);
+        Round8(f, g, h, a, b, c, d, e, secp256k1_sha256_k[i + 3], w[(i + 3) & 15]);
+        Round8(e, f, g, h, a, b, c, d, secp256k1_sha256_k[i + 4], w[(i + 4) & 15]);
+        Round8(d, e, f, g, h, a, b, c, secp256k1_sha256_k[i + 5], w[(i + 5) & 15]);
+        Round8(c, d, e, f, g, h, a, b, secp256k1_sha256_k[i + 6], w[(i + 6) & 15]);
+        Round8(b, c, d, e, f, g, h, a, secp256k1_sha256_k[i + 7], w[(i + 7) & 15]);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], h);
+}
+
+#undef Round8
+#undef Expand8
+#undef ROTR8
+#undef XOR3_8
+#undef ADD3_8
+
+/** Hash up to 8 messages in parallel, one per lane. Messages that need fewer blocks than the
+ *  longest one are padded with dummy blocks, and their digest is taken out after their last
+ *  block. May only be called if secp256k1_cpu_has_avx2() returns 1. */
+SECP256K1_TARGET_AVX2 static void secp256k1_sha256_multi_8way(unsigned char *out32, const unsigned char * const *msgs, const size_t *lens, size_t n) {
+    secp256k1_sha256 init;
+    __m256i s[8], w[16];
+    uint32_t words[16][8];
+    uint32_t state[8][8];
+    unsigned char block[64];
+    size_t nblocks[8], maxblocks = 0, b, l;
+    int i;
+
+    VERIFY_CHECK(n > 0 && n <= 8);
+    secp256k1_sha256_initialize(&init);
+    for (i = 0; i < 8; i++) {
+        s[i] = _mm256_set1_epi32(init.s[i]);
+    }
+    for (l = 0; l < 8; l++) {
+        nblocks[l] = l < n ? SECP256K1_SHA256_BLOCKS(lens[l]) : 0;
+        if (nblocks[l] > maxblocks) {
+            maxblocks = nblocks[l];
+        }
+    }
+
+    for (b = 0; b < maxblocks; b++) {
+        int done = 0;
+        for (l = 0; l < 8; l++) {
+            if (b < nblocks[l]) {
+                secp256k1_sha256_padded_block(block, msgs[l], lens[l], b);
+            } else {
+                memset(block, 0, 64);
+            }
+            for (i = 0; i < 16; i++) {
+                words[i][l] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 | (uint32_t)block[4 * i + 2] << 8 | block[4 * i + 3];
+            }
+            done |= (b + 1 == nblocks[l]);
+        }
+        for (i = 0; i < 16; i++) {
+            w[i] = _mm256_loadu_si256((const __m256i*)words[i]);
+        }
+        secp256k1_sha256_transform_8way(s, w);
+        if (!done) {
+            continue;
+        }
+        for (i = 0; i < 8; i++) {
+            _mm256_storeu_si256((__m256i*)state[i], s[i]);
+        }
+        for (l = 0; l < n; l++) {
+            if (b + 1 != nblocks[l]) {
+                continue;
+            }
+            for (i = 0; i < 8; i++) {
+                unsigned char *o = &out32[32 * l + 4 * i];
+                o[0] = state[i][l] >> 24;
+                o[1] = state[i][l] >> 16;
+                o[2] = state[i][l] >> 8;
+                o[3] = state[i][l];
+            }
+        }
+    }
+}
+#endif
+
+static void secp256k1_sha256_multi(unsigned char *out32, const unsigned char * const *msgs, const size_t *lens, size_t n) {
+    size_t i = 0;
+#ifdef USE_AVX2
+    /* A single SHA extensions transform is about as fast as a lane of the 8-way one, and does not
+     * need the messages transposed, so only use the latter without them. */
+    if (secp256k1_cpu_has_avx2() && !secp256k1_cpu_has_sha()) {
+        for (; i + SECP256K1_SHA256_MULTI_MIN_LANES <= n; i += 8) {
+            secp256k1_sha256_multi_8way(&out32[32 * i], &msgs[i], &lens[i], n - i < 8 ? n - i : 8);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        secp256k1_sha256 sha;
+        secp256k1_sha256_initialize(&sha);
+        secp256k1_sha256_write(&sha, msgs[i], lens[i]);
+        secp256k1_sha256_finalize(&sha, &out32[32 * i]);
+    }
+}
+
 static void secp256k1_hmac_sha256_initialize(secp256k1_hmac_sha256 *hash, const unsigned char *key, size_t keylen) {
     size_t n;
     unsigned char rkey[64];
@@ -233,6 +509,56 @@ static void secp256k1_rfc6979_hmac_sha256_initialize(secp256k1_rfc6979_hmac_sha2
     rng->retry = 0;
 }
 
+static void secp256k1_rfc6979_hmac_sha256_prefix_initialize(secp256k1_rfc6979_hmac_sha256_prefix *prefix, const unsigned char *key, size_t keylen) {
+    static const unsigned char zero[1] = {0x00};
+    unsigned char k[32];
+    unsigned char v[32];
+
+    memset(v, 0x01, 32); /* RFC6979 3.2.b. */
+    memset(k, 0x00, 32); /* RFC6979 3.2.c. */
+
+    VERIFY_CHECK(keylen <= sizeof(prefix->key));
+    memcpy(prefix->key, key, keylen);
+    prefix->keylen = keylen;
+
+    /* RFC6979 3.2.d, up to the end of the prefix. */
+    secp256k1_hmac_sha256_initialize(&prefix->hmac, k, 32);
+    secp256k1_hmac_sha256_write(&prefix->hmac, v, 32);
+    secp256k1_hmac_sha256_write(&prefix->hmac, zero, 1);
+    secp256k1_hmac_sha256_write(&prefix->hmac, key, keylen);
+}
+
+static void secp256k1_rfc6979_hmac_sha256_initialize_prefixed(secp256k1_rfc6979_hmac_sha256 *rng, const secp256k1_rfc6979_hmac_sha256_prefix *prefix, const unsigned char *key, size_t keylen) {
+    secp256k1_hmac_sha256 hmac = prefix->hmac;
+    static const unsigned char one[1] = {0x01};
+
+    memset(rng->v, 0x01, 32);
+
+    /* RFC6979 3.2.d, from the end of the prefix. */
+    secp256k1_hmac_sha256_write(&hmac, key, keylen);
+    secp256k1_hmac_sha256_finalize(&hmac, rng->k);
+    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
+    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
+    secp256k1_hmac_sha256_finalize(&hmac, rng->v);
+
+    /* RFC6979 3.2.f. The prefix's key is absorbed here in full again, as K is
+     * no longer independent of the rest of the key. */
+    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
+    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
+    secp256k1_hmac_sha256_write(&hmac, one, 1);
+    secp256k1_hmac_sha256_write(&hmac, prefix->key, prefix->keylen);
+    secp256k1_hmac_sha256_write(&hmac, key, keylen);
+    secp256k1_hmac_sha256_finalize(&hmac, rng->k);
+    secp256k1_hmac_sha256_initialize(&hmac, rng->k, 32);
+    secp256k1_hmac_sha256_write(&hmac, rng->v, 32);
+    secp256k1_hmac_sha256_finalize(&hmac, rng->v);
+    rng->retry = 0;
+}
+
+static void secp256k1_rfc6979_hmac_sha256_prefix_clear(secp256k1_rfc6979_hmac_sha256_prefix *prefix) {
+    memset(prefix, 0, sizeof(*prefix));
+}
+
 static void secp256k1_rfc6979_hmac_sha256_generate(secp256k1_rfc6979_hmac_sha256 *rng, unsigned char *out, size_t outlen) {
     /* RFC6979 3.2.h. */
     static const unsigned char zero[1] = {0x00};
@@ -87,19 +87,27 @@ static void secp256k1_compute_prehash(const secp256k1_context *ctx, unsigned cha
     secp256k1_sha256_finalize(&hasher, output);
 }
 
+/* Writes the index followed by the above hash to buf, which must have room for 42 bytes, and
+ * returns the length. This is hashed to customize the above hash for each pubkey. */
+static size_t secp256k1_compute_sighash_msg(unsigned char *buf, const unsigned char *prehash, size_t index) {
+    size_t len = 0;
+    /* Encode index as a UTF8-style bignum */
+    while (index > 0) {
+        buf[len++] = index & 0x7f;
+        index >>= 7;
+    }
+    memcpy(&buf[len], prehash, 32);
+    return len + 32;
+}
+
 /* Add the index to the above hash to customize it for each pubkey */
 static int secp256k1_compute_sighash(secp256k1_scalar *r, const unsigned char *prehash, size_t index) {
+    unsigned char buf[42];
     unsigned char output[32];
     int overflow;
     secp256k1_sha256 hasher;
     secp256k1_sha256_initialize(&hasher);
-    /* Encode index as a UTF8-style bignum */
-    while (index > 0) {
-        unsigned char ch = index & 0x7f;
-        secp256k1_sha256_write(&hasher, &ch, 1);
-        index >>= 7;
-    }
-    secp256k1_sha256_write(&hasher, prehash, 32);
+    secp256k1_sha256_write(&hasher, buf, secp256k1_compute_sighash_msg(buf, prehash, index));
     secp256k1_sha256_finalize(&hasher, output);
     secp256k1_scalar_set_b32(r, output, &overflow);
     return !overflow;
@@ -189,10 +197,11 @@ int secp256k1_aggsig_generate_nonce(const secp256k1_context* ctx, secp256k1_aggs
     return 1;
 }
 
-int secp256k1_aggsig_sign_single(const secp256k1_context* ctx,
+/* Signs with the secret key seckey, which has been checked for overflow. */
+static int secp256k1_aggsig_sign_single_inner(const secp256k1_context* ctx,
     unsigned char *sig64,
     const unsigned char *msg32,
-    const unsigned char *seckey32,
+    const secp256k1_scalar *seckey,
     const unsigned char* secnonce32,
     const unsigned char* extra32,
     const secp256k1_pubkey* pubnonce_for_e,
@@ -215,13 +224,6 @@ int secp256k1_aggsig_sign_single(const secp256k1_context* ctx,
     int retry;
     secp256k1_scalar tmp_scalar;
 
-    VERIFY_CHECK(ctx != NULL);
-    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
-    ARG_CHECK(sig64 != NULL);
-    ARG_CHECK(msg32 != NULL);
-    ARG_CHECK(seckey32 != NULL);
-    ARG_CHECK(seed != NULL);
-
     /* generate nonce if needed */
     if (secnonce32==NULL){
         secp256k1_rfc6979_hmac_sha256_initialize(&rng, seed, 32);
@@ -261,13 +263,7 @@ int secp256k1_aggsig_sign_single(const secp256k1_context* ctx,
         secp256k1_compute_sighash_single(ctx, &sighash, &pub_tmp, pubkey_for_e, msg32);
     }
     /* calculate signature */
-    secp256k1_scalar_set_b32(&sec, seckey32, &overflow);
-    if (overflow) {
-        secp256k1_scalar_clear(&sec);
-        return 0;
-    }
-
-    secp256k1_scalar_mul(&sec, &sec, &sighash);
+    secp256k1_scalar_mul(&sec, seckey, &sighash);
     secp256k1_scalar_add(&sec, &sec, &secnonce);
 
     if (extra32 != NULL) {
@@ -291,6 +287,57 @@ int secp256k1_aggsig_sign_single(const secp256k1_context* ctx,
     return 1;
 }
 
+int secp256k1_aggsig_sign_single(const secp256k1_context* ctx,
+    unsigned char *sig64,
+    const unsigned char *msg32,
+    const unsigned char *seckey32,
+    const unsigned char* secnonce32,
+    const unsigned char* extra32,
+    const secp256k1_pubkey* pubnonce_for_e,
+    const secp256k1_pubkey* pubnonce_total,
+    const secp256k1_pubkey* pubkey_for_e,
+    const unsigned char* seed){
+    secp256k1_scalar sec;
+    int overflow;
+    int ret;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(sig64 != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(seckey32 != NULL);
+    ARG_CHECK(seed != NULL);
+
+    secp256k1_scalar_set_b32(&sec, seckey32, &overflow);
+    if (overflow) {
+        secp256k1_scalar_clear(&sec);
+        return 0;
+    }
+    ret = secp256k1_aggsig_sign_single_inner(ctx, sig64, msg32, &sec, secnonce32, extra32, pubnonce_for_e, pubnonce_total, pubkey_for_e, seed);
+    secp256k1_scalar_clear(&sec);
+    return ret;
+}
+
+int secp256k1_aggsig_sign_single_with_key(const secp256k1_context* ctx,
+    unsigned char *sig64,
+    const unsigned char *msg32,
+    const secp256k1_signing_key *key,
+    const unsigned char* secnonce32,
+    const unsigned char* extra32,
+    const secp256k1_pubkey* pubnonce_for_e,
+    const secp256k1_pubkey* pubnonce_total,
+    const secp256k1_pubkey* pubkey_for_e,
+    const unsigned char* seed){
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(sig64 != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(key != NULL);
+    ARG_CHECK(seed != NULL);
+
+    return secp256k1_aggsig_sign_single_inner(ctx, sig64, msg32, &key->sec, secnonce32, extra32, pubnonce_for_e, pubnonce_total, pubkey_for_e, seed);
+}
+
 int secp256k1_aggsig_partial_sign(const secp256k1_context* ctx, secp256k1_aggsig_context* aggctx, secp256k1_aggsig_partial_signature *partial, const unsigned char *msghash32, const unsigned char *seckey32, size_t index) {
     size_t i;
     secp256k1_scalar sighash;
@@ -434,14 +481,38 @@ int secp256k1_aggsig_add_signatures_single(const secp256k1_context* ctx,
 typedef struct {
     const secp256k1_context *ctx;
     unsigned char prehash[32];
-    secp256k1_scalar single_hash;
     const secp256k1_pubkey *pubkeys;
+    size_t n_pubkeys;
+    /* Sighashes of the (up to 8) pubkeys starting at index sighash_start, which are hashed
+     * together as independent messages. */
+    size_t sighash_start;
+    unsigned char sighash_cache[8][32];
 } secp256k1_verify_callback_data;
 
+/* Computes the sighashes of the pubkeys starting at index start into the sighash cache. */
+static void secp256k1_aggsig_verify_sighashes(secp256k1_verify_callback_data *cbdata, size_t start) {
+    unsigned char buf[8][42];
+    const unsigned char *msgs[8];
+    size_t lens[8];
+    size_t j, n = cbdata->n_pubkeys - start < 8 ? cbdata->n_pubkeys - start : 8;
+
+    for (j = 0; j < n; j++) {
+        lens[j] = secp256k1_compute_sighash_msg(buf[j], cbdata->prehash, start + j);
+        msgs[j] = buf[j];
+    }
+    secp256k1_sha256_multi(cbdata->sighash_cache[0], msgs, lens, n);
+    cbdata->sighash_start = start;
+}
+
 static int secp256k1_aggsig_verify_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
     secp256k1_verify_callback_data *cbdata = (secp256k1_verify_callback_data*) data;
+    int overflow;
 
-    if (secp256k1_compute_sighash(sc, cbdata->prehash, idx) == 0) {
+    if (idx < cbdata->sighash_start || idx >= cbdata->sighash_start + 8) {
+        secp256k1_aggsig_verify_sighashes(cbdata, idx - idx % 8);
+    }
+    secp256k1_scalar_set_b32(sc, cbdata->sighash_cache[idx % 8], &overflow);
+    if (overflow) {
         return 0;
     }
     secp256k1_scalar_negate(sc, sc);
@@ -459,7 +530,7 @@ int secp256k1_aggsig_verify(const secp256k1_context* ctx, secp256k1_scratch_spac
 
     VERIFY_CHECK(ctx != NULL);
     ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
-    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(scratch != NULL || n_pubkeys == 1);
     ARG_CHECK(sig64 != NULL);
     ARG_CHECK(msg32 != NULL);
     ARG_CHECK(pubkeys != NULL);
@@ -483,10 +554,23 @@ int secp256k1_aggsig_verify(const secp256k1_context* ctx, secp256k1_scratch_spac
     /* Populate callback data */
     cbdata.ctx = ctx;
     cbdata.pubkeys = pubkeys;
+    cbdata.n_pubkeys = n_pubkeys;
+    /* Nothing cached yet */
+    cbdata.sighash_start = n_pubkeys;
     secp256k1_compute_prehash(ctx, cbdata.prehash, pubkeys, n_pubkeys, &r_x, msg32);
 
     /* Compute sum sG - e_i*P_i, which should be R */
-    if (!secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &pk_sum, &g_sc, secp256k1_aggsig_verify_callback, &cbdata, n_pubkeys)) {
+    if (n_pubkeys == 1) {
+        /* A single key needs no scratch space, a plain ecmult will do */
+        secp256k1_scalar e;
+        secp256k1_ge pk;
+        secp256k1_gej pkj;
+        if (!secp256k1_aggsig_verify_callback(&e, &pk, 0, &cbdata)) {
+            return 0;
+        }
+        secp256k1_gej_set_ge(&pkj, &pk);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &pk_sum, &pkj, &e, &g_sc);
+    } else if (!secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &pk_sum, &g_sc, secp256k1_aggsig_verify_callback, &cbdata, n_pubkeys)) {
         return 0;
     }
 
@@ -496,25 +580,35 @@ int secp256k1_aggsig_verify(const secp256k1_context* ctx, secp256k1_scratch_spac
            secp256k1_gej_has_quad_y_var(&pk_sum);
 }
 
+size_t secp256k1_aggsig_verify_scratch_size(const secp256k1_context* ctx, size_t n_pubkeys) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+
+    if (n_pubkeys <= 1) {
+        return 0;
+    }
+    return secp256k1_ecmult_multi_scratch_size(&ctx->ecmult_ctx, n_pubkeys);
+}
+
 int secp256k1_aggsig_build_scratch_and_verify(const secp256k1_context* ctx, 
                                               const unsigned char *sig64,
                                               const unsigned char *msg32,
                                               const secp256k1_pubkey *pubkeys, 
                                               size_t n_pubkeys) {
+    secp256k1_scratch_space *scratch;
+    int returnval;
+
+    /* A single key is verified without scratch space, so don't allocate one */
+    if (n_pubkeys == 1) {
+        return secp256k1_aggsig_verify(ctx, NULL, sig64, msg32, pubkeys, n_pubkeys);
+    }
     /* just going to inefficiently allocate every time */
-    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1024*4096);
-    int returnval=secp256k1_aggsig_verify(ctx, scratch, sig64, msg32, pubkeys, n_pubkeys);
+    scratch = secp256k1_scratch_space_create(ctx, secp256k1_aggsig_verify_scratch_size(ctx, n_pubkeys));
+    returnval=secp256k1_aggsig_verify(ctx, scratch, sig64, msg32, pubkeys, n_pubkeys);
     secp256k1_scratch_space_destroy(scratch);
     return returnval;
 }
 
-static int secp256k1_aggsig_verify_callback_single(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
-    secp256k1_verify_callback_data *cbdata = (secp256k1_verify_callback_data*) data;
-    secp256k1_scalar_negate(sc, &cbdata->single_hash);
-    secp256k1_pubkey_load(cbdata->ctx, pt, &cbdata->pubkeys[idx]);
-    return 1;
-}
-
 int secp256k1_aggsig_verify_single(
     const secp256k1_context* ctx,
     const unsigned char *sig64,
@@ -530,9 +624,8 @@ int secp256k1_aggsig_verify_single(
     secp256k1_gej pk_sum;
     secp256k1_ge pk_sum_ge;
     secp256k1_scalar sighash;
-    secp256k1_scratch_space *scratch;
-    secp256k1_verify_callback_data cbdata;
     secp256k1_ge tmp_ge;
+    secp256k1_gej tmp_gej;
     secp256k1_pubkey tmp_pk;
 
     int overflow;
@@ -564,23 +657,13 @@ int secp256k1_aggsig_verify_single(
         secp256k1_compute_sighash_single(ctx, &sighash, &tmp_pk, pubkey_total, msg32);
     }
 
-    /* Populate callback data */
-    cbdata.ctx = ctx;
-    cbdata.pubkeys = pubkey;
-    cbdata.single_hash = sighash;
-
-    scratch = secp256k1_scratch_space_create(ctx, 1024*4096);
-    if (scratch == NULL){
-        return 0;
-    }
-    
     /* Compute sG - eP, which should be R */
-    if (!secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &pk_sum, &g_sc, secp256k1_aggsig_verify_callback_single, &cbdata, 1)) {
-        secp256k1_scratch_space_destroy(scratch);
+    if (!secp256k1_pubkey_load(ctx, &tmp_ge, pubkey)) {
         return 0;
     }
-
-    secp256k1_scratch_space_destroy(scratch);
+    secp256k1_gej_set_ge(&tmp_gej, &tmp_ge);
+    secp256k1_scalar_negate(&sighash, &sighash);
+    secp256k1_ecmult(&ctx->ecmult_ctx, &pk_sum, &tmp_gej, &sighash, &g_sc);
 
     if (extra_pubkey != NULL) {
         /* Subtract an extra public key */
@@ -600,6 +683,159 @@ int secp256k1_aggsig_verify_single(
 
 }
 
+/* Data that is used by the batch verification ecmult callback */
+typedef struct {
+    const secp256k1_context *ctx;
+    /* Seed for the random number generator */
+    unsigned char chacha_seed[32];
+    /* Randomizers generated by the PRNG, which returns two per call. The very first
+     * randomizer is set to 1 and the PRNG is called at every odd indexed signature. */
+    secp256k1_scalar randomizer_cache[2];
+    /* Public nonce of the signature currently being processed */
+    secp256k1_ge r;
+    const unsigned char *const *sig64;
+    const unsigned char *const *msg32;
+    const secp256k1_pubkey *const *pubnonce;
+    const secp256k1_pubkey *const *pubkey;
+    const secp256k1_pubkey *const *pubkey_total;
+    const secp256k1_pubkey *const *extra_pubkey;
+} secp256k1_aggsig_verify_batch_ecmult_context;
+
+/* Returns the i'th entry of an optional array of pubkeys, or NULL if there is no array */
+static const secp256k1_pubkey *secp256k1_aggsig_batch_pubkey(const secp256k1_pubkey *const *pubkeys, size_t i) {
+    return pubkeys == NULL ? NULL : pubkeys[i];
+}
+
+static void secp256k1_aggsig_batch_hash_pubkey(const secp256k1_context *ctx, secp256k1_sha256 *sha, const secp256k1_pubkey *pubkey) {
+    unsigned char buf[33];
+    size_t buflen = sizeof(buf);
+
+    if (pubkey == NULL) {
+        memset(buf, 0, sizeof(buf));
+    } else {
+        secp256k1_ec_pubkey_serialize(ctx, buf, &buflen, pubkey, SECP256K1_EC_COMPRESSED);
+    }
+    secp256k1_sha256_write(sha, buf, sizeof(buf));
+}
+
+/* Every signature i has three (scalar, point) tuples, which are called for in order:
+ * (a_i, R_i), (a_i*e_i, P_i) and (a_i, X_i), where X_i is the extra pubkey. Signatures
+ * without an extra pubkey get a zero scalar for it, which ecmult_multi skips. */
+static int secp256k1_aggsig_verify_batch_ecmult_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+    secp256k1_aggsig_verify_batch_ecmult_context *ecmult_context = (secp256k1_aggsig_verify_batch_ecmult_context *) data;
+    const size_t i = idx / 3;
+    const secp256k1_scalar *randomizer = &ecmult_context->randomizer_cache[i % 2];
+
+    switch (idx % 3) {
+    case 0: {
+        secp256k1_fe rx;
+        if (i % 2 == 1) {
+            secp256k1_scalar_chacha20(&ecmult_context->randomizer_cache[0], &ecmult_context->randomizer_cache[1], ecmult_context->chacha_seed, i / 2);
+        }
+        if (!secp256k1_fe_set_b32(&rx, ecmult_context->sig64[i])) {
+            return 0;
+        }
+        if (!secp256k1_ge_set_xquad(&ecmult_context->r, &rx)) {
+            return 0;
+        }
+        *sc = *randomizer;
+        *pt = ecmult_context->r;
+        break;
+    }
+    case 1: {
+        const secp256k1_pubkey *pubnonce = secp256k1_aggsig_batch_pubkey(ecmult_context->pubnonce, i);
+        secp256k1_pubkey tmp_pk;
+        if (pubnonce == NULL) {
+            secp256k1_pubkey_save(&tmp_pk, &ecmult_context->r);
+            pubnonce = &tmp_pk;
+        }
+        secp256k1_compute_sighash_single(ecmult_context->ctx, sc, pubnonce, secp256k1_aggsig_batch_pubkey(ecmult_context->pubkey_total, i), ecmult_context->msg32[i]);
+        secp256k1_scalar_mul(sc, sc, randomizer);
+        if (!secp256k1_pubkey_load(ecmult_context->ctx, pt, ecmult_context->pubkey[i])) {
+            return 0;
+        }
+        break;
+    }
+    default: {
+        const secp256k1_pubkey *extra_pubkey = secp256k1_aggsig_batch_pubkey(ecmult_context->extra_pubkey, i);
+        if (extra_pubkey == NULL) {
+            secp256k1_scalar_clear(sc);
+            *pt = ecmult_context->r;
+        } else {
+            *sc = *randomizer;
+            if (!secp256k1_pubkey_load(ecmult_context->ctx, pt, extra_pubkey)) {
+                return 0;
+            }
+        }
+        break;
+    }
+    }
+    return 1;
+}
+
+/* Seeds a random number generator with the inputs and derives a random number a_i for every
+ * signature i, with a_1 = 1. Fails if the y-coordinate of any R is not a quadratic residue or if
+ * 0 != -(a_1*s_1 + ... + a_u*s_u)G + a_1*(R_1 + X_1) + ... + a_u*(R_u + X_u) + (a_1*e_1)P_1 + ... + (a_u*e_u)P_u. */
+int secp256k1_aggsig_verify_single_batch(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const unsigned char *const *sig64, const unsigned char *const *msg32, const secp256k1_pubkey *const *pubnonce, const secp256k1_pubkey *const *pubkey, const secp256k1_pubkey *const *pubkey_total, const secp256k1_pubkey *const *extra_pubkey, size_t n_sigs) {
+    secp256k1_aggsig_verify_batch_ecmult_context ecmult_context;
+    secp256k1_sha256 sha;
+    secp256k1_scalar s;
+    secp256k1_gej rj;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+    /* The number of points given to ecmult_multi is 3*n_sigs */
+    ARG_CHECK(n_sigs <= SIZE_MAX / 3);
+    ARG_CHECK(n_sigs < (size_t)(1 << 31));
+    if (n_sigs > 0) {
+        ARG_CHECK(sig64 != NULL);
+        ARG_CHECK(msg32 != NULL);
+        ARG_CHECK(pubkey != NULL);
+    }
+
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_aggsig_batch_hash_pubkey(ctx, &sha, secp256k1_aggsig_batch_pubkey(pubnonce, i));
+        secp256k1_aggsig_batch_hash_pubkey(ctx, &sha, pubkey[i]);
+        secp256k1_aggsig_batch_hash_pubkey(ctx, &sha, secp256k1_aggsig_batch_pubkey(pubkey_total, i));
+        secp256k1_aggsig_batch_hash_pubkey(ctx, &sha, secp256k1_aggsig_batch_pubkey(extra_pubkey, i));
+    }
+    secp256k1_sha256_finalize(&sha, ecmult_context.chacha_seed);
+    ecmult_context.ctx = ctx;
+    ecmult_context.sig64 = sig64;
+    ecmult_context.msg32 = msg32;
+    ecmult_context.pubnonce = pubnonce;
+    ecmult_context.pubkey = pubkey;
+    ecmult_context.pubkey_total = pubkey_total;
+    ecmult_context.extra_pubkey = extra_pubkey;
+
+    /* Sum the s parts of all signatures, multiplied by their randomizers */
+    secp256k1_scalar_clear(&s);
+    secp256k1_scalar_set_int(&ecmult_context.randomizer_cache[0], 1);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_scalar term;
+        int overflow;
+        if (i % 2 == 1) {
+            secp256k1_scalar_chacha20(&ecmult_context.randomizer_cache[0], &ecmult_context.randomizer_cache[1], ecmult_context.chacha_seed, i / 2);
+        }
+        secp256k1_scalar_set_b32(&term, sig64[i] + 32, &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_scalar_mul(&term, &term, &ecmult_context.randomizer_cache[i % 2]);
+        secp256k1_scalar_add(&s, &s, &term);
+    }
+    secp256k1_scalar_negate(&s, &s);
+    secp256k1_scalar_set_int(&ecmult_context.randomizer_cache[0], 1);
+
+    return secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &rj, &s, secp256k1_aggsig_verify_batch_ecmult_callback, (void *) &ecmult_context, 3 * n_sigs)
+            && secp256k1_gej_is_infinity(&rj);
+}
+
 void secp256k1_aggsig_context_destroy(secp256k1_aggsig_context *aggctx) {
     if (aggctx == NULL) {
         return;
@@ -318,6 +318,35 @@ void test_aggsig_onesigner(void) {
         }
         CHECK(secp256k1_aggsig_combine_signatures(ctx, aggctx, sig, partials, n_signers[i]));
         CHECK(secp256k1_aggsig_verify(ctx, scratch, sig, msg, pubkeys, n_signers[i]));
+        CHECK(secp256k1_aggsig_build_scratch_and_verify(ctx, sig, msg, pubkeys, n_signers[i]));
+        /* A scratch space of the advertised size is enough */
+        {
+            size_t size = secp256k1_aggsig_verify_scratch_size(ctx, n_signers[i]);
+            secp256k1_scratch_space *exact = secp256k1_scratch_space_create(ctx, size);
+            CHECK((size == 0) == (n_signers[i] == 1));
+            CHECK(secp256k1_aggsig_verify(ctx, exact, sig, msg, pubkeys, n_signers[i]));
+            CHECK(secp256k1_scratch_space_high_water_mark(exact) <= size);
+            secp256k1_scratch_space_destroy(exact);
+        }
+        /* A single key is verified without scratch space */
+        if (n_signers[i] == 1) {
+            CHECK(secp256k1_aggsig_verify(ctx, NULL, sig, msg, pubkeys, 1));
+            sig[63] ^= 1;
+            CHECK(!secp256k1_aggsig_verify(ctx, NULL, sig, msg, pubkeys, 1));
+            CHECK(!secp256k1_aggsig_build_scratch_and_verify(ctx, sig, msg, pubkeys, 1));
+            sig[63] ^= 1;
+        }
+        /* Signing with a prepared key gives the same signature */
+        if (n_signers[i] == 1) {
+            unsigned char sig2[64];
+            secp256k1_signing_key *key = secp256k1_signing_key_create(ctx, seckeys[0]);
+            CHECK(key != NULL);
+            CHECK(secp256k1_aggsig_sign_single(ctx, sig, msg, seckeys[0], NULL, NULL, NULL, NULL, NULL, seed));
+            CHECK(secp256k1_aggsig_sign_single_with_key(ctx, sig2, msg, key, NULL, NULL, NULL, NULL, NULL, seed));
+            CHECK(memcmp(sig, sig2, 64) == 0);
+            CHECK(secp256k1_aggsig_verify_single(ctx, sig2, msg, NULL, &pubkeys[0], NULL, NULL, 0));
+            secp256k1_signing_key_destroy(key);
+        }
         /* Make sure verification with 0 pubkeys fails without Bad Things happenings */
         CHECK(!secp256k1_aggsig_verify(ctx, scratch, sig, msg, pubkeys, 0));
 
@@ -328,9 +357,108 @@ void test_aggsig_onesigner(void) {
 }
 #undef N_KEYS
 
+#define N_SIGS 20
+void test_aggsig_verify_single_batch(void) {
+    unsigned char seckeys[N_SIGS][32];
+    unsigned char extras[N_SIGS][32];
+    secp256k1_pubkey pubkeys[N_SIGS];
+    secp256k1_pubkey extra_pubkeys[N_SIGS];
+    unsigned char sigs[N_SIGS][64];
+    unsigned char sig[64];
+    unsigned char msgs[N_SIGS][32];
+    const unsigned char *sig_ptr[N_SIGS];
+    const unsigned char *msg_ptr[N_SIGS];
+    const secp256k1_pubkey *pk_ptr[N_SIGS];
+    const secp256k1_pubkey *total_ptr[N_SIGS];
+    const secp256k1_pubkey *extra_ptr[N_SIGS];
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1024*4096);
+    secp256k1_scalar tmp_s;
+    unsigned char seed[32];
+    int32_t ecount = 0;
+    size_t i;
+
+    secp256k1_context_set_illegal_callback(ctx, counting_illegal_callback_fn, &ecount);
+
+    /* Kernel-style signatures, committing to their own pubkey, some with an extra key */
+    for (i = 0; i < N_SIGS; i++) {
+        const int use_extra = i == 0 || secp256k1_rand_bits(1);
+        random_scalar_order_test(&tmp_s);
+        secp256k1_scalar_get_b32(seckeys[i], &tmp_s);
+        random_scalar_order_test(&tmp_s);
+        secp256k1_scalar_get_b32(extras[i], &tmp_s);
+        random_scalar_order_test(&tmp_s);
+        secp256k1_scalar_get_b32(msgs[i], &tmp_s);
+        random_scalar_order_test(&tmp_s);
+        secp256k1_scalar_get_b32(seed, &tmp_s);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkeys[i], seckeys[i]));
+        CHECK(secp256k1_ec_pubkey_create(ctx, &extra_pubkeys[i], extras[i]));
+        CHECK(secp256k1_aggsig_sign_single(ctx, sigs[i], msgs[i], seckeys[i], NULL, use_extra ? extras[i] : NULL, NULL, NULL, &pubkeys[i], seed));
+        sig_ptr[i] = sigs[i];
+        msg_ptr[i] = msgs[i];
+        pk_ptr[i] = &pubkeys[i];
+        total_ptr[i] = &pubkeys[i];
+        extra_ptr[i] = use_extra ? &extra_pubkeys[i] : NULL;
+        CHECK(secp256k1_aggsig_verify_single(ctx, sigs[i], msgs[i], NULL, &pubkeys[i], &pubkeys[i], extra_ptr[i], 0));
+    }
+
+    CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, NULL, NULL, NULL, NULL, NULL, NULL, 0));
+    CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, 1));
+    CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+    /* Passing the nonces explicitly is the same as taking them from the signatures */
+    {
+        secp256k1_pubkey nonces[N_SIGS];
+        const secp256k1_pubkey *nonce_ptr[N_SIGS];
+        for (i = 0; i < N_SIGS; i++) {
+            secp256k1_ge r;
+            secp256k1_fe rx;
+            CHECK(secp256k1_fe_set_b32(&rx, sigs[i]));
+            CHECK(secp256k1_ge_set_xquad(&r, &rx));
+            secp256k1_pubkey_save(&nonces[i], &r);
+            nonce_ptr[i] = &nonces[i];
+        }
+        CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, nonce_ptr, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+        nonce_ptr[N_SIGS / 2] = &pubkeys[0];
+        CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, nonce_ptr, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+    }
+    CHECK(ecount == 0);
+
+    /* Any broken signature fails the whole batch */
+    i = secp256k1_rand_int(N_SIGS);
+    memcpy(sig, sigs[i], 64);
+    sigs[i][32 + secp256k1_rand_int(32)] ^= 1 << secp256k1_rand_int(8);
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+    CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, i));
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, &sig_ptr[i], &msg_ptr[i], NULL, &pk_ptr[i], &total_ptr[i], &extra_ptr[i], 1));
+    memset(sigs[i] + 32, 0xff, 32);
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+    memcpy(sigs[i], sig, 64);
+    CHECK(secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+
+    /* ...as does a missing extra key or a swapped message */
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, NULL, N_SIGS));
+    msg_ptr[N_SIGS - 1] = msgs[0];
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, pk_ptr, total_ptr, extra_ptr, N_SIGS));
+    CHECK(ecount == 0);
+
+    /* API errors */
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, NULL, msg_ptr, NULL, pk_ptr, NULL, NULL, 1));
+    CHECK(ecount == 1);
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, NULL, NULL, pk_ptr, NULL, NULL, 1));
+    CHECK(ecount == 2);
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, scratch, sig_ptr, msg_ptr, NULL, NULL, NULL, NULL, 1));
+    CHECK(ecount == 3);
+    CHECK(!secp256k1_aggsig_verify_single_batch(ctx, NULL, sig_ptr, msg_ptr, NULL, pk_ptr, NULL, NULL, 1));
+    CHECK(ecount == 4);
+
+    secp256k1_context_set_illegal_callback(ctx, NULL, NULL);
+    secp256k1_scratch_space_destroy(scratch);
+}
+#undef N_SIGS
+
 void run_aggsig_tests(void) {
     test_aggsig_api();
     test_aggsig_onesigner();
+    test_aggsig_verify_single_batch();
 }
 
 #endif
@@ -62,16 +62,22 @@
  *   - For `i` from `3n/2 + 1` to `2n - 1`, multiply some earlier `s_j` by some `x_k^-2`
  * where of course, the indices `j` and `k` must be chosen carefully.
  *
- * The bulk of `secp256k1_bulletproof_innerproduct_vfy_ecmult_callback` involves computing
+ * The bulk of `secp256k1_bulletproof_innerproduct_vfy_term` involves computing
  * these indices, given `a_2/a_1`, `b_1/a_1`, `b_2/b_1`, and the `x_k^2`s as input. It
  * computes `x_k^-2` as a side-effect of its other computation.
  */
 
 typedef int (secp256k1_bulletproof_vfy_callback)(secp256k1_scalar *sc, secp256k1_ge *pt, secp256k1_scalar *randomizer, size_t idx, void *data);
 
-/* used by callers to wrap a proof with surrounding context */
+/* used by callers to wrap a proof with surrounding context. Proofs verified together
+ * may have different lengths `vec_len`; they share the `G_i` and `H_i` generators as
+ * far as they overlap. The first extra rangeproof point of every proof with the same
+ * `shared_g_idx` is summed into a single point, if the verifier is asked to do so. */
 typedef struct {
     const unsigned char *proof;
+    size_t plen;
+    size_t vec_len;
+    size_t shared_g_idx;
     secp256k1_scalar p_offs;
     secp256k1_scalar yinv;
     unsigned char commit[32];
@@ -90,6 +96,8 @@ typedef struct {
     secp256k1_scalar xcache[SECP256K1_BULLETPROOF_MAX_DEPTH + 1];
     secp256k1_scalar xsqinv_mask;
     const unsigned char *serialized_lr;
+    size_t lg_vec_len;
+    secp256k1_scalar p_offs;
 } secp256k1_bulletproof_innerproduct_vfy_data;
 
 /* used by callers to modify the multiexp */
@@ -100,8 +108,8 @@ typedef struct {
     const secp256k1_ge *geng;
     const secp256k1_ge *genh;
     size_t vec_len;
-    size_t lg_vec_len;
-    int shared_g;
+    size_t n_lr_points;
+    size_t n_shared_g;
     secp256k1_scalar *randomizer;
     secp256k1_bulletproof_innerproduct_vfy_data *proof;
 } secp256k1_bulletproof_innerproduct_vfy_ecmult_context;
@@ -116,9 +124,9 @@ size_t secp256k1_bulletproof_innerproduct_proof_length(size_t n) {
     }
 }
 
-/* Our ecmult_multi function takes `(c - a*b)*x` directly and multiplies this by `G`. For every other
- * (scalar, point) pair it calls the following callback function, which takes an index and outputs a
- * pair. The function therefore has three regimes:
+/* Our ecmult_multi function takes `(c - a*b)*x` directly and multiplies this by `G`. Every other
+ * (scalar, point) pair is computed by the following function, which takes an index and outputs a
+ * pair, and must be called for consecutive indices. The function therefore has three regimes:
  *
  * For the first `n` invocations, it returns `(s'_i, G_i)` for `i` from 1 to `n`.
  * For the next `n` invocations, it returns `(s_i, H_i)` for `i` from 1 to `n`.
@@ -133,19 +141,14 @@ size_t secp256k1_bulletproof_innerproduct_proof_length(size_t n) {
  * is the more convenient indexing. In particular we describe (a) how the indices `j` and `k`,
  * from the big comment block above, are chosen; and (b) when/how each `x_k^-2` is computed.
  */
-static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
-    secp256k1_bulletproof_innerproduct_vfy_ecmult_context *ctx = (secp256k1_bulletproof_innerproduct_vfy_ecmult_context *) data;
+static int secp256k1_bulletproof_innerproduct_vfy_term(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, secp256k1_bulletproof_innerproduct_vfy_ecmult_context *ctx) {
 
     /* First 2N points use the standard Gi, Hi generators, and the scalars can be aggregated across proofs.
-     * Inside this if clause, `idx` corresponds to the index `i` in the big comment, and runs from 0 to `2n-1`.
-     * Also `ctx->vec_len` corresponds to `n`. */
+     * Here `ctx->vec_len` is the largest `n` of any proof; a proof with a smaller `n` only contributes
+     * to the first `n` of the `G_i`s and the first `n` of the `H_i`s. Inside the loop below `local_idx`
+     * corresponds to the index `i` in the big comment for the current proof, and runs from 0 to `2n-1`. */
     if (idx < 2 * ctx->vec_len) {
-        /* Number of `a` scalars in the proof (same as number of `b` scalars in the proof). Will
-         * be 2 except for very small proofs that have fewer than 2 scalars as input. */
-        const size_t grouping = ctx->vec_len < IP_AB_SCALARS / 2 ? ctx->vec_len : IP_AB_SCALARS / 2;
-        const size_t lg_grouping = secp256k1_floor_lg(grouping);
         size_t i;
-        VERIFY_CHECK(lg_grouping == 0 || lg_grouping == 1); /* TODO support higher IP_AB_SCALARS */
 
         /* Determine whether we're multiplying by `G_i`s or `H_i`s. */
         if (idx < ctx->vec_len) {
@@ -162,6 +165,28 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
          * randomized this to ensure that this wanton addition cannot enable cancellation attacks.
          */
         for (i = 0; i < ctx->n_proofs; i++) {
+            const size_t vec_len = ctx->proof[i].proof->vec_len;
+            /* Number of `a` scalars in the proof (same as number of `b` scalars in the proof). Will
+             * be 2 except for very small proofs that have fewer than 2 scalars as input. */
+            const size_t grouping = vec_len < IP_AB_SCALARS / 2 ? vec_len : IP_AB_SCALARS / 2;
+            const size_t lg_grouping = secp256k1_floor_lg(grouping);
+            size_t local_idx;
+            size_t cache_idx;
+            secp256k1_scalar term;
+            VERIFY_CHECK(lg_grouping == 0 || lg_grouping == 1); /* TODO support higher IP_AB_SCALARS */
+
+            if (idx < ctx->vec_len) {
+                if (idx >= vec_len) {
+                    continue;
+                }
+                local_idx = idx;
+            } else {
+                if (idx - ctx->vec_len >= vec_len) {
+                    continue;
+                }
+                local_idx = idx - ctx->vec_len + vec_len;
+            }
+
             /* To recall from the introductory comment: most `s_i` values are computed by taking an
              * earlier `s_j` value and multiplying it by some `x_k^2`.
              *
@@ -177,16 +202,15 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
              * Note that `ctx->proof[i].xcache[0]` will always equal `-a_1 * prod_{i=1}^{n-1} x_i^-2`,
              * and we expect the caller to have set this.
              */
-            const size_t cache_idx = secp256k1_popcountl(idx);
-            secp256k1_scalar term;
+            cache_idx = secp256k1_popcountl(local_idx);
             VERIFY_CHECK(cache_idx < SECP256K1_BULLETPROOF_MAX_DEPTH);
-            /* For the special case `cache_idx == 0` (which is true iff `idx == 0`) there is nothing to do. */
+            /* For the special case `cache_idx == 0` (which is true iff `local_idx == 0`) there is nothing to do. */
             if (cache_idx > 0) {
                 /* Otherwise, check if this is one of the special indices where we transition from `a_1` to `a_2`,
                  * from `a_2` to `b_1`, or from `b_1` to `b_2`. (For small proofs there is only one transition,
                  * from `a` to `b`.) */
-                if (idx % (ctx->vec_len / grouping) == 0) {
-                    const size_t abinv_idx = idx / (ctx->vec_len / grouping) - 1;
+                if (local_idx % (vec_len / grouping) == 0) {
+                    const size_t abinv_idx = local_idx / (vec_len / grouping) - 1;
                     size_t prev_cache_idx;
                     /* Check if it's the even specialer index where we're transitioning from `a`s to `b`s, from
                      * `G`s to `H`s, and from `x_k^2`s to `x_k^-2`s. In rangeproof and circuit applications,
@@ -199,11 +223,11 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
                      * This is an underhanded trick but the result is that all `n` powers of `y^-i` show up
                      * in the right place, and we only need log-many scalar squarings and multiplications.
                      */
-                    if (idx == ctx->vec_len) {
+                    if (local_idx == vec_len) {
                         secp256k1_scalar yinvn = ctx->proof[i].proof->yinv;
                         size_t j;
-                        prev_cache_idx = secp256k1_popcountl(idx - 1);
-                        for (j = 0; j < (size_t) secp256k1_ctzl(idx) - lg_grouping; j++) {
+                        prev_cache_idx = secp256k1_popcountl(local_idx - 1);
+                        for (j = 0; j < (size_t) secp256k1_ctzl(local_idx) - lg_grouping; j++) {
                             secp256k1_scalar_mul(&ctx->proof[i].xsqinvy[j], &ctx->proof[i].xsqinv[j], &yinvn);
                             secp256k1_scalar_sqr(&yinvn, &yinvn);
                         }
@@ -226,11 +250,11 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
                  * is computed in the variable `xsq_idx` (`xsqinv_idx` respectively). In light of our discussion
                  * of `j`, we see that this should be "the least significant bit that's 1 in `i` but not `i-1`."
                  * In other words, it is the number of trailing 0 bits in the index `i`. */
-                } else if (idx < ctx->vec_len) {
-                    const size_t xsq_idx = secp256k1_ctzl(idx);
+                } else if (local_idx < vec_len) {
+                    const size_t xsq_idx = secp256k1_ctzl(local_idx);
                     secp256k1_scalar_mul(&ctx->proof[i].xcache[cache_idx], &ctx->proof[i].xcache[cache_idx - 1], &ctx->proof[i].xsq[xsq_idx]);
                 } else {
-                    const size_t xsqinv_idx = secp256k1_ctzl(idx);
+                    const size_t xsqinv_idx = secp256k1_ctzl(local_idx);
                     secp256k1_scalar_mul(&ctx->proof[i].xcache[cache_idx], &ctx->proof[i].xcache[cache_idx - 1], &ctx->proof[i].xsqinvy[xsqinv_idx]);
                 }
             }
@@ -241,8 +265,8 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
              * that has exactly one 0-bit, i.e. which is a product of all `x_i`s and one `x_k^-1`. By
              * multiplying that by the special value `prod_{i=1}^n x_i^-1` we obtain simply `x_k^-2`.
              * We expect the caller to give us this special value in `ctx->proof[i].xsqinv_mask`. */
-            if (idx < ctx->vec_len / grouping && secp256k1_popcountl(idx) == ctx->lg_vec_len - 1) {
-                const size_t xsqinv_idx = secp256k1_ctzl(~idx);
+            if (local_idx < vec_len / grouping && secp256k1_popcountl(local_idx) == ctx->proof[i].lg_vec_len - 1) {
+                const size_t xsqinv_idx = secp256k1_ctzl(~local_idx);
                 secp256k1_scalar_mul(&ctx->proof[i].xsqinv[xsqinv_idx], &ctx->proof[i].xcache[cache_idx], &ctx->proof[i].xsqinv_mask);
             }
 
@@ -251,7 +275,7 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
              * cancellation attacks here. */
             if (ctx->proof[i].proof->rangeproof_cb != NULL) {
                 secp256k1_scalar rangeproof_offset;
-                if ((ctx->proof[i].proof->rangeproof_cb)(&rangeproof_offset, NULL, &ctx->randomizer[i], idx, ctx->proof[i].proof->rangeproof_cb_data) != 1) {
+                if ((ctx->proof[i].proof->rangeproof_cb)(&rangeproof_offset, NULL, &ctx->randomizer[i], local_idx, ctx->proof[i].proof->rangeproof_cb_data) != 1) {
                     return 0;
                 }
                 secp256k1_scalar_add(&term, &term, &rangeproof_offset);
@@ -259,50 +283,61 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
 
             secp256k1_scalar_add(sc, sc, &term);
         }
-    /* Next 2lgN points are the L and R vectors */
-    } else if (idx < 2 * (ctx->vec_len + ctx->lg_vec_len * ctx->n_proofs)) {
+    /* Next 2lgN points per proof are the L and R vectors */
+    } else if (idx < 2 * ctx->vec_len + ctx->n_lr_points) {
         size_t real_idx = idx - 2 * ctx->vec_len;
-        const size_t proof_idx = real_idx / (2 * ctx->lg_vec_len);
-        real_idx = real_idx % (2 * ctx->lg_vec_len);
+        size_t proof_idx = 0;
+        while (real_idx >= 2 * ctx->proof[proof_idx].lg_vec_len) {
+            real_idx -= 2 * ctx->proof[proof_idx].lg_vec_len;
+            proof_idx++;
+            VERIFY_CHECK(proof_idx < ctx->n_proofs);
+        }
         if (!secp256k1_bulletproof_deserialize_point(
             pt,
             ctx->proof[proof_idx].serialized_lr,
             real_idx,
-            2 * ctx->lg_vec_len
+            2 * ctx->proof[proof_idx].lg_vec_len
         )) {
             return 0;
         }
-        if (idx % 2 == 0) {
+        if (real_idx % 2 == 0) {
             *sc = ctx->proof[proof_idx].xsq[real_idx / 2];
         } else {
             *sc = ctx->proof[proof_idx].xsqinv[real_idx / 2];
         }
         secp256k1_scalar_mul(sc, sc, &ctx->randomizer[proof_idx]);
     /* After the G's, H's, L's and R's, do the blinding_gen */
-    } else if (idx == 2 * (ctx->vec_len + ctx->lg_vec_len * ctx->n_proofs)) {
+    } else if (idx == 2 * ctx->vec_len + ctx->n_lr_points) {
         *sc = ctx->p_offs;
         *pt = *ctx->g;
     /* Remaining points are whatever the rangeproof wants */
-    } else if (ctx->shared_g && idx == 2 * (ctx->vec_len + ctx->lg_vec_len * ctx->n_proofs) + 1) {
-        /* Special case: the first extra point is independent of the proof, for both rangeproof and circuit */
+    } else if (idx < 2 * ctx->vec_len + ctx->n_lr_points + 1 + ctx->n_shared_g) {
+        /* Special case: the first extra point is independent of the proof, for both rangeproof and circuit,
+         * so proofs which agree on it (have the same `shared_g_idx`) can share a single point. */
+        const size_t shared_g_idx = idx - (2 * ctx->vec_len + ctx->n_lr_points + 1);
         size_t i;
         secp256k1_scalar_clear(sc);
         for (i = 0; i < ctx->n_proofs; i++) {
+            const secp256k1_bulletproof_innerproduct_vfy_data *proof = &ctx->proof[i];
             secp256k1_scalar term;
-            if ((ctx->proof[i].proof->rangeproof_cb)(&term, pt, &ctx->randomizer[i], 2 * (ctx->vec_len + ctx->lg_vec_len), ctx->proof[i].proof->rangeproof_cb_data) != 1) {
+            if (proof->proof->shared_g_idx != shared_g_idx) {
+                continue;
+            }
+            if ((proof->proof->rangeproof_cb)(&term, pt, &ctx->randomizer[i], 2 * (proof->proof->vec_len + proof->lg_vec_len), proof->proof->rangeproof_cb_data) != 1) {
                 return 0;
             }
             secp256k1_scalar_add(sc, sc, &term);
         }
     } else {
+        const size_t shared_g = ctx->n_shared_g > 0;
         size_t proof_idx = 0;
-        size_t real_idx = idx - 2 * (ctx->vec_len + ctx->lg_vec_len * ctx->n_proofs) - 1 - !!ctx->shared_g;
-        while (real_idx >= ctx->proof[proof_idx].proof->n_extra_rangeproof_points - !!ctx->shared_g) {
-            real_idx -= ctx->proof[proof_idx].proof->n_extra_rangeproof_points - !!ctx->shared_g;
+        size_t real_idx = idx - (2 * ctx->vec_len + ctx->n_lr_points + 1 + ctx->n_shared_g);
+        while (real_idx >= ctx->proof[proof_idx].proof->n_extra_rangeproof_points - shared_g) {
+            real_idx -= ctx->proof[proof_idx].proof->n_extra_rangeproof_points - shared_g;
             proof_idx++;
             VERIFY_CHECK(proof_idx < ctx->n_proofs);
         }
-        if ((ctx->proof[proof_idx].proof->rangeproof_cb)(sc, pt, &ctx->randomizer[proof_idx], 2 * (ctx->vec_len + ctx->lg_vec_len), ctx->proof[proof_idx].proof->rangeproof_cb_data) != 1) {
+        if ((ctx->proof[proof_idx].proof->rangeproof_cb)(sc, pt, &ctx->randomizer[proof_idx], 2 * (ctx->proof[proof_idx].proof->vec_len + ctx->proof[proof_idx].lg_vec_len), ctx->proof[proof_idx].proof->rangeproof_cb_data) != 1) {
             return 0;
         }
     }
@@ -310,198 +345,338 @@ static int secp256k1_bulletproof_innerproduct_vfy_ecmult_callback(secp256k1_scal
     return 1;
 }
 
+/* Returns the number of (L, R) point pairs in an inner product proof of vectors of length `vec_len` */
+static size_t secp256k1_bulletproof_innerproduct_lg_vec_len(size_t vec_len) {
+    return secp256k1_floor_lg(2 * vec_len / IP_AB_SCALARS);
+}
+
+/* Parses a single inner product proof and precomputes everything needed for its verification
+ * terms, including the proof's contribution to the scalar of `G`. The state `rng`
+ * is used to derive the proof's randomizer and is advanced. Returns 0 if the proof is
+ * malformed, in which case nothing else should be assumed about the output. */
+static int secp256k1_bulletproof_inner_product_vfy_prepare(secp256k1_bulletproof_innerproduct_vfy_data *data, secp256k1_scalar *randomizer, const secp256k1_bulletproof_innerproduct_context *proof, unsigned char *rng) {
+    secp256k1_sha256 sha256;
+    const size_t vec_len = proof->vec_len;
+    const unsigned char *serproof = proof->proof;
+    unsigned char proof_commit[32];
+    secp256k1_scalar dot;
+    secp256k1_scalar ab[IP_AB_SCALARS];
+    secp256k1_scalar negprod;
+    secp256k1_scalar x;
+    int overflow;
+    size_t j;
+    const size_t n_ab = 2 * vec_len < IP_AB_SCALARS ? 2 * vec_len : IP_AB_SCALARS;
+
+    if (proof->plen != secp256k1_bulletproof_innerproduct_proof_length(vec_len)) {
+        return 0;
+    }
+    data->lg_vec_len = secp256k1_bulletproof_innerproduct_lg_vec_len(vec_len);
+
+    /* Extract dot product, will always be the first 32 bytes */
+    secp256k1_scalar_set_b32(&dot, serproof, &overflow);
+    if (overflow) {
+        return 0;
+    }
+    /* Commit to dot product */
+    secp256k1_sha256_initialize(&sha256);
+    secp256k1_sha256_write(&sha256, proof->commit, 32);
+    secp256k1_sha256_write(&sha256, serproof, 32);
+    secp256k1_sha256_finalize(&sha256, proof_commit);
+    serproof += 32;
+
+    /* Extract a, b */
+    for (j = 0; j < n_ab; j++) {
+        secp256k1_scalar_set_b32(&ab[j], serproof, &overflow);
+        if (overflow) {
+            return 0;
+        }
+        /* TODO our verifier currently bombs out with zeros because it uses
+         * scalar inverses gratuitously. Fix that. */
+        if (secp256k1_scalar_is_zero(&ab[j])) {
+            return 0;
+        }
+        serproof += 32;
+    }
+    secp256k1_scalar_dot_product(&negprod, &ab[0], &ab[n_ab / 2], n_ab / 2);
+
+    data->proof = proof;
+    /* set per-proof randomizer */
+    secp256k1_sha256_initialize(&sha256);
+    secp256k1_sha256_write(&sha256, rng, 32);
+    secp256k1_sha256_finalize(&sha256, rng);
+    secp256k1_scalar_set_b32(randomizer, rng, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(randomizer)) {
+        /* cryptographically unreachable */
+        return 0;
+    }
+
+    /* Compute x*(dot - a*b) for each proof; together with p_offs this is the proof's G scalar */
+    secp256k1_scalar_set_b32(&x, proof_commit, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&x)) {
+        return 0;
+    }
+    secp256k1_scalar_negate(&negprod, &negprod);
+    secp256k1_scalar_add(&negprod, &negprod, &dot);
+    secp256k1_scalar_mul(&x, &x, &negprod);
+    secp256k1_scalar_add(&x, &x, &proof->p_offs);
+
+    secp256k1_scalar_mul(&data->p_offs, &x, randomizer);
+
+    /* Special-case: trivial proofs are valid iff the explicitly revealed scalars
+     *               dot to the explicitly revealed dot product. */
+    if (2 * vec_len <= IP_AB_SCALARS) {
+        if (!secp256k1_scalar_is_zero(&negprod)) {
+            return 0;
+        }
+        /* remaining data does not (and cannot) be computed for proofs with no a's or b's. */
+        if (vec_len == 0) {
+            return 1;
+        }
+    }
+
+    /* Compute the inverse product and the array of squares; the rest will be filled
+     * in while the terms of the multiexp are computed. */
+    data->serialized_lr = serproof; /* bookmark L/R location in proof */
+    negprod = ab[n_ab - 1];
+    ab[n_ab - 1] = *randomizer; /* build r * x1 * x2 * ... * xn in last slot of `ab` array */
+    for (j = 0; j < data->lg_vec_len; j++) {
+        secp256k1_scalar xi;
+        const size_t lidx = 2 * j;
+        const size_t ridx = 2 * j + 1;
+        const size_t bitveclen = (2 * data->lg_vec_len + 7) / 8;
+        const unsigned char lrparity = 2 * !!(serproof[lidx / 8] & (1 << (lidx % 8))) + !!(serproof[ridx / 8] & (1 << (ridx % 8)));
+        /* Map commit -> H(commit || LR parity || Lx || Rx), compute xi from it */
+        secp256k1_sha256_initialize(&sha256);
+        secp256k1_sha256_write(&sha256, proof_commit, 32);
+        secp256k1_sha256_write(&sha256, &lrparity, 1);
+        secp256k1_sha256_write(&sha256, &serproof[32 * lidx + bitveclen], 32);
+        secp256k1_sha256_write(&sha256, &serproof[32 * ridx + bitveclen], 32);
+        secp256k1_sha256_finalize(&sha256, proof_commit);
+
+        secp256k1_scalar_set_b32(&xi, proof_commit, &overflow);
+        if (overflow || secp256k1_scalar_is_zero(&xi)) {
+            return 0;
+        }
+        secp256k1_scalar_mul(&ab[n_ab - 1], &ab[n_ab - 1], &xi);
+        secp256k1_scalar_sqr(&data->xsq[j], &xi);
+    }
+    /* Compute inverse of all a's and b's, except the last b whose inverse is not needed.
+     * Also compute the inverse of (-r * x1 * ... * xn) which will be needed */
+    secp256k1_scalar_inverse_all_var(data->abinv, ab, n_ab);
+    ab[n_ab - 1] = negprod;
+
+    /* Compute (-a0 * r * x1 * ... * xn)^-1 which will be used to mask out individual x_i^-2's */
+    secp256k1_scalar_negate(&data->xsqinv_mask, &data->abinv[0]);
+    secp256k1_scalar_mul(&data->xsqinv_mask, &data->xsqinv_mask, &data->abinv[n_ab - 1]);
+
+    /* Compute each scalar times the previous' inverse, which is used to switch between a's and b's */
+    for (j = n_ab - 1; j > 0; j--) {
+        size_t prev_idx;
+        if (j == n_ab / 2) {
+            prev_idx = j - 1; /* we go from a_{n-1} to b_0  */
+        } else {
+            prev_idx = j & (j - 1); /* but from a_i' to a_i, where i' is i with its lowest set bit unset */
+        }
+        secp256k1_scalar_mul(
+            &data->abinv[j - 1],
+            &data->abinv[prev_idx],
+            &ab[j]
+        );
+    }
+
+    /* Extract -a0 * r * (x1 * ... * xn)^-1 which is our first coefficient. Use negprod as a dummy */
+    secp256k1_scalar_mul(&negprod, randomizer, &ab[0]); /* r*a */
+    secp256k1_scalar_sqr(&negprod, &negprod); /* (r*a)^2 */
+    secp256k1_scalar_mul(&data->xcache[0], &data->xsqinv_mask, &negprod);  /* -a * r * (x1 * x2 * ... * xn)^-1 */
+    return 1;
+}
+
+/* Does the multiexp for the already-prepared proofs `full->proof[lo..hi)`, returning 1 if they
+ * all verify, 0 if they do not and -1 if the multiexp could not be computed, e.g. because the
+ * scratch space is too small. Computing its terms consumes the precomputed per-proof data, so if `pristine` is
+ * non-NULL the data is first restored from there, allowing the same proofs to be checked repeatedly.
+ * The terms are computed in a separate pass and buffered in an accumulator, so that the multiexp
+ * reads them from arrays. */
+static int secp256k1_bulletproof_inner_product_verify_range(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const secp256k1_bulletproof_innerproduct_vfy_ecmult_context *full, const secp256k1_bulletproof_innerproduct_vfy_data *pristine, size_t lo, size_t hi, size_t n_shared_g) {
+    secp256k1_bulletproof_innerproduct_vfy_ecmult_context ecmult_data = *full;
+    secp256k1_ecmult_multi_accumulator acc;
+    size_t total_n_points = 1 + n_shared_g; /* +1 for H (blinding_gen), +n_shared_g for the shared G's (value_gen) */
+    secp256k1_gej r;
+    size_t i;
+
+    ecmult_data.n_proofs = hi - lo;
+    ecmult_data.proof = &full->proof[lo];
+    ecmult_data.randomizer = &full->randomizer[lo];
+    ecmult_data.vec_len = 0;
+    ecmult_data.n_lr_points = 0;
+    ecmult_data.n_shared_g = n_shared_g;
+    secp256k1_scalar_clear(&ecmult_data.p_offs);
+    for (i = 0; i < ecmult_data.n_proofs; i++) {
+        const secp256k1_bulletproof_innerproduct_vfy_data *data = &ecmult_data.proof[i];
+        if (pristine != NULL) {
+            ecmult_data.proof[i] = pristine[lo + i];
+        }
+        if (data->proof->vec_len > ecmult_data.vec_len) {
+            ecmult_data.vec_len = data->proof->vec_len;
+        }
+        ecmult_data.n_lr_points += 2 * data->lg_vec_len;
+        secp256k1_scalar_add(&ecmult_data.p_offs, &ecmult_data.p_offs, &data->p_offs);
+        total_n_points += 2 * data->lg_vec_len + data->proof->n_extra_rangeproof_points - (n_shared_g > 0); /* -1 for shared G */
+    }
+    total_n_points += 2 * ecmult_data.vec_len;
+
+    if (!secp256k1_ecmult_multi_accumulator_init(&acc, ecmult_ctx, scratch, total_n_points)) {
+        return -1;
+    }
+    for (i = 0; i < total_n_points; i++) {
+        secp256k1_scalar sc;
+        secp256k1_ge pt;
+        if (!secp256k1_bulletproof_innerproduct_vfy_term(&sc, &pt, i, &ecmult_data)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return 0;
+        }
+        if (!secp256k1_ecmult_multi_accumulator_add(&acc, &sc, &pt)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return -1;
+        }
+    }
+    if (!secp256k1_ecmult_multi_accumulator_finalize(&acc, &r)) {
+        return -1;
+    }
+    return secp256k1_gej_is_infinity(&r);
+}
+
+/* Given that the proofs `full->proof[lo..hi)` do not verify together, finds the valid ones among
+ * them by recursive bisection and sets their bits in `valid`. Whenever the left half of a range
+ * verifies the right half is known to be bad and need not be checked, so identifying `k` bad
+ * proofs out of `n` takes O(k log n) multiexps. Bits are indexed relative to `proof`. Returns 0
+ * if some multiexp could not be computed, in which case the proofs it did not get to check are
+ * left unmarked, and 1 otherwise. */
+static int secp256k1_bulletproof_inner_product_verify_bisect(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const secp256k1_bulletproof_innerproduct_vfy_ecmult_context *full, const secp256k1_bulletproof_innerproduct_vfy_data *pristine, size_t lo, size_t hi, const secp256k1_bulletproof_innerproduct_context *proof, unsigned char *valid) {
+    size_t mid;
+    size_t i;
+    int ret;
+
+    if (hi - lo == 1) {
+        return 1;
+    }
+    mid = lo + (hi - lo) / 2;
+    ret = secp256k1_bulletproof_inner_product_verify_range(ecmult_ctx, scratch, full, pristine, lo, mid, 0);
+    if (ret < 0) {
+        return 0;
+    }
+    if (ret) {
+        for (i = lo; i < mid; i++) {
+            const size_t idx = pristine[i].proof - proof;
+            valid[idx / 8] |= 1 << (idx % 8);
+        }
+    } else {
+        if (!secp256k1_bulletproof_inner_product_verify_bisect(ecmult_ctx, scratch, full, pristine, lo, mid, proof, valid)) {
+            return 0;
+        }
+        ret = secp256k1_bulletproof_inner_product_verify_range(ecmult_ctx, scratch, full, pristine, mid, hi, 0);
+        if (ret < 0) {
+            return 0;
+        }
+        if (ret) {
+            for (i = mid; i < hi; i++) {
+                const size_t idx = pristine[i].proof - proof;
+                valid[idx / 8] |= 1 << (idx % 8);
+            }
+            return 1;
+        }
+    }
+    return secp256k1_bulletproof_inner_product_verify_bisect(ecmult_ctx, scratch, full, pristine, mid, hi, proof, valid);
+}
+
 /* nb For security it is essential that `commit_inp` already commit to all data
  *    needed to compute `P`. We do not hash it in during verification since `P`
  *    may be specified indirectly as a bunch of scalar offsets.
+ *
+ *    If `n_shared_g` is nonzero, every proof's `shared_g_idx` must be less than it,
+ *    every index below it must be used by some proof, and proofs with equal
+ *    `shared_g_idx` must use the same first extra point.
+ *
+ *    If `valid` is non-NULL, malformed proofs do not abort verification, and on
+ *    return bit `i` of the bitmap `valid` (byte `i / 8`, bit `i % 8`) is set iff
+ *    proof `i` verified. The rangeproof callbacks must then be able to restart
+ *    from scratch whenever they are called with index 0. If the scratch space is
+ *    too small to check every proof, -1 is returned instead of 0, and a clear bit
+ *    only means that the proof was not found to be valid.
  */
-static int secp256k1_bulletproof_inner_product_verify_impl(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const secp256k1_bulletproof_generators *gens, size_t vec_len, const secp256k1_bulletproof_innerproduct_context *proof, size_t n_proofs, size_t plen, int shared_g) {
+static int secp256k1_bulletproof_inner_product_verify_impl(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const secp256k1_bulletproof_generators *gens, const secp256k1_bulletproof_innerproduct_context *proof, size_t n_proofs, size_t n_shared_g, unsigned char *valid) {
     secp256k1_sha256 sha256;
     secp256k1_bulletproof_innerproduct_vfy_ecmult_context ecmult_data;
+    secp256k1_bulletproof_innerproduct_vfy_data *pristine = NULL;
     unsigned char commit[32];
-    size_t total_n_points = 2 * vec_len + !!shared_g + 1; /* +1 for shared G (value_gen), +1 for H (blinding_gen) */
-    secp256k1_gej r;
-    secp256k1_scalar zero;
+    size_t n_ok = 0;
+    int ret;
     size_t i;
 
-    if (plen != secp256k1_bulletproof_innerproduct_proof_length(vec_len)) {
-        return 0;
+    if (valid != NULL) {
+        memset(valid, 0, (n_proofs + 7) / 8);
     }
-
     if (n_proofs == 0) {
         return 1;
     }
 
-    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*ecmult_data.randomizer) + sizeof(*ecmult_data.proof)), 2)) {
-        return 0;
+    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*ecmult_data.randomizer) + (1 + (valid != NULL)) * sizeof(*ecmult_data.proof)), 3)) {
+        return valid != NULL ? -1 : 0;
     }
 
-    secp256k1_scalar_clear(&zero);
-    ecmult_data.n_proofs = n_proofs;
     ecmult_data.g = gens->blinding_gen;
     ecmult_data.geng = gens->gens;
     ecmult_data.genh = gens->gens + gens->n / 2;
-    ecmult_data.vec_len = vec_len;
-    ecmult_data.lg_vec_len = secp256k1_floor_lg(2 * vec_len / IP_AB_SCALARS);
-    ecmult_data.shared_g = shared_g;
     ecmult_data.randomizer = (secp256k1_scalar *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*ecmult_data.randomizer));
     ecmult_data.proof = (secp256k1_bulletproof_innerproduct_vfy_data *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*ecmult_data.proof));
     /* Seed RNG for per-proof randomizers */
     secp256k1_sha256_initialize(&sha256);
     for (i = 0; i < n_proofs; i++) {
-        secp256k1_sha256_write(&sha256, proof[i].proof, plen);
+        secp256k1_sha256_write(&sha256, proof[i].proof, proof[i].plen);
         secp256k1_sha256_write(&sha256, proof[i].commit, 32);
         secp256k1_scalar_get_b32(commit, &proof[i].p_offs);
         secp256k1_sha256_write(&sha256, commit, 32);
     }
     secp256k1_sha256_finalize(&sha256, commit);
 
-    secp256k1_scalar_clear(&ecmult_data.p_offs);
     for (i = 0; i < n_proofs; i++) {
-        const unsigned char *serproof = proof[i].proof;
-        unsigned char proof_commit[32];
-        secp256k1_scalar dot;
-        secp256k1_scalar ab[IP_AB_SCALARS];
-        secp256k1_scalar negprod;
-        secp256k1_scalar x;
-        int overflow;
-        size_t j;
-        const size_t n_ab = 2 * vec_len < IP_AB_SCALARS ? 2 * vec_len : IP_AB_SCALARS;
-
-        total_n_points += 2 * ecmult_data.lg_vec_len + proof[i].n_extra_rangeproof_points - !!shared_g; /* -1 for shared G */
-
-        /* Extract dot product, will always be the first 32 bytes */
-        secp256k1_scalar_set_b32(&dot, serproof, &overflow);
-        if (overflow) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
-        /* Commit to dot product */
-        secp256k1_sha256_initialize(&sha256);
-        secp256k1_sha256_write(&sha256, proof[i].commit, 32);
-        secp256k1_sha256_write(&sha256, serproof, 32);
-        secp256k1_sha256_finalize(&sha256, proof_commit);
-        serproof += 32;
-
-        /* Extract a, b */
-        for (j = 0; j < n_ab; j++) {
-            secp256k1_scalar_set_b32(&ab[j], serproof, &overflow);
-            if (overflow) {
-                secp256k1_scratch_deallocate_frame(scratch);
-                return 0;
-            }
-            /* TODO our verifier currently bombs out with zeros because it uses
-             * scalar inverses gratuitously. Fix that. */
-            if (secp256k1_scalar_is_zero(&ab[j])) {
-                secp256k1_scratch_deallocate_frame(scratch);
-                return 0;
-            }
-            serproof += 32;
-        }
-        secp256k1_scalar_dot_product(&negprod, &ab[0], &ab[n_ab / 2], n_ab / 2);
-
-        ecmult_data.proof[i].proof = &proof[i];
-        /* set per-proof randomizer */
-        secp256k1_sha256_initialize(&sha256);
-        secp256k1_sha256_write(&sha256, commit, 32);
-        secp256k1_sha256_finalize(&sha256, commit);
-        secp256k1_scalar_set_b32(&ecmult_data.randomizer[i], commit, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data.randomizer[i])) {
-            /* cryptographically unreachable */
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
-
-        /* Compute x*(dot - a*b) for each proof; add it and p_offs to the p_offs accumulator */
-        secp256k1_scalar_set_b32(&x, proof_commit, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&x)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
-        secp256k1_scalar_negate(&negprod, &negprod);
-        secp256k1_scalar_add(&negprod, &negprod, &dot);
-        secp256k1_scalar_mul(&x, &x, &negprod);
-        secp256k1_scalar_add(&x, &x, &proof[i].p_offs);
-
-        secp256k1_scalar_mul(&x, &x, &ecmult_data.randomizer[i]);
-        secp256k1_scalar_add(&ecmult_data.p_offs, &ecmult_data.p_offs, &x);
-
-        /* Special-case: trivial proofs are valid iff the explicitly revealed scalars
-         *               dot to the explicitly revealed dot product. */
-        if (2 * vec_len <= IP_AB_SCALARS) {
-            if (!secp256k1_scalar_is_zero(&negprod)) {
-                secp256k1_scratch_deallocate_frame(scratch);
-                return 0;
-            }
-            /* remaining data does not (and cannot) be computed for proofs with no a's or b's. */
-            if (vec_len == 0) {
-                continue;
-            }
-        }
-
-        /* Compute the inverse product and the array of squares; the rest will be filled
-         * in by the callback during the multiexp. */
-        ecmult_data.proof[i].serialized_lr = serproof; /* bookmark L/R location in proof */
-        negprod = ab[n_ab - 1];
-        ab[n_ab - 1] = ecmult_data.randomizer[i]; /* build r * x1 * x2 * ... * xn in last slot of `ab` array */
-        for (j = 0; j < ecmult_data.lg_vec_len; j++) {
-            secp256k1_scalar xi;
-            const size_t lidx = 2 * j;
-            const size_t ridx = 2 * j + 1;
-            const size_t bitveclen = (2 * ecmult_data.lg_vec_len + 7) / 8;
-            const unsigned char lrparity = 2 * !!(serproof[lidx / 8] & (1 << (lidx % 8))) + !!(serproof[ridx / 8] & (1 << (ridx % 8)));
-            /* Map commit -> H(commit || LR parity || Lx || Rx), compute xi from it */
-            secp256k1_sha256_initialize(&sha256);
-            secp256k1_sha256_write(&sha256, proof_commit, 32);
-            secp256k1_sha256_write(&sha256, &lrparity, 1);
-            secp256k1_sha256_write(&sha256, &serproof[32 * lidx + bitveclen], 32);
-            secp256k1_sha256_write(&sha256, &serproof[32 * ridx + bitveclen], 32);
-            secp256k1_sha256_finalize(&sha256, proof_commit);
-
-            secp256k1_scalar_set_b32(&xi, proof_commit, &overflow);
-            if (overflow || secp256k1_scalar_is_zero(&xi)) {
+        VERIFY_CHECK(n_shared_g == 0 || proof[i].shared_g_idx < n_shared_g);
+        if (2 * proof[i].vec_len > gens->n ||
+            !secp256k1_bulletproof_inner_product_vfy_prepare(&ecmult_data.proof[n_ok], &ecmult_data.randomizer[n_ok], &proof[i], commit)) {
+            if (valid == NULL) {
                 secp256k1_scratch_deallocate_frame(scratch);
                 return 0;
             }
-            secp256k1_scalar_mul(&ab[n_ab - 1], &ab[n_ab - 1], &xi);
-            secp256k1_scalar_sqr(&ecmult_data.proof[i].xsq[j], &xi);
-        }
-        /* Compute inverse of all a's and b's, except the last b whose inverse is not needed.
-         * Also compute the inverse of (-r * x1 * ... * xn) which will be needed */
-        secp256k1_scalar_inverse_all_var(ecmult_data.proof[i].abinv, ab, n_ab);
-        ab[n_ab - 1] = negprod;
-
-        /* Compute (-a0 * r * x1 * ... * xn)^-1 which will be used to mask out individual x_i^-2's */
-        secp256k1_scalar_negate(&ecmult_data.proof[i].xsqinv_mask, &ecmult_data.proof[i].abinv[0]);
-        secp256k1_scalar_mul(&ecmult_data.proof[i].xsqinv_mask, &ecmult_data.proof[i].xsqinv_mask, &ecmult_data.proof[i].abinv[n_ab - 1]);
-
-        /* Compute each scalar times the previous' inverse, which is used to switch between a's and b's */
-        for (j = n_ab - 1; j > 0; j--) {
-            size_t prev_idx;
-            if (j == n_ab / 2) {
-                prev_idx = j - 1; /* we go from a_{n-1} to b_0  */
-            } else {
-                prev_idx = j & (j - 1); /* but from a_i' to a_i, where i' is i with its lowest set bit unset */
-            }
-            secp256k1_scalar_mul(
-                &ecmult_data.proof[i].abinv[j - 1],
-                &ecmult_data.proof[i].abinv[prev_idx],
-                &ab[j]
-            );
+            continue;
         }
-
-        /* Extract -a0 * r * (x1 * ... * xn)^-1 which is our first coefficient. Use negprod as a dummy */
-        secp256k1_scalar_mul(&negprod, &ecmult_data.randomizer[i], &ab[0]); /* r*a */
-        secp256k1_scalar_sqr(&negprod, &negprod); /* (r*a)^2 */
-        secp256k1_scalar_mul(&ecmult_data.proof[i].xcache[0], &ecmult_data.proof[i].xsqinv_mask, &negprod);  /* -a * r * (x1 * x2 * ... * xn)^-1 */
+        n_ok++;
+    }
+    /* With proofs missing, some shared generator might have nobody to compute its scalar */
+    if (n_ok < n_proofs) {
+        n_shared_g = 0;
+    }
+    if (valid != NULL) {
+        pristine = (secp256k1_bulletproof_innerproduct_vfy_data *)secp256k1_scratch_alloc(scratch, n_ok * sizeof(*pristine));
+        memcpy(pristine, ecmult_data.proof, n_ok * sizeof(*pristine));
     }
 
     /* Do the multiexp */
-    if (secp256k1_ecmult_multi_var(ecmult_ctx, scratch, &r, NULL, secp256k1_bulletproof_innerproduct_vfy_ecmult_callback, (void *) &ecmult_data, total_n_points) != 1) {
-        secp256k1_scratch_deallocate_frame(scratch);
-        return 0;
+    ret = secp256k1_bulletproof_inner_product_verify_range(ecmult_ctx, scratch, &ecmult_data, NULL, 0, n_ok, n_shared_g);
+    if (valid != NULL) {
+        if (ret == 1) {
+            for (i = 0; i < n_ok; i++) {
+                const size_t idx = pristine[i].proof - proof;
+                valid[idx / 8] |= 1 << (idx % 8);
+            }
+        } else if (ret == 0 && !secp256k1_bulletproof_inner_product_verify_bisect(ecmult_ctx, scratch, &ecmult_data, pristine, 0, n_ok, proof, valid)) {
+            ret = -1;
+        }
     }
     secp256k1_scratch_deallocate_frame(scratch);
-    return secp256k1_gej_is_infinity(&r);
+    if (ret < 0) {
+        return valid != NULL ? -1 : 0;
+    }
+    return ret && n_ok == n_proofs;
 }
 
 typedef struct {
@@ -77,6 +77,124 @@ void secp256k1_bulletproof_generators_destroy(const secp256k1_context* ctx, secp
     }
 }
 
+static const unsigned char secp256k1_bulletproof_generators_magic[4] = { 'B', 'P', 'G', 'S' };
+#define SECP256K1_BULLETPROOF_GENERATORS_VERSION 1
+
+int secp256k1_bulletproof_generators_serialize(const secp256k1_context *ctx, unsigned char *output, size_t *outputlen, const secp256k1_bulletproof_generators *gens) {
+    secp256k1_sha256 sha;
+    size_t len;
+    unsigned char *ptr = output;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(output != NULL);
+    ARG_CHECK(outputlen != NULL);
+    ARG_CHECK(gens != NULL);
+    (void) ctx;
+
+    len = SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(gens->n);
+    if (*outputlen < len) {
+        return 0;
+    }
+
+    memcpy(ptr, secp256k1_bulletproof_generators_magic, 4);
+    ptr += 4;
+    for (i = 0; i < 4; i++) {
+        *ptr++ = (SECP256K1_BULLETPROOF_GENERATORS_VERSION >> (24 - 8 * i)) & 0xff;
+    }
+    for (i = 0; i < 8; i++) {
+        *ptr++ = ((uint64_t) gens->n >> (56 - 8 * i)) & 0xff;
+    }
+    /* G_i and H_i, followed by the blinding generator */
+    for (i = 0; i < gens->n + 1; i++) {
+        secp256k1_fe x = gens->gens[i].x;
+        secp256k1_fe y = gens->gens[i].y;
+        secp256k1_fe_normalize_var(&x);
+        secp256k1_fe_normalize_var(&y);
+        secp256k1_fe_get_b32(ptr, &x);
+        secp256k1_fe_get_b32(ptr + 32, &y);
+        ptr += 64;
+    }
+
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, output, ptr - output);
+    secp256k1_sha256_finalize(&sha, ptr);
+
+    *outputlen = len;
+    return 1;
+}
+
+secp256k1_bulletproof_generators *secp256k1_bulletproof_generators_parse(const secp256k1_context *ctx, const unsigned char *input, size_t inputlen) {
+    secp256k1_bulletproof_generators *ret;
+    secp256k1_sha256 sha;
+    unsigned char checksum[32];
+    const unsigned char *ptr = input;
+    uint64_t version = 0;
+    uint64_t n = 0;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(input != NULL);
+
+    if (inputlen < SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(0)) {
+        return NULL;
+    }
+    if (memcmp(ptr, secp256k1_bulletproof_generators_magic, 4) != 0) {
+        return NULL;
+    }
+    ptr += 4;
+    for (i = 0; i < 4; i++) {
+        version = (version << 8) | *ptr++;
+    }
+    for (i = 0; i < 8; i++) {
+        n = (n << 8) | *ptr++;
+    }
+    if (version != SECP256K1_BULLETPROOF_GENERATORS_VERSION) {
+        return NULL;
+    }
+    /* Compare n against the number of points the blob can actually hold before computing its size,
+     * so that a bogus n cannot overflow the computation */
+    if (n > (inputlen - SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(0)) / 64 ||
+        inputlen != SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(n)) {
+        return NULL;
+    }
+
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, input, inputlen - 32);
+    secp256k1_sha256_finalize(&sha, checksum);
+    if (memcmp(checksum, input + inputlen - 32, 32) != 0) {
+        return NULL;
+    }
+
+    ret = (secp256k1_bulletproof_generators *)checked_malloc(&ctx->error_callback, sizeof(*ret));
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret->gens = (secp256k1_ge *)checked_malloc(&ctx->error_callback, (n + 1) * sizeof(*ret->gens));
+    if (ret->gens == NULL) {
+        free(ret);
+        return NULL;
+    }
+    ret->blinding_gen = &ret->gens[n];
+    ret->n = n;
+
+    for (i = 0; i < n + 1; i++) {
+        secp256k1_fe x, y;
+        if (!secp256k1_fe_set_b32(&x, ptr) || !secp256k1_fe_set_b32(&y, ptr + 32)) {
+            secp256k1_bulletproof_generators_destroy(ctx, ret);
+            return NULL;
+        }
+        secp256k1_ge_set_xy(&ret->gens[i], &x, &y);
+        if (!secp256k1_ge_is_valid_var(&ret->gens[i])) {
+            secp256k1_bulletproof_generators_destroy(ctx, ret);
+            return NULL;
+        }
+        ptr += 64;
+    }
+
+    return ret;
+}
+
 int secp256k1_bulletproof_rangeproof_verify(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const secp256k1_bulletproof_generators *gens, const unsigned char *proof, size_t plen,
  const uint64_t *min_value, const secp256k1_pedersen_commitment* commit, size_t n_commits, size_t nbits, const secp256k1_generator *value_gen, const unsigned char *extra_commit, size_t extra_commit_len) {
     int ret;
@@ -111,7 +229,7 @@ int secp256k1_bulletproof_rangeproof_verify(const secp256k1_context* ctx, secp25
 
     commitp_ptr = commitp;
     minvalue_ptr = min_value;
-    ret = secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, &proof, 1, plen, nbits, &minvalue_ptr, &commitp_ptr, n_commits, &value_genp, gens, &extra_commit, &extra_commit_len);
+    ret = secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, &proof, 1, &plen, &nbits, &minvalue_ptr, &commitp_ptr, &n_commits, &value_genp, gens, &extra_commit, &extra_commit_len, NULL);
     secp256k1_scratch_deallocate_frame(scratch);
     return ret;
 }
@@ -120,6 +238,9 @@ int secp256k1_bulletproof_rangeproof_verify_multi(const secp256k1_context* ctx,
     int ret;
     secp256k1_ge **commitp;
     secp256k1_ge *value_genp;
+    size_t *plens;
+    size_t *nbitss;
+    size_t *n_commitss;
     size_t i;
 
     VERIFY_CHECK(ctx != NULL);
@@ -141,12 +262,15 @@ int secp256k1_bulletproof_rangeproof_verify_multi(const secp256k1_context* ctx,
     }
     ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
 
-    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*value_genp) + sizeof(*commitp) + n_commits * sizeof(**commitp)), 2 + n_proofs)) {
+    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*value_genp) + sizeof(*commitp) + n_commits * sizeof(**commitp) + 3 * sizeof(size_t)), 5 + n_proofs)) {
         return 0;
     }
 
     commitp = (secp256k1_ge **)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*commitp));
     value_genp = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*value_genp));
+    plens = (size_t *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*plens));
+    nbitss = (size_t *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*nbitss));
+    n_commitss = (size_t *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*n_commitss));
     for (i = 0; i < n_proofs; i++) {
         size_t j;
         commitp[i] = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, n_commits * sizeof(*commitp[i]));
@@ -154,13 +278,110 @@ int secp256k1_bulletproof_rangeproof_verify_multi(const secp256k1_context* ctx,
             secp256k1_pedersen_commitment_load(&commitp[i][j], &commit[i][j]);
         }
         secp256k1_generator_load(&value_genp[i], &value_gen[i]);
+        plens[i] = plen;
+        nbitss[i] = nbits;
+        n_commitss[i] = n_commits;
+    }
+
+    ret = secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof, n_proofs, plens, nbitss, min_value, (const secp256k1_ge **) commitp, n_commitss, value_genp, gens, extra_commit, extra_commit_len, NULL);
+    secp256k1_scratch_deallocate_frame(scratch);
+    return ret;
+}
+
+size_t secp256k1_bulletproof_rangeproof_verify_scratch_size(const secp256k1_context* ctx, size_t n_proofs, size_t nbits, size_t n_commits) {
+    const size_t vec_len = nbits * n_commits;
+    size_t n_points;
+    size_t outer;
+    size_t ret;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n_proofs > 0);
+    ARG_CHECK(n_commits > 0);
+    ARG_CHECK(nbits > 0);
+    ARG_CHECK(nbits <= 64);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+
+    /* The frames of secp256k1_bulletproof_rangeproof_verify{,_multi}, of
+     * secp256k1_bulletproof_rangeproof_verify_impl and of
+     * secp256k1_bulletproof_inner_product_verify_impl are all in use
+     * during the multiexp, on top of the buffer of its terms */
+    outer = n_proofs * (sizeof(secp256k1_ge) + sizeof(secp256k1_ge *) + n_commits * sizeof(secp256k1_ge) + 3 * sizeof(size_t)) + (5 + n_proofs) * ALIGNMENT;
+    if (n_proofs == 1 && outer < 2 * n_commits * sizeof(secp256k1_ge) + ALIGNMENT) {
+        outer = 2 * n_commits * sizeof(secp256k1_ge) + ALIGNMENT;
+    }
+    ret = outer;
+    ret += n_proofs * (sizeof(secp256k1_bulletproof_vfy_ecmult_context) + sizeof(secp256k1_bulletproof_innerproduct_context) + 2 * sizeof(size_t)) + (n_proofs + 7) / 8 + 5 * ALIGNMENT;
+    ret += n_proofs * (sizeof(secp256k1_scalar) + sizeof(secp256k1_bulletproof_innerproduct_vfy_data)) + 3 * ALIGNMENT;
+
+    /* Proofs sharing a value generator save a point each, so the multiexp is
+     * largest when they all differ */
+    n_points = 1 + 2 * vec_len + n_proofs * (2 * secp256k1_bulletproof_innerproduct_lg_vec_len(vec_len) + 5 + n_commits);
+    return ret + secp256k1_ecmult_multi_accumulator_scratch_size(&ctx->ecmult_ctx, n_points);
+}
+
+static int secp256k1_bulletproof_rangeproof_verify_multi_mixed_impl(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const secp256k1_bulletproof_generators *gens, unsigned char *valid, const unsigned char* const* proof, size_t n_proofs, const size_t *plen, const uint64_t* const* min_value, const secp256k1_pedersen_commitment* const* commit, const size_t *n_commits, const size_t *nbits, const secp256k1_generator *value_gen, const unsigned char* const* extra_commit, size_t *extra_commit_len) {
+    int ret;
+    secp256k1_ge **commitp;
+    secp256k1_ge *value_genp;
+    size_t total_commits = 0;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(gens != NULL);
+    ARG_CHECK(commit != NULL);
+    ARG_CHECK(proof != NULL);
+    ARG_CHECK(n_proofs > 0);
+    ARG_CHECK(plen != NULL);
+    ARG_CHECK(n_commits != NULL);
+    ARG_CHECK(nbits != NULL);
+    for (i = 0; i < n_proofs; i++) {
+        ARG_CHECK(n_commits[i] > 0);
+        ARG_CHECK(nbits[i] > 0);
+        ARG_CHECK(nbits[i] <= 64);
+        ARG_CHECK(gens->n >= 2 * nbits[i] * n_commits[i]);
+        total_commits += n_commits[i];
+    }
+    ARG_CHECK(value_gen != NULL);
+    ARG_CHECK((extra_commit_len == NULL) == (extra_commit == NULL));
+    if (extra_commit != NULL) {
+        for (i = 0; i < n_proofs; i++) {
+            ARG_CHECK(extra_commit[i] != NULL || extra_commit_len[i] == 0);
+        }
+    }
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+
+    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*value_genp) + sizeof(*commitp)) + total_commits * sizeof(**commitp), 2 + n_proofs)) {
+        return valid != NULL ? -1 : 0;
+    }
+
+    commitp = (secp256k1_ge **)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*commitp));
+    value_genp = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*value_genp));
+    for (i = 0; i < n_proofs; i++) {
+        size_t j;
+        commitp[i] = (secp256k1_ge *)secp256k1_scratch_alloc(scratch, n_commits[i] * sizeof(*commitp[i]));
+        for (j = 0; j < n_commits[i]; j++) {
+            secp256k1_pedersen_commitment_load(&commitp[i][j], &commit[i][j]);
+        }
+        secp256k1_generator_load(&value_genp[i], &value_gen[i]);
     }
 
-    ret = secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof, n_proofs, plen, nbits, min_value, (const secp256k1_ge **) commitp, n_commits, value_genp, gens, extra_commit, extra_commit_len);
+    ret = secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof, n_proofs, plen, nbits, min_value, (const secp256k1_ge **) commitp, n_commits, value_genp, gens, extra_commit, extra_commit_len, valid);
     secp256k1_scratch_deallocate_frame(scratch);
     return ret;
 }
 
+int secp256k1_bulletproof_rangeproof_verify_multi_mixed(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const secp256k1_bulletproof_generators *gens, const unsigned char* const* proof, size_t n_proofs, const size_t *plen, const uint64_t* const* min_value, const secp256k1_pedersen_commitment* const* commit, const size_t *n_commits, const size_t *nbits, const secp256k1_generator *value_gen, const unsigned char* const* extra_commit, size_t *extra_commit_len) {
+    return secp256k1_bulletproof_rangeproof_verify_multi_mixed_impl(ctx, scratch, gens, NULL, proof, n_proofs, plen, min_value, commit, n_commits, nbits, value_gen, extra_commit, extra_commit_len);
+}
+
+int secp256k1_bulletproof_rangeproof_verify_multi_bitmap(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const secp256k1_bulletproof_generators *gens, unsigned char *valid, const unsigned char* const* proof, size_t n_proofs, const size_t *plen, const uint64_t* const* min_value, const secp256k1_pedersen_commitment* const* commit, const size_t *n_commits, const size_t *nbits, const secp256k1_generator *value_gen, const unsigned char* const* extra_commit, size_t *extra_commit_len) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(valid != NULL);
+    memset(valid, 0, (n_proofs + 7) / 8);
+    return secp256k1_bulletproof_rangeproof_verify_multi_mixed_impl(ctx, scratch, gens, valid, proof, n_proofs, plen, min_value, commit, n_commits, nbits, value_gen, extra_commit, extra_commit_len);
+}
+
 int secp256k1_bulletproof_rangeproof_rewind(const secp256k1_context* ctx, uint64_t *value, unsigned char *blind, const unsigned char *proof, size_t plen, uint64_t min_value, const secp256k1_pedersen_commitment* commit, const secp256k1_generator *value_gen, const unsigned char *nonce, const unsigned char *extra_commit, size_t extra_commit_len, unsigned char *message) {
     secp256k1_scalar blinds;
     int ret;
@@ -243,7 +464,7 @@ int secp256k1_bulletproof_rangeproof_prove(
         if (commits == NULL) {
             /* Calculate commitment from blinding factor */
             secp256k1_gej commitj;
-            secp256k1_pedersen_ecmult(&commitj, &blinds[i], value[i], &value_genp, &gens->blinding_gen[0]);
+            secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &commitj, &blinds[i], value[i], &value_genp, &gens->blinding_gen[0]);
             secp256k1_ge_set_gej(&commitp[i], &commitj);
         }
         else {
@@ -41,7 +41,10 @@ typedef struct {
 static int secp256k1_bulletproof_rangeproof_vfy_callback(secp256k1_scalar *sc, secp256k1_ge *pt, secp256k1_scalar *randomizer, size_t idx, void *data) {
     secp256k1_bulletproof_vfy_ecmult_context *ctx = (secp256k1_bulletproof_vfy_ecmult_context *) data;
 
+    /* Index 0 always comes first, so restart here to allow the same proof to be
+     * checked more than once, as happens when a batch is bisected. */
     if (idx == 0) {
+        ctx->count = 0;
         secp256k1_scalar_mul(&ctx->g_exponent, &ctx->negz, randomizer);
         secp256k1_scalar_mul(&ctx->z_randomized, &ctx->z, randomizer);
     }
@@ -162,12 +165,16 @@ static int secp256k1_bulletproof_rangeproof_vfy_callback(secp256k1_scalar *sc, s
     return 1;
 }
 
-static int secp256k1_bulletproof_rangeproof_verify_impl(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const unsigned char* const* proof, const size_t n_proofs, const size_t plen, size_t nbits, const uint64_t* const* min_value, const secp256k1_ge* const* commitp, size_t n_commits, const secp256k1_ge *value_gen, const secp256k1_bulletproof_generators *gens, const unsigned char* const* extra_commit, size_t *extra_commit_len) {
-    secp256k1_bulletproof_vfy_ecmult_context *ecmult_data;
-    secp256k1_bulletproof_innerproduct_context *innp_ctx;
-    int ret;
-    size_t i;
-    int same_generators = 1;
+/* Parses a single rangeproof and fills in the data needed to verify it as part of a batch.
+ * Returns 0 if the proof is malformed. */
+static int secp256k1_bulletproof_rangeproof_vfy_prepare(secp256k1_bulletproof_vfy_ecmult_context *ecmult_data, secp256k1_bulletproof_innerproduct_context *innp_ctx, const unsigned char *proof, size_t plen, size_t nbits, const uint64_t *min_value, const secp256k1_ge *commitp, size_t n_commits, const secp256k1_ge *value_gen, const unsigned char *extra_commit, size_t extra_commit_len) {
+    secp256k1_sha256 sha256;
+    unsigned char commit[32] = {0};
+    unsigned char randomizer61[32] = {0};  /* randomizer for eq (61) so we can add it to eq (62) to save a separate multiexp */
+    secp256k1_scalar taux, mu;
+    secp256k1_ge age, sge;
+    int overflow;
+    size_t j;
 
     /* sanity-check input */
     if (secp256k1_popcountl(nbits) != 1 || nbits > MAX_NBITS) {
@@ -180,164 +187,205 @@ static int secp256k1_bulletproof_rangeproof_verify_impl(const secp256k1_ecmult_c
         return 0;
     }
 
-    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*ecmult_data) + sizeof(*innp_ctx)), 2)) {
+    /* Commit to all input data: min value, pedersen commit, asset generator, extra_commit */
+    if (min_value != NULL) {
+        unsigned char len[4];
+        secp256k1_sha256_initialize(&sha256);
+        secp256k1_sha256_write(&sha256, commit, 32);
+        len[0] = n_commits;
+        len[1] = n_commits >> 8;
+        len[2] = n_commits >> 16;
+        len[3] = n_commits >> 24;
+        secp256k1_sha256_write(&sha256, len, 4);
+        for (j = 0; j < n_commits; j++) {
+            unsigned char vbuf[8];
+            vbuf[0] = min_value[j];
+            vbuf[1] = min_value[j] >> 8;
+            vbuf[2] = min_value[j] >> 16;
+            vbuf[3] = min_value[j] >> 24;
+            vbuf[4] = min_value[j] >> 32;
+            vbuf[5] = min_value[j] >> 40;
+            vbuf[6] = min_value[j] >> 48;
+            vbuf[7] = min_value[j] >> 56;
+            secp256k1_sha256_write(&sha256, vbuf, 8);
+        }
+        secp256k1_sha256_finalize(&sha256, commit);
+    }
+    for (j = 0; j < n_commits; j++) {
+        secp256k1_bulletproof_update_commit(commit, &commitp[j], value_gen);
+    }
+    if (extra_commit != NULL) {
+        secp256k1_sha256_initialize(&sha256);
+        secp256k1_sha256_write(&sha256, commit, 32);
+        secp256k1_sha256_write(&sha256, extra_commit, extra_commit_len);
+        secp256k1_sha256_finalize(&sha256, commit);
+    }
+
+    /* Compute y, z, x */
+    if (!secp256k1_bulletproof_deserialize_point(&age, &proof[64], 0, 4) ||
+        !secp256k1_bulletproof_deserialize_point(&sge, &proof[64], 1, 4)) {
         return 0;
     }
-    ecmult_data = (secp256k1_bulletproof_vfy_ecmult_context *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*ecmult_data));
-    innp_ctx = (secp256k1_bulletproof_innerproduct_context *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*innp_ctx));
 
-    /* Check if all generators are equal. If so, we can amortize all their scalar multiplications
-     * by them and save one scalar-ge multiplication per proof. */
-    VERIFY_CHECK(!secp256k1_ge_is_infinity(&value_gen[0]));
-    for (i = 1; i < n_proofs; i++) {
-        VERIFY_CHECK(!secp256k1_ge_is_infinity(&value_gen[i]));
-        if (!secp256k1_fe_equal_var(&value_gen[i].x, &value_gen[i - 1].x) ||
-            !secp256k1_fe_equal_var(&value_gen[i].y, &value_gen[i - 1].y)) {
-            same_generators = 0;
-        }
+    secp256k1_bulletproof_update_commit(commit, &age, &sge);
+    secp256k1_scalar_set_b32(&ecmult_data->y, commit, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&ecmult_data->y)) {
+        return 0;
+    }
+    secp256k1_bulletproof_update_commit(commit, &age, &sge);
+    secp256k1_scalar_set_b32(&ecmult_data->z, commit, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&ecmult_data->z)) {
+        return 0;
     }
 
-    for (i = 0; i < n_proofs; i++) {
-        secp256k1_sha256 sha256;
-        unsigned char commit[32] = {0};
-        unsigned char randomizer61[32] = {0};  /* randomizer for eq (61) so we can add it to eq (62) to save a separate multiexp */
-        secp256k1_scalar taux, mu;
-        secp256k1_ge age, sge;
-        int overflow;
-        size_t j;
+    if (!secp256k1_bulletproof_deserialize_point(&ecmult_data->t1, &proof[64], 2, 4) ||
+        !secp256k1_bulletproof_deserialize_point(&ecmult_data->t2, &proof[64], 3, 4)) {
+        return 0;
+    }
 
-        /* Commit to all input data: min value, pedersen commit, asset generator, extra_commit */
-        if (min_value != NULL && min_value[i] != NULL) {
-            unsigned char len[4];
-            secp256k1_sha256_initialize(&sha256);
-            secp256k1_sha256_write(&sha256, commit, 32);
-            len[0] = n_commits;
-            len[1] = n_commits >> 8;
-            len[2] = n_commits >> 16;
-            len[3] = n_commits >> 24;
-            secp256k1_sha256_write(&sha256, len, 4);
-            for (j = 0; j < n_commits; j++) {
-                unsigned char vbuf[8];
-                vbuf[0] = min_value[i][j];
-                vbuf[1] = min_value[i][j] >> 8;
-                vbuf[2] = min_value[i][j] >> 16;
-                vbuf[3] = min_value[i][j] >> 24;
-                vbuf[4] = min_value[i][j] >> 32;
-                vbuf[5] = min_value[i][j] >> 40;
-                vbuf[6] = min_value[i][j] >> 48;
-                vbuf[7] = min_value[i][j] >> 56;
-                secp256k1_sha256_write(&sha256, vbuf, 8);
-            }
-            secp256k1_sha256_finalize(&sha256, commit);
-        }
-        for (j = 0; j < n_commits; j++) {
-            secp256k1_bulletproof_update_commit(commit, &commitp[i][j], &value_gen[i]);
-        }
-        if (extra_commit != NULL && extra_commit[i] != NULL) {
-            secp256k1_sha256_initialize(&sha256);
-            secp256k1_sha256_write(&sha256, commit, 32);
-            secp256k1_sha256_write(&sha256, extra_commit[i], extra_commit_len[i]);
-            secp256k1_sha256_finalize(&sha256, commit);
-        }
+    secp256k1_bulletproof_update_commit(commit, &ecmult_data->t1, &ecmult_data->t2);
+    secp256k1_scalar_set_b32(&ecmult_data->x, commit, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&ecmult_data->x)) {
+        return 0;
+    }
 
-        /* Compute y, z, x */
-        if (!secp256k1_bulletproof_deserialize_point(&age, &proof[i][64], 0, 4) ||
-            !secp256k1_bulletproof_deserialize_point(&sge, &proof[i][64], 1, 4)) {
-            return 0;
-        }
+    /* compute exponent offsets */
+    secp256k1_scalar_inverse_var(&ecmult_data->yinv, &ecmult_data->y);  /* TODO somehow batch this w the inner-product argument inverse */
+    ecmult_data->yinvn = ecmult_data->yinv;
+    for (j = 0; j < secp256k1_floor_lg(nbits); j++) {
+        secp256k1_scalar_sqr(&ecmult_data->yinvn, &ecmult_data->yinvn);
+    }
+    secp256k1_scalar_sqr(&ecmult_data->zsq, &ecmult_data->z);
+    secp256k1_scalar_negate(&ecmult_data->negz, &ecmult_data->z);
 
-        secp256k1_bulletproof_update_commit(commit, &age, &sge);
-        secp256k1_scalar_set_b32(&ecmult_data[i].y, commit, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data[i].y)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
-        secp256k1_bulletproof_update_commit(commit, &age, &sge);
-        secp256k1_scalar_set_b32(&ecmult_data[i].z, commit, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data[i].z)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
+    /* Update commit with remaining data for the inner product proof */
+    secp256k1_sha256_initialize(&sha256);
+    secp256k1_sha256_write(&sha256, commit, 32);
+    secp256k1_sha256_write(&sha256, &proof[0], 64);
+    secp256k1_sha256_finalize(&sha256, commit);
 
-        if (!secp256k1_bulletproof_deserialize_point(&ecmult_data[i].t1, &proof[i][64], 2, 4) ||
-            !secp256k1_bulletproof_deserialize_point(&ecmult_data[i].t2, &proof[i][64], 3, 4)) {
-            return 0;
-        }
+    secp256k1_sha256_initialize(&sha256);
+    secp256k1_sha256_write(&sha256, commit, 32);
+    secp256k1_sha256_finalize(&sha256, randomizer61);
+    secp256k1_scalar_set_b32(&ecmult_data->randomizer61, randomizer61, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&ecmult_data->randomizer61)) {
+        return 0;
+    }
 
-        secp256k1_bulletproof_update_commit(commit, &ecmult_data[i].t1, &ecmult_data[i].t2);
-        secp256k1_scalar_set_b32(&ecmult_data[i].x, commit, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data[i].x)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
+    /* Deserialize everything else */
+    secp256k1_scalar_set_b32(&taux, &proof[0], &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&taux)) {
+        return 0;
+    }
+    secp256k1_scalar_set_b32(&mu, &proof[32], &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&mu)) {
+        return 0;
+    }
+    /* A little sketchy, we read t (l(x) . r(x)) off the front of the inner product proof,
+     * which we otherwise treat as a black box */
+    secp256k1_scalar_set_b32(&ecmult_data->t, &proof[64 + 128 + 1], &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&ecmult_data->t)) {
+        return 0;
+    }
 
-        /* compute exponent offsets */
-        secp256k1_scalar_inverse_var(&ecmult_data[i].yinv, &ecmult_data[i].y);  /* TODO somehow batch this w the inner-product argument inverse */
-        ecmult_data[i].yinvn = ecmult_data[i].yinv;
-        for (j = 0; j < secp256k1_floor_lg(nbits); j++) {
-            secp256k1_scalar_sqr(&ecmult_data[i].yinvn, &ecmult_data[i].yinvn);
-        }
-        secp256k1_scalar_sqr(&ecmult_data[i].zsq, &ecmult_data[i].z);
-        secp256k1_scalar_negate(&ecmult_data[i].negz, &ecmult_data[i].z);
+    /* Verify inner product proof */
+    ecmult_data->a = age;
+    ecmult_data->s = sge;
+    ecmult_data->n = nbits * n_commits;
+    ecmult_data->count = 0;
+    ecmult_data->asset = value_gen;
+    ecmult_data->min_value = min_value;
+    ecmult_data->commit = commitp;
+    ecmult_data->n_commits = n_commits;
+    secp256k1_scalar_mul(&taux, &taux, &ecmult_data->randomizer61);
+    secp256k1_scalar_add(&mu, &mu, &taux);
+
+    innp_ctx->proof = &proof[64 + 128 + 1];
+    innp_ctx->plen = plen - (64 + 128 + 1);
+    innp_ctx->vec_len = nbits * n_commits;
+    innp_ctx->p_offs = mu;
+    memcpy(innp_ctx->commit, commit, 32);
+    innp_ctx->yinv = ecmult_data->yinv;
+    innp_ctx->rangeproof_cb = secp256k1_bulletproof_rangeproof_vfy_callback;
+    innp_ctx->rangeproof_cb_data = (void *) ecmult_data;
+    innp_ctx->n_extra_rangeproof_points = 5 + n_commits;
+    return 1;
+}
 
-        /* Update commit with remaining data for the inner product proof */
-        secp256k1_sha256_initialize(&sha256);
-        secp256k1_sha256_write(&sha256, commit, 32);
-        secp256k1_sha256_write(&sha256, &proof[i][0], 64);
-        secp256k1_sha256_finalize(&sha256, commit);
+/* Verifies `n_proofs` rangeproofs in a single multiexponentiation. The proofs need not have the
+ * same number of commitments or bits, so `plen`, `nbits` and `n_commits` are arrays with one
+ * entry per proof. If `valid` is non-NULL, bit `i` of it (byte `i / 8`, bit `i % 8`) is set
+ * on return iff proof `i` is valid; bad proofs are then located by bisection rather than by
+ * verifying every proof on its own. In that case -1 is returned if the scratch space is too
+ * small to check every proof. */
+static int secp256k1_bulletproof_rangeproof_verify_impl(const secp256k1_ecmult_context *ecmult_ctx, secp256k1_scratch *scratch, const unsigned char* const* proof, const size_t n_proofs, const size_t *plen, const size_t *nbits, const uint64_t* const* min_value, const secp256k1_ge* const* commitp, const size_t *n_commits, const secp256k1_ge *value_gen, const secp256k1_bulletproof_generators *gens, const unsigned char* const* extra_commit, size_t *extra_commit_len, unsigned char *valid) {
+    secp256k1_bulletproof_vfy_ecmult_context *ecmult_data;
+    secp256k1_bulletproof_innerproduct_context *innp_ctx;
+    size_t *proof_idx;
+    size_t *shared_gen;
+    unsigned char *innp_valid = NULL;
+    size_t n_shared_gens = 0;
+    size_t n_ok = 0;
+    int ret;
+    size_t i;
 
-        secp256k1_sha256_initialize(&sha256);
-        secp256k1_sha256_write(&sha256, commit, 32);
-        secp256k1_sha256_finalize(&sha256, randomizer61);
-        secp256k1_scalar_set_b32(&ecmult_data[i].randomizer61, randomizer61, &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data[i].randomizer61)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
-        }
+    if (valid != NULL) {
+        memset(valid, 0, (n_proofs + 7) / 8);
+    }
+    if (!secp256k1_scratch_allocate_frame(scratch, n_proofs * (sizeof(*ecmult_data) + sizeof(*innp_ctx) + sizeof(*proof_idx) + sizeof(*shared_gen)) + (n_proofs + 7) / 8, 5)) {
+        return valid != NULL ? -1 : 0;
+    }
+    ecmult_data = (secp256k1_bulletproof_vfy_ecmult_context *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*ecmult_data));
+    innp_ctx = (secp256k1_bulletproof_innerproduct_context *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*innp_ctx));
+    proof_idx = (size_t *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*proof_idx));
+    shared_gen = (size_t *)secp256k1_scratch_alloc(scratch, n_proofs * sizeof(*shared_gen));
+    if (valid != NULL) {
+        innp_valid = (unsigned char *)secp256k1_scratch_alloc(scratch, (n_proofs + 7) / 8);
+    }
 
-        /* Deserialize everything else */
-        secp256k1_scalar_set_b32(&taux, &proof[i][0], &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&taux)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
+    for (i = 0; i < n_proofs; i++) {
+        if (!secp256k1_bulletproof_rangeproof_vfy_prepare(&ecmult_data[n_ok], &innp_ctx[n_ok], proof[i], plen[i], nbits[i], min_value == NULL ? NULL : min_value[i], commitp[i], n_commits[i], &value_gen[i], extra_commit == NULL ? NULL : extra_commit[i], extra_commit == NULL ? 0 : extra_commit_len[i])) {
+            if (valid == NULL) {
+                secp256k1_scratch_deallocate_frame(scratch);
+                return 0;
+            }
+            continue;
         }
-        secp256k1_scalar_set_b32(&mu, &proof[i][32], &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&mu)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
+        proof_idx[n_ok++] = i;
+    }
+
+    /* Group the proofs by value generator. All proofs using the same generator can amortize
+     * their scalar multiplications by it, saving one scalar-ge multiplication per proof. The
+     * `shared_gen` array holds the index of the first proof using each distinct generator. */
+    for (i = 0; i < n_ok; i++) {
+        const secp256k1_ge *gen = ecmult_data[i].asset;
+        size_t j;
+        VERIFY_CHECK(!secp256k1_ge_is_infinity(gen));
+        for (j = 0; j < n_shared_gens; j++) {
+            const secp256k1_ge *shared = ecmult_data[shared_gen[j]].asset;
+            if (secp256k1_fe_equal_var(&gen->x, &shared->x) && secp256k1_fe_equal_var(&gen->y, &shared->y)) {
+                break;
+            }
         }
-        /* A little sketchy, we read t (l(x) . r(x)) off the front of the inner product proof,
-         * which we otherwise treat as a black box */
-        secp256k1_scalar_set_b32(&ecmult_data[i].t, &proof[i][64 + 128 + 1], &overflow);
-        if (overflow || secp256k1_scalar_is_zero(&ecmult_data[i].t)) {
-            secp256k1_scratch_deallocate_frame(scratch);
-            return 0;
+        if (j == n_shared_gens) {
+            shared_gen[n_shared_gens++] = i;
         }
+        innp_ctx[i].shared_g_idx = j;
+    }
 
-        /* Verify inner product proof */
-        ecmult_data[i].a = age;
-        ecmult_data[i].s = sge;
-        ecmult_data[i].n = nbits * n_commits;
-        ecmult_data[i].count = 0;
-        ecmult_data[i].asset = &value_gen[i];
-        ecmult_data[i].min_value = min_value == NULL ? NULL : min_value[i];
-        ecmult_data[i].commit = commitp[i];
-        ecmult_data[i].n_commits = n_commits;
-        secp256k1_scalar_mul(&taux, &taux, &ecmult_data[i].randomizer61);
-        secp256k1_scalar_add(&mu, &mu, &taux);
-
-        innp_ctx[i].proof = &proof[i][64 + 128 + 1];
-        innp_ctx[i].p_offs = mu;
-        memcpy(innp_ctx[i].commit, commit, 32);
-        innp_ctx[i].yinv = ecmult_data[i].yinv;
-        innp_ctx[i].rangeproof_cb = secp256k1_bulletproof_rangeproof_vfy_callback;
-        innp_ctx[i].rangeproof_cb_data = (void *) &ecmult_data[i];
-        innp_ctx[i].n_extra_rangeproof_points = 5 + n_commits;
-    }
-
-    ret = secp256k1_bulletproof_inner_product_verify_impl(ecmult_ctx, scratch, gens, nbits * n_commits, innp_ctx, n_proofs, plen - (64 + 128 + 1), same_generators);
+    ret = secp256k1_bulletproof_inner_product_verify_impl(ecmult_ctx, scratch, gens, innp_ctx, n_ok, n_shared_gens, innp_valid);
+    if (valid != NULL) {
+        for (i = 0; i < n_ok; i++) {
+            if (innp_valid[i / 8] & (1 << (i % 8))) {
+                valid[proof_idx[i] / 8] |= 1 << (proof_idx[i] % 8);
+            }
+        }
+    }
     secp256k1_scratch_deallocate_frame(scratch);
-    return ret;
+    if (ret < 0) {
+        return ret;
+    }
+    return ret && n_ok == n_proofs;
 }
 
 typedef struct {
@@ -214,6 +214,51 @@ static void test_bulletproof_api(void) {
     CHECK(secp256k1_bulletproof_rangeproof_verify_multi(both, scratch, gens, &proof_ptr, 1, plen, &mv_ptr, pcommit_arr, 4, 64, &value_gen, blind_ptr, &blindlen) == 0);
     CHECK(ecount == 14);
 
+    /* verify_scratch_size */
+    ecount = 0;
+    CHECK(secp256k1_bulletproof_rangeproof_verify_scratch_size(sign, 1, 64, 1) == 0);
+    CHECK(ecount == 1);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_scratch_size(both, 0, 64, 1) == 0);
+    CHECK(ecount == 2);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_scratch_size(both, 1, 0, 1) == 0);
+    CHECK(ecount == 3);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_scratch_size(both, 1, 65, 1) == 0);
+    CHECK(ecount == 4);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_scratch_size(both, 1, 64, 0) == 0);
+    CHECK(ecount == 5);
+    {
+        size_t size = secp256k1_bulletproof_rangeproof_verify_scratch_size(vrfy, 1, 64, 1);
+        secp256k1_scratch_space *exact = secp256k1_scratch_space_create(vrfy, size);
+        CHECK(size > 0);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi(vrfy, exact, gens, &proof_ptr, 1, plen, &mv_ptr, pcommit_arr, 1, 64, &value_gen, blind_ptr, &blindlen) == 1);
+        CHECK(secp256k1_bulletproof_rangeproof_verify(vrfy, exact, gens, proof, plen, min_value, pcommit, 1, 64, &value_gen, blind, 32) == 1);
+        CHECK(secp256k1_scratch_space_high_water_mark(exact) <= size);
+        secp256k1_scratch_space_destroy(exact);
+    }
+    CHECK(ecount == 5);
+
+    /* verify_multi_mixed */
+    ecount = 0;
+    {
+        size_t n_commits = 1;
+        size_t nbits = 64;
+        size_t bad_nbits = 65;
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(none, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, &n_commits, &nbits, &value_gen, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 1);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, &n_commits, &nbits, &value_gen, blind_ptr, &blindlen) == 1);
+        CHECK(ecount == 1);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, NULL, &mv_ptr, pcommit_arr, &n_commits, &nbits, &value_gen, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 2);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, NULL, &nbits, &value_gen, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 3);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, &n_commits, NULL, &value_gen, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 4);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, &n_commits, &bad_nbits, &value_gen, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 5);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(vrfy, scratch, gens, &proof_ptr, 1, &plen, &mv_ptr, pcommit_arr, &n_commits, &nbits, NULL, blind_ptr, &blindlen) == 0);
+        CHECK(ecount == 6);
+    }
+
     /* Rewind */
     ecount = 0;
     CHECK(secp256k1_bulletproof_rangeproof_rewind(none, &rewind_v, rewind_blind, proof, plen, min_value[0], pcommit, &value_gen, blind, blind, 32, NULL) == 1);
@@ -356,6 +401,9 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
     CHECK(secp256k1_bulletproof_inner_product_prove_impl(&ctx->ecmult_ctx, scratch, proof, &plen, gens, &one, n, secp256k1_bulletproof_ip_test_abgh_callback, (void *) &abgh_data, commit) == 1);
 
     innp_ctx.proof = proof;
+    innp_ctx.plen = plen;
+    innp_ctx.vec_len = n;
+    innp_ctx.shared_g_idx = 0;
     memcpy(innp_ctx.commit, commit, 32);
     secp256k1_scalar_set_int(&innp_ctx.yinv, 1);
     innp_ctx.n_extra_rangeproof_points = 1;
@@ -378,7 +426,7 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
     /* Check proof with no offsets or other baubles */
     offs_ctx.parity = 0;
     secp256k1_scalar_clear(&innp_ctx.p_offs);
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
 
     /* skew P by a random amount and instruct the verifier to offset it */
     random_scalar_order(&innp_ctx.p_offs);
@@ -389,18 +437,18 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
 
     /* wrong p_offs should fail */
     offs_ctx.parity = 0;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 0);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 0);
 
     secp256k1_scalar_negate(&innp_ctx.p_offs, &innp_ctx.p_offs);
 
     offs_ctx.parity = 0;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
     /* check that verification did not trash anything */
     offs_ctx.parity = 0;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
     /* check that adding a no-op rangeproof skew function doesn't break anything */
     offs_ctx.parity = 0;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
 
     /* Offset P by some random point and then try to undo this in the verification */
     secp256k1_gej_set_ge(&tmpj2, &offs_ctx.ext_pt);
@@ -410,7 +458,7 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
     secp256k1_ge_set_gej(&offs_ctx.p, &tmpj);
     offs_ctx.parity = 0;
     innp_ctx.n_extra_rangeproof_points = 2;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
 
     /* Offset each basis by some random point and try to undo this in the verification */
     secp256k1_gej_set_infinity(&tmpj2);
@@ -432,7 +480,7 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
     secp256k1_scalar_negate(&offs_ctx.skew_sc, &offs_ctx.skew_sc);
 
     offs_ctx.parity = 0;
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, &innp_ctx, 1, plen, 1) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, &innp_ctx, 1, 1, NULL) == 1);
 
     /* Try to validate the same proof twice */
 {
@@ -445,8 +493,8 @@ void test_bulletproof_inner_product(size_t n, const secp256k1_bulletproof_genera
     memcpy(&offs_ctxs[1], &offs_ctx, sizeof(offs_ctx));
     innp_ctxs[0].rangeproof_cb_data = (void *)&offs_ctxs[0];
     innp_ctxs[1].rangeproof_cb_data = (void *)&offs_ctxs[1];
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, innp_ctxs, 2, plen, 1) == 1);
-    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, n, innp_ctxs, 2, plen, 0) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, innp_ctxs, 2, 1, NULL) == 1);
+    CHECK(secp256k1_bulletproof_inner_product_verify_impl(&ctx->ecmult_ctx, scratch, gens, innp_ctxs, 2, 0, NULL) == 1);
 }
 
     free(a_arr);
@@ -462,6 +510,9 @@ void test_bulletproof_rangeproof(size_t nbits, size_t expected_size, const secp2
     unsigned char proof3[1024];
     const unsigned char *proof_ptr[3];
     size_t plen = sizeof(proof);
+    size_t plens[3];
+    size_t nbitss[3];
+    size_t n_commitss[3];
     uint64_t v = 123456;
     uint64_t v_recovered;
     secp256k1_gej commitj;
@@ -487,9 +538,9 @@ void test_bulletproof_rangeproof(size_t nbits, size_t expected_size, const secp2
     secp256k1_generator_load(&value_gen[2], &secp256k1_generator_const_h);
     random_scalar_order(&blind);
 
-    secp256k1_pedersen_ecmult(&commitj, &blind, v, &value_gen[0], &gens->blinding_gen[0]);
+    secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &commitj, &blind, v, &value_gen[0], &gens->blinding_gen[0]);
     secp256k1_ge_set_gej(&commitp, &commitj);
-    secp256k1_pedersen_ecmult(&commitj, &blind, v, &value_gen[2], &gens->blinding_gen[0]);
+    secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &commitj, &blind, v, &value_gen[2], &gens->blinding_gen[0]);
     secp256k1_ge_set_gej(&commitp2, &commitj);
     commitp_ptr[0] = commitp_ptr[1] = &commitp;
     commitp_ptr[2] = &commitp2;
@@ -504,12 +555,23 @@ void test_bulletproof_rangeproof(size_t nbits, size_t expected_size, const secp2
     CHECK(secp256k1_bulletproof_rangeproof_prove_impl(&ctx->ecmult_ctx, scratch, proof3, &plen, NULL, NULL, nbits, &v, NULL, &blind, &commitp2, 1, &value_gen[2], gens, nonce, nonce, NULL, 0, NULL) == 1);
     CHECK(plen == expected_size);
     nonce[0] ^= 3;
+    plens[0] = plens[1] = plens[2] = plen;
+    nbitss[0] = nbitss[1] = nbitss[2] = nbits;
+    n_commitss[0] = n_commitss[1] = n_commitss[2] = 1;
     /* Verify once */
-    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 1, plen, nbits, NULL, commitp_ptr, 1, value_gen, gens, NULL, 0) == 1);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 1, plens, nbitss, NULL, commitp_ptr, n_commitss, value_gen, gens, NULL, 0, NULL) == 1);
     /* Verify twice at once to test batch validation */
-    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 2, plen, nbits, NULL, commitp_ptr, 1, value_gen, gens, NULL, 0) == 1);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 2, plens, nbitss, NULL, commitp_ptr, n_commitss, value_gen, gens, NULL, 0, NULL) == 1);
     /* Verify thrice at once where one has a different asset type */
-    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 3, plen, nbits, NULL, commitp_ptr, 1, value_gen, gens, NULL, 0) == 1);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, proof_ptr, 3, plens, nbitss, NULL, commitp_ptr, n_commitss, value_gen, gens, NULL, 0, NULL) == 1);
+    /* ...with just the advertised scratch space */
+    {
+        size_t size = secp256k1_bulletproof_rangeproof_verify_scratch_size(ctx, 3, nbits, 1);
+        secp256k1_scratch *exact = secp256k1_scratch_space_create(ctx, size);
+        CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, exact, proof_ptr, 3, plens, nbitss, NULL, commitp_ptr, n_commitss, value_gen, gens, NULL, 0, NULL) == 1);
+        CHECK(secp256k1_scratch_space_high_water_mark(exact) <= size);
+        secp256k1_scratch_space_destroy(exact);
+    }
 
     /* Rewind */
     CHECK(secp256k1_bulletproof_rangeproof_rewind_impl(&v_recovered, &blind_recovered, proof, plen, 0, &pcommit, &secp256k1_generator_const_g, nonce, NULL, 0, NULL) == 1);
@@ -548,7 +610,7 @@ void test_bulletproof_rangeproof_aggregate(size_t nbits, size_t n_commits, size_
         }
         secp256k1_scalar_set_u64(&vs, v[i]);
         random_scalar_order(&blind[i]);
-        secp256k1_pedersen_ecmult(&commitj, &blind[i], v[i], &value_gen, &gens->blinding_gen[0]);
+        secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &commitj, &blind[i], v[i], &value_gen, &gens->blinding_gen[0]);
         secp256k1_ge_set_gej(&commitp[i], &commitj);
 
         secp256k1_bulletproof_update_commit(commit, &commitp[i], &value_gen);
@@ -556,7 +618,7 @@ void test_bulletproof_rangeproof_aggregate(size_t nbits, size_t n_commits, size_
 
     CHECK(secp256k1_bulletproof_rangeproof_prove_impl(&ctx->ecmult_ctx, scratch, proof, &plen, NULL, NULL, nbits, v, NULL, blind, commitp, n_commits, &value_gen, gens, nonce, nonce, NULL, 0, NULL) == 1);
     CHECK(plen == expected_size);
-    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, &proof_ptr, 1, plen, nbits, NULL, &constptr, n_commits, &value_gen, gens, NULL, 0) == 1);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_impl(&ctx->ecmult_ctx, scratch, &proof_ptr, 1, &plen, &nbits, NULL, &constptr, &n_commits, &value_gen, gens, NULL, 0, NULL) == 1);
 
     secp256k1_scratch_destroy(scratch);
     free(commitp);
@@ -564,6 +626,147 @@ void test_bulletproof_rangeproof_aggregate(size_t nbits, size_t n_commits, size_
     free(blind);
 }
 
+/* Batch-verify proofs of differing sizes, aggregation counts and value generators in one go */
+void test_bulletproof_rangeproof_mixed(const secp256k1_bulletproof_generators *gens) {
+    const size_t nbits[4] = { 64, 32, 16, 8 };
+    const size_t n_commits[4] = { 1, 2, 1, 4 };
+    unsigned char proof[4][1024];
+    const unsigned char *proof_ptr[4];
+    size_t plen[4];
+    secp256k1_pedersen_commitment commit[4][4];
+    const secp256k1_pedersen_commitment *commit_ptr[4];
+    secp256k1_generator value_gen[4];
+    unsigned char blind[4][32];
+    const unsigned char *blind_ptr[4];
+    uint64_t value[4];
+    unsigned char nonce[32];
+    secp256k1_pedersen_commitment tmp;
+    size_t i, j;
+
+    secp256k1_scratch *scratch = secp256k1_scratch_space_create(ctx, 10000000);
+
+    value_gen[0] = secp256k1_generator_const_g;
+    value_gen[1] = secp256k1_generator_const_g;
+    secp256k1_rand256(nonce);
+    CHECK(secp256k1_generator_generate(ctx, &value_gen[2], nonce));
+    value_gen[3] = value_gen[2];
+
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < n_commits[i]; j++) {
+            secp256k1_scalar tmp_s;
+            random_scalar_order(&tmp_s);
+            secp256k1_scalar_get_b32(blind[j], &tmp_s);
+            blind_ptr[j] = blind[j];
+            value[j] = secp256k1_rand32() >> (32 - nbits[i] / 2);
+            CHECK(secp256k1_pedersen_commit(ctx, &commit[i][j], blind[j], value[j], &value_gen[i], &secp256k1_generator_const_h));
+        }
+        secp256k1_rand256(nonce);
+        plen[i] = sizeof(proof[i]);
+        CHECK(secp256k1_bulletproof_rangeproof_prove(ctx, scratch, gens, proof[i], &plen[i], NULL, NULL, NULL, value, NULL, blind_ptr, NULL, n_commits[i], &value_gen[i], nbits[i], nonce, NULL, NULL, 0, NULL) == 1);
+        proof_ptr[i] = proof[i];
+        commit_ptr[i] = commit[i];
+    }
+
+    for (i = 1; i <= 4; i++) {
+        CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(ctx, scratch, gens, proof_ptr, i, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == 1);
+    }
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(ctx, scratch, gens, &proof_ptr[1], 3, &plen[1], NULL, &commit_ptr[1], &n_commits[1], &nbits[1], &value_gen[1], NULL, NULL) == 1);
+
+    /* Swap two commitments of an aggregate proof, which must make the batch fail */
+    tmp = commit[3][0];
+    commit[3][0] = commit[3][1];
+    commit[3][1] = tmp;
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(ctx, scratch, gens, proof_ptr, 4, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == 0);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_mixed(ctx, scratch, gens, proof_ptr, 3, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == 1);
+
+    secp256k1_scratch_destroy(scratch);
+}
+
+/* Check that a failing batch reports exactly the bad proofs */
+void test_bulletproof_rangeproof_bitmap(const secp256k1_bulletproof_generators *gens) {
+    unsigned char proof[16][1024];
+    const unsigned char *proof_ptr[16];
+    size_t plen[16];
+    size_t nbits[16];
+    size_t n_commits[16];
+    secp256k1_pedersen_commitment commit[16];
+    const secp256k1_pedersen_commitment *commit_ptr[16];
+    secp256k1_generator value_gen[16];
+    unsigned char valid[2];
+    int bad[16];
+    size_t scratch_size;
+    size_t i;
+
+    secp256k1_scratch *scratch = secp256k1_scratch_space_create(ctx, 10000000);
+
+    for (i = 0; i < 16; i++) {
+        secp256k1_scalar tmp_s;
+        unsigned char blind[32];
+        const unsigned char *blind_ptr = blind;
+        unsigned char nonce[32];
+        uint64_t value = secp256k1_rand_bits(8);
+
+        random_scalar_order(&tmp_s);
+        secp256k1_scalar_get_b32(blind, &tmp_s);
+        secp256k1_rand256(nonce);
+        value_gen[i] = i % 3 == 0 ? secp256k1_generator_const_g : secp256k1_generator_const_h;
+        nbits[i] = 8;
+        n_commits[i] = 1;
+        plen[i] = sizeof(proof[i]);
+        CHECK(secp256k1_pedersen_commit(ctx, &commit[i], blind, value, &value_gen[i], &secp256k1_generator_const_h));
+        CHECK(secp256k1_bulletproof_rangeproof_prove(ctx, scratch, gens, proof[i], &plen[i], NULL, NULL, NULL, &value, NULL, &blind_ptr, NULL, 1, &value_gen[i], 8, nonce, NULL, NULL, 0, NULL) == 1);
+        proof_ptr[i] = proof[i];
+        commit_ptr[i] = &commit[i];
+    }
+
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_bitmap(ctx, scratch, gens, valid, proof_ptr, 16, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == 1);
+    CHECK(valid[0] == 0xff && valid[1] == 0xff);
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_bitmap(ctx, scratch, gens, valid, proof_ptr, 11, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == 1);
+    CHECK(valid[0] == 0xff && valid[1] == 0x07);
+
+    /* A scratch space that is too small never makes a valid proof invalid */
+    scratch_size = secp256k1_bulletproof_rangeproof_verify_scratch_size(ctx, 16, 8, 1);
+    for (i = 0; i <= 32; i++) {
+        secp256k1_scratch *small = secp256k1_scratch_space_create(ctx, scratch_size * i / 32);
+        int ret = secp256k1_bulletproof_rangeproof_verify_multi_bitmap(ctx, small, gens, valid, proof_ptr, 16, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL);
+        CHECK(ret == 1 || ret == -1);
+        CHECK(ret == -1 || (valid[0] == 0xff && valid[1] == 0xff));
+        if (i == 0) {
+            CHECK(ret == -1);
+        } else if (i == 32) {
+            CHECK(ret == 1);
+        }
+        secp256k1_scratch_destroy(small);
+    }
+
+    /* Break a random subset of the proofs in different ways */
+    for (i = 0; i < 16; i++) {
+        bad[i] = secp256k1_rand_bits(2) == 0;
+        if (bad[i]) {
+            switch (secp256k1_rand_int(3)) {
+            case 0:
+                /* a commitment the proof is not for */
+                commit_ptr[i] = &commit[(i + 1) % 16];
+                break;
+            case 1:
+                /* a truncated proof, rejected before the multiexp */
+                plen[i]--;
+                break;
+            default:
+                /* a corrupted inner product argument L/R point */
+                proof[i][plen[i] - 1] ^= 1;
+                break;
+            }
+        }
+    }
+    CHECK(secp256k1_bulletproof_rangeproof_verify_multi_bitmap(ctx, scratch, gens, valid, proof_ptr, 16, plen, NULL, commit_ptr, n_commits, nbits, value_gen, NULL, NULL) == (bad[0] + bad[1] + bad[2] + bad[3] + bad[4] + bad[5] + bad[6] + bad[7] + bad[8] + bad[9] + bad[10] + bad[11] + bad[12] + bad[13] + bad[14] + bad[15] == 0));
+    for (i = 0; i < 16; i++) {
+        CHECK(!!(valid[i / 8] & (1 << (i % 8))) == !bad[i]);
+    }
+
+    secp256k1_scratch_destroy(scratch);
+}
+
 void test_multi_party_bulletproof(size_t n_parties, secp256k1_scratch_space* scratch, const secp256k1_bulletproof_generators *gens) {
     size_t j;
     secp256k1_scalar tmp_s;
@@ -628,6 +831,69 @@ void test_multi_party_bulletproof(size_t n_parties, secp256k1_scratch_space* scr
     CHECK(secp256k1_bulletproof_rangeproof_verify(ctx, scratch, gens, proof, plen, NULL, commit, 1, 64, &secp256k1_generator_const_h, NULL, 0) == 1);
 }
 
+void test_bulletproof_generators_serialize(void) {
+    const size_t n = 64;
+    const size_t len = SECP256K1_BULLETPROOF_GENERATORS_SERIALIZED_SIZE(n);
+    secp256k1_bulletproof_generators *gens = secp256k1_bulletproof_generators_create(ctx, &secp256k1_generator_const_h, n);
+    secp256k1_bulletproof_generators *gens2;
+    unsigned char *blob = (unsigned char *)checked_malloc(&ctx->error_callback, len + 1);
+    unsigned char *blob2 = (unsigned char *)checked_malloc(&ctx->error_callback, len);
+    size_t bloblen;
+    size_t i;
+    int32_t ecount = 0;
+
+    secp256k1_context_set_illegal_callback(ctx, counting_illegal_callback_fn, &ecount);
+    CHECK(gens != NULL);
+
+    bloblen = len - 1;
+    CHECK(secp256k1_bulletproof_generators_serialize(ctx, blob, &bloblen, gens) == 0);
+    bloblen = len + 1;
+    CHECK(secp256k1_bulletproof_generators_serialize(ctx, blob, &bloblen, gens) == 1);
+    CHECK(bloblen == len);
+
+    /* Round trip */
+    gens2 = secp256k1_bulletproof_generators_parse(ctx, blob, bloblen);
+    CHECK(gens2 != NULL);
+    CHECK(gens2->n == n);
+    for (i = 0; i < n + 1; i++) {
+        ge_equals_ge(&gens->gens[i], &gens2->gens[i]);
+    }
+    ge_equals_ge(gens->blinding_gen, gens2->blinding_gen);
+    bloblen = len;
+    CHECK(secp256k1_bulletproof_generators_serialize(ctx, blob2, &bloblen, gens2) == 1);
+    CHECK(memcmp(blob, blob2, len) == 0);
+    secp256k1_bulletproof_generators_destroy(ctx, gens2);
+
+    /* Wrong lengths */
+    CHECK(secp256k1_bulletproof_generators_parse(ctx, blob, len - 1) == NULL);
+    CHECK(secp256k1_bulletproof_generators_parse(ctx, blob, len + 1) == NULL);
+    CHECK(secp256k1_bulletproof_generators_parse(ctx, blob, 0) == NULL);
+    /* Any flipped bit is caught, whether by the header checks or by the checksum */
+    for (i = 0; i < 16; i++) {
+        size_t pos = secp256k1_rand_int(len);
+        unsigned char bit = 1 << secp256k1_rand_int(8);
+        blob[pos] ^= bit;
+        CHECK(secp256k1_bulletproof_generators_parse(ctx, blob, len) == NULL);
+        blob[pos] ^= bit;
+    }
+    /* An n which does not fit the blob, even one which overflows its size computation */
+    memset(&blob[8], 0xff, 8);
+    CHECK(secp256k1_bulletproof_generators_parse(ctx, blob, len) == NULL);
+    CHECK(ecount == 0);
+
+    CHECK(secp256k1_bulletproof_generators_parse(ctx, NULL, len) == NULL);
+    CHECK(ecount == 1);
+    CHECK(secp256k1_bulletproof_generators_serialize(ctx, blob, NULL, gens) == 0);
+    CHECK(ecount == 2);
+    CHECK(secp256k1_bulletproof_generators_serialize(ctx, blob, &bloblen, NULL) == 0);
+    CHECK(ecount == 3);
+
+    secp256k1_context_set_illegal_callback(ctx, NULL, NULL);
+    secp256k1_bulletproof_generators_destroy(ctx, gens);
+    free(blob);
+    free(blob2);
+}
+
 void run_bulletproofs_tests(void) {
     size_t i;
     secp256k1_scratch *scratch;
@@ -635,6 +901,7 @@ void run_bulletproofs_tests(void) {
     /* Make a ton of generators */
     secp256k1_bulletproof_generators *gens = secp256k1_bulletproof_generators_create(ctx, &secp256k1_generator_const_h, 32768);
     test_bulletproof_api();
+    test_bulletproof_generators_serialize();
 
     /* sanity checks */
     CHECK(secp256k1_bulletproof_innerproduct_proof_length(0) == 32);  /* encoding of 1 */
@@ -663,6 +930,10 @@ void run_bulletproofs_tests(void) {
     test_bulletproof_rangeproof_aggregate(64, 1, 675, gens);
     test_bulletproof_rangeproof_aggregate(8, 2, 546, gens);
     test_bulletproof_rangeproof_aggregate(8, 4, 610, gens);
+    test_bulletproof_rangeproof_mixed(gens);
+    for (i = 0; i < (size_t) count; i++) {
+        test_bulletproof_rangeproof_bitmap(gens);
+    }
 
     secp256k1_bulletproof_generators_destroy(ctx, gens);
 
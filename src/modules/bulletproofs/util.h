@@ -69,33 +69,6 @@ static void secp256k1_scalar_dot_product(secp256k1_scalar *r, const secp256k1_sc
     }
 }
 
-static void secp256k1_scalar_inverse_all_var(secp256k1_scalar *r, const secp256k1_scalar *a, size_t len) {
-    secp256k1_scalar u;
-    size_t i;
-    if (len < 1) {
-        return;
-    }
-
-    VERIFY_CHECK((r + len <= a) || (a + len <= r));
-
-    r[0] = a[0];
-
-    i = 0;
-    while (++i < len) {
-        secp256k1_scalar_mul(&r[i], &r[i - 1], &a[i]);
-    }
-
-    secp256k1_scalar_inverse_var(&u, &r[--i]);
-
-    while (i > 0) {
-        size_t j = i--;
-        secp256k1_scalar_mul(&r[j], &r[i], &u);
-        secp256k1_scalar_mul(&u, &u, &a[j]);
-    }
-
-    r[0] = u;
-}
-
 SECP256K1_INLINE static void secp256k1_bulletproof_serialize_points(unsigned char *out, secp256k1_ge *pt, size_t n) {
     const size_t bitveclen = (n + 7) / 8;
     size_t i;
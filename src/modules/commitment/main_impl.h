@@ -27,18 +27,37 @@ static const secp256k1_generator secp256k1_generator_h_internal = {{
 const secp256k1_generator *secp256k1_generator_h = &secp256k1_generator_h_internal;
 
 static void secp256k1_pedersen_commitment_load(secp256k1_ge* ge, const secp256k1_pedersen_commitment* commit) {
-    secp256k1_fe fe;
-    secp256k1_fe_set_b32(&fe, &commit->data[1]);
-    secp256k1_ge_set_xquad(ge, &fe);
-    if (commit->data[0] & 1) {
-        secp256k1_ge_neg(ge, ge);
+    if (sizeof(secp256k1_ge_storage) == 64) {
+        /* When the secp256k1_ge_storage type is exactly 64 byte, use its
+         * representation inside secp256k1_pedersen_commitment, as conversion is
+         * very fast. Note that secp256k1_pedersen_commitment_save must use the
+         * same representation. */
+        secp256k1_ge_storage s;
+        memcpy(&s, &commit->data[0], sizeof(s));
+        secp256k1_ge_from_storage(ge, &s);
+    } else {
+        /* Otherwise, fall back to 32-byte big endian for X and Y. */
+        secp256k1_fe x, y;
+        secp256k1_fe_set_b32(&x, commit->data);
+        secp256k1_fe_set_b32(&y, commit->data + 32);
+        secp256k1_ge_set_xy(ge, &x, &y);
     }
 }
 
+/* Stores the full affine point, so that loading a commitment does not need a
+ * square root. The quadratic residue flag is only computed on serialization. */
 static void secp256k1_pedersen_commitment_save(secp256k1_pedersen_commitment* commit, secp256k1_ge* ge) {
-    secp256k1_fe_normalize(&ge->x);
-    secp256k1_fe_get_b32(&commit->data[1], &ge->x);
-    commit->data[0] = 9 ^ secp256k1_fe_is_quad_var(&ge->y);
+    if (sizeof(secp256k1_ge_storage) == 64) {
+        secp256k1_ge_storage s;
+        secp256k1_ge_to_storage(&s, ge);
+        memcpy(&commit->data[0], &s, sizeof(s));
+    } else {
+        VERIFY_CHECK(!secp256k1_ge_is_infinity(ge));
+        secp256k1_fe_normalize_var(&ge->x);
+        secp256k1_fe_normalize_var(&ge->y);
+        secp256k1_fe_get_b32(commit->data, &ge->x);
+        secp256k1_fe_get_b32(commit->data + 32, &ge->y);
+    }
 }
 
 int secp256k1_pedersen_commitment_parse(const secp256k1_context* ctx, secp256k1_pedersen_commitment* commit, const unsigned char *input) {
@@ -95,7 +114,7 @@ int secp256k1_pedersen_commit(const secp256k1_context* ctx, secp256k1_pedersen_c
     secp256k1_generator_load(&blind_genp, blind_gen);
     secp256k1_scalar_set_b32(&sec, blind, &overflow);
     if (!overflow) {
-        secp256k1_pedersen_ecmult(&rj, &sec, value, &value_genp, &blind_genp);
+        secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &rj, &sec, value, &value_genp, &blind_genp);
         if (!secp256k1_gej_is_infinity(&rj)) {
             secp256k1_ge_set_gej(&r, &rj);
             secp256k1_pedersen_commitment_save(commit, &r);
@@ -130,7 +149,7 @@ int secp256k1_pedersen_blind_commit(const secp256k1_context* ctx, secp256k1_pede
     secp256k1_scalar_set_b32(&sec, blind, &overflow);
     secp256k1_scalar_set_b32(&sec2, value, &overflow2);
     if (!overflow && !overflow2) {
-        secp256k1_pedersen_blind_ecmult(&rj, &sec, &sec2, &value_genp, &blind_genp);
+        secp256k1_pedersen_blind_ecmult(&ctx->ecmult_gen_ctx, &rj, &sec, &sec2, &value_genp, &blind_genp);
         if (!secp256k1_gej_is_infinity(&rj)) {
             secp256k1_ge_set_gej(&r, &rj);
             secp256k1_pedersen_commitment_save(commit, &r);
@@ -145,18 +164,13 @@ int secp256k1_pedersen_blind_commit(const secp256k1_context* ctx, secp256k1_pede
 
 int secp256k1_pedersen_commitment_to_pubkey(const secp256k1_context* ctx, secp256k1_pubkey* pubkey, const secp256k1_pedersen_commitment* commit) {
     secp256k1_ge Q;
-    secp256k1_fe fe;
 
     VERIFY_CHECK(ctx != NULL);
     ARG_CHECK(pubkey != NULL);
     memset(pubkey, 0, sizeof(*pubkey));
     ARG_CHECK(commit != NULL);
 
-    secp256k1_fe_set_b32(&fe, &commit->data[1]);
-    secp256k1_ge_set_xquad(&Q, &fe);
-    if (commit->data[0] & 1) {
-        secp256k1_ge_neg(&Q, &Q);
-    }
+    secp256k1_pedersen_commitment_load(&Q, commit);
     secp256k1_pubkey_save(pubkey, &Q);
     secp256k1_ge_clear(&Q);
     return 1;
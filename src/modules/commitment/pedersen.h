@@ -0,0 +1,40 @@
+/***********************************************************************
+ * Copyright (c) 2015 Gregory Maxwell                                  *
+ * Distributed under the MIT software license, see the accompanying    *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php. *
+ ***********************************************************************/
+
+#ifndef SECP256K1_MODULE_COMMITMENT_PEDERSEN_H
+#define SECP256K1_MODULE_COMMITMENT_PEDERSEN_H
+
+#include <stdint.h>
+
+#include "group.h"
+#include "scalar.h"
+#include "ecmult_gen.h"
+
+typedef struct {
+    /* For accelerating the computation of v*H for 64-bit values v, using the
+     * same mechanism as secp256k1_ecmult_gen_context: v is broken up into
+     * groups of 4 bits n_0, ..., n_15 and sum(n_i * 16^i * H + U_i, i=0..15)
+     * is computed, where U_i = U * 2^i (for i=0..14), U_i = U * (1-2^15)
+     * (for i=15) and U is a point with no known corresponding scalar. */
+    secp256k1_ge_storage (*prec)[16][16]; /* prec[j][i] = 16^j * i * H + U_j */
+} secp256k1_pedersen_context;
+
+static void secp256k1_pedersen_context_init(secp256k1_pedersen_context* ctx);
+static void secp256k1_pedersen_context_build(secp256k1_pedersen_context* ctx, const secp256k1_callback* cb);
+static void secp256k1_pedersen_context_clone(secp256k1_pedersen_context *dst,
+                                             const secp256k1_pedersen_context* src, const secp256k1_callback* cb);
+static void secp256k1_pedersen_context_clear(secp256k1_pedersen_context* ctx);
+static int secp256k1_pedersen_context_is_built(const secp256k1_pedersen_context* ctx);
+
+/** Multiply the value generator H with a 64-bit value in constant time: R = value*H */
+static void secp256k1_pedersen_ecmult_small(const secp256k1_pedersen_context* ctx, secp256k1_gej *r, uint64_t value);
+
+/** Compute R = sec*blind_gen + value*value_gen in constant time. The
+ *  precomputed tables are used when value_gen is H or blind_gen is G and the
+ *  respective context is built; either context may be NULL. */
+static void secp256k1_pedersen_ecmult(const secp256k1_ecmult_gen_context *ecmult_gen_ctx, const secp256k1_pedersen_context *pedersen_ctx, secp256k1_gej *rj, const secp256k1_scalar *sec, uint64_t value, const secp256k1_ge* value_gen, const secp256k1_ge* blind_gen);
+
+#endif
@@ -10,18 +10,156 @@
 #include <string.h>
 
 #include "ecmult_const.h"
+#include "ecmult_gen.h"
 #include "group.h"
 #include "scalar.h"
 
+#include "modules/commitment/pedersen.h"
+
+/** The alternative generator H as a group element, see secp256k1_generator_h. */
+static const secp256k1_ge secp256k1_ge_const_h = SECP256K1_GE_CONST(
+    0x50929b74UL, 0xc1a04954UL, 0xb78b4b60UL, 0x35e97a5eUL,
+    0x078a5a0fUL, 0x28ec96d5UL, 0x47bfee9aUL, 0xce803ac0UL,
+    0x31d3c686UL, 0x3973926eUL, 0x049e637cUL, 0xb1b5f40aUL,
+    0x36dac28aUL, 0xf1766968UL, 0xc30c2313UL, 0xf3a38904UL
+);
+
+static void secp256k1_pedersen_context_init(secp256k1_pedersen_context *ctx) {
+    ctx->prec = NULL;
+}
+
+static void secp256k1_pedersen_context_build(secp256k1_pedersen_context *ctx, const secp256k1_callback* cb) {
+    secp256k1_ge prec[256];
+    secp256k1_gej nums_gej;
+    int i, j;
+
+    if (ctx->prec != NULL) {
+        return;
+    }
+    ctx->prec = (secp256k1_ge_storage (*)[16][16])secp256k1_shared_malloc(cb, sizeof(*ctx->prec));
+
+    /* Construct a group element with no known corresponding scalar (nothing up my sleeve). */
+    {
+        static const unsigned char nums_b32[33] = "The scalar for this x is unknown";
+        secp256k1_fe nums_x;
+        secp256k1_ge nums_ge;
+        int r;
+        r = secp256k1_fe_set_b32(&nums_x, nums_b32);
+        (void)r;
+        VERIFY_CHECK(r);
+        r = secp256k1_ge_set_xo_var(&nums_ge, &nums_x, 0);
+        (void)r;
+        VERIFY_CHECK(r);
+        secp256k1_gej_set_ge(&nums_gej, &nums_ge);
+        /* Add H to make the bits in x uniformly distributed. */
+        secp256k1_gej_add_ge_var(&nums_gej, &nums_gej, &secp256k1_ge_const_h, NULL);
+    }
+
+    /* compute prec. */
+    {
+        secp256k1_gej precj[256]; /* Jacobian versions of prec. */
+        secp256k1_gej hbase;
+        secp256k1_gej numsbase;
+        secp256k1_gej_set_ge(&hbase, &secp256k1_ge_const_h); /* 16^j * H */
+        numsbase = nums_gej; /* 2^j * nums. */
+        for (j = 0; j < 16; j++) {
+            /* Set precj[j*16 .. j*16+15] to (numsbase, numsbase + hbase, ..., numsbase + 15*hbase). */
+            precj[j*16] = numsbase;
+            for (i = 1; i < 16; i++) {
+                secp256k1_gej_add_var(&precj[j*16 + i], &precj[j*16 + i - 1], &hbase, NULL);
+            }
+            /* Multiply hbase by 16. */
+            for (i = 0; i < 4; i++) {
+                secp256k1_gej_double_var(&hbase, &hbase, NULL);
+            }
+            /* Multiply numbase by 2. */
+            secp256k1_gej_double_var(&numsbase, &numsbase, NULL);
+            if (j == 14) {
+                /* In the last iteration, numsbase is (1 - 2^j) * nums instead. */
+                secp256k1_gej_neg(&numsbase, &numsbase);
+                secp256k1_gej_add_var(&numsbase, &numsbase, &nums_gej, NULL);
+            }
+        }
+        secp256k1_ge_set_all_gej_var(prec, precj, 256, cb);
+    }
+    for (j = 0; j < 16; j++) {
+        for (i = 0; i < 16; i++) {
+            secp256k1_ge_to_storage(&(*ctx->prec)[j][i], &prec[j*16 + i]);
+        }
+    }
+}
+
+static int secp256k1_pedersen_context_is_built(const secp256k1_pedersen_context* ctx) {
+    return ctx->prec != NULL;
+}
+
+static void secp256k1_pedersen_context_clone(secp256k1_pedersen_context *dst,
+                                             const secp256k1_pedersen_context *src, const secp256k1_callback* cb) {
+    if (src->prec == NULL) {
+        dst->prec = NULL;
+    } else {
+        dst->prec = (secp256k1_ge_storage (*)[16][16])secp256k1_shared_clone(cb, src->prec, sizeof(*dst->prec));
+    }
+}
+
+static void secp256k1_pedersen_context_clear(secp256k1_pedersen_context *ctx) {
+    secp256k1_shared_free(ctx->prec);
+    ctx->prec = NULL;
+}
+
+static void secp256k1_pedersen_ecmult_small(const secp256k1_pedersen_context *ctx, secp256k1_gej *r, uint64_t value) {
+    secp256k1_ge add;
+    secp256k1_ge_storage adds;
+    int bits;
+    int i, j;
+    memset(&adds, 0, sizeof(adds));
+    secp256k1_gej_set_infinity(r);
+    add.infinity = 0;
+    for (j = 0; j < 16; j++) {
+        bits = (value >> (j * 4)) & 15;
+        for (i = 0; i < 16; i++) {
+            /* Avoid secret data in array indexes, see secp256k1_ecmult_gen. */
+            secp256k1_ge_storage_cmov(&adds, &(*ctx->prec)[j][i], i == bits);
+        }
+        secp256k1_ge_from_storage(&add, &adds);
+        secp256k1_gej_add_ge(r, r, &add);
+    }
+    bits = 0;
+    secp256k1_ge_clear(&add);
+}
+
+static int secp256k1_pedersen_ge_equal_var(const secp256k1_ge *a, const secp256k1_ge *b) {
+    secp256k1_fe ax = a->x, ay = a->y;
+    if (a->infinity || b->infinity) {
+        return a->infinity && b->infinity;
+    }
+    secp256k1_fe_normalize_weak(&ax);
+    secp256k1_fe_normalize_weak(&ay);
+    return secp256k1_fe_equal_var(&ax, &b->x) && secp256k1_fe_equal_var(&ay, &b->y);
+}
+
+/* Computes the blinding factor term of a commitment, sec * blind_gen. */
+static void secp256k1_pedersen_ecmult_blind(const secp256k1_ecmult_gen_context *ecmult_gen_ctx, secp256k1_gej *bj, const secp256k1_scalar *sec, const secp256k1_ge* blind_gen) {
+    if (ecmult_gen_ctx != NULL && secp256k1_ecmult_gen_context_is_built(ecmult_gen_ctx) && secp256k1_pedersen_ge_equal_var(blind_gen, &secp256k1_ge_const_g)) {
+        secp256k1_ecmult_gen(ecmult_gen_ctx, bj, sec);
+    } else {
+        secp256k1_ecmult_const(bj, blind_gen, sec, 256);
+    }
+}
+
 /* sec * G + value * G2. */
-SECP256K1_INLINE static void secp256k1_pedersen_ecmult(secp256k1_gej *rj, const secp256k1_scalar *sec, uint64_t value, const secp256k1_ge* value_gen, const secp256k1_ge* blind_gen) {
+static void secp256k1_pedersen_ecmult(const secp256k1_ecmult_gen_context *ecmult_gen_ctx, const secp256k1_pedersen_context *pedersen_ctx, secp256k1_gej *rj, const secp256k1_scalar *sec, uint64_t value, const secp256k1_ge* value_gen, const secp256k1_ge* blind_gen) {
     secp256k1_scalar vs;
     secp256k1_gej bj;
     secp256k1_ge bp;
 
     secp256k1_scalar_set_u64(&vs, value);
-    secp256k1_ecmult_const(rj, value_gen, &vs, 64);
-    secp256k1_ecmult_const(&bj, blind_gen, sec, 256);
+    if (pedersen_ctx != NULL && secp256k1_pedersen_context_is_built(pedersen_ctx) && secp256k1_pedersen_ge_equal_var(value_gen, &secp256k1_ge_const_h)) {
+        secp256k1_pedersen_ecmult_small(pedersen_ctx, rj, value);
+    } else {
+        secp256k1_ecmult_const(rj, value_gen, &vs, 64);
+    }
+    secp256k1_pedersen_ecmult_blind(ecmult_gen_ctx, &bj, sec, blind_gen);
 
     /* zero blinding factor indicates that we are not trying to be zero-knowledge,
      * so not being constant-time in this case is OK. */
@@ -35,12 +173,12 @@ SECP256K1_INLINE static void secp256k1_pedersen_ecmult(secp256k1_gej *rj, const
     secp256k1_scalar_clear(&vs);
 }
 
-SECP256K1_INLINE static void secp256k1_pedersen_blind_ecmult(secp256k1_gej *rj, const secp256k1_scalar *sec, const secp256k1_scalar *value, const secp256k1_ge* value_gen, const secp256k1_ge* blind_gen) {
+SECP256K1_INLINE static void secp256k1_pedersen_blind_ecmult(const secp256k1_ecmult_gen_context *ecmult_gen_ctx, secp256k1_gej *rj, const secp256k1_scalar *sec, const secp256k1_scalar *value, const secp256k1_ge* value_gen, const secp256k1_ge* blind_gen) {
     secp256k1_gej bj;
     secp256k1_ge bp;
 
     secp256k1_ecmult_const(rj, value_gen, value, 256);
-    secp256k1_ecmult_const(&bj, blind_gen, sec, 256);
+    secp256k1_pedersen_ecmult_blind(ecmult_gen_ctx, &bj, sec, blind_gen);
 
     /* zero blinding factor indicates that we are not trying to be zero-knowledge,
      * so not being constant-time in this case is OK. */
@@ -137,7 +137,22 @@ static void test_commitment_api(void) {
     /* Test conversion of commit to pubkey and back */
     CHECK(secp256k1_pedersen_commitment_to_pubkey(sign, &pubkey, &commit) == 1);
     CHECK(secp256k1_pubkey_to_pedersen_commitment(sign, &commit2, &pubkey) == 1);
-    CHECK(memcmp(&commit.data, &commit2.data, 33) == 0);
+    CHECK(memcmp(&commit.data, &commit2.data, sizeof(commit.data)) == 0);
+
+    /* Parsing and saving a commitment stores the same decompressed point */
+    CHECK(secp256k1_pedersen_commitment_parse(none, &commit2, out) == 1);
+    CHECK(memcmp(&commit.data, &commit2.data, sizeof(commit.data)) == 0);
+    out[0] ^= 1;
+    CHECK(secp256k1_pedersen_commitment_parse(none, &commit2, out) == 1);
+    CHECK(secp256k1_pedersen_commitment_serialize(none, out2, &commit2) == 1);
+    CHECK(memcmp(out, out2, 33) == 0);
+    {
+        secp256k1_ge ge, ge2;
+        secp256k1_pedersen_commitment_load(&ge, &commit);
+        secp256k1_pedersen_commitment_load(&ge2, &commit2);
+        secp256k1_ge_neg(&ge2, &ge2);
+        ge_equals_ge(&ge, &ge2);
+    }
 
     secp256k1_context_destroy(none);
     secp256k1_context_destroy(sign);
@@ -335,9 +350,48 @@ void test_switch(void) {
     CHECK(memcmp(blind_switch_2, blind_switch, 32) == 0);
 }
 
+static void test_pedersen_ecmult_small(void) {
+    secp256k1_ge h;
+    secp256k1_gej r1, r2;
+    secp256k1_scalar vs, blind;
+    uint64_t value;
+    int i;
+
+    /* secp256k1_ge_const_h is secp256k1_generator_h */
+    secp256k1_generator_load(&h, secp256k1_generator_h);
+    CHECK(secp256k1_pedersen_ge_equal_var(&h, &secp256k1_ge_const_h));
+    CHECK(!secp256k1_pedersen_ge_equal_var(&h, &secp256k1_ge_const_g));
+    CHECK(secp256k1_pedersen_context_is_built(&ctx->pedersen_ctx));
+
+    for (i = 0; i < 4 + count; i++) {
+        switch (i) {
+        case 0: value = 0; break;
+        case 1: value = 1; break;
+        case 2: value = UINT64_MAX; break;
+        default: value = ((uint64_t)secp256k1_rand32() << 32) | secp256k1_rand32(); value >>= secp256k1_rand_int(64);
+        }
+        secp256k1_scalar_set_u64(&vs, value);
+        secp256k1_pedersen_ecmult_small(&ctx->pedersen_ctx, &r1, value);
+        secp256k1_ecmult_const(&r2, &secp256k1_ge_const_h, &vs, 64);
+        CHECK(secp256k1_gej_is_infinity(&r1) == (value == 0));
+        secp256k1_gej_neg(&r2, &r2);
+        secp256k1_gej_add_var(&r1, &r1, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r1));
+
+        /* The table-based and the generic code agree */
+        random_scalar_order(&blind);
+        secp256k1_pedersen_ecmult(&ctx->ecmult_gen_ctx, &ctx->pedersen_ctx, &r1, &blind, value, &h, &secp256k1_ge_const_g);
+        secp256k1_pedersen_ecmult(NULL, NULL, &r2, &blind, value, &h, &secp256k1_ge_const_g);
+        secp256k1_gej_neg(&r2, &r2);
+        secp256k1_gej_add_var(&r1, &r1, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r1));
+    }
+}
+
 void run_commitment_tests(void) {
     int i;
     test_commitment_api();
+    test_pedersen_ecmult_small();
     for (i = 0; i < 10*count; i++) {
         test_pedersen();
     }
@@ -84,19 +84,13 @@ int secp256k1_ecdsa_recoverable_signature_convert(const secp256k1_context* ctx,
     return 1;
 }
 
-static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context *ctx, const secp256k1_scalar *sigr, const secp256k1_scalar* sigs, secp256k1_ge *pubkey, const secp256k1_scalar *message, int recid) {
+/* Computes the point whose x coordinate is sigr, plus the group order if recid & 2, and
+ * whose y coordinate has the parity recid & 1. */
+static int secp256k1_ecdsa_sig_recover_point(secp256k1_ge *x, const secp256k1_scalar *sigr, int recid) {
     unsigned char brx[32];
     secp256k1_fe fx;
-    secp256k1_ge x;
-    secp256k1_gej xj;
-    secp256k1_scalar rn, u1, u2;
-    secp256k1_gej qj;
     int r;
 
-    if (secp256k1_scalar_is_zero(sigr) || secp256k1_scalar_is_zero(sigs)) {
-        return 0;
-    }
-
     secp256k1_scalar_get_b32(brx, sigr);
     r = secp256k1_fe_set_b32(&fx, brx);
     (void)r;
@@ -107,7 +101,20 @@ static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context *ctx, cons
         }
         secp256k1_fe_add(&fx, &secp256k1_ecdsa_const_order_as_fe);
     }
-    if (!secp256k1_ge_set_xo_var(&x, &fx, recid & 1)) {
+    return secp256k1_ge_set_xo_var(x, &fx, recid & 1);
+}
+
+static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context *ctx, const secp256k1_scalar *sigr, const secp256k1_scalar* sigs, secp256k1_ge *pubkey, const secp256k1_scalar *message, int recid) {
+    secp256k1_ge x;
+    secp256k1_gej xj;
+    secp256k1_scalar rn, u1, u2;
+    secp256k1_gej qj;
+
+    if (secp256k1_scalar_is_zero(sigr) || secp256k1_scalar_is_zero(sigs)) {
+        return 0;
+    }
+
+    if (!secp256k1_ecdsa_sig_recover_point(&x, sigr, recid)) {
         return 0;
     }
     secp256k1_gej_set_ge(&xj, &x);
@@ -120,6 +127,75 @@ static int secp256k1_ecdsa_sig_recover(const secp256k1_ecmult_context *ctx, cons
     return !secp256k1_gej_is_infinity(&qj);
 }
 
+/* Number of signatures whose inversions are shared by secp256k1_ecdsa_recover_batch. */
+#define SECP256K1_ECDSA_RECOVER_BATCH_SIZE 32
+
+/* Recovers the public keys of n <= SECP256K1_ECDSA_RECOVER_BATCH_SIZE signatures, sharing one
+ * scalar inversion for all r values and one field inversion for all z coordinates. Sets bit
+ * i of valid iff key i was recovered; the caller clears valid beforehand. Returns whether all
+ * keys were recovered. */
+static int secp256k1_ecdsa_recover_batch_chunk(const secp256k1_context* ctx, secp256k1_pubkey *pubkeys, unsigned char *valid, const secp256k1_ecdsa_recoverable_signature *sigs, const unsigned char *msgs32, size_t n) {
+    secp256k1_scalar r[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    secp256k1_scalar s[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    secp256k1_scalar rn[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    secp256k1_gej qj[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    secp256k1_fe z[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    secp256k1_fe zi[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    /* Index into sigs of the k-th signature that is still being recovered. */
+    size_t idx[SECP256K1_ECDSA_RECOVER_BATCH_SIZE];
+    size_t i, k, count = 0, nz = 0;
+
+    VERIFY_CHECK(n <= SECP256K1_ECDSA_RECOVER_BATCH_SIZE);
+
+    /* Compute the points R, dropping signatures that do not have one. */
+    for (i = 0; i < n; i++) {
+        secp256k1_ge x;
+        int recid;
+        secp256k1_ecdsa_recoverable_signature_load(ctx, &r[count], &s[count], &recid, &sigs[i]);
+        VERIFY_CHECK(recid >= 0 && recid < 4);  /* should have been caught in parse_compact */
+        memset(&pubkeys[i], 0, sizeof(pubkeys[i]));
+        if (secp256k1_scalar_is_zero(&r[count]) || secp256k1_scalar_is_zero(&s[count])) {
+            continue;
+        }
+        if (!secp256k1_ecdsa_sig_recover_point(&x, &r[count], recid)) {
+            continue;
+        }
+        secp256k1_gej_set_ge(&qj[count], &x);
+        idx[count++] = i;
+    }
+
+    secp256k1_scalar_inverse_all_var(rn, r, count);
+
+    for (k = 0; k < count; k++) {
+        secp256k1_scalar m, u1, u2;
+        secp256k1_gej xj = qj[k];
+        secp256k1_scalar_set_b32(&m, &msgs32[32 * idx[k]], NULL);
+        secp256k1_scalar_mul(&u1, &rn[k], &m);
+        secp256k1_scalar_negate(&u1, &u1);
+        secp256k1_scalar_mul(&u2, &rn[k], &s[k]);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &qj[k], &xj, &u2, &u1);
+        if (!secp256k1_gej_is_infinity(&qj[k])) {
+            z[nz++] = qj[k].z;
+        }
+    }
+
+    secp256k1_fe_inv_all_var(zi, z, nz);
+
+    nz = 0;
+    for (k = 0; k < count; k++) {
+        secp256k1_ge q;
+        if (secp256k1_gej_is_infinity(&qj[k])) {
+            continue;
+        }
+        secp256k1_ge_set_gej_zinv(&q, &qj[k], &zi[nz++]);
+        secp256k1_pubkey_save(&pubkeys[idx[k]], &q);
+        if (valid != NULL) {
+            valid[idx[k] / 8] |= 1 << (idx[k] % 8);
+        }
+    }
+    return nz == n;
+}
+
 int secp256k1_ecdsa_sign_recoverable(const secp256k1_context* ctx, secp256k1_ecdsa_recoverable_signature *signature, const unsigned char *msg32, const unsigned char *seckey, secp256k1_nonce_function noncefp, const void* noncedata) {
     secp256k1_scalar r, s;
     secp256k1_scalar sec, non, msg;
@@ -190,4 +266,163 @@ int secp256k1_ecdsa_recover(const secp256k1_context* ctx, secp256k1_pubkey *pubk
     }
 }
 
+int secp256k1_ecdsa_recover_batch(const secp256k1_context* ctx, secp256k1_pubkey *pubkeys, unsigned char *valid, const secp256k1_ecdsa_recoverable_signature *sigs, const unsigned char *msgs32, size_t n) {
+    size_t i;
+    int ret = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(pubkeys != NULL || n == 0);
+    ARG_CHECK(sigs != NULL || n == 0);
+    ARG_CHECK(msgs32 != NULL || n == 0);
+
+    if (valid != NULL) {
+        memset(valid, 0, (n + 7) / 8);
+    }
+    for (i = 0; i < n; i += SECP256K1_ECDSA_RECOVER_BATCH_SIZE) {
+        size_t chunk = n - i < SECP256K1_ECDSA_RECOVER_BATCH_SIZE ? n - i : SECP256K1_ECDSA_RECOVER_BATCH_SIZE;
+        /* Chunks start at multiples of 8, so the bitmap can be passed on bytewise. */
+        ret &= secp256k1_ecdsa_recover_batch_chunk(ctx, &pubkeys[i], valid != NULL ? &valid[i / 8] : NULL, &sigs[i], &msgs32[32 * i], chunk);
+    }
+    return ret;
+}
+
+/* Checks a single signature the way secp256k1_ecdsa_recoverable_verify_batch does. */
+static int secp256k1_ecdsa_recoverable_verify_single(const secp256k1_context* ctx, const secp256k1_ecdsa_recoverable_signature *sig, const unsigned char *msg32, const secp256k1_pubkey *pk) {
+    secp256k1_scalar r, s, m;
+    secp256k1_ge q;
+    secp256k1_pubkey recovered;
+    int recid;
+
+    secp256k1_ecdsa_recoverable_signature_load(ctx, &r, &s, &recid, sig);
+    if (secp256k1_scalar_is_high(&s)) {
+        return 0;
+    }
+    secp256k1_scalar_set_b32(&m, msg32, NULL);
+    if (!secp256k1_ecdsa_sig_recover(&ctx->ecmult_ctx, &r, &s, &q, &m, recid)) {
+        return 0;
+    }
+    secp256k1_pubkey_save(&recovered, &q);
+    return memcmp(&recovered, pk, sizeof(recovered)) == 0;
+}
+
+/* Checks 0 = -(a1*e1 + ... + au*eu)G + a1*(s1*R1 - r1*P1) + ... + au*(su*Ru - ru*Pu) for
+ * randomizers ai derived from the inputs, where a1 = 1. Returns 0 if it does not hold, if any
+ * signature has no point R or a high s, or if the scratch space is too small. */
+static int secp256k1_ecdsa_recoverable_verify_batch_multi(const secp256k1_context *ctx, secp256k1_scratch *scratch, const secp256k1_ecdsa_recoverable_signature *const *sig, const unsigned char *const *msg32, const secp256k1_pubkey *const *pk, size_t n_sigs) {
+    secp256k1_ecmult_multi_accumulator acc;
+    secp256k1_sha256 sha;
+    unsigned char chacha_seed[32];
+    secp256k1_scalar randomizer_cache[2];
+    secp256k1_scalar g_sc;
+    secp256k1_gej rj;
+    size_t i;
+
+    /* Seed the randomizers with everything that is verified. */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        unsigned char buf[33];
+        size_t buflen = sizeof(buf);
+        secp256k1_sha256_write(&sha, sig[i]->data, 65);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        if (!secp256k1_ec_pubkey_serialize(ctx, buf, &buflen, pk[i], SECP256K1_EC_COMPRESSED)) {
+            return 0;
+        }
+        secp256k1_sha256_write(&sha, buf, buflen);
+    }
+    secp256k1_sha256_finalize(&sha, chacha_seed);
+
+    if (!secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, 2 * n_sigs)) {
+        return 0;
+    }
+    secp256k1_scalar_set_int(&randomizer_cache[0], 1);
+    secp256k1_scalar_clear(&g_sc);
+    for (i = 0; i < n_sigs; i++) {
+        secp256k1_scalar r, s, m, sc;
+        secp256k1_ge rp, pp;
+        int recid;
+        if (i % 2 == 1) {
+            secp256k1_scalar_chacha20(&randomizer_cache[0], &randomizer_cache[1], chacha_seed, i / 2);
+        }
+
+        secp256k1_ecdsa_recoverable_signature_load(ctx, &r, &s, &recid, sig[i]);
+        if (secp256k1_scalar_is_zero(&r) || secp256k1_scalar_is_zero(&s) || secp256k1_scalar_is_high(&s)
+            || !secp256k1_ecdsa_sig_recover_point(&rp, &r, recid)
+            || !secp256k1_pubkey_load(ctx, &pp, pk[i])) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return 0;
+        }
+        secp256k1_scalar_set_b32(&m, msg32[i], NULL);
+        secp256k1_scalar_mul(&m, &m, &randomizer_cache[i % 2]);
+        secp256k1_scalar_add(&g_sc, &g_sc, &m);
+
+        secp256k1_scalar_mul(&sc, &s, &randomizer_cache[i % 2]);
+        if (!secp256k1_ecmult_multi_accumulator_add(&acc, &sc, &rp)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return 0;
+        }
+        secp256k1_scalar_mul(&sc, &r, &randomizer_cache[i % 2]);
+        secp256k1_scalar_negate(&sc, &sc);
+        if (!secp256k1_ecmult_multi_accumulator_add(&acc, &sc, &pp)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return 0;
+        }
+    }
+    secp256k1_scalar_negate(&g_sc, &g_sc);
+    secp256k1_ecmult_multi_accumulator_add_g(&acc, &g_sc);
+    return secp256k1_ecmult_multi_accumulator_finalize(&acc, &rj)
+            && secp256k1_gej_is_infinity(&rj);
+}
+
+int secp256k1_ecdsa_recoverable_verify_batch(const secp256k1_context *ctx, secp256k1_scratch *scratch, unsigned char *valid, const secp256k1_ecdsa_recoverable_signature *const *sig, const unsigned char *const *msg32, const secp256k1_pubkey *const *pk, size_t n_sigs) {
+    size_t i;
+    int ret = 1;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(n_sigs <= SIZE_MAX / 2);
+    ARG_CHECK(n_sigs < (size_t)(1 << 31));
+    if (n_sigs > 0) {
+        ARG_CHECK(sig != NULL);
+        ARG_CHECK(msg32 != NULL);
+        ARG_CHECK(pk != NULL);
+    }
+
+    if (valid != NULL) {
+        memset(valid, 0, (n_sigs + 7) / 8);
+    }
+    if (secp256k1_ecdsa_recoverable_verify_batch_multi(ctx, scratch, sig, msg32, pk, n_sigs)) {
+        for (i = 0; valid != NULL && i < n_sigs; i++) {
+            valid[i / 8] |= 1 << (i % 8);
+        }
+        return 1;
+    }
+    /* Find the invalid signatures, or verify them one by one if the scratch space was too small. */
+    for (i = 0; i < n_sigs; i++) {
+        if (secp256k1_ecdsa_recoverable_verify_single(ctx, sig[i], msg32[i], pk[i])) {
+            if (valid != NULL) {
+                valid[i / 8] |= 1 << (i % 8);
+            }
+        } else {
+            ret = 0;
+            if (valid == NULL) {
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+size_t secp256k1_ecdsa_recoverable_verify_batch_scratch_size(const secp256k1_context *ctx, size_t n_sigs) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n_sigs <= SIZE_MAX / 2);
+    ARG_CHECK(n_sigs < (size_t)(1 << 31));
+
+    if (n_sigs == 0) {
+        return 0;
+    }
+    return secp256k1_ecmult_multi_accumulator_scratch_size(&ctx->ecmult_ctx, 2 * n_sigs);
+}
+
 #endif /* SECP256K1_MODULE_RECOVERY_MAIN_H */
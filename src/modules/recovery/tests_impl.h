@@ -379,6 +379,135 @@ void test_ecdsa_recovery_edge_cases(void) {
     }
 }
 
+#define N_SIGS 70
+/* Recovers a batch of valid and corrupted signatures, and checks that every key is recovered
+ * exactly when secp256k1_ecdsa_recover recovers it. */
+void test_ecdsa_recovery_batch(void) {
+    secp256k1_ecdsa_recoverable_signature sigs[N_SIGS];
+    unsigned char msgs[N_SIGS][32];
+    secp256k1_pubkey pubkeys[N_SIGS];
+    secp256k1_pubkey recpubkey;
+    unsigned char valid[(N_SIGS + 7) / 8];
+    size_t n = secp256k1_rand_int(N_SIGS + 1);
+    size_t i;
+    int ret;
+    int all = 1;
+
+    for (i = 0; i < n; i++) {
+        unsigned char privkey[32];
+        secp256k1_scalar key;
+        do {
+            random_scalar_order_test(&key);
+        } while (secp256k1_scalar_is_zero(&key));
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ecdsa_sign_recoverable(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+        if (secp256k1_rand_int(4) == 0) {
+            /* Corrupt r, s or the recovery id, which leaves a wrong key or none at all. */
+            unsigned char sig[64];
+            int recid;
+            CHECK(secp256k1_ecdsa_recoverable_signature_serialize_compact(ctx, sig, &recid, &sigs[i]) == 1);
+            switch (secp256k1_rand_int(4)) {
+            case 0: memset(sig, 0, 32); break;
+            case 1: memset(sig + 32, 0, 32); break;
+            case 2: sig[secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255); break;
+            default: recid ^= 1 + secp256k1_rand_int(3); break;
+            }
+            CHECK(secp256k1_ecdsa_recoverable_signature_parse_compact(ctx, &sigs[i], sig, recid) == 1);
+        }
+    }
+
+    ret = secp256k1_ecdsa_recover_batch(ctx, pubkeys, valid, sigs, &msgs[0][0], n);
+    for (i = 0; i < n; i++) {
+        int single = secp256k1_ecdsa_recover(ctx, &recpubkey, &sigs[i], msgs[i]);
+        CHECK(((valid[i / 8] >> (i % 8)) & 1) == single);
+        CHECK(memcmp(&pubkeys[i], &recpubkey, sizeof(recpubkey)) == 0);
+        all &= single;
+    }
+    CHECK(ret == all);
+    CHECK(secp256k1_ecdsa_recover_batch(ctx, pubkeys, NULL, sigs, &msgs[0][0], n) == all);
+    CHECK(secp256k1_ecdsa_recover_batch(ctx, NULL, NULL, NULL, NULL, 0) == 1);
+}
+#undef N_SIGS
+
+#define N_SIGS 40
+/* Batch-verifies valid and invalid signatures, and checks the result against verifying them
+ * one at a time. */
+void test_ecdsa_recoverable_verify_batch(void) {
+    secp256k1_ecdsa_recoverable_signature sigs[N_SIGS];
+    unsigned char msgs[N_SIGS][32];
+    secp256k1_pubkey pks[N_SIGS];
+    const secp256k1_ecdsa_recoverable_signature *sig_ptr[N_SIGS];
+    const unsigned char *msg_ptr[N_SIGS];
+    const secp256k1_pubkey *pk_ptr[N_SIGS];
+    unsigned char valid[(N_SIGS + 7) / 8];
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, secp256k1_ecdsa_recoverable_verify_batch_scratch_size(ctx, N_SIGS));
+    secp256k1_scratch_space *tiny = secp256k1_scratch_space_create(ctx, 1);
+    size_t n = secp256k1_rand_int(N_SIGS) + 1;
+    size_t bad = secp256k1_rand_int(n);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        unsigned char privkey[32];
+        secp256k1_scalar key;
+        do {
+            random_scalar_order_test(&key);
+        } while (secp256k1_scalar_is_zero(&key));
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msgs[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pks[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign_recoverable(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+    }
+    for (i = 0; i < N_SIGS; i++) {
+        sig_ptr[i] = &sigs[i];
+        msg_ptr[i] = msgs[i];
+        pk_ptr[i] = &pks[i];
+    }
+
+    CHECK(secp256k1_ecdsa_recoverable_verify_batch(ctx, scratch, valid, sig_ptr, msg_ptr, pk_ptr, n) == 1);
+    for (i = 0; i < n; i++) {
+        CHECK((valid[i / 8] >> (i % 8)) & 1);
+    }
+    CHECK(secp256k1_ecdsa_recoverable_verify_batch(ctx, scratch, NULL, NULL, NULL, NULL, 0) == 1);
+    /* A scratch space that is too small only makes it slower */
+    CHECK(secp256k1_ecdsa_recoverable_verify_batch(ctx, tiny, NULL, sig_ptr, msg_ptr, pk_ptr, n) == 1);
+
+    /* Invalidate one signature in one of several ways */
+    {
+        unsigned char sig[64];
+        int recid;
+        secp256k1_scalar s;
+        CHECK(secp256k1_ecdsa_recoverable_signature_serialize_compact(ctx, sig, &recid, &sigs[bad]) == 1);
+        switch (secp256k1_rand_int(4)) {
+        case 0:
+            /* High s, which recovers the right key */
+            secp256k1_scalar_set_b32(&s, sig + 32, NULL);
+            secp256k1_scalar_negate(&s, &s);
+            secp256k1_scalar_get_b32(sig + 32, &s);
+            recid ^= 1;
+            break;
+        case 1: recid ^= 1 + secp256k1_rand_int(3); break;
+        case 2: msgs[bad][secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255); break;
+        default: sig[secp256k1_rand_int(64)] ^= 1 + secp256k1_rand_int(255); break;
+        }
+        if (secp256k1_ecdsa_recoverable_signature_parse_compact(ctx, &sigs[bad], sig, recid) == 0) {
+            memset(&sigs[bad], 0, sizeof(sigs[bad]));
+        }
+    }
+    CHECK(secp256k1_ecdsa_recoverable_verify_batch(ctx, scratch, valid, sig_ptr, msg_ptr, pk_ptr, n) == 0);
+    for (i = 0; i < n; i++) {
+        CHECK(((valid[i / 8] >> (i % 8)) & 1) == (i != bad));
+    }
+    CHECK(secp256k1_ecdsa_recoverable_verify_batch(ctx, tiny, valid, sig_ptr, msg_ptr, pk_ptr, n) == 0);
+    for (i = 0; i < n; i++) {
+        CHECK(((valid[i / 8] >> (i % 8)) & 1) == (i != bad));
+    }
+
+    secp256k1_scratch_space_destroy(tiny);
+    secp256k1_scratch_space_destroy(scratch);
+}
+#undef N_SIGS
+
 void run_recovery_tests(void) {
     int i;
     for (i = 0; i < count; i++) {
@@ -387,6 +516,10 @@ void run_recovery_tests(void) {
     for (i = 0; i < 64*count; i++) {
         test_ecdsa_recovery_end_to_end();
     }
+    for (i = 0; i < count; i++) {
+        test_ecdsa_recovery_batch();
+        test_ecdsa_recoverable_verify_batch();
+    }
     test_ecdsa_recovery_edge_cases();
 }
 
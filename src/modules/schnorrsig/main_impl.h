@@ -29,38 +29,19 @@ int secp256k1_schnorrsig_parse(const secp256k1_context* ctx, secp256k1_schnorrsi
     return 1;
 }
 
-int secp256k1_schnorrsig_sign(const secp256k1_context* ctx, secp256k1_schnorrsig *sig, int *nonce_is_negated, const unsigned char *msg32, const unsigned char *seckey, secp256k1_nonce_function noncefp, void *ndata) {
-    secp256k1_scalar x;
+/* Signs with the valid secret key x, whose encoding is seckey and whose public key is pk. */
+static int secp256k1_schnorrsig_sign_inner(const secp256k1_context* ctx, secp256k1_schnorrsig *sig, int *nonce_is_negated, const unsigned char *msg32, const secp256k1_scalar *x, const unsigned char *seckey, secp256k1_ge *pk, secp256k1_nonce_function noncefp, void *ndata) {
     secp256k1_scalar e;
     secp256k1_scalar k;
-    secp256k1_gej pkj;
     secp256k1_gej rj;
-    secp256k1_ge pk;
     secp256k1_ge r;
     secp256k1_sha256 sha;
-    int overflow;
     unsigned char buf[33];
     size_t buflen = sizeof(buf);
 
-    VERIFY_CHECK(ctx != NULL);
-    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
-    ARG_CHECK(sig != NULL);
-    ARG_CHECK(msg32 != NULL);
-    ARG_CHECK(seckey != NULL);
-
     if (noncefp == NULL) {
         noncefp = secp256k1_nonce_function_bipschnorr;
     }
-    secp256k1_scalar_set_b32(&x, seckey, &overflow);
-    /* Fail if the secret key is invalid. */
-    if (overflow || secp256k1_scalar_is_zero(&x)) {
-        memset(sig, 0, sizeof(*sig));
-        return 0;
-    }
-
-    secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pkj, &x);
-    secp256k1_ge_set_gej(&pk, &pkj);
-
     if (!noncefp(buf, msg32, seckey, NULL, (void*)ndata, 0)) {
         return 0;
     }
@@ -86,22 +67,62 @@ int secp256k1_schnorrsig_sign(const secp256k1_context* ctx, secp256k1_schnorrsig
 
     secp256k1_sha256_initialize(&sha);
     secp256k1_sha256_write(&sha, &sig->data[0], 32);
-    secp256k1_eckey_pubkey_serialize(&pk, buf, &buflen, 1);
+    secp256k1_eckey_pubkey_serialize(pk, buf, &buflen, 1);
     secp256k1_sha256_write(&sha, buf, buflen);
     secp256k1_sha256_write(&sha, msg32, 32);
     secp256k1_sha256_finalize(&sha, buf);
 
     secp256k1_scalar_set_b32(&e, buf, NULL);
-    secp256k1_scalar_mul(&e, &e, &x);
+    secp256k1_scalar_mul(&e, &e, x);
     secp256k1_scalar_add(&e, &e, &k);
 
     secp256k1_scalar_get_b32(&sig->data[32], &e);
     secp256k1_scalar_clear(&k);
-    secp256k1_scalar_clear(&x);
 
     return 1;
 }
 
+int secp256k1_schnorrsig_sign(const secp256k1_context* ctx, secp256k1_schnorrsig *sig, int *nonce_is_negated, const unsigned char *msg32, const unsigned char *seckey, secp256k1_nonce_function noncefp, void *ndata) {
+    secp256k1_scalar x;
+    secp256k1_gej pkj;
+    secp256k1_ge pk;
+    int overflow;
+    int ret;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(seckey != NULL);
+
+    secp256k1_scalar_set_b32(&x, seckey, &overflow);
+    /* Fail if the secret key is invalid. */
+    if (overflow || secp256k1_scalar_is_zero(&x)) {
+        memset(sig, 0, sizeof(*sig));
+        return 0;
+    }
+
+    secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pkj, &x);
+    secp256k1_ge_set_gej(&pk, &pkj);
+
+    ret = secp256k1_schnorrsig_sign_inner(ctx, sig, nonce_is_negated, msg32, &x, seckey, &pk, noncefp, ndata);
+    secp256k1_scalar_clear(&x);
+    return ret;
+}
+
+int secp256k1_schnorrsig_sign_with_key(const secp256k1_context* ctx, secp256k1_schnorrsig *sig, int *nonce_is_negated, const unsigned char *msg32, const secp256k1_signing_key *key, secp256k1_nonce_function noncefp, void *ndata) {
+    secp256k1_ge pk;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(key != NULL);
+
+    pk = key->pubkey;
+    return secp256k1_schnorrsig_sign_inner(ctx, sig, nonce_is_negated, msg32, &key->sec, key->seckey, &pk, noncefp, ndata);
+}
+
 /* Helper function for verification and batch verification.
  * Computes R = sG - eP. */
 static int secp256k1_schnorrsig_real_verify(const secp256k1_context* ctx, secp256k1_gej *rj, const secp256k1_scalar *s, const secp256k1_scalar *e, const secp256k1_pubkey *pk) {
@@ -163,7 +184,7 @@ int secp256k1_schnorrsig_verify(const secp256k1_context* ctx, const secp256k1_sc
     return 1;
 }
 
-/* Data that is used by the batch verification ecmult callback */
+/* Data that is used to compute the terms of the batch verification multiexp */
 typedef struct {
     const secp256k1_context *ctx;
     /* Seed for the random number generator */
@@ -172,6 +193,9 @@ typedef struct {
      * avoids having to call the PRNG twice as often. The very first randomizer will be set to 1 and
      * the PRNG is called at every odd indexed schnorrsig to fill the cache. */
     secp256k1_scalar randomizer_cache[2];
+    /* Caches the challenges of up to 8 consecutive signatures, which are hashed together as
+     * independent messages. Refilled whenever the first of them is needed. */
+    unsigned char challenge_cache[8][32];
     /* Signature, message, public key tuples to verify */
     const secp256k1_schnorrsig *const *sig;
     const unsigned char *const *msg32;
@@ -179,13 +203,31 @@ typedef struct {
     size_t n_sigs;
 } secp256k1_schnorrsig_verify_ecmult_context;
 
-/* Callback function which is called by ecmult_multi in order to convert the ecmult_context
- * consisting of signature, message and public key tuples into scalars and points. */
-static int secp256k1_schnorrsig_verify_batch_ecmult_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+/* Computes the challenges of signatures i, i+1, ... (up to 8 of them) into the challenge cache. */
+static void secp256k1_schnorrsig_verify_batch_challenges(secp256k1_schnorrsig_verify_ecmult_context *ecmult_context, size_t i) {
+    unsigned char buf[8][32 + 33 + 32];
+    const unsigned char *msgs[8];
+    size_t lens[8];
+    size_t j, n = ecmult_context->n_sigs - i < 8 ? ecmult_context->n_sigs - i : 8;
+
+    for (j = 0; j < n; j++) {
+        size_t buflen = 33;
+        memcpy(&buf[j][0], &ecmult_context->sig[i + j]->data[0], 32);
+        secp256k1_ec_pubkey_serialize(ecmult_context->ctx, &buf[j][32], &buflen, ecmult_context->pk[i + j], SECP256K1_EC_COMPRESSED);
+        memcpy(&buf[j][32 + 33], ecmult_context->msg32[i + j], 32);
+        msgs[j] = buf[j];
+        lens[j] = sizeof(buf[j]);
+    }
+    secp256k1_sha256_multi(ecmult_context->challenge_cache[0], msgs, lens, n);
+}
+
+/* Converts the ecmult_context consisting of signature, message and public key tuples into the
+ * idx-th (scalar, point) pair of the multiexp. Must be called for consecutive indices. */
+static int secp256k1_schnorrsig_verify_batch_term(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
     secp256k1_schnorrsig_verify_ecmult_context *ecmult_context = (secp256k1_schnorrsig_verify_ecmult_context *) data;
 
     if (idx % 4 == 2) {
-        /* Every idx corresponds to a (scalar,point)-tuple. So this callback is called with 4
+        /* Every idx corresponds to a (scalar,point)-tuple. So this function is called with 4
          * consecutive tuples before we need to call the RNG for new randomizers:
          * (-randomizer_cache[0], R1)
          * (-randomizer_cache[0]*e1, P1)
@@ -206,17 +248,10 @@ static int secp256k1_schnorrsig_verify_batch_ecmult_callback(secp256k1_scalar *s
         }
     /* eP */
     } else {
-        unsigned char buf[33];
-        size_t buflen = sizeof(buf);
-        secp256k1_sha256 sha;
-        secp256k1_sha256_initialize(&sha);
-        secp256k1_sha256_write(&sha, &ecmult_context->sig[idx / 2]->data[0], 32);
-        secp256k1_ec_pubkey_serialize(ecmult_context->ctx, buf, &buflen, ecmult_context->pk[idx / 2], SECP256K1_EC_COMPRESSED);
-        secp256k1_sha256_write(&sha, buf, buflen);
-        secp256k1_sha256_write(&sha, ecmult_context->msg32[idx / 2], 32);
-        secp256k1_sha256_finalize(&sha, buf);
-
-        secp256k1_scalar_set_b32(sc, buf, NULL);
+        if ((idx / 2) % 8 == 0) {
+            secp256k1_schnorrsig_verify_batch_challenges(ecmult_context, idx / 2);
+        }
+        secp256k1_scalar_set_b32(sc, ecmult_context->challenge_cache[(idx / 2) % 8], NULL);
         secp256k1_scalar_mul(sc, sc, &ecmult_context->randomizer_cache[(idx / 2) % 2]);
 
         if (!secp256k1_pubkey_load(ecmult_context->ctx, pt, ecmult_context->pk[idx / 2])) {
@@ -232,7 +267,7 @@ static int secp256k1_schnorrsig_verify_batch_ecmult_callback(secp256k1_scalar *s
  *  Returns 1 if the randomizer was successfully initialized.
  *
  *  Args:    ctx: a secp256k1 context object
- *  Out: ecmult_context: context for batch_ecmult_callback
+ *  Out: ecmult_context: context for secp256k1_schnorrsig_verify_batch_term
  *  In/Out   sha: an initialized sha256 object which hashes the schnorrsig input in order to get a
  *                seed for the randomizer PRNG
  *  In:      sig: array of signatures, or NULL if there are no signatures
@@ -304,9 +339,11 @@ int secp256k1_schnorrsig_verify_batch_sum_s(secp256k1_scalar *s, unsigned char *
  * 0 != -(s1 + a2*s2 + ... + au*su)G + R1 + a2*R2 + ... + au*Ru + e1*P1 + (a2*e2)P2 + ... + (au*eu)Pu. */
 int secp256k1_schnorrsig_verify_batch(const secp256k1_context *ctx, secp256k1_scratch *scratch, const secp256k1_schnorrsig *const *sig, const unsigned char *const *msg32, const secp256k1_pubkey *const *pk, size_t n_sigs) {
     secp256k1_schnorrsig_verify_ecmult_context ecmult_context;
+    secp256k1_ecmult_multi_accumulator acc;
     secp256k1_sha256 sha;
     secp256k1_scalar s;
     secp256k1_gej rj;
+    size_t i;
 
     VERIFY_CHECK(ctx != NULL);
     ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
@@ -330,9 +367,305 @@ int secp256k1_schnorrsig_verify_batch(const secp256k1_context *ctx, secp256k1_sc
         return 0;
     }
     secp256k1_scalar_negate(&s, &s);
+    if (n_sigs == 0) {
+        return 1;
+    }
 
-    return secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &rj, &s, secp256k1_schnorrsig_verify_batch_ecmult_callback, (void *) &ecmult_context, 2 * n_sigs)
+    /* Hash and decompress everything in a separate pass, so that the multiexp reads its
+     * inputs from the accumulator's arrays rather than calling back for every point. */
+    if (!secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, 2 * n_sigs)) {
+        return 0;
+    }
+    secp256k1_ecmult_multi_accumulator_add_g(&acc, &s);
+    for (i = 0; i < 2 * n_sigs; i++) {
+        secp256k1_scalar sc;
+        secp256k1_ge pt;
+        if (!secp256k1_schnorrsig_verify_batch_term(&sc, &pt, i, &ecmult_context)
+            || !secp256k1_ecmult_multi_accumulator_add(&acc, &sc, &pt)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return 0;
+        }
+    }
+    return secp256k1_ecmult_multi_accumulator_finalize(&acc, &rj)
             && secp256k1_gej_is_infinity(&rj);
 }
 
+size_t secp256k1_schnorrsig_verify_batch_scratch_size(const secp256k1_context *ctx, size_t n_sigs) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n_sigs <= SIZE_MAX / 2);
+    ARG_CHECK(n_sigs < (size_t)(1 << 31));
+
+    if (n_sigs == 0) {
+        return 0;
+    }
+    return secp256k1_ecmult_multi_accumulator_scratch_size(&ctx->ecmult_ctx, 2 * n_sigs);
+}
+
+/* A signature in a batch verifier, with everything that does not depend on the other
+ * signatures already computed. */
+typedef struct {
+    secp256k1_scalar s;
+    secp256k1_scalar e;
+    secp256k1_ge r;
+    secp256k1_ge pk;
+    /* Randomizer, set when the batch is finalized */
+    secp256k1_scalar a;
+    /* Whether the signature could be parsed */
+    int parsed;
+} secp256k1_schnorrsig_batch_entry;
+
+struct secp256k1_schnorrsig_batch_struct {
+    secp256k1_schnorrsig_batch_entry *entries;
+    size_t n;
+    size_t capacity;
+    /* Hashes the inputs as they are added, to seed the randomizers */
+    secp256k1_sha256 sha;
+};
+
+secp256k1_schnorrsig_batch* secp256k1_schnorrsig_batch_create(const secp256k1_context* ctx, size_t capacity) {
+    secp256k1_schnorrsig_batch *ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(capacity <= SIZE_MAX / 2);
+    ARG_CHECK(capacity < (size_t)(1 << 31));
+    ARG_CHECK(capacity <= SIZE_MAX / sizeof(secp256k1_schnorrsig_batch_entry));
+
+    ret = (secp256k1_schnorrsig_batch *)checked_malloc(&ctx->error_callback, sizeof(*ret));
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret->entries = (secp256k1_schnorrsig_batch_entry *)checked_malloc(&ctx->error_callback, capacity * sizeof(*ret->entries));
+    if (ret->entries == NULL && capacity > 0) {
+        free(ret);
+        return NULL;
+    }
+    ret->n = 0;
+    ret->capacity = capacity;
+    secp256k1_sha256_initialize(&ret->sha);
+    return ret;
+}
+
+int secp256k1_schnorrsig_batch_add(const secp256k1_context* ctx, secp256k1_schnorrsig_batch* batch, const secp256k1_schnorrsig* sig, const unsigned char* msg32, const secp256k1_pubkey* pk) {
+    secp256k1_schnorrsig_batch_entry *entry;
+    secp256k1_sha256 sha;
+    secp256k1_fe rx;
+    unsigned char buf[33];
+    size_t buflen = sizeof(buf);
+    int overflow;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(batch != NULL);
+    ARG_CHECK(sig != NULL);
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(pk != NULL);
+
+    if (batch->n == batch->capacity) {
+        return 0;
+    }
+    entry = &batch->entries[batch->n];
+    if (!secp256k1_pubkey_load(ctx, &entry->pk, pk)) {
+        return 0;
+    }
+    batch->n++;
+
+    secp256k1_eckey_pubkey_serialize(&entry->pk, buf, &buflen, 1);
+    secp256k1_sha256_write(&batch->sha, sig->data, 64);
+    secp256k1_sha256_write(&batch->sha, msg32, 32);
+    secp256k1_sha256_write(&batch->sha, buf, buflen);
+
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, &sig->data[0], 32);
+    secp256k1_sha256_write(&sha, buf, buflen);
+    secp256k1_sha256_write(&sha, msg32, 32);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(&entry->e, buf, NULL);
+
+    secp256k1_scalar_set_b32(&entry->s, &sig->data[32], &overflow);
+    entry->parsed = !overflow
+        && secp256k1_fe_set_b32(&rx, &sig->data[0])
+        && secp256k1_ge_set_xquad(&entry->r, &rx);
+    return 1;
+}
+
+/* Returns 1 if the parsed signatures among entries[lo..hi) verify together, 0 if they do not,
+ * and -1 if the multiexp could not be computed, e.g. because the scratch space is too small. */
+static int secp256k1_schnorrsig_batch_verify_range(const secp256k1_context *ctx, secp256k1_scratch *scratch, const secp256k1_schnorrsig_batch *batch, size_t lo, size_t hi) {
+    secp256k1_ecmult_multi_accumulator acc;
+    secp256k1_scalar s;
+    secp256k1_gej rj;
+    size_t i, n_points = 0;
+
+    secp256k1_scalar_clear(&s);
+    for (i = lo; i < hi; i++) {
+        const secp256k1_schnorrsig_batch_entry *entry = &batch->entries[i];
+        secp256k1_scalar term;
+        if (!entry->parsed) {
+            continue;
+        }
+        secp256k1_scalar_mul(&term, &entry->s, &entry->a);
+        secp256k1_scalar_add(&s, &s, &term);
+        n_points += 2;
+    }
+    if (n_points == 0) {
+        return 1;
+    }
+    secp256k1_scalar_negate(&s, &s);
+
+    if (!secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, n_points)) {
+        return -1;
+    }
+    secp256k1_ecmult_multi_accumulator_add_g(&acc, &s);
+    for (i = lo; i < hi; i++) {
+        const secp256k1_schnorrsig_batch_entry *entry = &batch->entries[i];
+        secp256k1_scalar ae;
+        if (!entry->parsed) {
+            continue;
+        }
+        secp256k1_scalar_mul(&ae, &entry->e, &entry->a);
+        if (!secp256k1_ecmult_multi_accumulator_add(&acc, &entry->a, &entry->r)
+            || !secp256k1_ecmult_multi_accumulator_add(&acc, &ae, &entry->pk)) {
+            secp256k1_ecmult_multi_accumulator_clear(&acc);
+            return -1;
+        }
+    }
+    if (!secp256k1_ecmult_multi_accumulator_finalize(&acc, &rj)) {
+        return -1;
+    }
+    return secp256k1_gej_is_infinity(&rj);
+}
+
+/* Sets the bits in `valid` of the parsed signatures among entries[lo..hi). */
+static void secp256k1_schnorrsig_batch_set_valid(const secp256k1_schnorrsig_batch *batch, size_t lo, size_t hi, unsigned char *valid) {
+    size_t i;
+    for (i = lo; i < hi; i++) {
+        if (batch->entries[i].parsed) {
+            valid[i / 8] |= 1 << (i % 8);
+        }
+    }
+}
+
+/* Verifies the signatures entries[lo..hi) one at a time without a scratch space, like
+ * secp256k1_schnorrsig_verify does, and sets the bits of the valid ones in `valid` if it is
+ * non-NULL. Returns whether all of them are valid. */
+static int secp256k1_schnorrsig_batch_verify_each(const secp256k1_context *ctx, const secp256k1_schnorrsig_batch *batch, size_t lo, size_t hi, unsigned char *valid) {
+    size_t i;
+    int ret = 1;
+
+    for (i = lo; i < hi; i++) {
+        const secp256k1_schnorrsig_batch_entry *entry = &batch->entries[i];
+        secp256k1_scalar nege;
+        secp256k1_gej pkj;
+        secp256k1_gej rj;
+
+        if (!entry->parsed) {
+            ret = 0;
+            continue;
+        }
+        /* rj = s*G + (-e)*pk */
+        secp256k1_scalar_negate(&nege, &entry->e);
+        secp256k1_gej_set_ge(&pkj, &entry->pk);
+        secp256k1_ecmult(&ctx->ecmult_ctx, &rj, &pkj, &nege, &entry->s);
+        if (!secp256k1_gej_has_quad_y_var(&rj) /* fails if rj is infinity */
+            || !secp256k1_gej_eq_x_var(&entry->r.x, &rj)) {
+            ret = 0;
+            if (valid == NULL) {
+                break;
+            }
+            continue;
+        }
+        if (valid != NULL) {
+            valid[i / 8] |= 1 << (i % 8);
+        }
+    }
+    return ret;
+}
+
+/* Given that the signatures entries[lo..hi) do not verify together, finds the valid ones among
+ * them by recursive bisection and sets their bits in `valid`. Whenever the left half of a range
+ * verifies the right half is known to be bad and need not be checked, so identifying `k` bad
+ * signatures out of `n` takes O(k log n) multiexps. A half for which no multiexp can be computed
+ * is verified one signature at a time instead. */
+static void secp256k1_schnorrsig_batch_bisect(const secp256k1_context *ctx, secp256k1_scratch *scratch, const secp256k1_schnorrsig_batch *batch, size_t lo, size_t hi, unsigned char *valid) {
+    size_t mid;
+    int ret;
+
+    if (hi - lo == 1) {
+        return;
+    }
+    mid = lo + (hi - lo) / 2;
+    ret = secp256k1_schnorrsig_batch_verify_range(ctx, scratch, batch, lo, mid);
+    if (ret == 1) {
+        secp256k1_schnorrsig_batch_set_valid(batch, lo, mid, valid);
+    } else {
+        if (ret == 0) {
+            secp256k1_schnorrsig_batch_bisect(ctx, scratch, batch, lo, mid, valid);
+        } else {
+            secp256k1_schnorrsig_batch_verify_each(ctx, batch, lo, mid, valid);
+        }
+        ret = secp256k1_schnorrsig_batch_verify_range(ctx, scratch, batch, mid, hi);
+        if (ret == 1) {
+            secp256k1_schnorrsig_batch_set_valid(batch, mid, hi, valid);
+            return;
+        } else if (ret < 0) {
+            secp256k1_schnorrsig_batch_verify_each(ctx, batch, mid, hi, valid);
+            return;
+        }
+    }
+    secp256k1_schnorrsig_batch_bisect(ctx, scratch, batch, mid, hi, valid);
+}
+
+int secp256k1_schnorrsig_batch_finalize(const secp256k1_context* ctx, secp256k1_scratch_space* scratch, secp256k1_schnorrsig_batch* batch, unsigned char* valid) {
+    unsigned char chacha_seed[32];
+    secp256k1_scalar randomizer_cache[2];
+    size_t i;
+    int ret = 1;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+    ARG_CHECK(batch != NULL);
+
+    /* Derive the randomizers like secp256k1_schnorrsig_verify_batch, the first one being 1. */
+    secp256k1_sha256_finalize(&batch->sha, chacha_seed);
+    secp256k1_scalar_set_int(&randomizer_cache[0], 1);
+    for (i = 0; i < batch->n; i++) {
+        if (i % 2 == 1) {
+            secp256k1_scalar_chacha20(&randomizer_cache[0], &randomizer_cache[1], chacha_seed, i / 2);
+        }
+        batch->entries[i].a = randomizer_cache[i % 2];
+        ret &= batch->entries[i].parsed;
+    }
+
+    if (valid != NULL) {
+        memset(valid, 0, (batch->n + 7) / 8);
+    }
+    if (batch->n > 0) {
+        int verified = secp256k1_schnorrsig_batch_verify_range(ctx, scratch, batch, 0, batch->n);
+        if (verified == 1) {
+            if (valid != NULL) {
+                secp256k1_schnorrsig_batch_set_valid(batch, 0, batch->n, valid);
+            }
+        } else if (verified < 0) {
+            ret = secp256k1_schnorrsig_batch_verify_each(ctx, batch, 0, batch->n, valid);
+        } else {
+            ret = 0;
+            if (valid != NULL) {
+                secp256k1_schnorrsig_batch_bisect(ctx, scratch, batch, 0, batch->n, valid);
+            }
+        }
+    }
+
+    batch->n = 0;
+    secp256k1_sha256_initialize(&batch->sha);
+    return ret;
+}
+
+void secp256k1_schnorrsig_batch_destroy(secp256k1_schnorrsig_batch* batch) {
+    if (batch != NULL) {
+        free(batch->entries);
+        free(batch);
+    }
+}
+
 #endif
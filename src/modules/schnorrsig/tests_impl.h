@@ -636,7 +636,9 @@ static int nonce_function_0(unsigned char *nonce32, const unsigned char *msg32,
 void test_schnorrsig_sign(void) {
     unsigned char sk[32];
     const unsigned char msg[32] = "this is a msg for a schnorrsig..";
-    secp256k1_schnorrsig sig;
+    secp256k1_schnorrsig sig, sig2;
+    secp256k1_signing_key *key;
+    int negated, negated2;
 
     memset(sk, 23, sizeof(sk));
     CHECK(secp256k1_schnorrsig_sign(ctx, &sig, NULL, msg, sk, NULL, NULL) == 1);
@@ -648,6 +650,17 @@ void test_schnorrsig_sign(void) {
 
     CHECK(secp256k1_schnorrsig_sign(ctx, &sig, NULL, msg, sk, nonce_function_failing, NULL) == 0);
     CHECK(secp256k1_schnorrsig_sign(ctx, &sig, NULL, msg, sk, nonce_function_0, NULL) == 0);
+
+    /* Signing with a prepared key gives the same signature */
+    key = secp256k1_signing_key_create(ctx, sk);
+    CHECK(key != NULL);
+    CHECK(secp256k1_schnorrsig_sign(ctx, &sig, &negated, msg, sk, NULL, NULL) == 1);
+    CHECK(secp256k1_schnorrsig_sign_with_key(ctx, &sig2, &negated2, msg, key, NULL, NULL) == 1);
+    CHECK(memcmp(&sig, &sig2, sizeof(sig)) == 0);
+    CHECK(negated == negated2);
+    CHECK(secp256k1_schnorrsig_sign_with_key(ctx, &sig2, NULL, msg, key, nonce_function_failing, NULL) == 0);
+    CHECK(secp256k1_schnorrsig_sign_with_key(ctx, &sig2, NULL, msg, key, nonce_function_0, NULL) == 0);
+    secp256k1_signing_key_destroy(key);
 }
 
 #define N_SIGS  200
@@ -681,6 +694,17 @@ void test_schnorrsig_sign_verify(secp256k1_scratch_space *scratch) {
     CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_arr, msg_arr, pk_arr, 4));
     CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_arr, msg_arr, pk_arr, N_SIGS));
 
+    {
+        /* A scratch space of the advertised size fits the whole batch */
+        size_t size = secp256k1_schnorrsig_verify_batch_scratch_size(ctx, N_SIGS);
+        secp256k1_scratch_space *exact = secp256k1_scratch_space_create(ctx, size);
+        CHECK(secp256k1_schnorrsig_verify_batch_scratch_size(ctx, 0) == 0);
+        CHECK(size > 0 && size < secp256k1_schnorrsig_verify_batch_scratch_size(ctx, 2 * N_SIGS));
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, exact, sig_arr, msg_arr, pk_arr, N_SIGS));
+        CHECK(secp256k1_scratch_space_high_water_mark(exact) <= size);
+        secp256k1_scratch_space_destroy(exact);
+    }
+
     {
         /* Flip a few bits in the signature and in the message and check that
          * verify and verify_batch fail */
@@ -711,7 +735,99 @@ void test_schnorrsig_sign_verify(secp256k1_scratch_space *scratch) {
 }
 #undef N_SIGS
 
+#define N_SIGS  50
+/* Adds valid and invalid signatures to a batch verifier and checks that exactly the invalid ones
+ * are reported, as by verifying them one at a time. */
+void test_schnorrsig_batch(secp256k1_scratch_space *scratch) {
+    const unsigned char sk[32] = "shhhhhhhh! this key is a secret.";
+    unsigned char msg[N_SIGS][32];
+    secp256k1_schnorrsig sig[N_SIGS];
+    unsigned char valid[(N_SIGS + 7) / 8];
+    secp256k1_pubkey pk;
+    secp256k1_pubkey invalid_pk;
+    secp256k1_schnorrsig_batch *batch = secp256k1_schnorrsig_batch_create(ctx, N_SIGS);
+    secp256k1_scratch_space *tiny = secp256k1_scratch_space_create(ctx, 1);
+    size_t n = secp256k1_rand_int(N_SIGS) + 1;
+    size_t i;
+    int ret;
+    int all = 1;
+    int32_t ecount = 0;
+
+    CHECK(batch != NULL);
+    CHECK(secp256k1_ec_pubkey_create(ctx, &pk, sk));
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, scratch, batch, NULL) == 1);
+
+    for (i = 0; i < N_SIGS; i++) {
+        secp256k1_rand256(msg[i]);
+        CHECK(secp256k1_schnorrsig_sign(ctx, &sig[i], NULL, msg[i], sk, NULL, NULL));
+        CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[i], msg[i], &pk) == 1);
+    }
+    CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[0], msg[0], &pk) == 0);
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, scratch, batch, valid) == 1);
+    for (i = 0; i < N_SIGS; i++) {
+        CHECK((valid[i / 8] >> (i % 8)) & 1);
+    }
+
+    /* An invalid public key is an illegal argument and is not added */
+    memset(&invalid_pk, 0, sizeof(invalid_pk));
+    secp256k1_context_set_illegal_callback(ctx, counting_illegal_callback_fn, &ecount);
+    CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[0], msg[0], &invalid_pk) == 0);
+    CHECK(ecount == 1);
+    secp256k1_context_set_illegal_callback(ctx, NULL, NULL);
+    CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[0], msg[0], &pk) == 1);
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, scratch, batch, valid) == 1);
+    CHECK(valid[0] == 1);
+
+    /* Invalidate a few signatures: wrong s, message or R, and R or s that do not parse */
+    for (i = 0; i < n; i++) {
+        if (secp256k1_rand_int(8) == 0) {
+            switch (secp256k1_rand_int(5)) {
+            case 0: sig[i].data[32 + secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255); break;
+            case 1: msg[i][secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255); break;
+            case 2: sig[i].data[secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255); break;
+            case 3: memset(&sig[i].data[0], 0xFF, 32); break;
+            default: memset(&sig[i].data[32], 0xFF, 32); break;
+            }
+        }
+        CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[i], msg[i], &pk) == 1);
+    }
+    ret = secp256k1_schnorrsig_batch_finalize(ctx, scratch, batch, valid);
+    for (i = 0; i < n; i++) {
+        int single = secp256k1_schnorrsig_verify(ctx, &sig[i], msg[i], &pk);
+        CHECK(((valid[i / 8] >> (i % 8)) & 1) == single);
+        all &= single;
+    }
+    CHECK(ret == all);
+    for (i = 0; i < n; i++) {
+        CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[i], msg[i], &pk) == 1);
+    }
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, scratch, batch, NULL) == all);
+
+    /* Without room for a multiexp the signatures are verified one at a time */
+    for (i = 0; i < n; i++) {
+        CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[i], msg[i], &pk) == 1);
+    }
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, tiny, batch, valid) == all);
+    for (i = 0; i < n; i++) {
+        CHECK(((valid[i / 8] >> (i % 8)) & 1) == secp256k1_schnorrsig_verify(ctx, &sig[i], msg[i], &pk));
+    }
+    for (i = 0; i < n; i++) {
+        CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[i], msg[i], &pk) == 1);
+    }
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, tiny, batch, NULL) == all);
+    CHECK(secp256k1_schnorrsig_sign(ctx, &sig[0], NULL, msg[0], sk, NULL, NULL));
+    CHECK(secp256k1_schnorrsig_batch_add(ctx, batch, &sig[0], msg[0], &pk) == 1);
+    CHECK(secp256k1_schnorrsig_batch_finalize(ctx, tiny, batch, valid) == 1);
+    CHECK(valid[0] == 1);
+
+    secp256k1_scratch_space_destroy(tiny);
+    secp256k1_schnorrsig_batch_destroy(batch);
+    secp256k1_schnorrsig_batch_destroy(NULL);
+}
+#undef N_SIGS
+
 void run_schnorrsig_tests(void) {
+    int i;
     secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1024 * 1024);
 
     test_schnorrsig_serialize();
@@ -719,6 +835,9 @@ void run_schnorrsig_tests(void) {
     test_schnorrsig_bip_vectors(scratch);
     test_schnorrsig_sign();
     test_schnorrsig_sign_verify(scratch);
+    for (i = 0; i < count; i++) {
+        test_schnorrsig_batch(scratch);
+    }
 
     secp256k1_scratch_space_destroy(scratch);
 }
@@ -7,6 +7,8 @@
 #ifndef SECP256K1_SCALAR_REPR_IMPL_H
 #define SECP256K1_SCALAR_REPR_IMPL_H
 
+#include "cpu.h"
+#include "modinv64_impl.h"
 #include "scalar.h"
 #include <string.h>
 
@@ -586,9 +588,95 @@ static void secp256k1_scalar_reduce_512(secp256k1_scalar *r, const uint64_t *l)
     secp256k1_scalar_reduce(r, c + secp256k1_scalar_check_overflow(r));
 }
 
+#ifdef USE_ASM_X86_64_ADX
+/* Row by row schoolbook multiplication. MULX leaves the flags alone, so the
+ * low halves of each row's products are added on the carry flag chain
+ * (ADCX) while the high halves are added on the overflow flag chain (ADOX).
+ * May only be called if secp256k1_cpu_has_adx() returns 1. */
+static void secp256k1_scalar_mul_512_adx(uint64_t l[8], const secp256k1_scalar *a, const secp256k1_scalar *b) {
+    __asm__ __volatile__(
+    /* Clear CF and OF; rax stays zero */
+    "xorl %%eax, %%eax\n"
+    /* (l0..l4) = a0 * b */
+    "movq 0(%%rdi), %%rdx\n"
+    "mulxq 0(%%rcx), %%r8, %%r9\n"
+    "mulxq 8(%%rcx), %%r13, %%r10\n"
+    "adcxq %%r13, %%r9\n"
+    "mulxq 16(%%rcx), %%r13, %%r11\n"
+    "adcxq %%r13, %%r10\n"
+    "mulxq 24(%%rcx), %%r13, %%r12\n"
+    "adcxq %%r13, %%r11\n"
+    "adcxq %%rax, %%r12\n"
+    "movq %%r8, 0(%%rsi)\n"
+    /* (l1..l5) += a1 * b, low halves on the CF chain and high halves on the OF chain */
+    "movq 8(%%rdi), %%rdx\n"
+    "mulxq 0(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r9\n"
+    "adoxq %%r14, %%r10\n"
+    "mulxq 8(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r10\n"
+    "adoxq %%r14, %%r11\n"
+    "mulxq 16(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r11\n"
+    "adoxq %%r14, %%r12\n"
+    "mulxq 24(%%rcx), %%r13, %%r8\n"
+    "adcxq %%r13, %%r12\n"
+    "adoxq %%rax, %%r8\n"
+    "adcxq %%rax, %%r8\n"
+    "movq %%r9, 8(%%rsi)\n"
+    /* (l2..l6) += a2 * b, low halves on the CF chain and high halves on the OF chain */
+    "movq 16(%%rdi), %%rdx\n"
+    "mulxq 0(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r10\n"
+    "adoxq %%r14, %%r11\n"
+    "mulxq 8(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r11\n"
+    "adoxq %%r14, %%r12\n"
+    "mulxq 16(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r12\n"
+    "adoxq %%r14, %%r8\n"
+    "mulxq 24(%%rcx), %%r13, %%r9\n"
+    "adcxq %%r13, %%r8\n"
+    "adoxq %%rax, %%r9\n"
+    "adcxq %%rax, %%r9\n"
+    "movq %%r10, 16(%%rsi)\n"
+    /* (l3..l7) += a3 * b, low halves on the CF chain and high halves on the OF chain */
+    "movq 24(%%rdi), %%rdx\n"
+    "mulxq 0(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r11\n"
+    "adoxq %%r14, %%r12\n"
+    "mulxq 8(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r12\n"
+    "adoxq %%r14, %%r8\n"
+    "mulxq 16(%%rcx), %%r13, %%r14\n"
+    "adcxq %%r13, %%r8\n"
+    "adoxq %%r14, %%r9\n"
+    "mulxq 24(%%rcx), %%r13, %%r10\n"
+    "adcxq %%r13, %%r9\n"
+    "adoxq %%rax, %%r10\n"
+    "adcxq %%rax, %%r10\n"
+    "movq %%r11, 24(%%rsi)\n"
+    /* Extract l4..l7 */
+    "movq %%r12, 32(%%rsi)\n"
+    "movq %%r8, 40(%%rsi)\n"
+    "movq %%r9, 48(%%rsi)\n"
+    "movq %%r10, 56(%%rsi)\n"
+
+    :
+    : "S"(l), "D"(a->d), "c"(b->d)
+    : "rax", "rdx", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "cc", "memory");
+}
+#endif
+
 static void secp256k1_scalar_mul_512(uint64_t l[8], const secp256k1_scalar *a, const secp256k1_scalar *b) {
 #ifdef USE_ASM_X86_64
     const uint64_t *pb = b->d;
+#ifdef USE_ASM_X86_64_ADX
+    if (secp256k1_cpu_has_adx()) {
+        secp256k1_scalar_mul_512_adx(l, a, b);
+        return;
+    }
+#endif
     __asm__ __volatile__(
     /* Preload */
     "movq 0(%%rdi), %%r15\n"
@@ -1046,4 +1134,71 @@ static void secp256k1_scalar_chacha20(secp256k1_scalar *r1, secp256k1_scalar *r2
 #undef BE32
 #undef LE32
 
+static void secp256k1_scalar_from_signed62(secp256k1_scalar *r, const secp256k1_modinv64_signed62 *a) {
+    const uint64_t a0 = a->v[0], a1 = a->v[1], a2 = a->v[2], a3 = a->v[3], a4 = a->v[4];
+
+    /* The output from secp256k1_modinv64{_var} should be normalized to range [0,modulus), and
+     * have limbs in [0,2^62). The modulus is < 2^256, so the top limb must be below 2^(256-62*4).
+     */
+    VERIFY_CHECK(a0 >> 62 == 0);
+    VERIFY_CHECK(a1 >> 62 == 0);
+    VERIFY_CHECK(a2 >> 62 == 0);
+    VERIFY_CHECK(a3 >> 62 == 0);
+    VERIFY_CHECK(a4 >> 8 == 0);
+
+    r->d[0] = a0      | a1 << 62;
+    r->d[1] = a1 >> 2 | a2 << 60;
+    r->d[2] = a2 >> 4 | a3 << 58;
+    r->d[3] = a3 >> 6 | a4 << 56;
+
+    VERIFY_CHECK(secp256k1_scalar_check_overflow(r) == 0);
+}
+
+static void secp256k1_scalar_to_signed62(secp256k1_modinv64_signed62 *r, const secp256k1_scalar *a) {
+    const uint64_t M62 = UINT64_MAX >> 2;
+    const uint64_t a0 = a->d[0], a1 = a->d[1], a2 = a->d[2], a3 = a->d[3];
+
+    VERIFY_CHECK(secp256k1_scalar_check_overflow(a) == 0);
+
+    r->v[0] =  a0                   & M62;
+    r->v[1] = (a0 >> 62 | a1 <<  2) & M62;
+    r->v[2] = (a1 >> 60 | a2 <<  4) & M62;
+    r->v[3] = (a2 >> 58 | a3 <<  6) & M62;
+    r->v[4] =  a3 >> 56;
+}
+
+/* The group order n in signed62 notation, and n^-1 mod 2^62. */
+static const secp256k1_modinv64_modinfo secp256k1_const_modinfo_scalar = {
+    {{-0x2DA1732FC9BEBFLL, -0x15448C6542DD7F11LL, -0x14LL, 0, 256}},
+    0x34F20099AA774EC1LL
+};
+
+static void secp256k1_scalar_inverse(secp256k1_scalar *r, const secp256k1_scalar *x) {
+    secp256k1_modinv64_signed62 s;
+#ifdef VERIFY
+    int zero_in = secp256k1_scalar_is_zero(x);
+#endif
+    secp256k1_scalar_to_signed62(&s, x);
+    secp256k1_modinv64(&s, &secp256k1_const_modinfo_scalar);
+    secp256k1_scalar_from_signed62(r, &s);
+
+#ifdef VERIFY
+    VERIFY_CHECK(secp256k1_scalar_is_zero(r) == zero_in);
+#endif
+}
+
+static void secp256k1_scalar_inverse_var(secp256k1_scalar *r, const secp256k1_scalar *x) {
+    secp256k1_modinv64_signed62 s;
+#ifdef VERIFY
+    int zero_in = secp256k1_scalar_is_zero(x);
+#endif
+    secp256k1_scalar_to_signed62(&s, x);
+    secp256k1_modinv64_var(&s, &secp256k1_const_modinfo_scalar);
+    secp256k1_scalar_from_signed62(r, &s);
+
+#ifdef VERIFY
+    VERIFY_CHECK(secp256k1_scalar_is_zero(r) == zero_in);
+#endif
+}
+
 #endif /* SECP256K1_SCALAR_REPR_IMPL_H */
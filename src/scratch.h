@@ -7,15 +7,35 @@
 #ifndef _SECP256K1_SCRATCH_
 #define _SECP256K1_SCRATCH_
 
-#define SECP256K1_SCRATCH_MAX_FRAMES	5
+/* A block of memory the scratch space carves its frames from. The chunks of a
+ * scratch space form a list and are kept for later frames. Once the last frame
+ * is popped they are merged into a single chunk that fits the budget. */
+typedef struct secp256k1_scratch_chunk_struct {
+    struct secp256k1_scratch_chunk_struct *next;
+    /* Number of bytes available after the (aligned) chunk header */
+    size_t size;
+} secp256k1_scratch_chunk;
+
+/* Header in front of every stack frame, inside the chunk holding the frame */
+typedef struct secp256k1_scratch_frame_struct {
+    struct secp256k1_scratch_frame_struct *prev;
+    secp256k1_scratch_chunk *chunk;
+    size_t size;
+    size_t offset;
+} secp256k1_scratch_frame;
 
 /* The typedef is used internally; the struct name is used in the public API
  * (where it is exposed as a different typedef) */
 typedef struct secp256k1_scratch_space_struct {
-    void *data[SECP256K1_SCRATCH_MAX_FRAMES];
-    size_t offset[SECP256K1_SCRATCH_MAX_FRAMES];
-    size_t frame_size[SECP256K1_SCRATCH_MAX_FRAMES];
+    secp256k1_scratch_chunk *chunks;
+    secp256k1_scratch_frame *top;
     size_t frame;
+    /* Sum of the sizes of all frames, which may not exceed max_size */
+    size_t allocated;
+    /* Largest value `allocated` has reached */
+    size_t high_water_mark;
+    /* Largest value `frame` has reached */
+    size_t max_frames;
     size_t max_size;
     const secp256k1_callback* error_callback;
 } secp256k1_scratch;
@@ -24,15 +44,25 @@ static secp256k1_scratch* secp256k1_scratch_create(const secp256k1_callback* err
 
 static void secp256k1_scratch_destroy(secp256k1_scratch* scratch);
 
-/** Attempts to allocate a new stack frame with `n` available bytes. Returns 1 on success, 0 on failure */
+/** Attempts to allocate a new stack frame with `n` available bytes. Memory is taken from the
+ *  chunks of the scratch space, and a new chunk is allocated only if none of them has room.
+ *  Returns 1 on success, 0 on failure */
 static int secp256k1_scratch_allocate_frame(secp256k1_scratch* scratch, size_t n, size_t objects);
 
-/** Deallocates a stack frame */
+/** Deallocates a stack frame. Its memory is retained for later frames, but once no frames are left
+ *  the scratch space keeps at most max_size bytes plus the headers of its deepest stack */
 static void secp256k1_scratch_deallocate_frame(secp256k1_scratch* scratch);
 
 /** Returns the maximum allocation the scratch space will allow */
 static size_t secp256k1_scratch_max_allocation(const secp256k1_scratch* scratch, size_t n_objects);
 
+/** Returns the maximum allocation for a frame of `n_objects` objects when `available` bytes of the
+ *  budget are left */
+static size_t secp256k1_scratch_max_allocation_within(size_t available, size_t n_objects);
+
+/** Returns how much of the budget a frame of `n` bytes for `n_objects` objects uses up */
+static size_t secp256k1_scratch_frame_budget(size_t n, size_t n_objects);
+
 /** Returns a pointer into the most recently allocated frame, or NULL if there is insufficient available space */
 static void *secp256k1_scratch_alloc(secp256k1_scratch* scratch, size_t n);
 
@@ -15,6 +15,9 @@
  * TODO: Determine this at configure time. */
 #define ALIGNMENT 16
 
+/* Chunk and frame headers are padded so that the memory after them stays aligned */
+#define SCRATCH_HEADER_SIZE(type) (((sizeof(type) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT)
+
 static secp256k1_scratch* secp256k1_scratch_create(const secp256k1_callback* error_callback, size_t max_size) {
     secp256k1_scratch* ret = (secp256k1_scratch*)checked_malloc(error_callback, sizeof(*ret));
     if (ret != NULL) {
@@ -27,58 +30,155 @@ static secp256k1_scratch* secp256k1_scratch_create(const secp256k1_callback* err
 
 static void secp256k1_scratch_destroy(secp256k1_scratch* scratch) {
     if (scratch != NULL) {
+        secp256k1_scratch_chunk *chunk = scratch->chunks;
         VERIFY_CHECK(scratch->frame == 0);
+        while (chunk != NULL) {
+            secp256k1_scratch_chunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
         free(scratch);
     }
 }
 
-static size_t secp256k1_scratch_max_allocation(const secp256k1_scratch* scratch, size_t objects) {
-    size_t i = 0;
-    size_t allocated = 0;
-    for (i = 0; i < scratch->frame; i++) {
-        allocated += scratch->frame_size[i];
-    }
-    if (scratch->max_size - allocated <= objects * ALIGNMENT) {
+static size_t secp256k1_scratch_max_allocation_within(size_t available, size_t objects) {
+    if (available <= objects * ALIGNMENT) {
         return 0;
     }
-    return scratch->max_size - allocated - objects * ALIGNMENT;
+    return available - objects * ALIGNMENT;
+}
+
+static size_t secp256k1_scratch_frame_budget(size_t n, size_t objects) {
+    return n + objects * ALIGNMENT;
+}
+
+static size_t secp256k1_scratch_max_allocation(const secp256k1_scratch* scratch, size_t objects) {
+    return secp256k1_scratch_max_allocation_within(scratch->max_size - scratch->allocated, objects);
 }
 
 static int secp256k1_scratch_allocate_frame(secp256k1_scratch* scratch, size_t n, size_t objects) {
-    VERIFY_CHECK(scratch->frame < SECP256K1_SCRATCH_MAX_FRAMES);
+    secp256k1_scratch_chunk *chunk;
+    secp256k1_scratch_chunk **tail;
+    secp256k1_scratch_frame *frame;
+    size_t offset;
+    size_t needed;
+
+    if (n > secp256k1_scratch_max_allocation(scratch, objects)) {
+        return 0;
+    }
+    n += objects * ALIGNMENT;
+    if (n > SIZE_MAX - SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk) - SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) - ALIGNMENT) {
+        return 0;
+    }
+    needed = SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + n;
+
+    /* Frames are laid out in stack order, so everything after the top frame is free */
+    if (scratch->top != NULL) {
+        chunk = scratch->top->chunk;
+        offset = (unsigned char *)scratch->top - ((unsigned char *)chunk + SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk));
+        offset += SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + scratch->top->size;
+        offset = ((offset + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+    } else {
+        chunk = scratch->chunks;
+        offset = 0;
+    }
+    while (chunk != NULL && (offset > chunk->size || chunk->size - offset < needed)) {
+        chunk = chunk->next;
+        offset = 0;
+    }
 
-    if (n <= secp256k1_scratch_max_allocation(scratch, objects)) {
-        n += objects * ALIGNMENT;
-        scratch->data[scratch->frame] = checked_malloc(scratch->error_callback, n);
-        if (scratch->data[scratch->frame] == NULL) {
+    if (chunk == NULL) {
+        /* Grow geometrically, but not past what the rest of the budget can use */
+        size_t total = 0;
+        size_t size;
+        size_t limit = needed + (scratch->max_size - scratch->allocated - n);
+        for (tail = &scratch->chunks; *tail != NULL; tail = &(*tail)->next) {
+            total += (*tail)->size;
+        }
+        size = total < limit ? total : limit;
+        if (size < needed) {
+            size = needed;
+        }
+        chunk = (secp256k1_scratch_chunk *)checked_malloc(scratch->error_callback, SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk) + size);
+        if (chunk == NULL) {
             return 0;
         }
-        scratch->frame_size[scratch->frame] = n;
-        scratch->offset[scratch->frame] = 0;
-        scratch->frame++;
-        return 1;
+        chunk->next = NULL;
+        chunk->size = size;
+        *tail = chunk;
+        offset = 0;
+    }
+
+    frame = (secp256k1_scratch_frame *)((unsigned char *)chunk + SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk) + offset);
+    frame->prev = scratch->top;
+    frame->chunk = chunk;
+    frame->size = n;
+    frame->offset = 0;
+    scratch->top = frame;
+    scratch->frame++;
+    if (scratch->frame > scratch->max_frames) {
+        scratch->max_frames = scratch->frame;
+    }
+    scratch->allocated += n;
+    if (scratch->allocated > scratch->high_water_mark) {
+        scratch->high_water_mark = scratch->allocated;
+    }
+    return 1;
+}
+
+/* Replaces the chunks of a scratch space without frames by a single one, so that the memory it
+ * keeps does not exceed the budget. The chunk is as large as all of them together if possible,
+ * so a stack of frames that needed several chunks fits into it next time. */
+static void secp256k1_scratch_merge_chunks(secp256k1_scratch* scratch) {
+    secp256k1_scratch_chunk *chunk = scratch->chunks;
+    size_t total = 0;
+    size_t overhead = SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + ALIGNMENT;
+    size_t limit = scratch->max_size;
+
+    VERIFY_CHECK(scratch->frame == 0);
+    if (scratch->max_frames <= (SIZE_MAX - limit) / overhead) {
+        limit += scratch->max_frames * overhead;
     } else {
-        return 0;
+        limit = SIZE_MAX;
     }
+    if (limit > SIZE_MAX - SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk)) {
+        limit = SIZE_MAX - SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk);
+    }
+    while (chunk != NULL) {
+        secp256k1_scratch_chunk *next = chunk->next;
+        total += chunk->size < limit - total ? chunk->size : limit - total;
+        free(chunk);
+        chunk = next;
+    }
+    chunk = (secp256k1_scratch_chunk *)checked_malloc(scratch->error_callback, SCRATCH_HEADER_SIZE(secp256k1_scratch_chunk) + total);
+    if (chunk != NULL) {
+        chunk->next = NULL;
+        chunk->size = total;
+    }
+    scratch->chunks = chunk;
 }
 
 static void secp256k1_scratch_deallocate_frame(secp256k1_scratch* scratch) {
     VERIFY_CHECK(scratch->frame > 0);
+    scratch->allocated -= scratch->top->size;
+    scratch->top = scratch->top->prev;
     scratch->frame -= 1;
-    free(scratch->data[scratch->frame]);
+    if (scratch->frame == 0 && scratch->chunks != NULL && scratch->chunks->next != NULL) {
+        secp256k1_scratch_merge_chunks(scratch);
+    }
 }
 
 static void *secp256k1_scratch_alloc(secp256k1_scratch* scratch, size_t size) {
     void *ret;
-    size_t frame = scratch->frame - 1;
+    secp256k1_scratch_frame *frame = scratch->top;
     size = ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
 
-    if (scratch->frame == 0 || size + scratch->offset[frame] > scratch->frame_size[frame]) {
+    if (frame == NULL || size > frame->size - frame->offset) {
         return NULL;
     }
-    ret = (void *) ((unsigned char *) scratch->data[frame] + scratch->offset[frame]);
+    ret = (void *) ((unsigned char *) frame + SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + frame->offset);
     memset(ret, 0, size);
-    scratch->offset[frame] += size;
+    frame->offset += size;
 
     return ret;
 }
@@ -25,6 +25,7 @@
 
 #ifdef ENABLE_MODULE_COMMITMENT
 # include "include/secp256k1_commitment.h"
+# include "modules/commitment/pedersen.h"
 #endif
 
 #ifdef ENABLE_MODULE_RANGEPROOF
@@ -98,6 +99,9 @@ struct secp256k1_context_struct {
     secp256k1_ecmult_gen_context ecmult_gen_ctx;
     secp256k1_callback illegal_callback;
     secp256k1_callback error_callback;
+#ifdef ENABLE_MODULE_COMMITMENT
+    secp256k1_pedersen_context pedersen_ctx;
+#endif
 };
 
 static const secp256k1_context secp256k1_context_no_precomp_ = {
@@ -105,6 +109,9 @@ static const secp256k1_context secp256k1_context_no_precomp_ = {
         { 0 },
         { secp256k1_default_illegal_callback_fn, 0 },
         { secp256k1_default_error_callback_fn, 0 }
+#ifdef ENABLE_MODULE_COMMITMENT
+        , { 0 }
+#endif
 };
 const secp256k1_context *secp256k1_context_no_precomp = &secp256k1_context_no_precomp_;
 
@@ -122,9 +129,15 @@ secp256k1_context* secp256k1_context_create(unsigned int flags) {
 
     secp256k1_ecmult_context_init(&ret->ecmult_ctx);
     secp256k1_ecmult_gen_context_init(&ret->ecmult_gen_ctx);
+#ifdef ENABLE_MODULE_COMMITMENT
+    secp256k1_pedersen_context_init(&ret->pedersen_ctx);
+#endif
 
     if (flags & SECP256K1_FLAGS_BIT_CONTEXT_SIGN) {
         secp256k1_ecmult_gen_context_build(&ret->ecmult_gen_ctx, &ret->error_callback);
+#ifdef ENABLE_MODULE_COMMITMENT
+        secp256k1_pedersen_context_build(&ret->pedersen_ctx, &ret->error_callback);
+#endif
     }
     if (flags & SECP256K1_FLAGS_BIT_CONTEXT_VERIFY) {
         secp256k1_ecmult_context_build(&ret->ecmult_ctx, &ret->error_callback);
@@ -139,6 +152,9 @@ secp256k1_context* secp256k1_context_clone(const secp256k1_context* ctx) {
     ret->error_callback = ctx->error_callback;
     secp256k1_ecmult_context_clone(&ret->ecmult_ctx, &ctx->ecmult_ctx, &ctx->error_callback);
     secp256k1_ecmult_gen_context_clone(&ret->ecmult_gen_ctx, &ctx->ecmult_gen_ctx, &ctx->error_callback);
+#ifdef ENABLE_MODULE_COMMITMENT
+    secp256k1_pedersen_context_clone(&ret->pedersen_ctx, &ctx->pedersen_ctx, &ctx->error_callback);
+#endif
     return ret;
 }
 
@@ -147,6 +163,9 @@ void secp256k1_context_destroy(secp256k1_context* ctx) {
     if (ctx != NULL) {
         secp256k1_ecmult_context_clear(&ctx->ecmult_ctx);
         secp256k1_ecmult_gen_context_clear(&ctx->ecmult_gen_ctx);
+#ifdef ENABLE_MODULE_COMMITMENT
+        secp256k1_pedersen_context_clear(&ctx->pedersen_ctx);
+#endif
 
         free(ctx);
     }
@@ -170,6 +189,48 @@ void secp256k1_context_set_error_callback(secp256k1_context* ctx, void (*fun)(co
     ctx->error_callback.data = data;
 }
 
+void secp256k1_context_set_task_runner(secp256k1_context* ctx, secp256k1_task_runner_function fun, size_t max_tasks, void* data) {
+    ARG_CHECK_NO_RETURN(ctx != secp256k1_context_no_precomp);
+    if (fun == NULL || max_tasks < 2) {
+        fun = NULL;
+        data = NULL;
+        max_tasks = 1;
+    }
+    ctx->ecmult_ctx.task_runner.fn = fun;
+    ctx->ecmult_ctx.task_runner.data = data;
+    ctx->ecmult_ctx.task_runner.n_tasks = max_tasks;
+}
+
+int secp256k1_context_calibrate(secp256k1_context* ctx, secp256k1_scratch_space* scratch, size_t max_points) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+    return secp256k1_ecmult_calibrate(&ctx->ecmult_ctx, scratch, max_points);
+}
+
+int secp256k1_context_serialize_tuning(const secp256k1_context* ctx, unsigned char *output, size_t *outputlen) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(output != NULL);
+    ARG_CHECK(outputlen != NULL);
+    VERIFY_CHECK(SECP256K1_ECMULT_TUNING_SERIALIZED_SIZE == SECP256K1_CONTEXT_TUNING_SIZE);
+    if (*outputlen < SECP256K1_CONTEXT_TUNING_SIZE) {
+        return 0;
+    }
+    secp256k1_ecmult_tuning_serialize(output, &ctx->ecmult_ctx.tuning);
+    *outputlen = SECP256K1_CONTEXT_TUNING_SIZE;
+    return 1;
+}
+
+int secp256k1_context_parse_tuning(secp256k1_context* ctx, const unsigned char *input, size_t inputlen) {
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(ctx != secp256k1_context_no_precomp);
+    ARG_CHECK(input != NULL);
+    if (inputlen != SECP256K1_CONTEXT_TUNING_SIZE) {
+        return 0;
+    }
+    return secp256k1_ecmult_tuning_parse(&ctx->ecmult_ctx.tuning, input);
+}
+
 secp256k1_scratch_space* secp256k1_scratch_space_create(const secp256k1_context* ctx, size_t max_size) {
     VERIFY_CHECK(ctx != NULL);
     return secp256k1_scratch_create(&ctx->error_callback, max_size);
@@ -179,6 +240,11 @@ void secp256k1_scratch_space_destroy(secp256k1_scratch_space* scratch) {
     secp256k1_scratch_destroy(scratch);
 }
 
+size_t secp256k1_scratch_space_high_water_mark(const secp256k1_scratch_space* scratch) {
+    VERIFY_CHECK(scratch != NULL);
+    return scratch->high_water_mark;
+}
+
 static int secp256k1_pubkey_load(const secp256k1_context* ctx, secp256k1_ge* ge, const secp256k1_pubkey* pubkey) {
     if (sizeof(secp256k1_ge_storage) == 64) {
         /* When the secp256k1_ge_storage type is exactly 64 byte, use its
@@ -398,8 +464,9 @@ static int secp256k1_nonce_function_bipschnorr(unsigned char* nonce32, const uns
 	return 1;
 }
 
-static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *msg32, const unsigned char *key32, const unsigned char *algo16, void *data, unsigned int counter) {
-   unsigned char keydata[112];
+/* The RFC6979 nonce function with the secret key already absorbed into prefix. */
+static int secp256k1_nonce_function_rfc6979_prefixed(unsigned char *nonce32, const secp256k1_rfc6979_hmac_sha256_prefix *prefix, const unsigned char *msg32, const unsigned char *algo16, void *data, unsigned int counter) {
+   unsigned char keydata[80];
    unsigned int offset = 0;
    secp256k1_rfc6979_hmac_sha256 rng;
    unsigned int i;
@@ -409,9 +476,8 @@ static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *m
     * - optionally 16 extra bytes with the algorithm name.
     * Because the arguments have distinct fixed lengths it is not possible for
     *  different argument mixtures to emulate each other and result in the same
-    *  nonces.
+    *  nonces. The private key is the prefix, everything after it is assembled here.
     */
-   buffer_append(keydata, &offset, key32, 32);
    buffer_append(keydata, &offset, msg32, 32);
    if (data != NULL) {
        buffer_append(keydata, &offset, data, 32);
@@ -419,7 +485,7 @@ static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *m
    if (algo16 != NULL) {
        buffer_append(keydata, &offset, algo16, 16);
    }
-   secp256k1_rfc6979_hmac_sha256_initialize(&rng, keydata, offset);
+   secp256k1_rfc6979_hmac_sha256_initialize_prefixed(&rng, prefix, keydata, offset);
    memset(keydata, 0, sizeof(keydata));
    for (i = 0; i <= counter; i++) {
        secp256k1_rfc6979_hmac_sha256_generate(&rng, nonce32, 32);
@@ -428,12 +494,59 @@ static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *m
    return 1;
 }
 
+static int nonce_function_rfc6979(unsigned char *nonce32, const unsigned char *msg32, const unsigned char *key32, const unsigned char *algo16, void *data, unsigned int counter) {
+   secp256k1_rfc6979_hmac_sha256_prefix prefix;
+   int ret;
+   secp256k1_rfc6979_hmac_sha256_prefix_initialize(&prefix, key32, 32);
+   ret = secp256k1_nonce_function_rfc6979_prefixed(nonce32, &prefix, msg32, algo16, data, counter);
+   secp256k1_rfc6979_hmac_sha256_prefix_clear(&prefix);
+   return ret;
+}
+
 const secp256k1_nonce_function secp256k1_nonce_function_rfc6979 = nonce_function_rfc6979;
 const secp256k1_nonce_function secp256k1_nonce_function_default = nonce_function_rfc6979;
 
-int secp256k1_ecdsa_sign(const secp256k1_context* ctx, secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const unsigned char *seckey, secp256k1_nonce_function noncefp, const void* noncedata) {
+/* Signs with the valid secret key sec, whose encoding is seckey. If prefix is not NULL the
+ * nonce is derived from it with the RFC6979 nonce function, otherwise noncefp is used. */
+static int secp256k1_ecdsa_sign_inner(const secp256k1_context* ctx, secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const secp256k1_scalar *sec, const unsigned char *seckey, const secp256k1_rfc6979_hmac_sha256_prefix *prefix, secp256k1_nonce_function noncefp, const void* noncedata) {
     secp256k1_scalar r, s;
-    secp256k1_scalar sec, non, msg;
+    secp256k1_scalar non, msg;
+    unsigned char nonce32[32];
+    unsigned int count = 0;
+    int ret = 0;
+    int overflow = 0;
+
+    secp256k1_scalar_set_b32(&msg, msg32, NULL);
+    while (1) {
+        if (prefix != NULL) {
+            ret = secp256k1_nonce_function_rfc6979_prefixed(nonce32, prefix, msg32, NULL, (void*)noncedata, count);
+        } else {
+            ret = noncefp(nonce32, msg32, seckey, NULL, (void*)noncedata, count);
+        }
+        if (!ret) {
+            break;
+        }
+        secp256k1_scalar_set_b32(&non, nonce32, &overflow);
+        if (!overflow && !secp256k1_scalar_is_zero(&non)) {
+            if (secp256k1_ecdsa_sig_sign(&ctx->ecmult_gen_ctx, &r, &s, sec, &msg, &non, NULL)) {
+                break;
+            }
+        }
+        count++;
+    }
+    memset(nonce32, 0, 32);
+    secp256k1_scalar_clear(&msg);
+    secp256k1_scalar_clear(&non);
+    if (ret) {
+        secp256k1_ecdsa_signature_save(signature, &r, &s);
+    } else {
+        memset(signature, 0, sizeof(*signature));
+    }
+    return ret;
+}
+
+int secp256k1_ecdsa_sign(const secp256k1_context* ctx, secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const unsigned char *seckey, secp256k1_nonce_function noncefp, const void* noncedata) {
+    secp256k1_scalar sec;
     int ret = 0;
     int overflow = 0;
     VERIFY_CHECK(ctx != NULL);
@@ -448,35 +561,70 @@ int secp256k1_ecdsa_sign(const secp256k1_context* ctx, secp256k1_ecdsa_signature
     secp256k1_scalar_set_b32(&sec, seckey, &overflow);
     /* Fail if the secret key is invalid. */
     if (!overflow && !secp256k1_scalar_is_zero(&sec)) {
-        unsigned char nonce32[32];
-        unsigned int count = 0;
-        secp256k1_scalar_set_b32(&msg, msg32, NULL);
-        while (1) {
-            ret = noncefp(nonce32, msg32, seckey, NULL, (void*)noncedata, count);
-            if (!ret) {
-                break;
-            }
-            secp256k1_scalar_set_b32(&non, nonce32, &overflow);
-            if (!overflow && !secp256k1_scalar_is_zero(&non)) {
-                if (secp256k1_ecdsa_sig_sign(&ctx->ecmult_gen_ctx, &r, &s, &sec, &msg, &non, NULL)) {
-                    break;
-                }
-            }
-            count++;
-        }
-        memset(nonce32, 0, 32);
-        secp256k1_scalar_clear(&msg);
-        secp256k1_scalar_clear(&non);
-        secp256k1_scalar_clear(&sec);
-    }
-    if (ret) {
-        secp256k1_ecdsa_signature_save(signature, &r, &s);
+        ret = secp256k1_ecdsa_sign_inner(ctx, signature, msg32, &sec, seckey, NULL, noncefp, noncedata);
     } else {
         memset(signature, 0, sizeof(*signature));
     }
+    secp256k1_scalar_clear(&sec);
     return ret;
 }
 
+struct secp256k1_signing_key_struct {
+    unsigned char seckey[32];
+    secp256k1_scalar sec;
+    secp256k1_ge pubkey;
+    /* The RFC6979 derivation with the secret key as prefix. */
+    secp256k1_rfc6979_hmac_sha256_prefix rfc6979;
+};
+
+secp256k1_signing_key* secp256k1_signing_key_create(const secp256k1_context* ctx, const unsigned char *seckey) {
+    secp256k1_signing_key *ret;
+    secp256k1_scalar sec;
+    secp256k1_gej pj;
+    int overflow;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(seckey != NULL);
+
+    secp256k1_scalar_set_b32(&sec, seckey, &overflow);
+    if (overflow || secp256k1_scalar_is_zero(&sec)) {
+        secp256k1_scalar_clear(&sec);
+        return NULL;
+    }
+    ret = (secp256k1_signing_key *)checked_malloc(&ctx->error_callback, sizeof(*ret));
+    if (ret != NULL) {
+        memcpy(ret->seckey, seckey, 32);
+        ret->sec = sec;
+        secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &pj, &sec);
+        secp256k1_ge_set_gej(&ret->pubkey, &pj);
+        secp256k1_rfc6979_hmac_sha256_prefix_initialize(&ret->rfc6979, seckey, 32);
+    }
+    secp256k1_scalar_clear(&sec);
+    return ret;
+}
+
+void secp256k1_signing_key_destroy(secp256k1_signing_key* key) {
+    if (key != NULL) {
+        memset(key->seckey, 0, sizeof(key->seckey));
+        secp256k1_scalar_clear(&key->sec);
+        secp256k1_rfc6979_hmac_sha256_prefix_clear(&key->rfc6979);
+        free(key);
+    }
+}
+
+int secp256k1_ecdsa_sign_with_key(const secp256k1_context* ctx, secp256k1_ecdsa_signature *signature, const unsigned char *msg32, const secp256k1_signing_key *key, secp256k1_nonce_function noncefp, const void* noncedata) {
+    const secp256k1_rfc6979_hmac_sha256_prefix *prefix = NULL;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_gen_context_is_built(&ctx->ecmult_gen_ctx));
+    ARG_CHECK(msg32 != NULL);
+    ARG_CHECK(signature != NULL);
+    ARG_CHECK(key != NULL);
+    if (noncefp == NULL || noncefp == nonce_function_rfc6979) {
+        prefix = &key->rfc6979;
+    }
+    return secp256k1_ecdsa_sign_inner(ctx, signature, msg32, &key->sec, key->seckey, prefix, noncefp, noncedata);
+}
+
 int secp256k1_ec_seckey_verify(const secp256k1_context* ctx, const unsigned char *seckey) {
     secp256k1_scalar sec;
     int ret;
@@ -704,6 +852,102 @@ int secp256k1_ec_privkey_tweak_neg(const secp256k1_context* ctx, unsigned char *
     return ret;
 }
 
+struct secp256k1_multiexp_struct {
+    secp256k1_ecmult_multi_accumulator acc;
+};
+
+secp256k1_multiexp* secp256k1_multiexp_create(const secp256k1_context* ctx, secp256k1_scratch_space* scratch) {
+    secp256k1_multiexp *ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(scratch != NULL);
+
+    ret = (secp256k1_multiexp *)checked_malloc(&ctx->error_callback, sizeof(*ret));
+    if (ret != NULL && !secp256k1_ecmult_multi_accumulator_init(&ret->acc, &ctx->ecmult_ctx, scratch, SIZE_MAX)) {
+        free(ret);
+        ret = NULL;
+    }
+    return ret;
+}
+
+int secp256k1_multiexp_add(const secp256k1_context* ctx, secp256k1_multiexp* multiexp, const unsigned char *scalars, const secp256k1_pubkey *points, size_t n) {
+    size_t i;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(multiexp != NULL);
+    ARG_CHECK(scalars != NULL || n == 0);
+    ARG_CHECK(points != NULL || n == 0);
+
+    for (i = 0; i < n && !multiexp->acc.failed; i++) {
+        secp256k1_scalar sc;
+        secp256k1_ge pt;
+        int overflow;
+        secp256k1_scalar_set_b32(&sc, &scalars[32 * i], &overflow);
+        if (overflow || !secp256k1_pubkey_load(ctx, &pt, &points[i])) {
+            multiexp->acc.failed = 1;
+            break;
+        }
+        secp256k1_ecmult_multi_accumulator_add(&multiexp->acc, &sc, &pt);
+    }
+    return !multiexp->acc.failed;
+}
+
+int secp256k1_multiexp_add_generator(const secp256k1_context* ctx, secp256k1_multiexp* multiexp, const unsigned char *scalar32) {
+    secp256k1_scalar sc;
+    int overflow;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(multiexp != NULL);
+    ARG_CHECK(scalar32 != NULL);
+
+    secp256k1_scalar_set_b32(&sc, scalar32, &overflow);
+    if (overflow) {
+        multiexp->acc.failed = 1;
+    } else {
+        secp256k1_ecmult_multi_accumulator_add_g(&multiexp->acc, &sc);
+    }
+    return !multiexp->acc.failed;
+}
+
+int secp256k1_multiexp_finalize(const secp256k1_context* ctx, secp256k1_multiexp* multiexp, secp256k1_pubkey *result) {
+    secp256k1_gej rj;
+    secp256k1_ge r;
+    int ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(multiexp != NULL);
+    if (result == NULL) {
+        /* The multiexp is consumed even when the call is illegal */
+        secp256k1_multiexp_destroy(multiexp);
+    }
+    ARG_CHECK(result != NULL);
+    memset(result, 0, sizeof(*result));
+
+    ret = secp256k1_ecmult_multi_accumulator_finalize(&multiexp->acc, &rj);
+    free(multiexp);
+    if (!ret || secp256k1_gej_is_infinity(&rj)) {
+        return 0;
+    }
+    secp256k1_ge_set_gej(&r, &rj);
+    secp256k1_pubkey_save(result, &r);
+    return 1;
+}
+
+int secp256k1_multiexp_finalize_is_infinity(const secp256k1_context* ctx, secp256k1_multiexp* multiexp) {
+    secp256k1_gej rj;
+    int ret;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(multiexp != NULL);
+
+    ret = secp256k1_ecmult_multi_accumulator_finalize(&multiexp->acc, &rj);
+    free(multiexp);
+    return ret && secp256k1_gej_is_infinity(&rj);
+}
+
+void secp256k1_multiexp_destroy(secp256k1_multiexp* multiexp) {
+    if (multiexp != NULL) {
+        secp256k1_ecmult_multi_accumulator_clear(&multiexp->acc);
+        free(multiexp);
+    }
+}
+
 #ifdef ENABLE_MODULE_ECDH
 # include "modules/ecdh/main_impl.h"
 #endif
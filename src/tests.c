@@ -219,6 +219,22 @@ void run_context_tests(void) {
         ctx_tmp = both; both = secp256k1_context_clone(both); secp256k1_context_destroy(ctx_tmp);
     }
 
+    /*** clones share the precomputed tables, but not the blinding ***/
+    {
+        secp256k1_context *ctx_tmp = secp256k1_context_clone(both);
+#ifdef SECP256K1_SHARED_TABLES
+        CHECK(ctx_tmp->ecmult_ctx.pre_g == both->ecmult_ctx.pre_g);
+        CHECK(ctx_tmp->ecmult_gen_ctx.prec == both->ecmult_gen_ctx.prec);
+#ifdef ENABLE_MODULE_COMMITMENT
+        CHECK(ctx_tmp->pedersen_ctx.prec == both->pedersen_ctx.prec);
+#endif
+#endif
+        memset(ctmp, 2, 32);
+        CHECK(secp256k1_context_randomize(ctx_tmp, ctmp) == 1);
+        CHECK(!secp256k1_scalar_eq(&ctx_tmp->ecmult_gen_ctx.blind, &both->ecmult_gen_ctx.blind));
+        secp256k1_context_destroy(ctx_tmp);
+    }
+
     /* Verify that the error callback makes it across the clone. */
     CHECK(vrfy->error_callback.fn != sign->error_callback.fn);
     /* And that it resets back to default. */
@@ -301,6 +317,8 @@ void run_scratch_tests(void) {
     int32_t ecount = 0;
     secp256k1_context *none = secp256k1_context_create(SECP256K1_CONTEXT_NONE);
     secp256k1_scratch_space *scratch;
+    size_t n_chunks_first = 0;
+    int i;
 
     /* Test public API */
     secp256k1_context_set_illegal_callback(none, counting_illegal_callback_fn, &ecount);
@@ -330,13 +348,80 @@ void run_scratch_tests(void) {
     CHECK(secp256k1_scratch_max_allocation(scratch, 0) == 1000);
     CHECK(secp256k1_scratch_alloc(scratch, 500) == NULL);
 
+    /* Chunks are kept and reused by smaller frames, and larger ones get a new chunk */
+    CHECK(secp256k1_scratch_space_high_water_mark(scratch) == 500 + ALIGNMENT);
+    CHECK(secp256k1_scratch_allocate_frame(scratch, 400, 1));
+    CHECK(secp256k1_scratch_alloc(scratch, 400) != NULL);
+    secp256k1_scratch_deallocate_frame(scratch);
+    CHECK(scratch->chunks != NULL && scratch->chunks->next == NULL);
+    CHECK(secp256k1_scratch_allocate_frame(scratch, 900, 1));
+    CHECK(scratch->chunks->next != NULL);
+    CHECK(secp256k1_scratch_alloc(scratch, 900) != NULL);
+    secp256k1_scratch_deallocate_frame(scratch);
+    CHECK(secp256k1_scratch_space_high_water_mark(scratch) == 900 + ALIGNMENT);
+
+    /* Without frames, the chunks are merged into one that fits the budget and holds either frame */
+    CHECK(scratch->chunks != NULL && scratch->chunks->next == NULL);
+    CHECK(scratch->chunks->size <= 1000 + SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + ALIGNMENT);
+    CHECK(secp256k1_scratch_allocate_frame(scratch, 900, 1));
+    CHECK(scratch->chunks->next == NULL);
+    secp256k1_scratch_deallocate_frame(scratch);
+    CHECK(secp256k1_scratch_allocate_frame(scratch, 400, 1));
+    CHECK(scratch->chunks->next == NULL);
+    secp256k1_scratch_deallocate_frame(scratch);
+
     /* cleanup */
     secp256k1_scratch_space_destroy(scratch);
+
+    /* Frames nest without limit, stay aligned, and the chunks are reused */
+    scratch = secp256k1_scratch_space_create(none, 10000);
+    for (i = 0; i < 2; i++) {
+        size_t j;
+        secp256k1_scratch_chunk *chunk;
+        size_t n_chunks = 0;
+        for (j = 0; j < 20; j++) {
+            unsigned char *p;
+            CHECK(secp256k1_scratch_allocate_frame(scratch, 7 * j + 1, 1));
+            p = (unsigned char *)secp256k1_scratch_alloc(scratch, 7 * j + 1);
+            CHECK(p != NULL);
+            CHECK((p - (unsigned char *)scratch->top->chunk) % ALIGNMENT == 0);
+            memset(p, (int)j, 7 * j + 1);
+        }
+        CHECK(secp256k1_scratch_space_high_water_mark(scratch) == 7 * 190 + 20 * (1 + ALIGNMENT));
+        for (j = 20; j > 0; j--) {
+            CHECK(((unsigned char *)scratch->top)[SCRATCH_HEADER_SIZE(secp256k1_scratch_frame) + 7 * (j - 1)] == (unsigned char)(j - 1));
+            secp256k1_scratch_deallocate_frame(scratch);
+        }
+        for (chunk = scratch->chunks; chunk != NULL; chunk = chunk->next) {
+            n_chunks++;
+        }
+        if (i == 0) {
+            n_chunks_first = n_chunks;
+        } else {
+            CHECK(n_chunks == n_chunks_first);
+        }
+    }
+    CHECK(secp256k1_scratch_max_allocation(scratch, 0) == 10000);
+    secp256k1_scratch_space_destroy(scratch);
     secp256k1_context_destroy(none);
 }
 
 /***** HASH TESTS *****/
 
+#ifdef USE_SHANI
+void sha256_transform_shani_test(void) {
+    uint32_t s1[8], s2[8], chunk[16];
+    int i;
+    for (i = 0; i < 8; i++) {
+        s1[i] = s2[i] = secp256k1_rand32();
+    }
+    secp256k1_rand_bytes_test((unsigned char*)chunk, sizeof(chunk));
+    secp256k1_sha256_transform_generic(s1, chunk);
+    secp256k1_sha256_transform_shani(s2, chunk);
+    CHECK(memcmp(s1, s2, sizeof(s1)) == 0);
+}
+#endif
+
 void run_sha256_tests(void) {
     static const char *inputs[8] = {
         "", "abc", "message digest", "secure hash algorithm", "SHA256 is considered to be safe",
@@ -371,6 +456,48 @@ void run_sha256_tests(void) {
             CHECK(memcmp(out, outputs[i], 32) == 0);
         }
     }
+#ifdef USE_SHANI
+    if (secp256k1_cpu_has_sha()) {
+        for (i = 0; i < 64 * count; i++) {
+            sha256_transform_shani_test();
+        }
+    }
+#endif
+}
+
+void run_sha256_multi_tests(void) {
+    unsigned char data[17 * 200];
+    const unsigned char *msgs[17];
+    size_t lens[17];
+    unsigned char out[17 * 32], expected[32];
+    size_t i, j, n;
+    int k;
+    secp256k1_rand_bytes_test(data, sizeof(data));
+    for (k = 0; k < 4 * count; k++) {
+        n = 1 + secp256k1_rand_int(17);
+        for (i = 0; i < n; i++) {
+            msgs[i] = &data[200 * i];
+            /* Mostly lengths around the padding boundaries, sometimes anything up to 200 */
+            lens[i] = secp256k1_rand_bits(1) ? 64 * secp256k1_rand_int(3) + 52 + secp256k1_rand_int(8) : secp256k1_rand_int(201);
+        }
+        secp256k1_sha256_multi(out, msgs, lens, n);
+        for (j = 0; j < n; j++) {
+            secp256k1_sha256 hasher;
+            secp256k1_sha256_initialize(&hasher);
+            secp256k1_sha256_write(&hasher, msgs[j], lens[j]);
+            secp256k1_sha256_finalize(&hasher, expected);
+            CHECK(memcmp(&out[32 * j], expected, 32) == 0);
+#ifdef USE_AVX2
+            /* The 8-way code is not used by secp256k1_sha256_multi if the SHA extensions are available */
+            if (secp256k1_cpu_has_avx2() && j % 8 == 0) {
+                unsigned char out8[8 * 32];
+                size_t lanes = n - j < 8 ? n - j : 8;
+                secp256k1_sha256_multi_8way(out8, &msgs[j], &lens[j], lanes);
+                CHECK(memcmp(out8, &out[32 * j], 32 * lanes) == 0);
+            }
+#endif
+        }
+    }
 }
 
 void run_hmac_sha256_tests(void) {
@@ -433,8 +560,10 @@ void run_rfc6979_hmac_sha256_tests(void) {
     };
 
     secp256k1_rfc6979_hmac_sha256 rng;
+    secp256k1_rfc6979_hmac_sha256_prefix prefix;
     unsigned char out[32];
     int i;
+    size_t j;
 
     secp256k1_rfc6979_hmac_sha256_initialize(&rng, key1, 64);
     for (i = 0; i < 3; i++) {
@@ -456,6 +585,18 @@ void run_rfc6979_hmac_sha256_tests(void) {
         CHECK(memcmp(out, out2[i], 32) == 0);
     }
     secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+
+    /* Splitting the key into a prefix and the rest gives the same output. */
+    for (j = 0; j <= 32; j += 8) {
+        secp256k1_rfc6979_hmac_sha256_prefix_initialize(&prefix, key1, j);
+        secp256k1_rfc6979_hmac_sha256_initialize_prefixed(&rng, &prefix, key1 + j, 64 - j);
+        for (i = 0; i < 3; i++) {
+            secp256k1_rfc6979_hmac_sha256_generate(&rng, out, 32);
+            CHECK(memcmp(out, out1[i], 32) == 0);
+        }
+        secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+        secp256k1_rfc6979_hmac_sha256_prefix_clear(&prefix);
+    }
 }
 
 /***** RANDOM TESTS *****/
@@ -1063,11 +1204,49 @@ void scalar_chacha_tests(void) {
     CHECK(secp256k1_scalar_eq(&exp_r2, &r2));
 }
 
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64_ADX)
+void scalar_mul_512_adx_test(void) {
+    secp256k1_scalar a, b;
+    uint64_t l[8], expected[8];
+    int i, j;
+    random_scalar_order_test(&a);
+    random_scalar_order_test(&b);
+    if (secp256k1_rand_bits(2) == 0) {
+        /* Maximize the carries with n - 1 */
+        secp256k1_scalar_set_int(&a, 1);
+        secp256k1_scalar_negate(&a, &a);
+    }
+    if (secp256k1_rand_bits(2) == 0) {
+        secp256k1_scalar_set_int(&b, 1);
+        secp256k1_scalar_negate(&b, &b);
+    }
+    memset(expected, 0, sizeof(expected));
+    for (i = 0; i < 4; i++) {
+        uint64_t carry = 0;
+        for (j = 0; j < 4; j++) {
+            uint128_t t = (uint128_t)a.d[i] * b.d[j] + expected[i + j] + carry;
+            expected[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        expected[i + 4] = carry;
+    }
+    secp256k1_scalar_mul_512_adx(l, &a, &b);
+    CHECK(memcmp(l, expected, sizeof(l)) == 0);
+}
+#endif
+
 void run_scalar_tests(void) {
     int i;
     for (i = 0; i < 128 * count; i++) {
         scalar_test();
     }
+#if defined(USE_SCALAR_4X64) && defined(USE_ASM_X86_64_ADX)
+    if (secp256k1_cpu_has_adx()) {
+        for (i = 0; i < 128 * count; i++) {
+            scalar_mul_512_adx_test();
+        }
+    }
+#endif
 
     scalar_chacha_tests();
 
@@ -1120,9 +1299,7 @@ void run_scalar_tests(void) {
         secp256k1_scalar one;
         secp256k1_scalar r1;
         secp256k1_scalar r2;
-#if defined(USE_SCALAR_INV_NUM)
         secp256k1_scalar zzv;
-#endif
         int overflow;
         unsigned char chal[33][2][32] = {
             {{0xff, 0xff, 0x03, 0x07, 0x00, 0x00, 0x00, 0x00,
@@ -1672,10 +1849,8 @@ void run_scalar_tests(void) {
             if (!secp256k1_scalar_is_zero(&y)) {
                 secp256k1_scalar_inverse(&zz, &y);
                 CHECK(!secp256k1_scalar_check_overflow(&zz));
-#if defined(USE_SCALAR_INV_NUM)
                 secp256k1_scalar_inverse_var(&zzv, &y);
                 CHECK(secp256k1_scalar_eq(&zzv, &zz));
-#endif
                 secp256k1_scalar_mul(&z, &z, &zz);
                 CHECK(!secp256k1_scalar_check_overflow(&z));
                 CHECK(secp256k1_scalar_eq(&x, &z));
@@ -1886,6 +2061,113 @@ void run_field_inv_var(void) {
     }
 }
 
+void test_inverse_scalar(const secp256k1_scalar *x) {
+    secp256k1_scalar l, r, t;
+    secp256k1_scalar_inverse(&l, x);
+    secp256k1_scalar_inverse_var(&r, x);
+    CHECK(secp256k1_scalar_eq(&l, &r));
+    if (secp256k1_scalar_is_zero(x)) {
+        CHECK(secp256k1_scalar_is_zero(&l));
+        return;
+    }
+    secp256k1_scalar_mul(&t, x, &l);
+    CHECK(secp256k1_scalar_is_one(&t));
+}
+
+void test_inverse_field(const secp256k1_fe *x) {
+    secp256k1_fe l, r, t;
+    secp256k1_fe_inv(&l, x);
+    secp256k1_fe_inv_var(&r, x);
+    CHECK(check_fe_equal(&l, &r));
+    t = *x;
+    if (secp256k1_fe_normalizes_to_zero_var(&t)) {
+        CHECK(secp256k1_fe_normalizes_to_zero_var(&l));
+        return;
+    }
+    CHECK(check_fe_inverse(x, &l));
+    /* The result is fully normalized */
+    t = l;
+    secp256k1_fe_normalize(&t);
+    CHECK(memcmp(&t.n, &l.n, sizeof(l.n)) == 0);
+}
+
+void run_inverse_tests(void) {
+    /* Inputs near 0, 2^255 and the modulus, where the divstep bounds are tightest */
+    static const secp256k1_fe fe_cases[] = {
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 1),
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0, 2),
+        SECP256K1_FE_CONST(0x80000000UL, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_FE_CONST(0x7FFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL),
+        SECP256K1_FE_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xFFFFFC2EUL),
+        SECP256K1_FE_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xFFFFFC2DUL),
+        SECP256K1_FE_CONST(0, 0, 0, 0, 0, 0, 0x00000001UL, 0x000003D1UL)
+    };
+    static const secp256k1_scalar scalar_cases[] = {
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 1),
+        SECP256K1_SCALAR_CONST(0, 0, 0, 0, 0, 0, 0, 2),
+        SECP256K1_SCALAR_CONST(0x80000000UL, 0, 0, 0, 0, 0, 0, 0),
+        SECP256K1_SCALAR_CONST(0x7FFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL),
+        SECP256K1_SCALAR_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xBAAEDCE6UL, 0xAF48A03BUL, 0xBFD25E8CUL, 0xD0364140UL),
+        SECP256K1_SCALAR_CONST(0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFFUL, 0xFFFFFFFEUL, 0xBAAEDCE6UL, 0xAF48A03BUL, 0xBFD25E8CUL, 0xD036413FUL),
+        SECP256K1_SCALAR_CONST(0, 0, 0, 1, 0x45512319UL, 0x50B75FC4UL, 0x402DA173UL, 0x2FC9BEBFUL)
+    };
+    secp256k1_fe fe;
+    secp256k1_scalar sc;
+    size_t i;
+    int j;
+    for (i = 0; i < sizeof(fe_cases) / sizeof(fe_cases[0]); i++) {
+        test_inverse_field(&fe_cases[i]);
+    }
+    for (i = 0; i < sizeof(scalar_cases) / sizeof(scalar_cases[0]); i++) {
+        test_inverse_scalar(&scalar_cases[i]);
+    }
+    for (j = 0; j < 100 * count; j++) {
+        random_fe_test(&fe);
+        if (j & 1) {
+            /* Unnormalized input of larger magnitude */
+            secp256k1_fe_negate(&fe, &fe, 1);
+            secp256k1_fe_mul_int(&fe, 3);
+        }
+        test_inverse_field(&fe);
+        random_scalar_order_test(&sc);
+        test_inverse_scalar(&sc);
+    }
+    /* Batch inversion agrees with inverting one at a time */
+    for (j = 0; j < count; j++) {
+        secp256k1_scalar a[16], r[16], t;
+        size_t len = secp256k1_rand_int(16) + 1;
+        for (i = 0; i < len; i++) {
+            do {
+                random_scalar_order_test(&a[i]);
+            } while (secp256k1_scalar_is_zero(&a[i]));
+        }
+        secp256k1_scalar_inverse_all_var(r, a, len);
+        for (i = 0; i < len; i++) {
+            secp256k1_scalar_inverse_var(&t, &a[i]);
+            CHECK(secp256k1_scalar_eq(&t, &r[i]));
+        }
+    }
+}
+
+void run_ctz_tests(void) {
+    static const uint32_t b32[] = {1, 0xffffffff, 0x5e56968f, 0xe0d63129};
+    static const uint64_t b64[] = {1, 0xffffffffffffffff, 0xbcd02462139b3fc3, 0x98b5f80c769693ef};
+    int shift;
+    unsigned i;
+    for (i = 0; i < sizeof(b32) / sizeof(b32[0]); ++i) {
+        for (shift = 0; shift < 32; ++shift) {
+            CHECK(secp256k1_ctz32_var(b32[i] << shift) == shift);
+        }
+    }
+    for (i = 0; i < sizeof(b64) / sizeof(b64[0]); ++i) {
+        for (shift = 0; shift < 64; ++shift) {
+            CHECK(secp256k1_ctz64_var(b64[i] << shift) == shift);
+        }
+    }
+}
+
 void run_field_inv_all_var(void) {
     secp256k1_fe x[16], xi[16], xii[16];
     int i;
@@ -1924,10 +2206,64 @@ void run_sqr(void) {
     }
 }
 
+#ifdef USE_AVX2
+void run_field_4x(void) {
+    secp256k1_fe a[4], b[4], r[4], t;
+    secp256k1_fe_4x a4, b4, r4;
+    int i, k;
+    if (!secp256k1_cpu_has_avx2()) {
+        return;
+    }
+    for (i = 0; i < 5*count; i++) {
+        for (k = 0; k < 4; k++) {
+            random_fe_test(&a[k]);
+            random_fe_test(&b[k]);
+            if (k & 1) {
+                /* Use the largest magnitude that can be loaded */
+                secp256k1_fe_negate(&t, &a[k], 1);
+                secp256k1_fe_mul_int(&t, 3);
+                secp256k1_fe_add(&a[k], &t);
+            }
+        }
+        secp256k1_fe_4x_load(&a4, &a[0], &a[1], &a[2], &a[3]);
+        secp256k1_fe_4x_load(&b4, &b[0], &b[1], &b[2], &b[3]);
+
+        secp256k1_fe_4x_store(&r[0], &r[1], &r[2], &r[3], &a4);
+        for (k = 0; k < 4; k++) {
+            CHECK(check_fe_equal(&a[k], &r[k]));
+        }
+        secp256k1_fe_4x_mul(&r4, &a4, &b4);
+        secp256k1_fe_4x_store(&r[0], &r[1], &r[2], &r[3], &r4);
+        for (k = 0; k < 4; k++) {
+            secp256k1_fe_mul(&t, &a[k], &b[k]);
+            CHECK(check_fe_equal(&t, &r[k]));
+        }
+        secp256k1_fe_4x_sqr(&r4, &a4);
+        secp256k1_fe_4x_store(&r[0], &r[1], &r[2], &r[3], &r4);
+        for (k = 0; k < 4; k++) {
+            secp256k1_fe_sqr(&t, &a[k]);
+            CHECK(check_fe_equal(&t, &r[k]));
+        }
+        /* r = 3*(-a) + b */
+        secp256k1_fe_4x_negate(&r4, &a4, 8);
+        secp256k1_fe_4x_mul_int(&r4, 3);
+        secp256k1_fe_4x_add(&r4, &b4);
+        secp256k1_fe_4x_store(&r[0], &r[1], &r[2], &r[3], &r4);
+        for (k = 0; k < 4; k++) {
+            secp256k1_fe_negate(&t, &a[k], 7);
+            secp256k1_fe_mul_int(&t, 3);
+            secp256k1_fe_add(&t, &b[k]);
+            CHECK(check_fe_equal(&t, &r[k]));
+        }
+    }
+}
+#endif
+
 void test_sqrt(const secp256k1_fe *a, const secp256k1_fe *k) {
     secp256k1_fe r1, r2;
     int v = secp256k1_fe_sqrt(&r1, a);
     CHECK((v == 0) == (k == NULL));
+    CHECK(secp256k1_fe_is_quad_var(a) == v);
 
     if (k != NULL) {
         /* Check that the returned root is +/- the given known answer */
@@ -2293,12 +2629,59 @@ void test_add_neg_y_diff_x(void) {
     ge_equals_gej(&res, &sumj);
 }
 
+#ifdef USE_AVX2
+void test_gej_add_ge_var_4x(void) {
+    secp256k1_gej a[4], r[4], expected, tj;
+    secp256k1_gej *rp[4];
+    secp256k1_ge b[4], t;
+    int k;
+    for (k = 0; k < 4; k++) {
+        /* Give the inputs the magnitudes of a previous addition's output */
+        random_group_element_test(&t);
+        random_group_element_jacobian_test(&a[k], &t);
+        random_group_element_test(&t);
+        secp256k1_gej_add_ge_var(&a[k], &a[k], &t, NULL);
+        tj = a[k];
+        secp256k1_ge_set_gej_var(&t, &tj);
+        random_group_element_test(&b[k]);
+        switch (secp256k1_rand_int(8)) {
+        case 0:
+            secp256k1_gej_set_infinity(&a[k]);
+            break;
+        case 1:
+            secp256k1_ge_set_infinity(&b[k]);
+            break;
+        case 2:
+            b[k] = t;
+            break;
+        case 3:
+            secp256k1_ge_neg(&b[k], &t);
+            break;
+        }
+        r[k] = a[k];
+        rp[k] = &r[k];
+    }
+    secp256k1_gej_add_ge_var_4x(rp, b);
+    for (k = 0; k < 4; k++) {
+        secp256k1_gej_add_ge_var(&expected, &a[k], &b[k], NULL);
+        CHECK(gej_xyz_equals_gej(&r[k], &expected));
+    }
+}
+#endif
+
 void run_ge(void) {
     int i;
     for (i = 0; i < count * 32; i++) {
         test_ge();
     }
     test_add_neg_y_diff_x();
+#ifdef USE_AVX2
+    if (secp256k1_cpu_has_avx2()) {
+        for (i = 0; i < count * 32; i++) {
+            test_gej_add_ge_var_4x();
+        }
+    }
+#endif
 }
 
 void test_ec_combine(void) {
@@ -2333,6 +2716,114 @@ void run_ec_combine(void) {
     }
 }
 
+void run_multiexp_tests(void) {
+    static const size_t n_points = 600;
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 100000);
+    unsigned char *scalars = (unsigned char *)checked_malloc(&ctx->error_callback, 32 * n_points);
+    secp256k1_pubkey *points = (secp256k1_pubkey *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_pubkey) * n_points);
+    unsigned char overflow[32];
+    unsigned char g32[32];
+    secp256k1_scalar sum, g;
+    secp256k1_multiexp *multiexp;
+    secp256k1_pubkey expected, result;
+    secp256k1_gej rj;
+    secp256k1_ge r;
+    int ecount = 0;
+    size_t i;
+
+    secp256k1_context_set_illegal_callback(ctx, counting_illegal_callback_fn, &ecount);
+    secp256k1_scalar_clear(&sum);
+    for (i = 0; i < n_points; i++) {
+        secp256k1_scalar k, s;
+        random_scalar_order_test(&k);
+        random_scalar_order_test(&s);
+        secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &rj, &k);
+        secp256k1_ge_set_gej(&r, &rj);
+        secp256k1_pubkey_save(&points[i], &r);
+        secp256k1_scalar_get_b32(&scalars[32 * i], &s);
+        secp256k1_scalar_mul(&k, &k, &s);
+        secp256k1_scalar_add(&sum, &sum, &k);
+    }
+    random_scalar_order_test(&g);
+    secp256k1_scalar_get_b32(g32, &g);
+    secp256k1_scalar_add(&sum, &sum, &g);
+    secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &rj, &sum);
+    secp256k1_ge_set_gej(&r, &rj);
+    secp256k1_pubkey_save(&expected, &r);
+
+    /* Feed the pairs in random chunks, more than fit the scratch space at once */
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(multiexp->acc.capacity < n_points);
+    for (i = 0; i < n_points; ) {
+        size_t n = secp256k1_rand_int(100);
+        if (n > n_points - i) {
+            n = n_points - i;
+        }
+        CHECK(secp256k1_multiexp_add(ctx, multiexp, &scalars[32 * i], &points[i], n));
+        i += n;
+    }
+    CHECK(secp256k1_multiexp_add_generator(ctx, multiexp, g32));
+    CHECK(secp256k1_multiexp_finalize(ctx, multiexp, &result));
+    CHECK(memcmp(&result, &expected, sizeof(result)) == 0);
+
+    /* Cancel the sum out */
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(secp256k1_multiexp_add(ctx, multiexp, scalars, points, n_points));
+    secp256k1_scalar_negate(&sum, &sum);
+    secp256k1_scalar_add(&sum, &sum, &g);
+    secp256k1_scalar_get_b32(g32, &sum);
+    CHECK(secp256k1_multiexp_add_generator(ctx, multiexp, g32));
+    CHECK(secp256k1_multiexp_finalize_is_infinity(ctx, multiexp));
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(secp256k1_multiexp_add(ctx, multiexp, scalars, points, n_points));
+    CHECK(secp256k1_multiexp_add_generator(ctx, multiexp, g32));
+    CHECK(!secp256k1_multiexp_finalize(ctx, multiexp, &result));
+
+    /* Out-of-range scalars make the accumulator fail */
+    memset(overflow, 0xff, sizeof(overflow));
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(!secp256k1_multiexp_add(ctx, multiexp, overflow, points, 1));
+    CHECK(!secp256k1_multiexp_add(ctx, multiexp, scalars, points, 1));
+    CHECK(!secp256k1_multiexp_finalize_is_infinity(ctx, multiexp));
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(!secp256k1_multiexp_add_generator(ctx, multiexp, overflow));
+    CHECK(!secp256k1_multiexp_finalize(ctx, multiexp, &result));
+
+    /* Destroying releases the scratch space */
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(secp256k1_multiexp_add(ctx, multiexp, scalars, points, 10));
+    secp256k1_multiexp_destroy(multiexp);
+    secp256k1_multiexp_destroy(NULL);
+    CHECK(scratch->frame == 0);
+
+    /* Illegal arguments */
+    CHECK(ecount == 0);
+    CHECK(secp256k1_multiexp_create(ctx, NULL) == NULL);
+    CHECK(ecount == 1);
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(secp256k1_multiexp_add(ctx, multiexp, NULL, NULL, 0));
+    CHECK(!secp256k1_multiexp_add(ctx, multiexp, NULL, points, 1));
+    CHECK(ecount == 2);
+    secp256k1_multiexp_destroy(multiexp);
+    multiexp = secp256k1_multiexp_create(ctx, scratch);
+    CHECK(multiexp != NULL);
+    CHECK(!secp256k1_multiexp_finalize(ctx, multiexp, NULL));
+    CHECK(ecount == 3);
+    CHECK(scratch->frame == 0);
+
+    secp256k1_context_set_illegal_callback(ctx, NULL, NULL);
+    secp256k1_scratch_space_destroy(scratch);
+    free(scalars);
+    free(points);
+}
+
 void test_group_decompress(const secp256k1_fe* x) {
     /* The input itself, normalized. */
     secp256k1_fe fex = *x;
@@ -2924,7 +3415,7 @@ void test_ecmult_multi_pippenger_max_points(void) {
     for(; scratch_size < max_size; scratch_size+=256) {
         scratch = secp256k1_scratch_create(&ctx->error_callback, scratch_size);
         CHECK(scratch != NULL);
-        n_points_supported = secp256k1_pippenger_max_points(scratch);
+        n_points_supported = secp256k1_pippenger_max_points(&ctx->ecmult_ctx, secp256k1_scratch_max_allocation(scratch, 0));
         if (n_points_supported == 0) {
             secp256k1_scratch_destroy(scratch);
             continue;
@@ -3002,6 +3493,417 @@ void test_ecmult_multi_batching(void) {
     free(pt);
 }
 
+/**
+ * Compare the affine and Jacobian pippenger variants on points with many
+ * repetitions and negations, so that the affine variant has to defer additions
+ * to later rounds, double buckets and cancel them out.
+ */
+void test_ecmult_multi_pippenger_affine(void) {
+    static const size_t n_points = ECMULT_PIPPENGER_AFFINE_THRESHOLD;
+    secp256k1_scalar scG;
+    secp256k1_scalar *sc = (secp256k1_scalar *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_scalar) * n_points);
+    secp256k1_ge *pt = (secp256k1_ge *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_ge) * n_points);
+    int bucket_window = secp256k1_pippenger_bucket_window(n_points);
+    secp256k1_scratch *scratch = secp256k1_scratch_create(&ctx->error_callback, secp256k1_pippenger_scratch_size(n_points, bucket_window) + PIPPENGER_AFFINE_SCRATCH_OBJECTS*ALIGNMENT);
+    secp256k1_gej r, r2;
+    ecmult_multi_data data;
+    size_t n;
+    size_t i;
+
+    random_scalar_order(&scG);
+    for (i = 0; i < n_points; i++) {
+        if (i < 4 || secp256k1_rand_bits(1)) {
+            random_group_element_test(&pt[i]);
+        } else if (secp256k1_rand_bits(1)) {
+            pt[i] = pt[secp256k1_rand_int(4)];
+        } else {
+            secp256k1_ge_neg(&pt[i], &pt[secp256k1_rand_int(4)]);
+        }
+        if (i > 0 && secp256k1_rand_bits(2) == 0) {
+            sc[i] = sc[i - 1];
+        } else {
+            random_scalar_order(&sc[i]);
+        }
+    }
+    data.sc = sc;
+    data.pt = pt;
+
+    /* The affine buckets don't need more space than the Jacobian ones */
+    CHECK(secp256k1_pippenger_affine_scratch_size(n_points, bucket_window) <= secp256k1_pippenger_scratch_size(n_points, bucket_window));
+    for (n = 1; n < n_points; n = 3*n + 1) {
+        CHECK(secp256k1_ecmult_pippenger_batch_single(&ctx->ecmult_ctx, scratch, &r2, &scG, ecmult_multi_callback, &data, n));
+        CHECK(secp256k1_ecmult_pippenger_affine_batch_single(&ctx->ecmult_ctx, scratch, &r, &scG, ecmult_multi_callback, &data, n));
+        secp256k1_gej_neg(&r2, &r2);
+        secp256k1_gej_add_var(&r, &r, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r));
+    }
+
+    /* ecmult_multi_var selects the affine variant for this many points */
+    CHECK(secp256k1_ecmult_pippenger_batch_single(&ctx->ecmult_ctx, scratch, &r2, &scG, ecmult_multi_callback, &data, n_points));
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &r, &scG, ecmult_multi_callback, &data, n_points));
+    secp256k1_gej_neg(&r2, &r2);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+    CHECK(!secp256k1_ecmult_pippenger_affine_batch_single(&ctx->ecmult_ctx, scratch, &r, &scG, ecmult_multi_false_callback, &data, n_points));
+
+    secp256k1_scratch_destroy(scratch);
+    free(sc);
+    free(pt);
+}
+
+static int ecmult_multi_task_runner_calls;
+
+/* Runs the tasks sequentially in reverse order */
+static int ecmult_multi_task_runner(void (*task)(void *task_data), void * const *task_data, size_t n_tasks, void *data) {
+    size_t i;
+    CHECK(data == &ecmult_multi_task_runner_calls);
+    CHECK(n_tasks >= 2);
+    for (i = n_tasks; i > 0; i--) {
+        task(task_data[i - 1]);
+    }
+    ecmult_multi_task_runner_calls++;
+    return 1;
+}
+
+static int ecmult_multi_false_task_runner(void (*task)(void *task_data), void * const *task_data, size_t n_tasks, void *data) {
+    (void)task;
+    (void)task_data;
+    (void)n_tasks;
+    (void)data;
+    ecmult_multi_task_runner_calls++;
+    return 0;
+}
+
+/**
+ * Compare secp256k1_ecmult_multi_var results of a context with and without a
+ * task runner, for a scratch space that fits all points and for one that
+ * forces several batches.
+ */
+void test_ecmult_multi_parallel(void) {
+    static const size_t n_points = 1100;
+    secp256k1_scalar scG;
+    secp256k1_scalar *sc = (secp256k1_scalar *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_scalar) * n_points);
+    secp256k1_ge *pt = (secp256k1_ge *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_ge) * n_points);
+    secp256k1_context *ctx_par = secp256k1_context_clone(ctx);
+    secp256k1_scratch *scratch;
+    secp256k1_gej r, r2;
+    ecmult_multi_data data;
+    size_t i;
+    int j;
+
+    random_scalar_order(&scG);
+    for (i = 0; i < n_points; i++) {
+        random_group_element_test(&pt[i]);
+        random_scalar_order(&sc[i]);
+    }
+    data.sc = sc;
+    data.pt = pt;
+
+    secp256k1_context_set_task_runner(ctx_par, ecmult_multi_task_runner, 1 + secp256k1_rand_int(8), &ecmult_multi_task_runner_calls);
+    for (j = 0; j < 3; j++) {
+        size_t n = j == 0 ? n_points : ECMULT_PIPPENGER_THRESHOLD + secp256k1_rand_int(n_points - ECMULT_PIPPENGER_THRESHOLD);
+        ecmult_multi_task_runner_calls = 0;
+        scratch = secp256k1_scratch_create(&ctx->error_callback, 819200);
+        CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &r2, &scG, ecmult_multi_callback, &data, n));
+        CHECK(secp256k1_ecmult_multi_var(&ctx_par->ecmult_ctx, scratch, &r, &scG, ecmult_multi_callback, &data, n));
+        CHECK((ecmult_multi_task_runner_calls > 0) == (secp256k1_pippenger_parallel_n_tasks(&ctx_par->ecmult_ctx, n) >= 2));
+        secp256k1_gej_neg(&r2, &r2);
+        secp256k1_gej_add_var(&r, &r, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r));
+        secp256k1_scratch_destroy(scratch);
+
+        /* Scratch space for about a third of the points */
+        scratch = secp256k1_scratch_create(&ctx->error_callback, secp256k1_pippenger_scratch_size(n / 3, secp256k1_pippenger_bucket_window(n / 3)) + PIPPENGER_SCRATCH_OBJECTS*ALIGNMENT);
+        CHECK(secp256k1_ecmult_multi_var(&ctx_par->ecmult_ctx, scratch, &r, &scG, ecmult_multi_callback, &data, n));
+        secp256k1_gej_add_var(&r, &r, &r2, NULL);
+        CHECK(secp256k1_gej_is_infinity(&r));
+        secp256k1_scratch_destroy(scratch);
+    }
+
+    /* A task runner that refuses to run the tasks */
+    secp256k1_context_set_task_runner(ctx_par, ecmult_multi_false_task_runner, 4, NULL);
+    ecmult_multi_task_runner_calls = 0;
+    scratch = secp256k1_scratch_create(&ctx->error_callback, 819200);
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &r2, NULL, ecmult_multi_callback, &data, n_points));
+    CHECK(secp256k1_ecmult_pippenger_batch_parallel_single(&ctx_par->ecmult_ctx, scratch, &r, NULL, ecmult_multi_callback, &data, n_points));
+    CHECK(ecmult_multi_task_runner_calls == 1);
+    secp256k1_gej_neg(&r2, &r2);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+    CHECK(!secp256k1_ecmult_pippenger_batch_parallel_single(&ctx_par->ecmult_ctx, scratch, &r, NULL, ecmult_multi_false_callback, &data, n_points));
+    secp256k1_scratch_destroy(scratch);
+
+    /* Unsetting the task runner */
+    secp256k1_context_set_task_runner(ctx_par, NULL, 4, NULL);
+    CHECK(ctx_par->ecmult_ctx.task_runner.fn == NULL);
+    CHECK(ctx_par->ecmult_ctx.task_runner.n_tasks == 1);
+
+    secp256k1_context_destroy(ctx_par);
+    free(sc);
+    free(pt);
+}
+
+/* Checks that ecmult_multi_var with the given context agrees with the simple algorithm */
+void test_ecmult_multi_tuned(const secp256k1_context *tctx, secp256k1_scratch *scratch, size_t n_points) {
+    secp256k1_scalar scG;
+    secp256k1_scalar *sc = (secp256k1_scalar *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_scalar) * n_points);
+    secp256k1_ge *pt = (secp256k1_ge *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_ge) * n_points);
+    secp256k1_gej r, r2;
+    ecmult_multi_data data;
+    size_t i;
+
+    random_scalar_order(&scG);
+    for (i = 0; i < n_points; i++) {
+        random_group_element_test(&pt[i]);
+        random_scalar_order(&sc[i]);
+    }
+    data.sc = sc;
+    data.pt = pt;
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, NULL, &r2, &scG, ecmult_multi_callback, &data, n_points));
+    CHECK(secp256k1_ecmult_multi_var(&tctx->ecmult_ctx, scratch, &r, &scG, ecmult_multi_callback, &data, n_points));
+    secp256k1_gej_neg(&r2, &r2);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+    free(sc);
+    free(pt);
+}
+
+void test_ecmult_tuning(void) {
+    secp256k1_context *tctx = secp256k1_context_clone(ctx);
+    secp256k1_context *sctx;
+    secp256k1_scratch *scratch = secp256k1_scratch_create(&ctx->error_callback, 819200);
+    secp256k1_ecmult_tuning tuning;
+    unsigned char ser[SECP256K1_CONTEXT_TUNING_SIZE + 1];
+    unsigned char ser2[SECP256K1_CONTEXT_TUNING_SIZE];
+    size_t serlen = sizeof(ser);
+    size_t n;
+    int ecount = 0;
+    int i;
+
+    CHECK(SECP256K1_ECMULT_TUNING_SERIALIZED_SIZE == SECP256K1_CONTEXT_TUNING_SIZE);
+    secp256k1_context_set_illegal_callback(tctx, counting_illegal_callback_fn, &ecount);
+
+    /* The default tuning chooses the same windows as the built-in tables */
+    for (n = 1; n < 100000; n += n / 8 + 1) {
+        CHECK(secp256k1_pippenger_tuned_bucket_window(&tctx->ecmult_ctx.tuning, n) == secp256k1_pippenger_bucket_window(n));
+    }
+    CHECK(secp256k1_pippenger_tuned_bucket_window(&tctx->ecmult_ctx.tuning, SIZE_MAX) == PIPPENGER_MAX_BUCKET_WINDOW);
+
+    /* Serialization round trip */
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser, &serlen) == 1);
+    CHECK(serlen == SECP256K1_CONTEXT_TUNING_SIZE);
+    serlen--;
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser2, &serlen) == 0);
+    serlen = sizeof(ser2);
+    CHECK(secp256k1_context_serialize_tuning(tctx, NULL, &serlen) == 0);
+    CHECK(ecount == 1);
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser2, NULL) == 0);
+    CHECK(ecount == 2);
+    CHECK(secp256k1_context_parse_tuning(tctx, NULL, SECP256K1_CONTEXT_TUNING_SIZE) == 0);
+    CHECK(ecount == 3);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser, SECP256K1_CONTEXT_TUNING_SIZE) == 1);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser, SECP256K1_CONTEXT_TUNING_SIZE + 1) == 0);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser, SECP256K1_CONTEXT_TUNING_SIZE - 1) == 0);
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser2, &serlen) == 1);
+    CHECK(memcmp(ser, ser2, sizeof(ser2)) == 0);
+
+    /* Malformed input is rejected and leaves the context unchanged */
+    for (i = 0; i < 16; i++) {
+        memcpy(ser2, ser, sizeof(ser2));
+        ser2[i] ^= 1 << secp256k1_rand_int(8);
+        CHECK(secp256k1_context_parse_tuning(tctx, ser2, sizeof(ser2)) == 0);
+    }
+    tuning = tctx->ecmult_ctx.tuning;
+    tuning.bucket_window_max_points[3] = tuning.bucket_window_max_points[4] + 1;
+    secp256k1_ecmult_tuning_serialize(ser2, &tuning);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser2, sizeof(ser2)) == 0);
+    tuning = tctx->ecmult_ctx.tuning;
+    tuning.bucket_window_max_points[PIPPENGER_MAX_BUCKET_WINDOW - 1] = 100000;
+    secp256k1_ecmult_tuning_serialize(ser2, &tuning);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser2, sizeof(ser2)) == 0);
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser2, &serlen) == 1);
+    CHECK(memcmp(ser, ser2, sizeof(ser2)) == 0);
+
+    /* Any valid tuning gives correct results */
+    tuning.pippenger_threshold = 1 + secp256k1_rand_int(64);
+    tuning.pippenger_affine_threshold = 1 + secp256k1_rand_int(64);
+    for (i = 0; i < PIPPENGER_MAX_BUCKET_WINDOW - 1; i++) {
+        tuning.bucket_window_max_points[i] = i == 0 ? secp256k1_rand_int(16) : tuning.bucket_window_max_points[i - 1] + secp256k1_rand_int(16);
+    }
+    tuning.bucket_window_max_points[PIPPENGER_MAX_BUCKET_WINDOW - 1] = SIZE_MAX;
+    secp256k1_ecmult_tuning_serialize(ser2, &tuning);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser2, sizeof(ser2)) == 1);
+    test_ecmult_multi_tuned(tctx, scratch, 1 + secp256k1_rand_int(200));
+
+    /* Calibration */
+    CHECK(secp256k1_context_calibrate(tctx, NULL, 100) == 0);
+    CHECK(ecount == 4);
+    sctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+    secp256k1_context_set_illegal_callback(sctx, counting_illegal_callback_fn, &ecount);
+    CHECK(secp256k1_context_calibrate(sctx, scratch, 100) == 0);
+    CHECK(ecount == 5);
+    secp256k1_context_destroy(sctx);
+    secp256k1_scratch_destroy(scratch);
+    scratch = secp256k1_scratch_create(&ctx->error_callback, 0);
+    CHECK(secp256k1_context_calibrate(tctx, scratch, 100) == 0);
+    secp256k1_scratch_destroy(scratch);
+    scratch = secp256k1_scratch_create(&ctx->error_callback, 819200);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser, sizeof(ser2)) == 1);
+    CHECK(secp256k1_context_calibrate(tctx, scratch, 300) == 1);
+    /* Parameters for more points than were measured are unchanged */
+    CHECK(tctx->ecmult_ctx.tuning.pippenger_affine_threshold == ECMULT_PIPPENGER_AFFINE_THRESHOLD);
+    CHECK(tctx->ecmult_ctx.tuning.bucket_window_max_points[PIPPENGER_MAX_BUCKET_WINDOW - 2] == secp256k1_pippenger_bucket_window_inv(PIPPENGER_MAX_BUCKET_WINDOW - 1));
+    CHECK(secp256k1_context_serialize_tuning(tctx, ser2, &serlen) == 1);
+    CHECK(secp256k1_context_parse_tuning(tctx, ser2, sizeof(ser2)) == 1);
+    test_ecmult_multi_tuned(tctx, scratch, 1 + secp256k1_rand_int(400));
+
+    secp256k1_scratch_destroy(scratch);
+    secp256k1_context_destroy(tctx);
+}
+
+/**
+ * Check that secp256k1_ecmult_multi_scratch_size is the smallest budget that
+ * fits all points in a single batch, and that it suffices in practice.
+ */
+void test_ecmult_multi_scratch_size(void) {
+    secp256k1_context *ctx_par = secp256k1_context_clone(ctx);
+    const size_t sizes[] = {1, 2, ECMULT_PIPPENGER_THRESHOLD - 1, ECMULT_PIPPENGER_THRESHOLD, 1100, ECMULT_PIPPENGER_AFFINE_THRESHOLD};
+    int i, j;
+
+    secp256k1_context_set_task_runner(ctx_par, ecmult_multi_task_runner, 2 + secp256k1_rand_int(7), &ecmult_multi_task_runner_calls);
+    CHECK(secp256k1_ecmult_multi_scratch_size(&ctx->ecmult_ctx, 0) == 0);
+    for (i = 0; i < 2; i++) {
+        const secp256k1_context *tctx = i == 0 ? ctx : ctx_par;
+        for (j = 0; j < (int)(sizeof(sizes) / sizeof(sizes[0])) + 1; j++) {
+            size_t n = j < (int)(sizeof(sizes) / sizeof(sizes[0])) ? sizes[j] : 1 + secp256k1_rand_int(3000);
+            size_t size = secp256k1_ecmult_multi_scratch_size(&tctx->ecmult_ctx, n);
+            secp256k1_ecmult_multi_batch_func f;
+            size_t n_batches, n_batch_points;
+            secp256k1_scratch *scratch;
+
+            CHECK(secp256k1_ecmult_multi_plan(&tctx->ecmult_ctx, size, n, &f, &n_batches, &n_batch_points));
+            CHECK(n_batches == 1);
+            CHECK(!secp256k1_ecmult_multi_plan(&tctx->ecmult_ctx, size - 1, n, &f, &n_batches, &n_batch_points) || n_batches > 1);
+
+            scratch = secp256k1_scratch_create(&ctx->error_callback, size);
+            test_ecmult_multi_tuned(tctx, scratch, n);
+            CHECK(secp256k1_scratch_space_high_water_mark(scratch) <= size);
+            secp256k1_scratch_destroy(scratch);
+        }
+    }
+    secp256k1_context_destroy(ctx_par);
+}
+
+/**
+ * Compare the array entry point with the callback one.
+ */
+void test_ecmult_multi_array(secp256k1_scratch *scratch) {
+    static const size_t n_points = 200;
+    const size_t n = secp256k1_rand_int(n_points + 1);
+    secp256k1_scalar scG;
+    secp256k1_scalar sc[200];
+    secp256k1_ge pt[200];
+    secp256k1_gej r, r2;
+    ecmult_multi_data data;
+    size_t i;
+
+    random_scalar_order(&scG);
+    for (i = 0; i < n; i++) {
+        random_group_element_test(&pt[i]);
+        random_scalar_order(&sc[i]);
+    }
+    data.sc = sc;
+    data.pt = pt;
+
+    CHECK(secp256k1_ecmult_multi_var_array(&ctx->ecmult_ctx, scratch, &r, &scG, sc, pt, n));
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &r2, &scG, ecmult_multi_callback, &data, n));
+    secp256k1_gej_neg(&r2, &r2);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+
+    CHECK(secp256k1_ecmult_multi_var_array(&ctx->ecmult_ctx, scratch, &r, NULL, sc, pt, n));
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, scratch, &r2, NULL, ecmult_multi_callback, &data, n));
+    secp256k1_gej_neg(&r2, &r2);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+}
+
+/**
+ * Feed pairs to an accumulator whose scratch space only fits part of them and
+ * compare with the simple algorithm.
+ */
+void test_ecmult_multi_accumulator(void) {
+    static const size_t n_points = 1000;
+    const size_t entry_size = sizeof(secp256k1_scalar) + sizeof(secp256k1_ge);
+    const size_t capacity = 50 + secp256k1_rand_int(300);
+    secp256k1_scalar scG, szero;
+    secp256k1_scalar *sc = (secp256k1_scalar *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_scalar) * n_points);
+    secp256k1_ge *pt = (secp256k1_ge *)checked_malloc(&ctx->error_callback, sizeof(secp256k1_ge) * n_points);
+    secp256k1_ecmult_multi_accumulator acc;
+    secp256k1_scratch *scratch;
+    secp256k1_gej r, r2;
+    ecmult_multi_data data;
+    size_t i;
+
+    random_scalar_order(&scG);
+    for (i = 0; i < n_points; i++) {
+        random_group_element_test(&pt[i]);
+        random_scalar_order(&sc[i]);
+    }
+    data.sc = sc;
+    data.pt = pt;
+    CHECK(secp256k1_ecmult_multi_var(&ctx->ecmult_ctx, NULL, &r2, &scG, ecmult_multi_callback, &data, n_points));
+    secp256k1_gej_neg(&r2, &r2);
+
+    /* Too small a scratch space */
+    scratch = secp256k1_scratch_create(&ctx->error_callback, entry_size + 2 * ALIGNMENT);
+    CHECK(!secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, SIZE_MAX));
+    secp256k1_scratch_destroy(scratch);
+
+    scratch = secp256k1_scratch_create(&ctx->error_callback, secp256k1_ecmult_multi_accumulator_scratch_size(&ctx->ecmult_ctx, capacity));
+    CHECK(secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, capacity));
+    CHECK(acc.capacity == capacity);
+    for (i = 0; i < n_points; i++) {
+        CHECK(secp256k1_ecmult_multi_accumulator_add(&acc, &sc[i], &pt[i]));
+        if (i == n_points / 2) {
+            secp256k1_ecmult_multi_accumulator_add_g(&acc, &scG);
+        }
+    }
+    CHECK(secp256k1_ecmult_multi_accumulator_finalize(&acc, &r));
+    CHECK(scratch->frame == 0);
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+
+    /* Nothing added */
+    CHECK(secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, SIZE_MAX));
+    CHECK(secp256k1_ecmult_multi_accumulator_finalize(&acc, &r));
+    CHECK(secp256k1_gej_is_infinity(&r));
+
+    /* Discarding an accumulator releases its frame */
+    CHECK(secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, SIZE_MAX));
+    secp256k1_scalar_set_int(&szero, 0);
+    CHECK(secp256k1_ecmult_multi_accumulator_add(&acc, &szero, &pt[0]));
+    secp256k1_ecmult_multi_accumulator_clear(&acc);
+    CHECK(scratch->frame == 0);
+    secp256k1_scratch_destroy(scratch);
+
+    /* Bounded by max_n, all pairs fit the advertised scratch space size */
+    scratch = secp256k1_scratch_create(&ctx->error_callback, secp256k1_ecmult_multi_accumulator_scratch_size(&ctx->ecmult_ctx, n_points));
+    CHECK(secp256k1_ecmult_multi_accumulator_init(&acc, &ctx->ecmult_ctx, scratch, n_points));
+    CHECK(acc.capacity == n_points);
+    for (i = 0; i < n_points; i++) {
+        CHECK(secp256k1_ecmult_multi_accumulator_add(&acc, &sc[i], &pt[i]));
+    }
+    secp256k1_ecmult_multi_accumulator_add_g(&acc, &scG);
+    CHECK(secp256k1_ecmult_multi_accumulator_finalize(&acc, &r));
+    secp256k1_gej_add_var(&r, &r, &r2, NULL);
+    CHECK(secp256k1_gej_is_infinity(&r));
+    secp256k1_scratch_destroy(scratch);
+
+    free(sc);
+    free(pt);
+}
+
 void run_ecmult_multi_tests(void) {
     secp256k1_scratch *scratch;
 
@@ -3011,7 +3913,10 @@ void run_ecmult_multi_tests(void) {
     test_ecmult_multi(scratch, secp256k1_ecmult_multi_var);
     test_ecmult_multi(NULL, secp256k1_ecmult_multi_var);
     test_ecmult_multi(scratch, secp256k1_ecmult_pippenger_batch_single);
+    test_ecmult_multi(scratch, secp256k1_ecmult_pippenger_affine_batch_single);
     test_ecmult_multi(scratch, secp256k1_ecmult_strauss_batch_single);
+    test_ecmult_multi_array(scratch);
+    test_ecmult_multi_array(NULL);
     secp256k1_scratch_destroy(scratch);
 
     /* Run test_ecmult_multi with space for exactly one point */
@@ -3020,6 +3925,11 @@ void run_ecmult_multi_tests(void) {
     secp256k1_scratch_destroy(scratch);
 
     test_ecmult_multi_batching();
+    test_ecmult_multi_pippenger_affine();
+    test_ecmult_multi_parallel();
+    test_ecmult_tuning();
+    test_ecmult_multi_scratch_size();
+    test_ecmult_multi_accumulator();
 }
 
 void test_wnaf(const secp256k1_scalar *number, int w) {
@@ -3276,8 +4186,37 @@ void test_ecmult_constants(void) {
     }
 }
 
+void test_ecmult_pre_g_table(void) {
+    /* Test the odd multiples of G (and 2^128*G) in the ecmult context, which may be
+     * a static table, against ecmult_gen(). Check both ends and some random entries. */
+    secp256k1_scalar x;
+    secp256k1_gej r;
+    secp256k1_ge pre;
+    int i;
+    for (i = 0; i < 16; i++) {
+        int idx = i < 4 ? i : i < 8 ? ECMULT_TABLE_SIZE(WINDOW_G) - 8 + i : (int)secp256k1_rand_int(ECMULT_TABLE_SIZE(WINDOW_G));
+        secp256k1_scalar_set_int(&x, 2 * idx + 1);
+        secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &r, &x);
+        secp256k1_ge_from_storage(&pre, &(*ctx->ecmult_ctx.pre_g)[idx]);
+        ge_equals_gej(&pre, &r);
+#ifdef USE_ENDOMORPHISM
+        {
+            secp256k1_scalar shift;
+            unsigned char shift32[32] = { 0 };
+            shift32[15] = 1;
+            secp256k1_scalar_set_b32(&shift, shift32, NULL);
+            secp256k1_scalar_mul(&x, &x, &shift);
+            secp256k1_ecmult_gen(&ctx->ecmult_gen_ctx, &r, &x);
+            secp256k1_ge_from_storage(&pre, &(*ctx->ecmult_ctx.pre_g_128)[idx]);
+            ge_equals_gej(&pre, &r);
+        }
+#endif
+    }
+}
+
 void run_ecmult_constants(void) {
     test_ecmult_constants();
+    test_ecmult_pre_g_table();
 }
 
 void test_ecmult_gen_blind(void) {
@@ -4353,6 +5292,50 @@ void run_ecdsa_end_to_end(void) {
     }
 }
 
+void test_ecdsa_sign_with_key(void) {
+    unsigned char seckey[32];
+    unsigned char msg[32];
+    unsigned char ndata[32];
+    secp256k1_scalar key;
+    secp256k1_ecdsa_signature sig1, sig2;
+    secp256k1_signing_key *skey;
+
+    random_scalar_order_test(&key);
+    secp256k1_scalar_get_b32(seckey, &key);
+    secp256k1_rand256_test(msg);
+    secp256k1_rand256_test(ndata);
+    skey = secp256k1_signing_key_create(ctx, seckey);
+    CHECK(skey != NULL);
+
+    CHECK(secp256k1_ecdsa_sign(ctx, &sig1, msg, seckey, NULL, NULL) == 1);
+    CHECK(secp256k1_ecdsa_sign_with_key(ctx, &sig2, msg, skey, NULL, NULL) == 1);
+    CHECK(memcmp(&sig1, &sig2, sizeof(sig1)) == 0);
+    CHECK(secp256k1_ecdsa_sign(ctx, &sig1, msg, seckey, secp256k1_nonce_function_rfc6979, ndata) == 1);
+    CHECK(secp256k1_ecdsa_sign_with_key(ctx, &sig2, msg, skey, secp256k1_nonce_function_rfc6979, ndata) == 1);
+    CHECK(memcmp(&sig1, &sig2, sizeof(sig1)) == 0);
+    /* Other nonce functions are called with the secret key. */
+    CHECK(secp256k1_ecdsa_sign(ctx, &sig1, msg, seckey, nonce_function_test_retry, NULL) == 1);
+    CHECK(secp256k1_ecdsa_sign_with_key(ctx, &sig2, msg, skey, nonce_function_test_retry, NULL) == 1);
+    CHECK(memcmp(&sig1, &sig2, sizeof(sig1)) == 0);
+    CHECK(secp256k1_ecdsa_sign_with_key(ctx, &sig2, msg, skey, nonce_function_test_fail, NULL) == 0);
+    CHECK(is_empty_signature(&sig2));
+    secp256k1_signing_key_destroy(skey);
+
+    /* Invalid secret keys are rejected. */
+    memset(seckey, 0, 32);
+    CHECK(secp256k1_signing_key_create(ctx, seckey) == NULL);
+    memset(seckey, 0xFF, 32);
+    CHECK(secp256k1_signing_key_create(ctx, seckey) == NULL);
+    secp256k1_signing_key_destroy(NULL);
+}
+
+void run_ecdsa_sign_with_key(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_sign_with_key();
+    }
+}
+
 int test_ecdsa_der_parse(const unsigned char *sig, size_t siglen, int certainly_der, int certainly_not_der) {
     static const unsigned char zeroes[32] = {0};
 #ifdef ENABLE_OPENSSL_TESTS
@@ -5211,6 +6194,7 @@ int main(int argc, char **argv) {
     run_util_tests();
 
     run_sha256_tests();
+    run_sha256_multi_tests();
     run_hmac_sha256_tests();
     run_rfc6979_hmac_sha256_tests();
 
@@ -5226,10 +6210,14 @@ int main(int argc, char **argv) {
     run_field_inv();
     run_field_inv_var();
     run_field_inv_all_var();
+    run_inverse_tests();
     run_field_misc();
     run_field_convert();
     run_sqr();
     run_sqrt();
+#ifdef USE_AVX2
+    run_field_4x();
+#endif
 
     /* group tests */
     run_ge();
@@ -5244,6 +6232,7 @@ int main(int argc, char **argv) {
     run_ecmult_const_tests();
     run_ecmult_multi_tests();
     run_ec_combine();
+    run_multiexp_tests();
 
     /* endomorphism tests */
 #ifdef USE_ENDOMORPHISM
@@ -5271,6 +6260,7 @@ int main(int argc, char **argv) {
     run_ecdsa_der_parse();
     run_ecdsa_sign_verify();
     run_ecdsa_end_to_end();
+    run_ecdsa_sign_with_key();
     run_ecdsa_edge_cases();
 #ifdef ENABLE_OPENSSL_TESTS
     run_ecdsa_openssl();
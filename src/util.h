@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 typedef struct {
     void (*fn)(const char *text, void* data);
@@ -42,6 +43,13 @@ static SECP256K1_INLINE void secp256k1_callback_call(const secp256k1_callback *
 #define EXPECT(x,c) (x)
 #endif
 
+/* Hint that the memory at p will be read soon. */
+#if defined(__GNUC__)
+#define PREFETCH(p) __builtin_prefetch((p))
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
+
 #ifdef DETERMINISTIC
 #define CHECK(cond) do { \
     if (EXPECT(!(cond), 0)) { \
@@ -84,6 +92,64 @@ static SECP256K1_INLINE void *checked_realloc(const secp256k1_callback* cb, void
     return ret;
 }
 
+/* Precomputed tables are immutable once built, so cloned contexts share them through a
+ * reference count stored in front of the table. Without atomic operations to maintain the
+ * count from several threads, every clone gets its own copy instead. */
+#if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL)
+#define SECP256K1_SHARED_TABLES 1
+#endif
+
+typedef union {
+    size_t refcount;
+    /* Keep the table that follows aligned for the types it may contain */
+    uint64_t align64;
+    void *alignp;
+} secp256k1_shared_header;
+
+/** Allocates a table of `size` bytes with a reference count of 1 */
+static SECP256K1_INLINE void *secp256k1_shared_malloc(const secp256k1_callback* cb, size_t size) {
+    secp256k1_shared_header *ret = (secp256k1_shared_header *)checked_malloc(cb, sizeof(*ret) + size);
+    if (ret == NULL) {
+        return NULL;
+    }
+    ret->refcount = 1;
+    return ret + 1;
+}
+
+/** Returns a reference to a table allocated with secp256k1_shared_malloc, which is either
+ *  the table itself or a copy of it */
+static SECP256K1_INLINE void *secp256k1_shared_clone(const secp256k1_callback* cb, const void *table, size_t size) {
+#ifdef SECP256K1_SHARED_TABLES
+    secp256k1_shared_header *header = (secp256k1_shared_header *)table - 1;
+    (void)cb;
+    (void)size;
+    __atomic_add_fetch(&header->refcount, 1, __ATOMIC_RELAXED);
+    return (void *)table;
+#else
+    void *ret = secp256k1_shared_malloc(cb, size);
+    if (ret != NULL) {
+        memcpy(ret, table, size);
+    }
+    return ret;
+#endif
+}
+
+/** Drops a reference to a table allocated with secp256k1_shared_malloc, freeing it once the
+ *  last reference is gone. Does nothing if table is NULL. */
+static SECP256K1_INLINE void secp256k1_shared_free(void *table) {
+    secp256k1_shared_header *header;
+    if (table == NULL) {
+        return;
+    }
+    header = (secp256k1_shared_header *)table - 1;
+#ifdef SECP256K1_SHARED_TABLES
+    if (__atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+#endif
+    free(header);
+}
+
 /* Extract the sign of an int64, take the abs and return a uint64, constant time. */
 SECP256K1_INLINE static int secp256k1_sign_and_abs64(uint64_t *out, int64_t in) {
     uint64_t mask0, mask1;
@@ -110,6 +176,41 @@ SECP256K1_INLINE static int secp256k1_clz64_var(uint64_t x) {
     return ret;
 }
 
+/* Count the trailing zero bits of a nonzero x, using a de Bruijn sequence
+ * lookup where no builtin is available. */
+SECP256K1_INLINE static int secp256k1_ctz32_var(uint32_t x) {
+    VERIFY_CHECK(x != 0);
+#if defined(HAVE_BUILTIN_CTZ)
+    if (((unsigned int)UINT32_MAX) == UINT32_MAX) {
+        return __builtin_ctz(x);
+    }
+#endif
+    {
+        static const uint8_t debruijn[32] = {
+            0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+            31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+        };
+        return debruijn[((x & -x) * 0x077CB531U) >> 27];
+    }
+}
+
+SECP256K1_INLINE static int secp256k1_ctz64_var(uint64_t x) {
+    VERIFY_CHECK(x != 0);
+#if defined(HAVE_BUILTIN_CTZLL)
+    return __builtin_ctzll(x);
+#else
+    {
+        static const uint8_t debruijn[64] = {
+            0, 1, 2, 53, 3, 7, 54, 27, 4, 38, 41, 8, 34, 55, 48, 28,
+            62, 5, 39, 46, 44, 42, 22, 9, 24, 35, 59, 56, 49, 18, 29, 11,
+            63, 52, 6, 26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+            51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12
+        };
+        return debruijn[((x & -x) * 0x022FDD63CC95386DULL) >> 58];
+    }
+#endif
+}
+
 /* Macro for restrict, when available and not in a VERIFY build. */
 #if defined(SECP256K1_BUILD) && defined(VERIFY)
 # define SECP256K1_RESTRICT
@@ -142,6 +243,7 @@ SECP256K1_INLINE static int secp256k1_clz64_var(uint64_t x) {
 #  define SECP256K1_GNUC_EXT
 # endif
 SECP256K1_GNUC_EXT typedef unsigned __int128 uint128_t;
+SECP256K1_GNUC_EXT typedef __int128 int128_t;
 #endif
 
 #endif /* SECP256K1_UTIL_H */